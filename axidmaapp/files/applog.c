@@ -0,0 +1,393 @@
+/**
+ * @file applog.c
+ * @date Saturday, October 17, 2026 at 05:34:02 PM EDT
+ *
+ * This file contains the implementation of the application's log.
+ *
+ * The ring is a bounded multi-producer queue. Each slot holds a sequence
+ * number, which tells a producer whether the slot is free for its position,
+ * and tells the consumer whether the record in it is complete. Producers
+ * claim positions by advancing the tail, so they never wait on each other
+ * or on the background thread. The background thread is the only consumer,
+ * and it sleeps briefly whenever the ring is empty, so producers never need
+ * to wake it.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdarg.h>             // Variable argument lists
+#include <string.h>             // Memcpy function
+#include <errno.h>              // Error codes
+#include <time.h>               // Clock and sleep functions
+#include <pthread.h>            // Thread functions
+
+#include "applog.h"             // Local definitions
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The time the background thread sleeps when the ring is empty
+#define APPLOG_IDLE_NS          10000000
+
+// The number of bytes printed on each line of a dump
+#define DUMP_LINE_BYTES         16
+
+// The types of records in the log
+enum record_type {
+    RECORD_MESSAGE,             // A formatted message
+    RECORD_PACKET,              // A received packet
+};
+
+// A record in the log, copied in by a producer and formatted later
+struct log_record {
+    uint64_t timestamp;         // Time it was logged, in CLOCK_MONOTONIC ns
+    enum record_type type;      // What the record holds
+    uint32_t length;            // The length of the message or packet
+    uint32_t packet_num;        // The number of the packet since start
+    bool error;                 // The packet was received with an error
+    uint16_t payload_size;      // The number of bytes in the payload
+    unsigned char payload[APPLOG_PAYLOAD_SIZE];     // Message or packet bytes
+};
+
+// A slot in the ring, with the sequence number that hands it over
+struct log_slot {
+    unsigned int seq;           // Position of the slot's record, plus 1 if full
+    struct log_record record;   // The record in the slot
+};
+
+// The state of the log
+struct applog {
+    bool started;               // Indicates the log is accepting records
+    int stopping;               // Tells the background thread to exit
+    FILE *stream;               // The stream the records are written to
+    struct applog_config config;    // The parameters of the log
+    struct log_slot *slots;     // The slots of the ring
+    unsigned int mask;          // The number of slots minus 1
+    unsigned int head;          // The next position to write out
+    unsigned int tail;          // The next position to claim
+    int dumps;                  // Indicates packets' contents are dumped
+    unsigned int packet_num;    // The number of packets logged
+    unsigned int rate_window;   // The second that the rate limit counts in
+    unsigned int rate_count;    // The records logged in the rate's second
+    struct applog_stats stats;  // The counters of the log
+    pthread_t thread;           // The background thread
+};
+
+// The log for the application
+static struct applog applog;
+
+/*----------------------------------------------------------------------------
+ * Private Helper Functions
+ *----------------------------------------------------------------------------*/
+
+// Gets the current time in nanoseconds, from the monotonic clock
+static uint64_t get_time_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* Checks the record against the rate limit, counting it in the current second.
+ * The counting is approximate when the second rolls over, which is enough to
+ * keep the console from being flooded. */
+static bool rate_limited(uint64_t now)
+{
+    unsigned int second, window;
+
+    if (applog.config.rate_limit <= 0) {
+        return false;
+    }
+
+    second = now / 1000000000;
+    window = __atomic_load_n(&applog.rate_window, __ATOMIC_RELAXED);
+    if (second != window &&
+        __atomic_compare_exchange_n(&applog.rate_window, &window, second,
+                false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&applog.rate_count, 0, __ATOMIC_RELAXED);
+    }
+
+    if (__atomic_fetch_add(&applog.rate_count, 1, __ATOMIC_RELAXED) >=
+            (unsigned int)applog.config.rate_limit) {
+        __atomic_add_fetch(&applog.stats.suppressed, 1, __ATOMIC_RELAXED);
+        return true;
+    }
+    return false;
+}
+
+/* Claims a slot in the ring for a new record, returning NULL if the ring is
+ * full. The record is handed to the consumer with #commit_record. */
+static struct log_slot *claim_slot(unsigned int *position)
+{
+    int diff;
+    unsigned int pos, seq;
+    struct log_slot *slot;
+
+    pos = __atomic_load_n(&applog.tail, __ATOMIC_RELAXED);
+    while (true)
+    {
+        slot = &applog.slots[pos & applog.mask];
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        diff = (int)(seq - pos);
+
+        // The slot is free for this position, so try to claim it
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&applog.tail, &pos, pos + 1,
+                    true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *position = pos;
+                return slot;
+            }
+        // The slot still holds the record from a lap ago, so the ring is full
+        } else if (diff < 0) {
+            __atomic_add_fetch(&applog.stats.overruns, 1, __ATOMIC_RELAXED);
+            return NULL;
+        // Another producer claimed the position, so move on to the next one
+        } else {
+            pos = __atomic_load_n(&applog.tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// Hands the filled record to the consumer
+static void commit_record(struct log_slot *slot, unsigned int position)
+{
+    __atomic_store_n(&slot->seq, position + 1, __ATOMIC_RELEASE);
+    return;
+}
+
+// Prints a formatted record to the log's stream
+static void print_record(const struct log_record *record)
+{
+    int i;
+    double timestamp;
+
+    timestamp = record->timestamp / 1e9;
+    if (record->type == RECORD_MESSAGE) {
+        fprintf(applog.stream, "[%12.6f] %.*s\n", timestamp,
+                (int)record->payload_size, (const char *)record->payload);
+        return;
+    }
+
+    fprintf(applog.stream, "[%12.6f] packet %u: %u bytes%s\n", timestamp,
+            record->packet_num, record->length,
+            (record->error) ? " (error)" : "");
+    for (i = 0; i < record->payload_size; i++)
+    {
+        fprintf(applog.stream, "0x%02x%c", record->payload[i],
+                ((i + 1) % DUMP_LINE_BYTES == 0 ||
+                 i + 1 == record->payload_size) ? '\n' : ' ');
+    }
+    return;
+}
+
+/* Writes out every complete record in the ring, returning the number written.
+ * Any records dropped since the last call are reported as well. */
+static int drain_records(uint64_t *last_dropped)
+{
+    int num_records;
+    uint64_t dropped;
+    struct log_slot *slot;
+
+    num_records = 0;
+    while (true)
+    {
+        slot = &applog.slots[applog.head & applog.mask];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != applog.head + 1) {
+            break;
+        }
+
+        print_record(&slot->record);
+        __atomic_store_n(&slot->seq, applog.head + applog.mask + 1,
+                         __ATOMIC_RELEASE);
+        applog.head += 1;
+        num_records += 1;
+    }
+
+    dropped = __atomic_load_n(&applog.stats.overruns, __ATOMIC_RELAXED) +
+              __atomic_load_n(&applog.stats.suppressed, __ATOMIC_RELAXED);
+    if (dropped != *last_dropped) {
+        fprintf(applog.stream, "[log] %llu records dropped\n",
+                (unsigned long long)(dropped - *last_dropped));
+        *last_dropped = dropped;
+    }
+
+    if (num_records > 0) {
+        __atomic_add_fetch(&applog.stats.logged, num_records,
+                           __ATOMIC_RELAXED);
+        fflush(applog.stream);
+    }
+    return num_records;
+}
+
+// Formats the records as they are logged, until the log is stopped
+static void *applog_thread(void *arg)
+{
+    uint64_t last_dropped;
+    struct timespec idle;
+
+    (void)arg;
+    last_dropped = 0;
+    idle.tv_sec = 0;
+    idle.tv_nsec = APPLOG_IDLE_NS;
+    while (!__atomic_load_n(&applog.stopping, __ATOMIC_ACQUIRE))
+    {
+        if (drain_records(&last_dropped) == 0) {
+            nanosleep(&idle, NULL);
+        }
+    }
+
+    // Write out whatever was logged before the log was stopped
+    drain_records(&last_dropped);
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ * Public Interface
+ *----------------------------------------------------------------------------*/
+
+/* Allocates the ring, with each slot free for its position in the first lap,
+ * and starts the background thread. */
+int applog_start(FILE *stream, const struct applog_config *config)
+{
+    int rc;
+    unsigned int i, num_slots;
+
+    if (config->num_records <= 0 || config->dump_sample <= 0) {
+        return -EINVAL;
+    }
+
+    for (num_slots = 1; num_slots < (unsigned int)config->num_records;
+         num_slots *= 2);
+    applog.slots = calloc(num_slots, sizeof(applog.slots[0]));
+    if (applog.slots == NULL) {
+        return -ENOMEM;
+    }
+    for (i = 0; i < num_slots; i++)
+    {
+        applog.slots[i].seq = i;
+    }
+
+    applog.stream = stream;
+    applog.config = *config;
+    applog.mask = num_slots - 1;
+    applog.head = 0;
+    applog.tail = 0;
+    applog.dumps = config->dumps;
+    applog.stopping = false;
+
+    rc = pthread_create(&applog.thread, NULL, applog_thread, NULL);
+    if (rc != 0) {
+        free(applog.slots);
+        return -rc;
+    }
+
+    __atomic_store_n(&applog.started, true, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Stops accepting records, and waits for the thread to write out the rest
+void applog_stop()
+{
+    if (!applog.started) {
+        return;
+    }
+
+    __atomic_store_n(&applog.started, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&applog.stopping, true, __ATOMIC_RELEASE);
+    pthread_join(applog.thread, NULL);
+    free(applog.slots);
+    return;
+}
+
+// Formats the message straight into a record
+void applog_message(const char *format, ...)
+{
+    int length;
+    uint64_t now;
+    va_list args;
+    unsigned int position;
+    struct log_slot *slot;
+
+    if (!__atomic_load_n(&applog.started, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    now = get_time_ns();
+    if (rate_limited(now) || (slot = claim_slot(&position)) == NULL) {
+        return;
+    }
+
+    va_start(args, format);
+    length = vsnprintf((char *)slot->record.payload, APPLOG_PAYLOAD_SIZE,
+                       format, args);
+    va_end(args);
+
+    slot->record.timestamp = now;
+    slot->record.type = RECORD_MESSAGE;
+    slot->record.length = length;
+    slot->record.payload_size = (length < 0) ? 0 :
+            (length < APPLOG_PAYLOAD_SIZE) ? length : APPLOG_PAYLOAD_SIZE - 1;
+    commit_record(slot, position);
+    return;
+}
+
+/* Logs the packet's length, and a copy of its first bytes if it is one of the
+ * sampled packets while dumps are on. */
+void applog_packet(const void *data, size_t length, bool error)
+{
+    uint64_t now;
+    unsigned int position, packet_num;
+    struct log_slot *slot;
+
+    if (!__atomic_load_n(&applog.started, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    packet_num = __atomic_fetch_add(&applog.packet_num, 1, __ATOMIC_RELAXED);
+    now = get_time_ns();
+    if (rate_limited(now) || (slot = claim_slot(&position)) == NULL) {
+        return;
+    }
+
+    slot->record.timestamp = now;
+    slot->record.type = RECORD_PACKET;
+    slot->record.length = length;
+    slot->record.packet_num = packet_num;
+    slot->record.error = error;
+    slot->record.payload_size = 0;
+    if (applog_dumps_enabled() &&
+        packet_num % applog.config.dump_sample == 0) {
+        slot->record.payload_size = (length < APPLOG_PAYLOAD_SIZE) ? length :
+                                    APPLOG_PAYLOAD_SIZE;
+        memcpy(slot->record.payload, data, slot->record.payload_size);
+    }
+    commit_record(slot, position);
+    return;
+}
+
+// Turns packet dumps on or off, with a store that is safe in a signal handler
+void applog_set_dumps(bool enable)
+{
+    __atomic_store_n(&applog.dumps, enable, __ATOMIC_RELAXED);
+    return;
+}
+
+bool applog_dumps_enabled()
+{
+    return __atomic_load_n(&applog.dumps, __ATOMIC_RELAXED);
+}
+
+void applog_get_stats(struct applog_stats *stats)
+{
+    stats->logged = __atomic_load_n(&applog.stats.logged, __ATOMIC_RELAXED);
+    stats->overruns = __atomic_load_n(&applog.stats.overruns,
+                                      __ATOMIC_RELAXED);
+    stats->suppressed = __atomic_load_n(&applog.stats.suppressed,
+                                        __ATOMIC_RELAXED);
+    return;
+}
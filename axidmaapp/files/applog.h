@@ -0,0 +1,114 @@
+/**
+ * @file applog.h
+ * @date Saturday, October 17, 2026 at 05:12:40 PM EDT
+ *
+ * This file defines the interface to the application's log, which keeps the
+ * console out of the transfer path.
+ *
+ * Logging a message or a packet only copies it into a lock-free ring of
+ * binary records, and never blocks. A background thread formats the records
+ * and writes them out. Records past the rate limit, or logged when the ring
+ * is full, are dropped and counted instead. The contents of received packets
+ * are only dumped when dumps are turned on, which can be done at any time,
+ * and then only for a sample of the packets.
+ *
+ * @bug No known bugs.
+ **/
+
+#ifndef APPLOG_H_
+#define APPLOG_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The default number of records in the ring, and the default rate limit
+#define APPLOG_DEFAULT_RECORDS      1024
+#define APPLOG_DEFAULT_RATE_LIMIT   1000
+
+// The most bytes of a message, or of a packet's dump, held in a record
+#define APPLOG_PAYLOAD_SIZE         256
+
+/**
+ * Structure holding the parameters of the log.
+ **/
+struct applog_config {
+    int num_records;            ///< The number of records in the ring.
+    int rate_limit;             ///< The most records per second, 0 for none.
+    int dump_sample;            ///< Dumps one of every this many packets.
+    bool dumps;                 ///< Dump the contents of packets at start.
+};
+
+/**
+ * Structure holding the counters of the log.
+ **/
+struct applog_stats {
+    uint64_t logged;            ///< The number of records written out.
+    uint64_t overruns;          ///< Records dropped because the ring was full.
+    uint64_t suppressed;        ///< Records dropped by the rate limit.
+};
+
+/**
+ * Starts the log's background thread, writing to the given stream.
+ *
+ * Until the log is started, and after it is stopped, logging does nothing.
+ *
+ * @param[in] stream The stream to write the formatted records to.
+ * @param[in] config The parameters of the log.
+ * @return 0 upon success, a negative errno value on failure.
+ **/
+int applog_start(FILE *stream, const struct applog_config *config);
+
+/**
+ * Writes out the records still in the ring, then stops the log's thread.
+ **/
+void applog_stop();
+
+/**
+ * Logs a message, formatted as by printf.
+ *
+ * The message is formatted into the record by the caller, without touching
+ * any stream, and is cut short at #APPLOG_PAYLOAD_SIZE bytes.
+ *
+ * @param[in] format The printf format of the message.
+ **/
+void applog_message(const char *format, ...)
+    __attribute__((format(printf, 1, 2)));
+
+/**
+ * Logs a received packet.
+ *
+ * The packet's length is always logged. When dumps are on, the first
+ * #APPLOG_PAYLOAD_SIZE bytes of a sample of the packets are copied into the
+ * record as well, to be printed in hexadecimal.
+ *
+ * @param[in] data The contents of the packet.
+ * @param[in] length The number of bytes in the packet.
+ * @param[in] error Indicates that the packet was received with an error.
+ **/
+void applog_packet(const void *data, size_t length, bool error);
+
+/**
+ * Turns dumps of packets' contents on or off. This is safe to call from a
+ * signal handler.
+ *
+ * @param[in] enable Indicates that the contents should be dumped.
+ **/
+void applog_set_dumps(bool enable);
+
+/**
+ * Indicates if dumps of packets' contents are on.
+ *
+ * @return true if the contents are dumped, false otherwise.
+ **/
+bool applog_dumps_enabled();
+
+/**
+ * Gets the counters of the log.
+ *
+ * @param[out] stats Filled with the counts of written and dropped records.
+ **/
+void applog_get_stats(struct applog_stats *stats);
+
+#endif /* APPLOG_H_ */
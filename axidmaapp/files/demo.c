@@ -5,18 +5,27 @@
  * @author Jared Choi (jaewonch)
  * @author Xin Han (hicx)
  *
- * This program performs a simple AXI DMA transfer. It takes the input data,
- * loads it into memory, and then sends it out over the PL fabric. It then
- * receives the data back, and places it into the given output .
+ * This program runs the AXI DMA as a long-lived service. It sends packets out
+ * over the PL fabric, and prints the packets that it receives back, until it
+ * is interrupted.
  *
- * By default it uses the lowest numbered channels for the transmit and receive,
- * unless overriden by the user. The amount of data transfered is automatically
- * determined from the file size. Unless specified, the output file size is
- * made to be 2 times the input size (to account for creating more data).
+ * The transfers are made by the service's receive and transmit threads (see
+ * service.h), while the main thread builds the outbound packets, hands the
+ * received ones to the consumers (see dispatch.h), and periodically logs the
+ * throughput and latency of each direction. There are two consumers: the log,
+ * which can be skipped when buffers run low, and a checker that counts the
+ * packets that do not hold the counting pattern that is sent. Everything is printed through the log (see applog.h), so that
+ * the console never holds up the receive path. Dumps of the received packets
+ * are off unless -d is given, and can be turned on or off while the program
+ * runs by sending it SIGUSR1.
+ *
+ * With -C, it instead times sending control messages through the BRAM
+ * mailbox and by DMA over a range of sizes, prints the crossover between the
+ * two (see transport.h), and exits. The logic must be looping the mailbox
+ * back, or idle, since it is sent messages of zeros by both paths.
  *
- * This program also handles any additional channels that the pipeline
- * on the PL fabric might depend on. It starts up DMA transfers for these
- * pipeline stages, and discards their results.
+ * By default it uses the lowest numbered channels for the transmit and receive,
+ * unless overriden by the user.
  *
  * @bug No known bugs.
  **/
@@ -26,23 +35,42 @@
 #include <stdbool.h>
 #include <assert.h>
 
-#include <fcntl.h>    
-#include <sys/mman.h>          // Flags for open()
-#include <sys/stat.h>           // Open() system call
-#include <sys/types.h>          // Types for open()
-#include <unistd.h>             // Close() system call
+#include <unistd.h>             // Sysconf function
 #include <string.h>             // Memory setting and copying
 #include <getopt.h>             // Option parsing
 #include <errno.h>              // Error codes
-#include <string.h>
-#include <poll.h>
+#include <signal.h>             // Signal handling functions
+#include <time.h>               // Clock functions
 #include "util.h"               // Miscellaneous utilities
 #include "conversion.h"         // Convert bytes to MiBs
 #include "axidmaapp.h"          // Interface ot the AXI DMA library
-#include <pthread.h>
-static unsigned char rbuffer[2048] = {0};
-static unsigned char sbuffer[2048] = {0};
+#include "service.h"            // The transmit and receive threads
+#include "applog.h"             // Logging off the receive path
+#include "dispatch.h"           // Fan-out of received packets
+#include "transport.h"          // Mailbox or DMA control messages
+
+// The largest packet sent or received, and the interval to print statistics
 #define MAXLENGTH 2048
+#define STATS_INTERVAL          5
+
+// The sizes of the test packets sent when the service starts
+static const size_t test_packet_sizes[] = {1000, 2000, 1800};
+
+// The messages timed for each size and path when calibrating the transport
+#define CALIBRATION_ITERATIONS  1000
+#define CALIBRATION_POINTS      16
+
+// The time to wait for the logic to take each calibration message, in ms
+#define CALIBRATION_TIMEOUT     1000
+
+// The buffers that the consumers can hold, out of the service's buffers
+#define MAX_HELD_BUFFERS        (SERVICE_DEFAULT_BUFFERS * 3 / 4)
+
+// The number of received packets that did not hold the counting pattern
+static uint64_t pattern_mismatches;
+
+// Set by the signal handler when the program is asked to stop
+static volatile sig_atomic_t stop_requested;
 
 // Prints the usage for this program
 static void print_usage(bool help)
@@ -51,7 +79,8 @@ static void print_usage(bool help)
 
     fprintf(stream, "Usage: axidma_transfer  "
             "[-t <DMA tx channel>] [-r <DMA rx channel>] [-s <Output file size>"
-            " | -o <Output file size>].\n");
+            " | -o <Output file size>] [-c <receive CPU>] [-b <idle budget>]"
+            " [-d] [-C].\n");
     if (!help) {
         return;
     }
@@ -74,12 +103,24 @@ static void print_usage(bool help)
             "Mibs. This is a floating-point value that must be at least the "
             "number of bytes received back. By default, this is the same "
             "the size of the input file.\n");
+    fprintf(stream, "\t-c <receive CPU>:\tThe CPU to pin the receive thread "
+            "to. Default is the last CPU, or none if there is only one.\n");
+    fprintf(stream, "\t-b <idle budget>:\tThe time in microseconds to poll "
+            "the receive ring once it is idle, before sleeping on its "
+            "interrupt. Default is %d.\n", AXIDMA_RING_DEFAULT_IDLE_BUDGET);
+    fprintf(stream, "\t-d:\t\t\tDump the contents of received packets. "
+            "Send SIGUSR1 to turn dumps on or off while running.\n");
+    fprintf(stream, "\t-C:\t\t\tTime control messages sent through the "
+            "BRAM mailbox and by DMA, print the crossover size, and exit. "
+            "Only for logic that loops the mailbox back, or is idle.\n");
     return;
 }
 
 /* Parses the command line arguments overriding the default transfer sizes,
  * and number of transfer to use for the benchmark if specified. */
-static int parse_args(int argc, char **argv,  int *input_channel, int *output_channel, int *output_size)
+static int parse_args(int argc, char **argv,  int *input_channel,
+        int *output_channel, int *output_size, int *rx_cpu, int *idle_budget,
+        bool *dumps, bool *calibrate)
 {
     char option;
     int int_arg;
@@ -91,11 +132,16 @@ static int parse_args(int argc, char **argv,  int *input_channel, int *output_ch
     *input_channel = -1;
     *output_channel = -1;
     *output_size = -1;
+    *idle_budget = -1;
+    *dumps = false;
+    *calibrate = false;
+    *rx_cpu = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ?
+              sysconf(_SC_NPROCESSORS_ONLN) - 1 : -1;
     o_specified = false;
     s_specified = false;
     rc = 0;
 
-    while ((option = getopt(argc, argv, "t:r:s:o:h")) != (char)-1)
+    while ((option = getopt(argc, argv, "t:r:s:o:c:b:dCh")) != (char)-1)
     {
         switch (option)
         {
@@ -141,6 +187,32 @@ static int parse_args(int argc, char **argv,  int *input_channel, int *output_ch
                 o_specified = true;
                 break;
 
+            // Parse the CPU for the receive thread
+            case 'c':
+                rc = parse_int(option, optarg, rx_cpu);
+                if (rc < 0) {
+                    print_usage(false);
+                    return rc;
+                }
+                break;
+
+            // Parse the idle budget of the receive ring
+            case 'b':
+                rc = parse_int(option, optarg, idle_budget);
+                if (rc < 0) {
+                    print_usage(false);
+                    return rc;
+                }
+                break;
+
+            case 'd':
+                *dumps = true;
+                break;
+
+            case 'C':
+                *calibrate = true;
+                break;
+
             case 'h':
                 print_usage(true);
                 exit(0);
@@ -186,146 +258,243 @@ static int parse_args(int argc, char **argv,  int *input_channel, int *output_ch
     return 0;
 }
 
-//receive
-void *rapidio_taks_rec(int argc, char **argv)
+/*----------------------------------------------------------------------------
+ * Service
+ *----------------------------------------------------------------------------*/
+
+// Asks the main loop to stop the service and exit
+static void handle_stop(int signal)
 {
-    int rc;
-    int i;
-    int rec_len;
-    char *input_path, *output_path;
-    axidma_dev_t axidma_dev;
-    struct stat input_stat;
-    struct dma_transfer trans;
-    const array_t *tx_chans, *rx_chans;
-    int error;
-    int ret;
-    
+    (void)signal;
+    stop_requested = 1;
+    return;
+}
 
-    axidma_config();
-    XDma_Out32(map_base0+4,1);
+// Turns the dumps of received packets on or off
+static void handle_toggle_dumps(int signal)
+{
+    (void)signal;
+    applog_set_dumps(!applog_dumps_enabled());
+    return;
+}
 
-    //sbuffer init
-    for(i = 0;i < 2000;i++)
-      {
-        sbuffer[i]=i;
-      }
+// Queues the test packets, each filled with a counting pattern
+static void send_test_packets(service_t svc)
+{
+    size_t i, j;
+    unsigned char *data;
+    struct service_packet *packet;
 
-    // 解析输入参数
-    memset(&trans, 0, sizeof(trans));
-    if (parse_args(argc, argv, &trans.input_channel,
-                   &trans.output_channel, &trans.output_size) < 0) {
-        rc = 1;
-        goto ret;
+    for (i = 0; i < sizeof(test_packet_sizes) / sizeof(test_packet_sizes[0]);
+         i++)
+    {
+        packet = service_tx_get(svc, -1);
+        data = packet->data;
+        for (j = 0; j < test_packet_sizes[i]; j++)
+        {
+            data[j] = j;
+        }
+        packet->length = test_packet_sizes[i];
+        service_tx_put(svc, packet);
     }
 
-    // 初始化AXIDMA设备
-    axidma_dev = axidma_init();
-    if (axidma_dev == NULL) {
-        fprintf(stderr, "Error: Failed to initialize the AXI DMA device.\n");
-        rc = 1;
-        goto close_output;
-    }
-     printf("Succeed to initialize the AXI DMA device.\n");
-
-    // // 规定输入输出文件的大小
-    // 如果用户没有指定输出大小，则将其设置为默认值
-   
-    // trans.input_size = 1000;
-    // // printf("trans.output_size main1 is %d\n",trans.output_size);
-    //  if (trans.output_size == -1) {
-    //     trans.output_size = trans.input_size;
-    // }
-   
-    // 如果还没有指定tx和rx通道，则获取收发通道
-    tx_chans = axidma_get_dma_tx(axidma_dev);
-    // printf("tx_chans->len is%d\n ",tx_chans->len);
-    // printf("trans.input_channel is %d\n ",trans.input_channel);
-    // printf("tx_chans->data[0] is %d\n ",tx_chans->data[0]);
-    if (tx_chans->len < 1) {
-        fprintf(stderr, "Error: No transmit channels were found.\n");
-        rc = -ENODEV;
-        goto destroy_axidma;
+    return;
+}
+
+// Logs each received packet, and its contents if dumps are on
+static void log_consumer(const struct dispatch_view *view, void *data)
+{
+    dispatcher_t disp;
+
+    disp = data;
+    applog_packet(view->data, view->length, view->error);
+    dispatch_release(disp, view);
+    return;
+}
+
+// Checks that each received packet holds the counting pattern that is sent
+static void check_consumer(const struct dispatch_view *view, void *data)
+{
+    size_t i;
+    dispatcher_t disp;
+    const unsigned char *bytes;
+
+    disp = data;
+    bytes = view->data;
+    for (i = 0; i < view->length && bytes[i] == (unsigned char)i; i++);
+    if (view->error || i < view->length) {
+        __atomic_add_fetch(&pattern_mismatches, 1, __ATOMIC_RELAXED);
     }
-    rx_chans = axidma_get_dma_rx(axidma_dev);
-    // printf("rx_chans->len is%d\n ",rx_chans->len);
-    //  printf("trans.output_channel is %d\n ",trans.output_channel);
-    // printf("rx_chans->data[0] is %d\n ",rx_chans->data[0]);
-    if (rx_chans->len < 1) {
-        fprintf(stderr, "Error: No receive channels were found.\n");
-        rc = -ENODEV;
-        goto destroy_axidma;
+
+    dispatch_release(disp, view);
+    return;
+}
+
+// Logs the counters of the consumers, and the buffers they hold
+static void log_consumer_stats(dispatcher_t disp, int num_consumers)
+{
+    int i;
+    const char *name;
+    struct dispatch_consumer_stats stats;
+
+    for (i = 0; i < num_consumers; i++)
+    {
+        name = dispatch_get_consumer_stats(disp, i, &stats);
+        applog_message("Consumer %s: %llu packets, %llu skipped", name,
+                (unsigned long long)stats.delivered,
+                (unsigned long long)stats.skipped);
     }
+    applog_message("Buffers held: %d, pattern mismatches: %llu",
+            dispatch_num_held(disp), (unsigned long long)
+            __atomic_load_n(&pattern_mismatches, __ATOMIC_RELAXED));
+    return;
+}
 
-    /* 如果用户没有指定通道，我们假设发送和接收通道是编号最低的通道。 */
-    if (trans.input_channel == -1 && trans.output_channel == -1) {
-        trans.input_channel = tx_chans->data[0];
-        trans.output_channel = rx_chans->data[0];
+// Logs the counters for one direction, with its rates over the interval
+static void log_dir_stats(const char *name, const struct service_stats *now,
+        const struct service_stats *last, double interval)
+{
+    double latency_avg;
+
+    latency_avg = (now->packets > 0) ?
+                  (double)now->latency_total / now->packets : 0;
+    applog_message("%s: %llu packets, %.2f packets/s, %.4f MiB/s, %llu "
+            "errors, latency min/avg/max %.1f/%.1f/%.1f us", name,
+            (unsigned long long)now->packets,
+            (now->packets - last->packets) / interval,
+            BYTE_TO_MIB(now->bytes - last->bytes) / interval,
+            (unsigned long long)now->errors, now->latency_min / 1e3,
+            latency_avg / 1e3, now->latency_max / 1e3);
+    return;
+}
+
+// Logs how the receive ring was waited on, if the service has one
+static void log_ring_stats(service_t svc)
+{
+    double total_time;
+    struct axidma_ring_stats stats;
+
+    if (service_get_ring_stats(svc, &stats) < 0) {
+        return;
     }
-    while(1)
-    {
-        rec_len = axidma0read(axidma_dev, &trans, rbuffer);
-    printf("\nrec_len = 0x%d\n",rec_len);
-    for(i = 0;i<(rec_len);i++)
-        {
-            if(i%16 == 0)
-            {
-                printf("\n");
-            }
-            printf("0x%02x ",rbuffer[i]);
-        }
 
+    total_time = stats.poll_time_ns + stats.irq_time_ns;
+    applog_message("Receive ring: %s, %llu switches to interrupts, %llu "
+            "interrupts, polled %.1f%% of the time",
+            (stats.irq_mode) ? "sleeping" : "polling",
+            (unsigned long long)stats.irq_switches,
+            (unsigned long long)stats.interrupts, (total_time > 0) ?
+            100 * stats.poll_time_ns / total_time : 100.0);
+    return;
+}
 
-      
-      }
-    
-    printf("poll nothing--------------------------\n");
-   
+// Gets the current time in seconds, from the monotonic clock
+static double get_time_sec()
+{
+    struct timespec now;
 
-   pthread_exit(0);
-destroy_axidma:
-    axidma_destroy(axidma_dev);
-close_output:
-    assert(close(trans.output_fd) == 0);
-// close_input:
-//     assert(close(trans.input_fd) == 0);
-ret:
-    return rc;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
 }
 
+/*----------------------------------------------------------------------------
+ * Transport Calibration
+ *----------------------------------------------------------------------------*/
+
+/* Times control messages sent through the mailbox and by DMA at each size,
+ * and prints the largest size that the mailbox is faster for. */
+static int calibrate_transport(axidma_dev_t dev,
+        const struct service_config *config)
+{
+    int i, num_points;
+    transport_t trans;
+    struct transport_config trans_config;
+    struct transport_point points[CALIBRATION_POINTS];
+
+    trans_config.tx_channel = config->tx_channel;
+    trans_config.rx_channel = config->rx_channel;
+    trans_config.max_message = config->packet_size;
+    trans_config.pio_threshold = TRANSPORT_DEFAULT_THRESHOLD;
+    trans = transport_open(dev, bram_regs, &trans_config);
+    if (trans == NULL) {
+        return -ENOMEM;
+    }
+
+    num_points = transport_calibrate(trans, CALIBRATION_ITERATIONS,
+                                     CALIBRATION_TIMEOUT, points,
+                                     CALIBRATION_POINTS);
+    if (num_points < 0) {
+        fprintf(stderr, "Error: Failed to calibrate the transport: %s\n",
+                strerror(-num_points));
+        if (num_points == -ETIMEDOUT) {
+            fprintf(stderr, "The logic must take the messages from the "
+                    "mailbox, by looping it back.\n");
+        }
+        transport_close(trans);
+        return num_points;
+    }
+
+    printf("Control Message Send Times:\n");
+    printf("\t%8s %12s %12s\n", "Bytes", "Mailbox (us)", "DMA (us)");
+    for (i = 0; i < num_points; i++)
+    {
+        printf("\t%8zu %12.2f %12.2f\n", points[i].size, points[i].pio_us,
+               points[i].dma_us);
+    }
+    printf("Messages of up to %zu bytes should go through the mailbox.\n",
+           transport_get_threshold(trans));
+
+    transport_close(trans);
+    return 0;
+}
 
 /*----------------------------------------------------------------------------
  * Main
  *----------------------------------------------------------------------------*/
 int main(int argc, char **argv)
 {
-    int rc;
-    int i;
-    int rec_len;
-    char *input_path, *output_path;
+    int rc, packet_size;
+    bool dumps, calibrate;
+    double last_time, now;
     axidma_dev_t axidma_dev;
-    struct stat input_stat;
-    struct dma_transfer trans;
+    service_t svc;
+    dispatcher_t disp;
+    struct sigaction stop_action, dump_action;
+    struct applog_config log_config;
+    struct service_config config;
+    struct service_stats tx_stats, rx_stats, last_tx_stats, last_rx_stats;
     const array_t *tx_chans, *rx_chans;
-    int error;
-    int ret;
-
-   
-    pthread_t rapidio_rid;
 
     //地址映射，使能读写DMA，单独规定
-    axidma_config();
-    XDma_Out32(map_base0+4,1);
-
-    //sbuffer init
-    for(i = 0;i < 2000;i++)
-      {
-        sbuffer[i]=i;
-      }
+    if (axidma_config() < 0) {
+        rc = 1;
+        goto ret;
+    }
+    regbank_write(bram_regs, REGBANK_REG(bram_ctrl, enable), 1);
+    regbank_flush(bram_regs);
 
     // 解析输入参数
-    memset(&trans, 0, sizeof(trans));
-    if (parse_args(argc, argv, &trans.input_channel,
-                   &trans.output_channel, &trans.output_size) < 0) {
+    memset(&config, 0, sizeof(config));
+    if (parse_args(argc, argv, &config.tx_channel, &config.rx_channel,
+                   &packet_size, &config.rx_cpu, &config.rx_idle_budget,
+                   &dumps, &calibrate) < 0) {
+        rc = 1;
+        goto ret;
+    }
+    config.packet_size = (packet_size > 0) ? packet_size : MAXLENGTH;
+    config.num_buffers = SERVICE_DEFAULT_BUFFERS;
+    config.tx_batch = SERVICE_DEFAULT_TX_BATCH;
+    config.tx_cpu = -1;
+
+    // Start the log before any of the threads that use it
+    log_config.num_records = APPLOG_DEFAULT_RECORDS;
+    log_config.rate_limit = APPLOG_DEFAULT_RATE_LIMIT;
+    log_config.dump_sample = 1;
+    log_config.dumps = dumps;
+    rc = applog_start(stdout, &log_config);
+    if (rc < 0) {
+        fprintf(stderr, "Error: Failed to start the log: %s\n",
+                strerror(-rc));
         rc = 1;
         goto ret;
     }
@@ -335,136 +504,106 @@ int main(int argc, char **argv)
     if (axidma_dev == NULL) {
         fprintf(stderr, "Error: Failed to initialize the AXI DMA device.\n");
         rc = 1;
-        goto close_output;
+        goto stop_log;
     }
-     printf("Succeed to initialize the AXI DMA device.\n");
-
-    // // 规定输入输出文件的大小
-    // 如果用户没有指定输出大小，则将其设置为默认值
-   
-    // trans.input_size = 1000;
-    // // printf("trans.output_size main1 is %d\n",trans.output_size);
-    //  if (trans.output_size == -1) {
-    //     trans.output_size = trans.input_size;
-    // }
-   
+    printf("Succeed to initialize the AXI DMA device.\n");
+
     // 如果还没有指定tx和rx通道，则获取收发通道
     tx_chans = axidma_get_dma_tx(axidma_dev);
-    // printf("tx_chans->len is%d\n ",tx_chans->len);
-    // printf("trans.input_channel is %d\n ",trans.input_channel);
-    // printf("tx_chans->data[0] is %d\n ",tx_chans->data[0]);
     if (tx_chans->len < 1) {
         fprintf(stderr, "Error: No transmit channels were found.\n");
-        rc = -ENODEV;
+        rc = 1;
         goto destroy_axidma;
     }
     rx_chans = axidma_get_dma_rx(axidma_dev);
-    // printf("rx_chans->len is%d\n ",rx_chans->len);
-    //  printf("trans.output_channel is %d\n ",trans.output_channel);
-    // printf("rx_chans->data[0] is %d\n ",rx_chans->data[0]);
     if (rx_chans->len < 1) {
         fprintf(stderr, "Error: No receive channels were found.\n");
-        rc = -ENODEV;
+        rc = 1;
         goto destroy_axidma;
     }
 
     /* 如果用户没有指定通道，我们假设发送和接收通道是编号最低的通道。 */
-    if (trans.input_channel == -1 && trans.output_channel == -1) {
-        trans.input_channel = tx_chans->data[0];
-        trans.output_channel = rx_chans->data[0];
+    if (config.tx_channel == -1 && config.rx_channel == -1) {
+        config.tx_channel = tx_chans->data[0];
+        config.rx_channel = rx_chans->data[0];
     }
-    // trans.input_channel = 0;
-    // trans.output_channel = 1;
-    printf("AXI DMA File Transfer Info:\n");
-    printf("\tTransmit Channel: %d\n", trans.input_channel);
-    printf("\tReceive Channel: %d\n", trans.output_channel);
-    printf("\tInput Data Size: %.4f MiB\n", BYTE_TO_MIB(trans.input_size));
-    printf("\tOutput Data Size: %.4f MiB\n\n", BYTE_TO_MIB(trans.output_size));
-     
-
-    // 通过AXI DMA传输文件
-    // rc = transfer_file(axidma_dev, &trans, output_path);
-    // rc = (rc < 0) ? -rc : 0;
-    trans.input_size = 1000;
-    trans.output_size = 2048;
-    rc = axidma0send(axidma_dev, &trans, sbuffer);
-    printf("success send axidma0\n");
-    sleep(5);
-    trans.input_size = 2000;
-     sleep(5);
-    rc = axidma0send(axidma_dev, &trans, sbuffer);
-    trans.input_size = 1800;
-     sleep(5);
-    rc = axidma0send(axidma_dev, &trans, sbuffer);
-//     rec_len = axidma0read(axidma_dev, &trans, rbuffer);
-//     printf("\nrec_len = 0x%d\n",rec_len);
-//     for(i = 0;i<(rec_len);i++)
-//         {
-//             if(i%16 == 0)
-//             {
-//                 printf("\n");
-//             }
-//             printf("0x%02x ",rbuffer[i]);
-//         }
-
-//     sleep(3);
-
-//      trans.input_size = 2000;
-//      trans.output_size = MAXLENGTH;
-    
-//     rc = axidma0send(axidma_dev, &trans, sbuffer);
-//     printf("success send axidma0\n");
-//     rec_len = axidma0read(axidma_dev, &trans, rbuffer);
-//     printf("\nrec_len = 0x%d\n",rec_len);
-//     for(i = 0;i<(rec_len);i++)
-//         {
-//             if(i%16 == 0)
-//             {
-//                 printf("\n");
-//             }
-//             printf("0x%02x ",rbuffer[i]);
-//         }
-
-
-
-
-// sleep(3);
-
-//     trans.input_size = 1500;
-//     rc = axidma0send(axidma_dev, &trans, sbuffer);
-//      printf("success send axidma0\n");
-//     rec_len = axidma0read(axidma_dev, &trans, rbuffer);
-//     printf("\nrec_len = 0x%d\n",rec_len);
-//     for(i = 0;i<(rec_len);i++)
-//         {
-//             if(i%16 == 0)
-//             {
-//                 printf("\n");
-//             }
-//             printf("0x%02x ",rbuffer[i]);
-//         }
-
-// sleep(3);
-
-//      trans.input_size = 1000;
-//     rc = axidma0send(axidma_dev, &trans, sbuffer);
-//      printf("success send axidma0\n");
-   
-    
-error=pthread_create(&rapidio_rid, NULL, &rapidio_taks_rec,NULL);
-    if(error != 0)
+    printf("AXI DMA Service Info:\n");
+    printf("\tTransmit Channel: %d\n", config.tx_channel);
+    printf("\tReceive Channel: %d\n", config.rx_channel);
+    printf("\tPacket Size: %zu bytes\n", config.packet_size);
+    printf("\tReceive CPU: %d\n\n", config.rx_cpu);
+
+    // Find the crossover between the mailbox and DMA, instead of running
+    if (calibrate) {
+        rc = (calibrate_transport(axidma_dev, &config) < 0) ? 1 : 0;
+        goto destroy_axidma;
+    }
+
+    // Start the threads, and stop them cleanly when interrupted
+    svc = service_start(axidma_dev, &config);
+    if (svc == NULL) {
+        rc = 1;
+        goto destroy_axidma;
+    }
+
+    // Hand the received packets to the log and the checker
+    disp = dispatch_create(svc, MAX_HELD_BUFFERS);
+    if (disp == NULL) {
+        fprintf(stderr, "Error: Failed to create the dispatcher.\n");
+        rc = 1;
+        goto stop_service;
+    }
+    if (dispatch_add_consumer(disp, "log", log_consumer, disp, true) < 0 ||
+        dispatch_add_consumer(disp, "checker", check_consumer, disp,
+                              false) < 0) {
+        fprintf(stderr, "Error: Failed to add the consumers.\n");
+        rc = 1;
+        goto destroy_dispatcher;
+    }
+    memset(&stop_action, 0, sizeof(stop_action));
+    stop_action.sa_handler = handle_stop;
+    sigaction(SIGINT, &stop_action, NULL);
+    sigaction(SIGTERM, &stop_action, NULL);
+    memset(&dump_action, 0, sizeof(dump_action));
+    dump_action.sa_handler = handle_toggle_dumps;
+    sigaction(SIGUSR1, &dump_action, NULL);
+
+    send_test_packets(svc);
+
+    // Consume the received packets, printing the statistics periodically
+    memset(&last_tx_stats, 0, sizeof(last_tx_stats));
+    memset(&last_rx_stats, 0, sizeof(last_rx_stats));
+    last_time = get_time_sec();
+    while (!stop_requested)
     {
-        printf("pthreadrx_create fail\n");
-        return -1;
+        dispatch_run(disp, 100);
+
+        now = get_time_sec();
+        if (now - last_time >= STATS_INTERVAL) {
+            service_get_stats(svc, &tx_stats, &rx_stats);
+            log_dir_stats("Transmit", &tx_stats, &last_tx_stats,
+                          now - last_time);
+            log_dir_stats("Receive", &rx_stats, &last_rx_stats,
+                          now - last_time);
+            log_consumer_stats(disp, 2);
+            log_ring_stats(svc);
+            last_tx_stats = tx_stats;
+            last_rx_stats = rx_stats;
+            last_time = now;
+        }
     }
-pthread_detach(rapidio_rid);
-   rc = (rc < 0) ? -rc : 0;    
+
+    applog_message("Stopping the service.");
+    rc = 0;
+
+destroy_dispatcher:
+    dispatch_destroy(disp);
+stop_service:
+    service_stop(svc);
 destroy_axidma:
     axidma_destroy(axidma_dev);
-close_output:
-    assert(close(trans.output_fd) == 0);
-// close_input:
-//     assert(close(trans.input_fd) == 0);
+stop_log:
+    applog_stop();
 ret:
     return rc;
 }
@@ -0,0 +1,322 @@
+/**
+ * @file dispatch.c
+ * @date Saturday, October 17, 2026 at 07:10:26 PM EDT
+ *
+ * This file contains the implementation of the receive dispatcher.
+ *
+ * Each packet taken from the service is wrapped in a dispatch buffer, which
+ * holds the packet's view and a count of the consumers still holding it. The
+ * view is pushed onto the queue of each consumer that gets the packet. The
+ * consumer that drops the count to zero pushes the buffer onto a lock-free
+ * stack of released buffers, which the dispatching thread empties in one swap
+ * and gives back to the service. This keeps the service's queues with a single
+ * producer and consumer, however many consumers there are.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>             // Memset and strncpy functions
+#include <errno.h>              // Error codes
+#include <time.h>               // Sleep function
+#include <pthread.h>            // Thread functions
+
+#include "dispatch.h"           // Local definitions
+#include "queue.h"              // Lock-free queues to the consumers
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The most consumers of a dispatcher, and the length of their names
+#define DISPATCH_MAX_CONSUMERS  8
+#define DISPATCH_NAME_LEN       32
+
+// The time the consumers wait for a packet before checking if they should stop
+#define DISPATCH_POLL_MS        100
+
+// The time to wait for buffers to be released, when taking packets is paused
+#define DISPATCH_PAUSE_NS       1000000
+
+// A received packet, shared between the consumers that were given it
+struct dispatch_buffer {
+    struct dispatch_view view;  // The consumers' view, must be first
+    struct service_packet *packet;  // The service's packet
+    int refs;                   // The number of consumers holding it
+    struct dispatch_buffer *next;   // Link in the free or released list
+};
+
+// A consumer of the packets, with its own thread
+struct consumer {
+    char name[DISPATCH_NAME_LEN];   // The name of the consumer
+    dispatch_cb_t callback;     // The function to call with each packet
+    void *data;                 // The data to pass to the function
+    bool lossy;                 // Indicates it can be skipped
+    struct spsc_queue queue;    // The views waiting for the consumer
+    struct dispatch_consumer_stats stats;   // The counters of the consumer
+    pthread_t thread;           // The consumer's thread
+    dispatcher_t disp;          // The dispatcher it belongs to
+};
+
+// The structure that represents a dispatcher
+struct dispatcher {
+    service_t svc;              // The service the packets come from
+    int max_held;               // The most buffers consumers can hold
+    int num_held;               // The buffers held by consumers
+    struct dispatch_buffer *buffers;    // All of the dispatch buffers
+    struct dispatch_buffer *free_list;  // The unused dispatch buffers
+    struct dispatch_buffer *released;   // Buffers released by consumers
+    struct consumer consumers[DISPATCH_MAX_CONSUMERS];  // The consumers
+    int num_consumers;          // The number of consumers
+    int stopping;               // Tells the consumers' threads to exit
+};
+
+/*----------------------------------------------------------------------------
+ * Private Helper Functions
+ *----------------------------------------------------------------------------*/
+
+/* Calls the consumer's function with each view queued for it. Once the
+ * dispatcher is stopping, the views left in the queue are still handed on,
+ * so that they are released. */
+static void *consumer_thread(void *arg)
+{
+    struct consumer *consumer;
+    struct dispatch_view *view;
+
+    consumer = arg;
+    while (true)
+    {
+        view = queue_pop(&consumer->queue, DISPATCH_POLL_MS);
+        if (view != NULL) {
+            consumer->callback(view, consumer->data);
+        } else if (__atomic_load_n(&consumer->disp->stopping,
+                                   __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/* Gives the buffers released by the consumers back to the service. The whole
+ * released stack is taken in one swap, so there is no ABA problem. */
+static void reclaim_buffers(dispatcher_t disp)
+{
+    struct dispatch_buffer *buffer, *next;
+
+    buffer = __atomic_exchange_n(&disp->released, NULL, __ATOMIC_ACQUIRE);
+    for (; buffer != NULL; buffer = next)
+    {
+        next = buffer->next;
+        service_rx_put(disp->svc, buffer->packet);
+        buffer->next = disp->free_list;
+        disp->free_list = buffer;
+        __atomic_store_n(&disp->num_held, disp->num_held - 1,
+                         __ATOMIC_RELAXED);
+    }
+    return;
+}
+
+/*----------------------------------------------------------------------------
+ * Public Interface
+ *----------------------------------------------------------------------------*/
+
+// Creates the dispatcher, with a dispatch buffer for each buffer held
+dispatcher_t dispatch_create(service_t svc, int max_held)
+{
+    int i;
+    dispatcher_t disp;
+
+    if (max_held <= 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    disp = calloc(1, sizeof(*disp));
+    if (disp == NULL) {
+        return NULL;
+    }
+    disp->buffers = calloc(max_held, sizeof(disp->buffers[0]));
+    if (disp->buffers == NULL) {
+        free(disp);
+        return NULL;
+    }
+
+    for (i = 0; i < max_held; i++)
+    {
+        disp->buffers[i].next = disp->free_list;
+        disp->free_list = &disp->buffers[i];
+    }
+    disp->svc = svc;
+    disp->max_held = max_held;
+    return disp;
+}
+
+/* Stops the consumers once they have been given every queued view, then waits
+ * for the views they still hold to be released. */
+void dispatch_destroy(dispatcher_t disp)
+{
+    int i;
+    struct timespec pause;
+
+    __atomic_store_n(&disp->stopping, true, __ATOMIC_RELEASE);
+    for (i = 0; i < disp->num_consumers; i++)
+    {
+        pthread_join(disp->consumers[i].thread, NULL);
+    }
+
+    pause.tv_sec = 0;
+    pause.tv_nsec = DISPATCH_PAUSE_NS;
+    reclaim_buffers(disp);
+    while (disp->num_held > 0)
+    {
+        nanosleep(&pause, NULL);
+        reclaim_buffers(disp);
+    }
+
+    for (i = 0; i < disp->num_consumers; i++)
+    {
+        queue_destroy(&disp->consumers[i].queue);
+    }
+    free(disp->buffers);
+    free(disp);
+    return;
+}
+
+// Sets up the consumer's queue, with room for every buffer, and its thread
+int dispatch_add_consumer(dispatcher_t disp, const char *name,
+        dispatch_cb_t callback, void *data, bool lossy)
+{
+    int rc;
+    struct consumer *consumer;
+
+    if (disp->num_consumers == DISPATCH_MAX_CONSUMERS) {
+        return -ENOSPC;
+    }
+
+    consumer = &disp->consumers[disp->num_consumers];
+    memset(consumer, 0, sizeof(*consumer));
+    strncpy(consumer->name, name, sizeof(consumer->name) - 1);
+    consumer->callback = callback;
+    consumer->data = data;
+    consumer->lossy = lossy;
+    consumer->disp = disp;
+    rc = queue_init(&consumer->queue, disp->max_held);
+    if (rc < 0) {
+        return rc;
+    }
+
+    rc = pthread_create(&consumer->thread, NULL, consumer_thread, consumer);
+    if (rc != 0) {
+        queue_destroy(&consumer->queue);
+        return -rc;
+    }
+
+    disp->num_consumers += 1;
+    return disp->num_consumers - 1;
+}
+
+/* Takes back the released buffers, then hands the next packet to the
+ * consumers. Lossy consumers are skipped once half of the buffers are held,
+ * and taking packets is paused once all of them are. The count on the buffer
+ * is set before any consumer can see it, since they may release it at once. */
+int dispatch_run(dispatcher_t disp, int timeout)
+{
+    int i, num_targets;
+    bool low;
+    struct timespec pause;
+    struct service_packet *packet;
+    struct dispatch_buffer *buffer;
+    struct consumer *targets[DISPATCH_MAX_CONSUMERS];
+
+    reclaim_buffers(disp);
+    if (disp->num_held >= disp->max_held) {
+        pause.tv_sec = 0;
+        pause.tv_nsec = DISPATCH_PAUSE_NS;
+        nanosleep(&pause, NULL);
+        return 0;
+    }
+
+    packet = service_rx_get(disp->svc, timeout);
+    if (packet == NULL) {
+        return 0;
+    }
+
+    // Pick the consumers to give the packet to
+    low = disp->num_held >= disp->max_held / 2;
+    num_targets = 0;
+    for (i = 0; i < disp->num_consumers; i++)
+    {
+        if (low && disp->consumers[i].lossy) {
+            __atomic_store_n(&disp->consumers[i].stats.skipped,
+                             disp->consumers[i].stats.skipped + 1,
+                             __ATOMIC_RELAXED);
+            continue;
+        }
+        targets[num_targets] = &disp->consumers[i];
+        num_targets += 1;
+    }
+    if (num_targets == 0) {
+        service_rx_put(disp->svc, packet);
+        return 1;
+    }
+
+    // Wrap the packet, then queue a view of it for each consumer
+    buffer = disp->free_list;
+    disp->free_list = buffer->next;
+    buffer->view.data = packet->data;
+    buffer->view.length = packet->length;
+    buffer->view.timestamp = packet->timestamp;
+    buffer->view.error = packet->error;
+    buffer->packet = packet;
+    buffer->refs = num_targets;
+    __atomic_store_n(&disp->num_held, disp->num_held + 1, __ATOMIC_RELAXED);
+
+    for (i = 0; i < num_targets; i++)
+    {
+        __atomic_store_n(&targets[i]->stats.delivered,
+                         targets[i]->stats.delivered + 1, __ATOMIC_RELAXED);
+        queue_push(&targets[i]->queue, &buffer->view);
+    }
+
+    return 1;
+}
+
+/* Drops the consumer's hold on the buffer. The last consumer to let go of it
+ * pushes it onto the released stack for the dispatching thread. */
+void dispatch_release(dispatcher_t disp, const struct dispatch_view *view)
+{
+    struct dispatch_buffer *buffer, *head;
+
+    buffer = (struct dispatch_buffer *)view;
+    if (__atomic_sub_fetch(&buffer->refs, 1, __ATOMIC_ACQ_REL) > 0) {
+        return;
+    }
+
+    head = __atomic_load_n(&disp->released, __ATOMIC_RELAXED);
+    do {
+        buffer->next = head;
+    } while (!__atomic_compare_exchange_n(&disp->released, &head, buffer,
+                true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return;
+}
+
+// Gets the counters and name of the consumer
+const char *dispatch_get_consumer_stats(dispatcher_t disp, int consumer,
+        struct dispatch_consumer_stats *stats)
+{
+    struct consumer *cons;
+
+    cons = &disp->consumers[consumer];
+    stats->delivered = __atomic_load_n(&cons->stats.delivered,
+                                       __ATOMIC_RELAXED);
+    stats->skipped = __atomic_load_n(&cons->stats.skipped, __ATOMIC_RELAXED);
+    return cons->name;
+}
+
+int dispatch_num_held(dispatcher_t disp)
+{
+    return __atomic_load_n(&disp->num_held, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,145 @@
+/**
+ * @file dispatch.h
+ * @date Saturday, October 17, 2026 at 06:48:03 PM EDT
+ *
+ * This file defines the interface to the receive dispatcher, which hands each
+ * packet received by the service to several consumers, such as a logger, a
+ * protocol decoder and a forwarder, without copying it.
+ *
+ * Each consumer runs in its own thread, and gets a view of the packet in the
+ * service's DMA buffer. The buffer is counted as held by every consumer that
+ * was given a view of it, and it goes back to the service only when the last
+ * of them releases its view.
+ *
+ * Consumers are either lossless or lossy. Once half of the dispatcher's limit
+ * of buffers are held by consumers, lossy consumers are skipped. Once all of
+ * them are held, no more packets are taken from the service until buffers are
+ * released. The service then runs out of buffers to receive into, which holds
+ * off the fabric.
+ *
+ * @bug No known bugs.
+ **/
+
+#ifndef DISPATCH_H_
+#define DISPATCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "service.h"            // The service the packets come from
+
+/**
+ * Structure representing a consumer's view of a received packet.
+ **/
+struct dispatch_view {
+    const void *data;           ///< The contents of the packet, read-only.
+    size_t length;              ///< The number of bytes in the packet.
+    uint64_t timestamp;         ///< Time it was received, in CLOCK_MONOTONIC ns.
+    bool error;                 ///< The packet was received with an error.
+};
+
+/**
+ * Type definition for a consumer's function.
+ *
+ * The function is called in the consumer's thread for each packet given to
+ * it. It must release the view with #dispatch_release once it has finished
+ * with the packet, which can be after it returns.
+ **/
+typedef void (*dispatch_cb_t)(const struct dispatch_view *view, void *data);
+
+/**
+ * Structure holding the counters of a consumer.
+ **/
+struct dispatch_consumer_stats {
+    uint64_t delivered;         ///< The number of packets given to it.
+    uint64_t skipped;           ///< Packets it was skipped for, when lossy.
+};
+
+/**
+ * The struct representing a dispatcher. This is an opaque type.
+ **/
+struct dispatcher;
+
+/**
+ * Type definition for a dispatcher.
+ **/
+typedef struct dispatcher* dispatcher_t;
+
+/**
+ * Creates a dispatcher for the packets received by the service.
+ *
+ * @param[in] svc A #service_t returned by #service_start.
+ * @param[in] max_held The most buffers that consumers can hold before taking
+ *                     packets is paused. It should leave the service some
+ *                     buffers to receive into.
+ * @return A handle to the dispatcher on success, NULL on failure.
+ **/
+dispatcher_t dispatch_create(service_t svc, int max_held);
+
+/**
+ * Stops the consumers' threads, waiting for the views they hold to be
+ * released, then frees the dispatcher.
+ *
+ * @param[in] disp A #dispatcher_t returned by #dispatch_create.
+ **/
+void dispatch_destroy(dispatcher_t disp);
+
+/**
+ * Registers a consumer, starting its thread. Consumers can only be added
+ * before the first call to #dispatch_run.
+ *
+ * @param[in] disp A #dispatcher_t returned by #dispatch_create.
+ * @param[in] name The name of the consumer, for its statistics.
+ * @param[in] callback The function to call with each packet.
+ * @param[in] data The data to pass to the function.
+ * @param[in] lossy Indicates that the consumer can be skipped when buffers
+ *                  run low, rather than holding up the receive.
+ * @return The consumer's index upon success, a negative errno value on
+ *         failure.
+ **/
+int dispatch_add_consumer(dispatcher_t disp, const char *name,
+        dispatch_cb_t callback, void *data, bool lossy);
+
+/**
+ * Takes the buffers released by the consumers back to the service, then
+ * hands the next received packet to the consumers.
+ *
+ * This must be called from the thread that consumes the service's packets.
+ *
+ * @param[in] disp A #dispatcher_t returned by #dispatch_create.
+ * @param[in] timeout The time to wait for a packet in milliseconds. A negative
+ *                    value waits forever, and 0 does not wait at all.
+ * @return 1 if a packet was dispatched, 0 if none arrived before the timeout,
+ *         or if taking packets is paused.
+ **/
+int dispatch_run(dispatcher_t disp, int timeout);
+
+/**
+ * Releases a consumer's view of a packet. This can be called from any thread.
+ *
+ * @param[in] disp A #dispatcher_t returned by #dispatch_create.
+ * @param[in] view The view given to the consumer's function.
+ **/
+void dispatch_release(dispatcher_t disp, const struct dispatch_view *view);
+
+/**
+ * Gets the counters of a consumer.
+ *
+ * @param[in] disp A #dispatcher_t returned by #dispatch_create.
+ * @param[in] consumer The index returned by #dispatch_add_consumer.
+ * @param[out] stats Filled with the consumer's counters.
+ * @return The name of the consumer.
+ **/
+const char *dispatch_get_consumer_stats(dispatcher_t disp, int consumer,
+        struct dispatch_consumer_stats *stats);
+
+/**
+ * Gets the number of buffers held by the consumers.
+ *
+ * @param[in] disp A #dispatcher_t returned by #dispatch_create.
+ * @return The number of buffers that have not been released.
+ **/
+int dispatch_num_held(dispatcher_t disp);
+
+#endif /* DISPATCH_H_ */
@@ -0,0 +1,95 @@
+/**
+ * @file queue.c
+ * @date Saturday, October 17, 2026 at 06:29:48 PM EDT
+ *
+ * This file contains the implementation of the single-producer,
+ * single-consumer queue. The head is only written by the consumer and the
+ * tail only by the producer, so each side publishes its index with a release
+ * store, and reads the other side's with an acquire load.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>              // Error codes
+#include <time.h>               // Clock functions
+#include <semaphore.h>          // Semaphore functions
+
+#include "queue.h"              // Local definitions
+
+// Initializes the queue with a power of two number of slots
+int queue_init(struct spsc_queue *queue, int num_entries)
+{
+    unsigned int num_slots;
+
+    for (num_slots = 1; num_slots < (unsigned int)num_entries; num_slots *= 2);
+    queue->slots = calloc(num_slots, sizeof(queue->slots[0]));
+    if (queue->slots == NULL) {
+        return -ENOMEM;
+    }
+
+    queue->mask = num_slots - 1;
+    queue->head = 0;
+    queue->tail = 0;
+    sem_init(&queue->items, 0, 0);
+    return 0;
+}
+
+void queue_destroy(struct spsc_queue *queue)
+{
+    sem_destroy(&queue->items);
+    free(queue->slots);
+    return;
+}
+
+// Adds the entry at the tail, then counts it for the consumer
+int queue_push(struct spsc_queue *queue, void *entry)
+{
+    unsigned int tail;
+
+    tail = queue->tail;
+    if (tail - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) > queue->mask) {
+        return -ENOSPC;
+    }
+
+    queue->slots[tail & queue->mask] = entry;
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    sem_post(&queue->items);
+    return 0;
+}
+
+/* Claims an entry from the semaphore, waiting for up to the timeout for one,
+ * then takes it from the head. */
+void *queue_pop(struct spsc_queue *queue, int timeout)
+{
+    int rc;
+    void *entry;
+    unsigned int head;
+    struct timespec deadline;
+
+    if (timeout == 0) {
+        rc = sem_trywait(&queue->items);
+    } else if (timeout < 0) {
+        while ((rc = sem_wait(&queue->items)) < 0 && errno == EINTR);
+    } else {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += (long)(timeout % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000;
+        }
+        while ((rc = sem_timedwait(&queue->items, &deadline)) < 0 &&
+               errno == EINTR);
+    }
+    if (rc < 0) {
+        return NULL;
+    }
+
+    head = queue->head;
+    assert(head != __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE));
+    entry = queue->slots[head & queue->mask];
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    return entry;
+}
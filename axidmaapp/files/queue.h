@@ -0,0 +1,70 @@
+/**
+ * @file queue.h
+ * @date Saturday, October 17, 2026 at 06:21:15 PM EDT
+ *
+ * This file defines a bounded, lock-free queue of pointers, for passing
+ * buffers between exactly one producer thread and one consumer thread.
+ *
+ * A semaphore counts the entries in the queue, so that the consumer can sleep
+ * while it is empty. Posting the semaphore does not enter the kernel unless
+ * the consumer is asleep.
+ *
+ * @bug No known bugs.
+ **/
+
+#ifndef QUEUE_H_
+#define QUEUE_H_
+
+#include <semaphore.h>          // Semaphore type
+
+// Keeps the producer and consumer indices of a queue on separate cache lines
+#define QUEUE_CACHE_LINE_SIZE   64
+
+/**
+ * Structure representing a single-producer, single-consumer queue.
+ **/
+struct spsc_queue {
+    void **slots;               ///< The entries of the queue.
+    unsigned int mask;          ///< The number of slots minus 1.
+    sem_t items;                ///< Counts the entries in the queue.
+    unsigned int head __attribute__((aligned(QUEUE_CACHE_LINE_SIZE)));
+    unsigned int tail __attribute__((aligned(QUEUE_CACHE_LINE_SIZE)));
+};
+
+/**
+ * Initializes a queue with room for at least the given number of entries.
+ *
+ * @param[out] queue The queue to initialize.
+ * @param[in] num_entries The most entries that will be in the queue at once.
+ * @return 0 upon success, a negative errno value on failure.
+ **/
+int queue_init(struct spsc_queue *queue, int num_entries);
+
+/**
+ * Frees a queue's slots.
+ *
+ * @param[in] queue A queue initialized with #queue_init.
+ **/
+void queue_destroy(struct spsc_queue *queue);
+
+/**
+ * Adds an entry to the queue. This must only be called by the producer.
+ *
+ * @param[in] queue A queue initialized with #queue_init.
+ * @param[in] entry The entry to add.
+ * @return 0 upon success, or -ENOSPC if the queue is full.
+ **/
+int queue_push(struct spsc_queue *queue, void *entry);
+
+/**
+ * Removes the oldest entry from the queue. This must only be called by the
+ * consumer.
+ *
+ * @param[in] queue A queue initialized with #queue_init.
+ * @param[in] timeout The time to wait for an entry in milliseconds. A negative
+ *                    value waits forever, and 0 does not wait at all.
+ * @return The entry, or NULL if there was none before the timeout.
+ **/
+void *queue_pop(struct spsc_queue *queue, int timeout);
+
+#endif /* QUEUE_H_ */
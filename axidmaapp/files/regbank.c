@@ -0,0 +1,292 @@
+/**
+ * @file regbank.c
+ * @date Saturday, October 17, 2026 at 02:58:36 PM EDT
+ *
+ * This file contains the register bank implementation. A bank keeps a shadow
+ * copy of its registers, along with a mask of the registers that have staged
+ * writes, so that control writes are made together in one pass.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>             // Memset and strcmp functions
+#include <fcntl.h>              // Flags for open()
+#include <dirent.h>             // Directory listing for UIO devices
+#include <sys/mman.h>           // Mmap system call
+#include <unistd.h>             // Close() system call
+
+#include "regbank.h"            // Local definitions
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The directory listing the UIO devices, and the maximum length of a path
+#define UIO_CLASS_PATH          "/sys/class/uio"
+#define UIO_PATH_LEN            512
+
+// The structure that represents a bank of registers
+struct regbank {
+    volatile uint32_t *regs;    // The mapped registers
+    void *map;                  // The mapping, or the mock's memory
+    size_t size;                // The size of the bank in bytes
+    bool mock;                  // Indicates the bank is backed by memory
+    uint32_t *shadow;           // The staged value of each register
+    uint32_t *dirty;            // A bit for each register with a staged write
+    int num_dirty;              // The number of registers with staged writes
+    struct regbank_stats stats; // The number of register accesses made
+};
+
+// Gets the index of a register, and checks it is in the bank
+#define REG_INDEX(bank, offset) \
+    (assert((offset) % 4 == 0 && (offset) < (bank)->size), (offset) / 4)
+
+/*----------------------------------------------------------------------------
+ * Private Helper Functions
+ *----------------------------------------------------------------------------*/
+
+/* Finds the UIO device with the given name, filling in the path to it. Returns
+ * 0 if it was found, and -1 otherwise. */
+static int find_uio_device(const char *uio_name, char *dev_path, size_t len)
+{
+    int rc;
+    FILE *name_file;
+    DIR *uio_dir;
+    struct dirent *entry;
+    char name_path[UIO_PATH_LEN], name[UIO_PATH_LEN];
+
+    uio_dir = opendir(UIO_CLASS_PATH);
+    if (uio_dir == NULL) {
+        return -1;
+    }
+
+    // Check the name of each device against the one given
+    rc = -1;
+    while (rc < 0 && (entry = readdir(uio_dir)) != NULL)
+    {
+        if (strncmp(entry->d_name, "uio", 3) != 0) {
+            continue;
+        }
+
+        snprintf(name_path, sizeof(name_path), "%s/%s/name", UIO_CLASS_PATH,
+                 entry->d_name);
+        name_file = fopen(name_path, "r");
+        if (name_file == NULL) {
+            continue;
+        }
+        if (fgets(name, sizeof(name), name_file) != NULL) {
+            name[strcspn(name, "\n")] = '\0';
+            if (strcmp(name, uio_name) == 0) {
+                snprintf(dev_path, len, "/dev/%s", entry->d_name);
+                rc = 0;
+            }
+        }
+        fclose(name_file);
+    }
+
+    closedir(uio_dir);
+    return rc;
+}
+
+// Allocates a bank, and its shadow registers, over the given registers
+static regbank_t regbank_alloc(void *regs, size_t size, bool mock)
+{
+    regbank_t bank;
+    size_t num_regs;
+
+    bank = calloc(1, sizeof(*bank));
+    if (bank == NULL) {
+        return NULL;
+    }
+
+    num_regs = size / 4;
+    bank->shadow = calloc(num_regs, sizeof(uint32_t));
+    bank->dirty = calloc((num_regs + 31) / 32, sizeof(uint32_t));
+    if (bank->shadow == NULL || bank->dirty == NULL) {
+        free(bank->shadow);
+        free(bank->dirty);
+        free(bank);
+        return NULL;
+    }
+
+    bank->regs = regs;
+    bank->map = regs;
+    bank->size = size;
+    bank->mock = mock;
+    return bank;
+}
+
+/*----------------------------------------------------------------------------
+ * Public Interface
+ *----------------------------------------------------------------------------*/
+
+/* Maps the bank through its UIO device, or through /dev/mem if it has none.
+ * A UIO device's first mapping is at offset 0 of the device. */
+regbank_t regbank_open(const char *uio_name, unsigned long phys_addr,
+        size_t size)
+{
+    int fd;
+    void *regs;
+    off_t offset;
+    regbank_t bank;
+    char dev_path[UIO_PATH_LEN];
+
+    if (uio_name != NULL &&
+        find_uio_device(uio_name, dev_path, sizeof(dev_path)) == 0) {
+        fd = open(dev_path, O_RDWR | O_SYNC);
+        offset = 0;
+    } else {
+        snprintf(dev_path, sizeof(dev_path), "/dev/mem");
+        fd = open(dev_path, O_RDWR | O_SYNC);
+        offset = phys_addr;
+    }
+    if (fd < 0) {
+        fprintf(stderr, "Unable to open %s: ", dev_path);
+        perror("");
+        return NULL;
+    }
+
+    // The mapping holds its own reference to the file
+    regs = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+    close(fd);
+    if (regs == MAP_FAILED) {
+        perror("Unable to map the register bank");
+        return NULL;
+    }
+
+    bank = regbank_alloc(regs, size, false);
+    if (bank == NULL) {
+        munmap(regs, size);
+    }
+    return bank;
+}
+
+// Creates a bank whose registers are regular memory
+regbank_t regbank_mock(size_t size)
+{
+    void *regs;
+    regbank_t bank;
+
+    regs = calloc(1, size);
+    if (regs == NULL) {
+        return NULL;
+    }
+
+    bank = regbank_alloc(regs, size, true);
+    if (bank == NULL) {
+        free(regs);
+    }
+    return bank;
+}
+
+// Gets the memory behind a mock bank
+uint32_t *regbank_mock_regs(regbank_t bank)
+{
+    assert(bank->mock);
+    return bank->map;
+}
+
+// Writes out the staged writes, then releases the bank
+void regbank_close(regbank_t bank)
+{
+    regbank_flush(bank);
+
+    if (bank->mock) {
+        free(bank->map);
+    } else {
+        munmap(bank->map, bank->size);
+    }
+    free(bank->shadow);
+    free(bank->dirty);
+    free(bank);
+    return;
+}
+
+// Reads the register, making any staged writes first if it has one
+uint32_t regbank_read(regbank_t bank, size_t offset)
+{
+    size_t i;
+
+    i = REG_INDEX(bank, offset);
+    if (bank->dirty[i / 32] & (1U << (i % 32))) {
+        regbank_flush(bank);
+    }
+
+    bank->stats.reads += 1;
+    return bank->regs[i];
+}
+
+// Stages the write in the shadow copy of the register
+void regbank_write(regbank_t bank, size_t offset, uint32_t value)
+{
+    size_t i;
+
+    i = REG_INDEX(bank, offset);
+    if ((bank->dirty[i / 32] & (1U << (i % 32))) == 0) {
+        bank->dirty[i / 32] |= 1U << (i % 32);
+        bank->num_dirty += 1;
+    }
+    bank->shadow[i] = value;
+    return;
+}
+
+/* Writes each register with a staged write, from the lowest offset up. The
+ * writes are made after any earlier memory accesses of the process. */
+void regbank_flush(regbank_t bank)
+{
+    size_t i, word;
+    uint32_t mask;
+
+    if (bank->num_dirty == 0) {
+        return;
+    }
+
+    __sync_synchronize();
+    for (word = 0; bank->num_dirty > 0; word++)
+    {
+        for (mask = bank->dirty[word]; mask != 0; mask &= mask - 1)
+        {
+            i = word * 32 + __builtin_ctz(mask);
+            bank->regs[i] = bank->shadow[i];
+            bank->num_dirty -= 1;
+            bank->stats.writes += 1;
+        }
+        bank->dirty[word] = 0;
+    }
+    __sync_synchronize();
+
+    bank->stats.flushes += 1;
+    return;
+}
+
+// Reads the block of registers into the snapshot
+void regbank_snapshot(regbank_t bank, size_t offset, void *snapshot,
+        size_t size)
+{
+    size_t i, first;
+    uint32_t *values;
+
+    assert(size % 4 == 0 && offset + size <= bank->size);
+    regbank_flush(bank);
+
+    first = REG_INDEX(bank, offset);
+    values = snapshot;
+    for (i = 0; i < size / 4; i++)
+    {
+        values[i] = bank->regs[first + i];
+    }
+
+    bank->stats.reads += size / 4;
+    return;
+}
+
+// Gets the number of register accesses made
+void regbank_get_stats(regbank_t bank, struct regbank_stats *stats)
+{
+    memcpy(stats, &bank->stats, sizeof(*stats));
+    return;
+}
@@ -0,0 +1,174 @@
+/**
+ * @file regbank.h
+ * @date Saturday, October 17, 2026 at 02:41:09 PM EDT
+ *
+ * This file defines the register bank interface, which gives named access to
+ * a block of memory-mapped registers in the programmable logic. Each block is
+ * mapped once, through its UIO device if it has one, and otherwise through
+ * /dev/mem. Control writes are staged and written out together, and status
+ * registers can be read in one batch into a snapshot.
+ *
+ * @bug No known bugs.
+ **/
+
+#ifndef REGBANK_H_
+#define REGBANK_H_
+
+#include <stddef.h>             // Offsetof macro
+#include <stdint.h>             // Fixed-width integer types
+
+/*----------------------------------------------------------------------------
+ * Register Maps
+ *----------------------------------------------------------------------------*/
+
+/* The control block that the FPGA design keeps at the start of the BRAM. The
+ * fields are 32-bit registers, laid out as in the BRAM. */
+struct bram_ctrl {
+    uint32_t reserved;          // Unused by the application
+    uint32_t enable;            // Starts the logic feeding the DMA when 1
+};
+
+/* A mailbox in the BRAM, for passing short messages to or from the logic by
+ * programmed I/O. The writer fills in the length and the data, then bumps the
+ * sequence number. The reader takes the message, then sets the acknowledge to
+ * the sequence number, which frees the mailbox for the next message. A message
+ * sent by DMA instead is announced in the mailbox, with its length and the DMA
+ * flag, and no data. */
+#define BRAM_MAILBOX_WORDS      252
+struct bram_mailbox {
+    uint32_t sequence;          // Bumped by the writer for each message
+    uint32_t ack;               // The last sequence number the reader took
+    uint32_t length;            // The number of bytes in the message
+    uint32_t flags;             // How the message is sent, see below
+    uint32_t data[BRAM_MAILBOX_WORDS];  // The message, padded to whole words
+};
+
+// The message follows on the DMA stream, rather than in the mailbox's data
+#define BRAM_MAILBOX_DMA        (1 << 0)
+
+// The largest message in a mailbox, and the offsets of the two mailboxes
+#define BRAM_MAILBOX_SIZE       (BRAM_MAILBOX_WORDS * 4)
+#define BRAM_TX_MAILBOX         0x400   // Messages to the logic
+#define BRAM_RX_MAILBOX         0x800   // Messages from the logic
+
+// The physical address and size of the BRAM, and the name of its UIO device
+#define BRAM_CTRL_BASEADDR      0x42000000
+#define BRAM_CTRL_SIZE          (1024 * 4)
+#define BRAM_CTRL_UIO_NAME      "bram_ctrl"
+
+// Gets the offset of the named register in a register map
+#define REGBANK_REG(map, field) offsetof(struct map, field)
+
+/*----------------------------------------------------------------------------
+ * Register Bank Interface
+ *----------------------------------------------------------------------------*/
+
+/**
+ * The struct representing a bank of registers. This is an opaque type.
+ **/
+struct regbank;
+
+/**
+ * Type definition for a register bank.
+ **/
+typedef struct regbank* regbank_t;
+
+/**
+ * Structure holding the number of accesses made to the bank's registers.
+ **/
+struct regbank_stats {
+    unsigned long reads;        ///< The number of registers read.
+    unsigned long writes;       ///< The number of registers written.
+    unsigned long flushes;      ///< The number of batches of writes.
+};
+
+/**
+ * Maps a bank of registers into the process.
+ *
+ * The UIO device with the given name is used if there is one, otherwise the
+ * physical address is mapped through /dev/mem.
+ *
+ * @param[in] uio_name The name of the bank's UIO device, or NULL for none.
+ * @param[in] phys_addr The physical address of the bank, page-aligned.
+ * @param[in] size The size of the bank in bytes.
+ * @return A handle to the bank on success, NULL on failure.
+ **/
+regbank_t regbank_open(const char *uio_name, unsigned long phys_addr,
+        size_t size);
+
+/**
+ * Creates a bank of registers backed by regular memory, for testing the code
+ * that uses a bank without the hardware.
+ *
+ * @param[in] size The size of the bank in bytes.
+ * @return A handle to the bank on success, NULL on failure.
+ **/
+regbank_t regbank_mock(size_t size);
+
+/**
+ * Gets the memory behind a bank made with #regbank_mock, so that a test can
+ * set the value of status registers and check the value of control ones.
+ *
+ * @param[in] bank A #regbank_t returned by #regbank_mock.
+ * @return The memory backing the bank's registers.
+ **/
+uint32_t *regbank_mock_regs(regbank_t bank);
+
+/**
+ * Writes out any staged writes, then unmaps and frees the bank.
+ *
+ * @param[in] bank A #regbank_t returned by #regbank_open or #regbank_mock.
+ **/
+void regbank_close(regbank_t bank);
+
+/**
+ * Reads a register of the bank.
+ *
+ * If the register has a staged write, the staged writes are written out
+ * first, so that the read sees it.
+ *
+ * @param[in] bank A #regbank_t returned by #regbank_open or #regbank_mock.
+ * @param[in] offset The byte offset of the register, from #REGBANK_REG.
+ * @return The value of the register.
+ **/
+uint32_t regbank_read(regbank_t bank, size_t offset);
+
+/**
+ * Stages a write to a register of the bank.
+ *
+ * The write is not made until #regbank_flush is called, and writing the same
+ * register again before then only keeps the last value.
+ *
+ * @param[in] bank A #regbank_t returned by #regbank_open or #regbank_mock.
+ * @param[in] offset The byte offset of the register, from #REGBANK_REG.
+ * @param[in] value The value to write to the register.
+ **/
+void regbank_write(regbank_t bank, size_t offset, uint32_t value);
+
+/**
+ * Writes out the staged writes, in the order of the registers' offsets.
+ *
+ * @param[in] bank A #regbank_t returned by #regbank_open or #regbank_mock.
+ **/
+void regbank_flush(regbank_t bank);
+
+/**
+ * Reads a block of consecutive registers into a snapshot.
+ *
+ * @param[in] bank A #regbank_t returned by #regbank_open or #regbank_mock.
+ * @param[in] offset The byte offset of the first register.
+ * @param[out] snapshot Filled with the registers' values.
+ * @param[in] size The number of bytes to read, a multiple of 4.
+ **/
+void regbank_snapshot(regbank_t bank, size_t offset, void *snapshot,
+        size_t size);
+
+/**
+ * Gets the number of register accesses made to the bank so far.
+ *
+ * @param[in] bank A #regbank_t returned by #regbank_open or #regbank_mock.
+ * @param[out] stats Filled with the counts of reads, writes, and flushes.
+ **/
+void regbank_get_stats(regbank_t bank, struct regbank_stats *stats);
+
+#endif /* REGBANK_H_ */
@@ -0,0 +1,190 @@
+/**
+ * @file regbank_test.c
+ * @date Monday, October 19, 2026 at 11:02:47 AM EDT
+ *
+ * This file tests the register bank against a mock bank, so that it can be
+ * run on the build machine without the hardware. It checks that writes are
+ * staged until they are flushed, that a read sees the staged write to its
+ * register, that snapshots see the staged writes, and that the accesses are
+ * counted.
+ *
+ * Run it with `make test`.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>             // Memcmp function
+
+#include "regbank.h"            // Register bank interface
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// Counts the checks that failed, printing each one
+static int failures;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: Check failed: %s\n", __FILE__, \
+                    __LINE__, #cond); \
+            failures += 1; \
+        } \
+    } while (0)
+
+// Checks the bank's counts of reads, writes, and flushes
+static void check_stats(regbank_t bank, unsigned long reads,
+                        unsigned long writes, unsigned long flushes)
+{
+    struct regbank_stats stats;
+
+    regbank_get_stats(bank, &stats);
+    CHECK(stats.reads == reads);
+    CHECK(stats.writes == writes);
+    CHECK(stats.flushes == flushes);
+}
+
+/*----------------------------------------------------------------------------
+ * Tests
+ *----------------------------------------------------------------------------*/
+
+// Writes are only made by a flush, which keeps the last value of each register
+static void test_staged_writes(void)
+{
+    regbank_t bank;
+    uint32_t *regs;
+    size_t enable;
+
+    bank = regbank_mock(BRAM_CTRL_SIZE);
+    CHECK(bank != NULL);
+    regs = regbank_mock_regs(bank);
+    enable = REGBANK_REG(bram_ctrl, enable);
+
+    regbank_write(bank, enable, 2);
+    regbank_write(bank, enable, 1);
+    CHECK(regs[enable / 4] == 0);
+    check_stats(bank, 0, 0, 0);
+
+    regbank_flush(bank);
+    CHECK(regs[enable / 4] == 1);
+    check_stats(bank, 0, 1, 1);
+
+    // A flush with nothing staged makes no writes, and isn't counted
+    regbank_flush(bank);
+    check_stats(bank, 0, 1, 1);
+
+    regbank_close(bank);
+}
+
+/* Writes staged across many registers are all made by one flush, including
+ * the ones past the first word of the staged-write mask. */
+static void test_flush_all(void)
+{
+    size_t i, num_regs;
+    regbank_t bank;
+    uint32_t *regs;
+
+    bank = regbank_mock(BRAM_CTRL_SIZE);
+    CHECK(bank != NULL);
+    regs = regbank_mock_regs(bank);
+    num_regs = BRAM_CTRL_SIZE / 4;
+
+    // Stage every third register, from the end of the bank down
+    for (i = num_regs; i-- > 0; )
+    {
+        if (i % 3 == 0) {
+            regbank_write(bank, i * 4, 0x1000 + i);
+        }
+    }
+    regbank_flush(bank);
+
+    for (i = 0; i < num_regs; i++)
+    {
+        CHECK(regs[i] == ((i % 3 == 0) ? 0x1000 + i : 0));
+    }
+    check_stats(bank, 0, (num_regs + 2) / 3, 1);
+
+    regbank_close(bank);
+}
+
+/* Reading a register with a staged write makes the staged writes first, but
+ * reading one without leaves them staged. */
+static void test_read_flushes(void)
+{
+    regbank_t bank;
+    uint32_t *regs;
+    size_t tx_ack, rx_ack;
+
+    bank = regbank_mock(BRAM_CTRL_SIZE);
+    CHECK(bank != NULL);
+    regs = regbank_mock_regs(bank);
+    tx_ack = BRAM_TX_MAILBOX + REGBANK_REG(bram_mailbox, ack);
+    rx_ack = BRAM_RX_MAILBOX + REGBANK_REG(bram_mailbox, ack);
+
+    // The status register is set by the logic, which the mock stands in for
+    regs[rx_ack / 4] = 7;
+    regbank_write(bank, tx_ack, 5);
+    CHECK(regbank_read(bank, rx_ack) == 7);
+    CHECK(regs[tx_ack / 4] == 0);
+    check_stats(bank, 1, 0, 0);
+
+    CHECK(regbank_read(bank, tx_ack) == 5);
+    CHECK(regs[tx_ack / 4] == 5);
+    check_stats(bank, 2, 1, 1);
+
+    regbank_close(bank);
+}
+
+// A snapshot reads the block of registers, after making the staged writes
+static void test_snapshot(void)
+{
+    regbank_t bank;
+    uint32_t *regs;
+    size_t base;
+    struct bram_mailbox mailbox;
+    static const char message[] = "hello";
+
+    bank = regbank_mock(BRAM_CTRL_SIZE);
+    CHECK(bank != NULL);
+    regs = regbank_mock_regs(bank);
+    base = BRAM_RX_MAILBOX;
+
+    regs[(base + REGBANK_REG(bram_mailbox, sequence)) / 4] = 3;
+    regs[(base + REGBANK_REG(bram_mailbox, length)) / 4] = sizeof(message);
+    memcpy(&regs[(base + REGBANK_REG(bram_mailbox, data)) / 4], message,
+           sizeof(message));
+    regbank_write(bank, base + REGBANK_REG(bram_mailbox, ack), 2);
+
+    regbank_snapshot(bank, base, &mailbox, sizeof(mailbox));
+    CHECK(mailbox.sequence == 3);
+    CHECK(mailbox.ack == 2);
+    CHECK(mailbox.length == sizeof(message));
+    CHECK(memcmp(mailbox.data, message, sizeof(message)) == 0);
+    check_stats(bank, sizeof(mailbox) / 4, 1, 1);
+
+    regbank_close(bank);
+}
+
+/*----------------------------------------------------------------------------
+ * Main Function
+ *----------------------------------------------------------------------------*/
+
+int main()
+{
+    test_staged_writes();
+    test_flush_all();
+    test_read_flushes();
+    test_snapshot();
+
+    if (failures > 0) {
+        printf("regbank: %d checks failed.\n", failures);
+        return 1;
+    }
+
+    printf("regbank: all tests passed.\n");
+    return 0;
+}
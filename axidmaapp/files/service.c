@@ -0,0 +1,516 @@
+/**
+ * @file service.c
+ * @date Saturday, October 17, 2026 at 04:05:19 PM EDT
+ *
+ * This file contains the implementation of the transfer service.
+ *
+ * Each direction has a queue of free buffers and a queue of full ones. Every
+ * queue has a single producer and a single consumer, one of them being the
+ * application, so the queues are lock-free (see queue.h). Each queue has a
+ * slot for every packet, so pushing to one never fails.
+ *
+ * When the receive channel supports it, the receive thread drives it through
+ * a userspace ring, and the packets are the ring's own buffers. A buffer
+ * given back by the application is posted to the engine again by the receive
+ * thread, which is the only thread that touches the ring. The ring is polled
+ * while packets keep arriving, and the thread sleeps on the channel's
+ * interrupt once the ring has been idle for its budget. Otherwise, the
+ * receive thread makes a blocking transfer into each free buffer in turn.
+ *
+ * @bug In the fallback mode, stopping the service waits for the receive in
+ *      progress, which is until the driver's timeout if no data arrives.
+ **/
+
+#define _GNU_SOURCE             // CPU affinity functions
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>             // Memset function
+#include <errno.h>              // Error codes
+#include <time.h>               // Clock functions
+#include <pthread.h>            // Thread functions
+#include <sched.h>              // CPU sets
+
+#include "service.h"            // Local definitions
+#include "queue.h"              // Lock-free queues between the threads
+#include "applog.h"             // Logging off the transfer path
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The time the threads wait for work before checking if they should stop
+#define SERVICE_POLL_MS         100
+
+// The queues, buffers and counters for one direction of the service
+struct service_dir {
+    struct spsc_queue free;     // Buffers that are free to fill
+    struct spsc_queue full;     // Buffers holding a packet
+    struct service_packet *packets;     // All of the direction's packets
+    struct service_stats stats; // The counters for the direction
+    pthread_t thread;           // The thread serving the direction
+    bool thread_started;        // Indicates the thread is running
+};
+
+// The structure that represents a running service
+struct service {
+    axidma_dev_t dev;           // The AXI DMA device
+    struct service_config config;   // The parameters of the service
+    axidma_ring_t rx_ring;      // The receive ring, or NULL for none
+    int stopping;               // Tells the threads to exit
+    struct service_dir tx;      // The transmit side
+    struct service_dir rx;      // The receive side
+};
+
+/*----------------------------------------------------------------------------
+ * Private Helper Functions
+ *----------------------------------------------------------------------------*/
+
+// Gets the current time in nanoseconds, from the monotonic clock
+static uint64_t get_time_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* Counts a transfer in the direction's counters. Each counter has only one
+ * thread that updates it, and the stores are atomic so that the counters can
+ * be read at any time. */
+static void count_transfer(struct service_stats *stats, size_t length,
+        bool error)
+{
+    if (error) {
+        __atomic_store_n(&stats->errors, stats->errors + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    __atomic_store_n(&stats->packets, stats->packets + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&stats->bytes, stats->bytes + length, __ATOMIC_RELAXED);
+    return;
+}
+
+// Counts the latency of a packet in the direction's counters
+static void count_latency(struct service_stats *stats, uint64_t latency)
+{
+    __atomic_store_n(&stats->latency_total, stats->latency_total + latency,
+                     __ATOMIC_RELAXED);
+    if (latency < stats->latency_min || stats->latency_min == 0) {
+        __atomic_store_n(&stats->latency_min, latency, __ATOMIC_RELAXED);
+    }
+    if (latency > stats->latency_max) {
+        __atomic_store_n(&stats->latency_max, latency, __ATOMIC_RELAXED);
+    }
+    return;
+}
+
+/* Pins the calling thread to the given CPU, unless it is negative. This runs
+ * in the service's threads, so failures go to the log. */
+static void pin_thread(int cpu, const char *name)
+{
+    int rc;
+    cpu_set_t cpus;
+
+    if (cpu < 0) {
+        return;
+    }
+
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (rc != 0) {
+        applog_message("Unable to pin the %s thread to CPU %d: %s", name,
+                       cpu, strerror(rc));
+    }
+    return;
+}
+
+static bool service_stopping(service_t svc)
+{
+    return __atomic_load_n(&svc->stopping, __ATOMIC_ACQUIRE);
+}
+
+/*----------------------------------------------------------------------------
+ * Service Threads
+ *----------------------------------------------------------------------------*/
+
+/* Receives through the userspace ring. Buffers given back by the application
+ * are posted again, and completed ones are queued for the application, until
+ * the service is stopped. When nothing completes, the thread waits on the
+ * ring, which polls it for the idle budget before sleeping. With no buffers
+ * posted, it waits for the application to give one back instead. */
+static void rx_ring_loop(service_t svc)
+{
+    int reaped;
+    struct service_packet *packet;
+    struct axidma_ring_completion done;
+
+    while (!service_stopping(svc))
+    {
+        // Post the buffers that the application has finished with
+        while ((packet = queue_pop(&svc->rx.free, 0)) != NULL)
+        {
+            axidma_ring_post(svc->rx_ring, packet - svc->rx.packets,
+                             svc->config.packet_size);
+        }
+
+        // Hand the completed buffers to the application
+        reaped = 0;
+        while (axidma_ring_reap(svc->rx_ring, &done) > 0)
+        {
+            reaped += 1;
+            packet = &svc->rx.packets[done.buffer_index];
+            packet->length = done.length;
+            packet->timestamp = get_time_ns();
+            packet->error = done.error;
+            count_transfer(&svc->rx.stats, done.length, done.error);
+            queue_push(&svc->rx.full, packet);
+        }
+
+        if (axidma_ring_pending(svc->rx_ring) > 0 &&
+            axidma_ring_status(svc->rx_ring) < 0) {
+            applog_message("The receive ring halted on an error.");
+            break;
+        }
+
+        if (reaped > 0) {
+            continue;
+        } else if (axidma_ring_pending(svc->rx_ring) > 0) {
+            axidma_ring_wait(svc->rx_ring, SERVICE_POLL_MS);
+        } else if ((packet = queue_pop(&svc->rx.free, SERVICE_POLL_MS)) !=
+                   NULL) {
+            axidma_ring_post(svc->rx_ring, packet - svc->rx.packets,
+                             svc->config.packet_size);
+        }
+    }
+
+    return;
+}
+
+/* Receives through the driver, one blocking transfer into each free buffer.
+ * The length of the packet is not known, so the whole buffer is handed on. */
+static void rx_transfer_loop(service_t svc)
+{
+    int rc;
+    struct service_packet *packet;
+
+    while (!service_stopping(svc))
+    {
+        packet = queue_pop(&svc->rx.free, SERVICE_POLL_MS);
+        if (packet == NULL) {
+            continue;
+        }
+
+        // A timeout means that the fabric had nothing to send
+        rc = axidma_oneway_transfer(svc->dev, svc->config.rx_channel,
+                packet->data, svc->config.packet_size, true);
+        if (rc < 0 && errno == ETIMEDOUT) {
+            queue_push(&svc->rx.free, packet);
+            continue;
+        }
+
+        packet->length = svc->config.packet_size;
+        packet->timestamp = get_time_ns();
+        packet->error = rc < 0;
+        count_transfer(&svc->rx.stats, packet->length, packet->error);
+        queue_push(&svc->rx.full, packet);
+    }
+
+    return;
+}
+
+static void *rx_thread(void *arg)
+{
+    service_t svc;
+
+    svc = arg;
+    pin_thread(svc->config.rx_cpu, "receive");
+    if (svc->rx_ring != NULL) {
+        rx_ring_loop(svc);
+    } else {
+        rx_transfer_loop(svc);
+    }
+
+    return NULL;
+}
+
+/* Sends the queued packets. Once a packet is queued, up to a batch of them are
+ * sent before the buffers are given back, so that the application is woken
+ * once per batch rather than once per packet. */
+static void *tx_thread(void *arg)
+{
+    int i, rc, num_packets;
+    service_t svc;
+    struct service_packet *packet, **batch;
+
+    svc = arg;
+    pin_thread(svc->config.tx_cpu, "transmit");
+    batch = calloc(svc->config.tx_batch, sizeof(batch[0]));
+    if (batch == NULL) {
+        perror("Unable to allocate the transmit batch");
+        return NULL;
+    }
+
+    while (!service_stopping(svc))
+    {
+        packet = queue_pop(&svc->tx.full, SERVICE_POLL_MS);
+        if (packet == NULL) {
+            continue;
+        }
+
+        // Gather the packets already queued behind the first
+        num_packets = 0;
+        do {
+            batch[num_packets] = packet;
+            num_packets += 1;
+        } while (num_packets < svc->config.tx_batch &&
+                 (packet = queue_pop(&svc->tx.full, 0)) != NULL);
+
+        for (i = 0; i < num_packets; i++)
+        {
+            packet = batch[i];
+            rc = axidma_oneway_transfer(svc->dev, svc->config.tx_channel,
+                    packet->data, packet->length, true);
+            count_transfer(&svc->tx.stats, packet->length, rc < 0);
+            if (rc == 0) {
+                count_latency(&svc->tx.stats,
+                              get_time_ns() - packet->timestamp);
+            }
+        }
+
+        for (i = 0; i < num_packets; i++)
+        {
+            queue_push(&svc->tx.free, batch[i]);
+        }
+    }
+
+    free(batch);
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ * Setup and Teardown
+ *----------------------------------------------------------------------------*/
+
+// Frees the direction's queues and the buffers that came from the device
+static void dir_destroy(service_t svc, struct service_dir *dir, bool dma_bufs)
+{
+    int i;
+
+    if (dir->packets != NULL) {
+        for (i = 0; dma_bufs && i < svc->config.num_buffers; i++)
+        {
+            if (dir->packets[i].data != NULL) {
+                axidma_free(svc->dev, dir->packets[i].data,
+                            svc->config.packet_size);
+            }
+        }
+        free(dir->packets);
+    }
+    queue_destroy(&dir->free);
+    queue_destroy(&dir->full);
+    return;
+}
+
+/* Sets up the direction's queues and packets. Unless the buffers are given,
+ * they are allocated from the device. Every packet starts out free. */
+static int dir_init(service_t svc, struct service_dir *dir, axidma_ring_t ring)
+{
+    int i, num_buffers;
+
+    num_buffers = svc->config.num_buffers;
+    if (queue_init(&dir->free, num_buffers) < 0) {
+        return -ENOMEM;
+    } else if (queue_init(&dir->full, num_buffers) < 0) {
+        queue_destroy(&dir->free);
+        return -ENOMEM;
+    }
+
+    dir->packets = calloc(num_buffers, sizeof(dir->packets[0]));
+    if (dir->packets == NULL) {
+        dir_destroy(svc, dir, false);
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < num_buffers; i++)
+    {
+        if (ring != NULL) {
+            dir->packets[i].data = axidma_ring_buffer(ring, i);
+        } else {
+            dir->packets[i].data = axidma_malloc(svc->dev,
+                                                 svc->config.packet_size);
+        }
+        if (dir->packets[i].data == NULL) {
+            dir_destroy(svc, dir, ring == NULL);
+            return -ENOMEM;
+        }
+        queue_push(&dir->free, &dir->packets[i]);
+    }
+
+    return 0;
+}
+
+/* Allocates the buffers for both directions, attaching a ring to the receive
+ * channel if it supports one, then starts the threads. */
+service_t service_start(axidma_dev_t dev, const struct service_config *config)
+{
+    int rc;
+    service_t svc;
+
+    if (config->num_buffers < AXIDMA_RING_MIN_DESCRIPTORS ||
+        config->num_buffers > AXIDMA_RING_MAX_DESCRIPTORS ||
+        config->packet_size == 0 || config->tx_batch <= 0) {
+        fprintf(stderr, "Invalid service parameters.\n");
+        return NULL;
+    }
+
+    svc = calloc(1, sizeof(*svc));
+    if (svc == NULL) {
+        perror("Unable to allocate the service");
+        return NULL;
+    }
+    svc->dev = dev;
+    memcpy(&svc->config, config, sizeof(svc->config));
+
+    // Drive the receive channel from userspace if the core allows it
+    svc->rx_ring = axidma_ring_attach(dev, config->rx_channel,
+            config->num_buffers, config->packet_size);
+    if (svc->rx_ring == NULL) {
+        printf("Receiving through the driver, without a ring.\n");
+    } else if (config->rx_idle_budget >= 0) {
+        axidma_ring_set_idle_budget(svc->rx_ring, config->rx_idle_budget);
+    }
+
+    if (dir_init(svc, &svc->tx, NULL) < 0) {
+        fprintf(stderr, "Unable to allocate the transmit buffers.\n");
+        goto detach_ring;
+    }
+    if (dir_init(svc, &svc->rx, svc->rx_ring) < 0) {
+        fprintf(stderr, "Unable to allocate the receive buffers.\n");
+        goto destroy_tx;
+    }
+
+    rc = pthread_create(&svc->rx.thread, NULL, rx_thread, svc);
+    if (rc != 0) {
+        fprintf(stderr, "Unable to start the receive thread: %s\n",
+                strerror(rc));
+        goto destroy_rx;
+    }
+    svc->rx.thread_started = true;
+
+    rc = pthread_create(&svc->tx.thread, NULL, tx_thread, svc);
+    if (rc != 0) {
+        fprintf(stderr, "Unable to start the transmit thread: %s\n",
+                strerror(rc));
+        service_stop(svc);
+        return NULL;
+    }
+    svc->tx.thread_started = true;
+
+    return svc;
+
+destroy_rx:
+    dir_destroy(svc, &svc->rx, svc->rx_ring == NULL);
+destroy_tx:
+    dir_destroy(svc, &svc->tx, true);
+detach_ring:
+    if (svc->rx_ring != NULL) {
+        axidma_ring_detach(svc->rx_ring);
+    }
+    free(svc);
+    return NULL;
+}
+
+// Tells the threads to stop, waits for them, then frees the service
+void service_stop(service_t svc)
+{
+    __atomic_store_n(&svc->stopping, true, __ATOMIC_RELEASE);
+    if (svc->rx.thread_started) {
+        pthread_join(svc->rx.thread, NULL);
+    }
+    if (svc->tx.thread_started) {
+        pthread_join(svc->tx.thread, NULL);
+    }
+
+    dir_destroy(svc, &svc->rx, svc->rx_ring == NULL);
+    dir_destroy(svc, &svc->tx, true);
+    if (svc->rx_ring != NULL) {
+        axidma_ring_detach(svc->rx_ring);
+    }
+    free(svc);
+    return;
+}
+
+/*----------------------------------------------------------------------------
+ * Application Interface
+ *----------------------------------------------------------------------------*/
+
+// Takes a free transmit buffer
+struct service_packet *service_tx_get(service_t svc, int timeout)
+{
+    return queue_pop(&svc->tx.free, timeout);
+}
+
+// Queues the packet for the transmit thread, stamping it for its latency
+void service_tx_put(service_t svc, struct service_packet *packet)
+{
+    assert(packet->length > 0 && packet->length <= svc->config.packet_size);
+
+    packet->timestamp = get_time_ns();
+    queue_push(&svc->tx.full, packet);
+    return;
+}
+
+/* Takes the next received packet. The time it spent queued is counted as its
+ * latency, here, since only the application takes received packets. */
+struct service_packet *service_rx_get(service_t svc, int timeout)
+{
+    struct service_packet *packet;
+
+    packet = queue_pop(&svc->rx.full, timeout);
+    if (packet != NULL && !packet->error) {
+        count_latency(&svc->rx.stats, get_time_ns() - packet->timestamp);
+    }
+    return packet;
+}
+
+// Gives the buffer back to the receive thread
+void service_rx_put(service_t svc, struct service_packet *packet)
+{
+    queue_push(&svc->rx.free, packet);
+    return;
+}
+
+// Reads each of the counters for both directions
+static void read_stats(const struct service_stats *stats,
+        struct service_stats *copy)
+{
+    copy->packets = __atomic_load_n(&stats->packets, __ATOMIC_RELAXED);
+    copy->bytes = __atomic_load_n(&stats->bytes, __ATOMIC_RELAXED);
+    copy->errors = __atomic_load_n(&stats->errors, __ATOMIC_RELAXED);
+    copy->latency_total = __atomic_load_n(&stats->latency_total,
+                                          __ATOMIC_RELAXED);
+    copy->latency_min = __atomic_load_n(&stats->latency_min, __ATOMIC_RELAXED);
+    copy->latency_max = __atomic_load_n(&stats->latency_max, __ATOMIC_RELAXED);
+    return;
+}
+
+void service_get_stats(service_t svc, struct service_stats *tx_stats,
+        struct service_stats *rx_stats)
+{
+    read_stats(&svc->tx.stats, tx_stats);
+    read_stats(&svc->rx.stats, rx_stats);
+    return;
+}
+
+int service_get_ring_stats(service_t svc, struct axidma_ring_stats *stats)
+{
+    if (svc->rx_ring == NULL) {
+        return -ENODEV;
+    }
+
+    return axidma_ring_get_stats(svc->rx_ring, stats);
+}
@@ -0,0 +1,167 @@
+/**
+ * @file service.h
+ * @date Saturday, October 17, 2026 at 03:37:52 PM EDT
+ *
+ * This file defines the interface to the transfer service, which runs the
+ * receive and transmit sides of the AXI DMA in their own threads.
+ *
+ * The receive thread polls the receive channel and hands each packet to the
+ * application through a lock-free queue. The transmit thread drains a queue
+ * of outbound packets in batches. Packets live in DMA buffers that are
+ * allocated once when the service starts, and are passed between the
+ * application and the threads without being copied.
+ *
+ * @bug No known bugs.
+ **/
+
+#ifndef SERVICE_H_
+#define SERVICE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "axidmaapp.h"          // Interface to the AXI DMA library
+
+/*----------------------------------------------------------------------------
+ * Service Definitions
+ *----------------------------------------------------------------------------*/
+
+// The default number of buffers for each direction, and transmit batch size
+#define SERVICE_DEFAULT_BUFFERS     64
+#define SERVICE_DEFAULT_TX_BATCH    8
+
+/**
+ * Structure holding the parameters of the service.
+ **/
+struct service_config {
+    int tx_channel;             ///< DMA channel to transmit packets on.
+    int rx_channel;             ///< DMA channel to receive packets on.
+    size_t packet_size;         ///< The largest packet, in bytes.
+    int num_buffers;            ///< The number of buffers for each direction.
+    int tx_batch;               ///< The most packets sent per wakeup.
+    int rx_cpu;                 ///< CPU to pin the receive thread to, or -1.
+    int tx_cpu;                 ///< CPU to pin the transmit thread to, or -1.
+    int rx_idle_budget;         ///< Microseconds to poll an idle receive ring
+                                ///< before sleeping, or -1 for the default.
+};
+
+/**
+ * Structure representing a packet, held in one of the service's buffers.
+ **/
+struct service_packet {
+    void *data;                 ///< The DMA buffer holding the packet.
+    size_t length;              ///< The number of bytes in the packet.
+    uint64_t timestamp;         ///< Time it was queued, in CLOCK_MONOTONIC ns.
+    bool error;                 ///< The packet was received with an error.
+};
+
+/**
+ * Structure holding the counters for one direction of the service.
+ *
+ * The latency of a transmitted packet is from when it was queued until its
+ * transfer finished. The latency of a received packet is from when it was
+ * received until the application took it from the queue.
+ **/
+struct service_stats {
+    uint64_t packets;           ///< The number of packets transferred.
+    uint64_t bytes;             ///< The number of bytes transferred.
+    uint64_t errors;            ///< The number of failed transfers.
+    uint64_t latency_total;     ///< The sum of the latencies, in ns.
+    uint64_t latency_min;       ///< The lowest latency, in ns.
+    uint64_t latency_max;       ///< The highest latency, in ns.
+};
+
+/**
+ * The struct representing a running service. This is an opaque type.
+ **/
+struct service;
+
+/**
+ * Type definition for a running service.
+ **/
+typedef struct service* service_t;
+
+/*----------------------------------------------------------------------------
+ * Service Interface
+ *----------------------------------------------------------------------------*/
+
+/**
+ * Allocates the service's buffers, and starts its receive and transmit
+ * threads.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] config The parameters of the service.
+ * @return A handle to the service on success, NULL on failure.
+ **/
+service_t service_start(axidma_dev_t dev, const struct service_config *config);
+
+/**
+ * Stops the service's threads, waiting for them to exit, and frees its
+ * buffers. Packets still queued for transmit are not sent.
+ *
+ * @param[in] svc A #service_t returned by #service_start.
+ **/
+void service_stop(service_t svc);
+
+/**
+ * Takes a free buffer to build an outbound packet in.
+ *
+ * @param[in] svc A #service_t returned by #service_start.
+ * @param[in] timeout The time to wait for a buffer in milliseconds. A negative
+ *                    value waits forever, and 0 does not wait at all.
+ * @return A packet whose buffer is #service_config.packet_size bytes, or NULL
+ *         if none was freed before the timeout.
+ **/
+struct service_packet *service_tx_get(service_t svc, int timeout);
+
+/**
+ * Queues a packet taken with #service_tx_get for transmit. The buffer belongs
+ * to the service again after this call.
+ *
+ * @param[in] svc A #service_t returned by #service_start.
+ * @param[in] packet The packet, with its length set.
+ **/
+void service_tx_put(service_t svc, struct service_packet *packet);
+
+/**
+ * Takes the next received packet.
+ *
+ * @param[in] svc A #service_t returned by #service_start.
+ * @param[in] timeout The time to wait for a packet in milliseconds. A negative
+ *                    value waits forever, and 0 does not wait at all.
+ * @return The packet, or NULL if none arrived before the timeout.
+ **/
+struct service_packet *service_rx_get(service_t svc, int timeout);
+
+/**
+ * Gives a packet taken with #service_rx_get back to the service, so that its
+ * buffer can receive another packet.
+ *
+ * @param[in] svc A #service_t returned by #service_start.
+ * @param[in] packet The packet to give back.
+ **/
+void service_rx_put(service_t svc, struct service_packet *packet);
+
+/**
+ * Gets the counters for both directions of the service.
+ *
+ * @param[in] svc A #service_t returned by #service_start.
+ * @param[out] tx_stats Filled with the counters for transmitted packets.
+ * @param[out] rx_stats Filled with the counters for received packets.
+ **/
+void service_get_stats(service_t svc, struct service_stats *tx_stats,
+        struct service_stats *rx_stats);
+
+/**
+ * Gets the counters of how the receive ring was waited on: the switches
+ * between polling it and sleeping on its interrupt, and the time in each.
+ *
+ * @param[in] svc A #service_t returned by #service_start.
+ * @param[out] stats Filled with the receive ring's counters.
+ * @return 0 upon success, a negative errno value on failure. This is -ENODEV
+ *         if the service receives without a ring.
+ **/
+int service_get_ring_stats(service_t svc, struct axidma_ring_stats *stats);
+
+#endif /* SERVICE_H_ */
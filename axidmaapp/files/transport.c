@@ -0,0 +1,354 @@
+/**
+ * @file transport.c
+ * @date Sunday, October 18, 2026 at 12:31:52 AM EDT
+ *
+ * This file contains the implementation of the message transport.
+ *
+ * A message is put in the mailbox by staging its words and length in the
+ * register bank and flushing them, then bumping the sequence number in a
+ * second flush, so the logic never sees the new sequence number before the
+ * message. Taking a message from the mailbox reads it in one snapshot, then
+ * acknowledges it. A message that the logic sends by DMA is still announced
+ * in the mailbox, so the receiver learns the path and length from the logic
+ * rather than guessing them. The mailboxes are polled without sleeping, since
+ * the messages they are used for are the ones that latency matters most for.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>             // Memcpy function
+#include <errno.h>              // Error codes
+#include <time.h>               // Clock functions
+
+#include "transport.h"          // Local definitions
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// Gets the offset of a field of one of the mailboxes in the BRAM
+#define MAILBOX_REG(mailbox, field) \
+    ((mailbox) + REGBANK_REG(bram_mailbox, field))
+
+// The structure that represents a transport
+struct transport {
+    axidma_dev_t dev;           // The AXI DMA device
+    regbank_t bram;             // The BRAM holding the mailboxes
+    struct transport_config config;     // The parameters of the transport
+    void *tx_buf;               // The DMA buffer for sent messages
+    void *rx_buf;               // The DMA buffer for received messages
+    uint32_t tx_sequence;       // The last sequence number sent
+    uint32_t rx_sequence;       // The last sequence number taken
+    uint32_t words[BRAM_MAILBOX_WORDS];     // A message padded to words
+    struct transport_stats stats;   // The counts of messages on each path
+};
+
+/*----------------------------------------------------------------------------
+ * Private Helper Functions
+ *----------------------------------------------------------------------------*/
+
+// Gets the current time in nanoseconds
+static uint64_t get_time_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// Checks if a wait that started at the given time has timed out
+static bool timed_out(uint64_t start_ns, int timeout)
+{
+    return timeout >= 0 &&
+           get_time_ns() - start_ns >= (uint64_t)timeout * 1000000;
+}
+
+// Waits for the logic to acknowledge the last message put in its mailbox
+static int pio_wait_ack(transport_t trans, int timeout)
+{
+    uint64_t start_ns;
+
+    start_ns = get_time_ns();
+    while (regbank_read(trans->bram, MAILBOX_REG(BRAM_TX_MAILBOX, ack)) !=
+            trans->tx_sequence)
+    {
+        if (timed_out(start_ns, timeout)) {
+            return -ETIMEDOUT;
+        }
+    }
+
+    return 0;
+}
+
+/* Puts the message in the mailbox to the logic, once the logic has
+ * acknowledged the previous message. */
+static int pio_send(transport_t trans, const void *msg, size_t len,
+        int timeout)
+{
+    int rc;
+    size_t i;
+
+    rc = pio_wait_ack(trans, timeout);
+    if (rc < 0) {
+        return rc;
+    }
+
+    // Write the message and its length, then ring the doorbell
+    if (len % 4 != 0) {
+        trans->words[len / 4] = 0;
+    }
+    memcpy(trans->words, msg, len);
+    for (i = 0; i < (len + 3) / 4; i++)
+    {
+        regbank_write(trans->bram, MAILBOX_REG(BRAM_TX_MAILBOX, data) + i * 4,
+                      trans->words[i]);
+    }
+    regbank_write(trans->bram, MAILBOX_REG(BRAM_TX_MAILBOX, length), len);
+    regbank_write(trans->bram, MAILBOX_REG(BRAM_TX_MAILBOX, flags), 0);
+    regbank_flush(trans->bram);
+    trans->tx_sequence += 1;
+    regbank_write(trans->bram, MAILBOX_REG(BRAM_TX_MAILBOX, sequence),
+                  trans->tx_sequence);
+    regbank_flush(trans->bram);
+
+    trans->stats.pio_sent += 1;
+    return 0;
+}
+
+// Copies the message into the DMA buffer, and sends it
+static int dma_send(transport_t trans, const void *msg, size_t len)
+{
+    memcpy(trans->tx_buf, msg, len);
+    if (axidma_oneway_transfer(trans->dev, trans->config.tx_channel,
+            trans->tx_buf, len, true) < 0) {
+        return -errno;
+    }
+
+    trans->stats.dma_sent += 1;
+    return 0;
+}
+
+// Acknowledges the message in the mailbox from the logic, freeing the mailbox
+static void pio_ack(transport_t trans, uint32_t sequence)
+{
+    trans->rx_sequence = sequence;
+    regbank_write(trans->bram, MAILBOX_REG(BRAM_RX_MAILBOX, ack), sequence);
+    regbank_flush(trans->bram);
+}
+
+/* Takes the message from the mailbox, and acknowledges it. A message too long
+ * for the buffer is acknowledged as well, so that it does not block the
+ * mailbox. */
+static ssize_t pio_receive(transport_t trans, void *buf, size_t len,
+        uint32_t sequence, uint32_t length)
+{
+    if (length <= len && length <= BRAM_MAILBOX_SIZE) {
+        regbank_snapshot(trans->bram, MAILBOX_REG(BRAM_RX_MAILBOX, data),
+                         trans->words, (length + 3) & ~3U);
+        memcpy(buf, trans->words, length);
+    }
+
+    pio_ack(trans, sequence);
+    if (length > len || length > BRAM_MAILBOX_SIZE) {
+        return -EMSGSIZE;
+    }
+
+    trans->stats.pio_received += 1;
+    return length;
+}
+
+/* Acknowledges the message's announcement in the mailbox, then receives the
+ * message itself into the DMA buffer, and copies it out. A message too long
+ * for the caller's buffer is still received, so that it doesn't hold up the
+ * stream, but one too long for the DMA buffer is left on the stream. */
+static ssize_t dma_receive(transport_t trans, void *buf, size_t len,
+        uint32_t sequence, uint32_t length)
+{
+    pio_ack(trans, sequence);
+    if (length > trans->config.max_message) {
+        return -EMSGSIZE;
+    }
+
+    if (axidma_oneway_transfer(trans->dev, trans->config.rx_channel,
+            trans->rx_buf, length, true) < 0) {
+        return -errno;
+    }
+    if (length > len) {
+        return -EMSGSIZE;
+    }
+    memcpy(buf, trans->rx_buf, length);
+
+    trans->stats.dma_received += 1;
+    return length;
+}
+
+/*----------------------------------------------------------------------------
+ * Public Interface
+ *----------------------------------------------------------------------------*/
+
+/* Allocates the DMA buffers, and picks up the sequence numbers where the
+ * mailboxes were left, so that a message already taken is not taken again. */
+transport_t transport_open(axidma_dev_t dev, regbank_t bram,
+        const struct transport_config *config)
+{
+    transport_t trans;
+
+    trans = calloc(1, sizeof(*trans));
+    if (trans == NULL) {
+        return NULL;
+    }
+    trans->dev = dev;
+    trans->bram = bram;
+    trans->config = *config;
+    if (trans->config.pio_threshold > BRAM_MAILBOX_SIZE) {
+        trans->config.pio_threshold = BRAM_MAILBOX_SIZE;
+    }
+
+    trans->tx_buf = axidma_malloc(dev, config->max_message);
+    if (trans->tx_buf == NULL) {
+        goto free_trans;
+    }
+    trans->rx_buf = axidma_malloc(dev, config->max_message);
+    if (trans->rx_buf == NULL) {
+        goto free_tx_buf;
+    }
+
+    trans->tx_sequence = regbank_read(bram, MAILBOX_REG(BRAM_TX_MAILBOX,
+                                                        sequence));
+    trans->rx_sequence = regbank_read(bram, MAILBOX_REG(BRAM_RX_MAILBOX,
+                                                        ack));
+    return trans;
+
+free_tx_buf:
+    axidma_free(dev, trans->tx_buf, config->max_message);
+free_trans:
+    fprintf(stderr, "Unable to allocate the transport's DMA buffers.\n");
+    free(trans);
+    return NULL;
+}
+
+void transport_close(transport_t trans)
+{
+    axidma_free(trans->dev, trans->rx_buf, trans->config.max_message);
+    axidma_free(trans->dev, trans->tx_buf, trans->config.max_message);
+    free(trans);
+    return;
+}
+
+int transport_send(transport_t trans, const void *msg, size_t len,
+        int timeout)
+{
+    if (len > trans->config.max_message) {
+        return -EMSGSIZE;
+    } else if (len <= trans->config.pio_threshold) {
+        return pio_send(trans, msg, len, timeout);
+    }
+
+    return dma_send(trans, msg, len);
+}
+
+/* Waits for the next message to be put in, or announced in, the mailbox from
+ * the logic. The logic picks the path, which the mailbox's flags give. */
+ssize_t transport_receive(transport_t trans, void *buf, size_t len,
+        int timeout)
+{
+    uint32_t sequence, length, flags;
+    uint64_t start_ns;
+
+    start_ns = get_time_ns();
+    while ((sequence = regbank_read(trans->bram, MAILBOX_REG(BRAM_RX_MAILBOX,
+            sequence))) == trans->rx_sequence)
+    {
+        if (timed_out(start_ns, timeout)) {
+            return -ETIMEDOUT;
+        }
+    }
+
+    length = regbank_read(trans->bram, MAILBOX_REG(BRAM_RX_MAILBOX, length));
+    flags = regbank_read(trans->bram, MAILBOX_REG(BRAM_RX_MAILBOX, flags));
+    if (flags & BRAM_MAILBOX_DMA) {
+        return dma_receive(trans, buf, len, sequence, length);
+    }
+
+    return pio_receive(trans, buf, len, sequence, length);
+}
+
+/* Times both paths at each size, then sets the threshold to the largest size
+ * that programmed I/O won at, leaving it alone if a transfer fails. Each
+ * message through the mailbox waits for the previous one to be acknowledged,
+ * as it does when sending, and the time for a size includes waiting for the
+ * last one. The counters are put back afterwards, so they only count real
+ * messages. */
+int transport_calibrate(transport_t trans, int iterations, int timeout,
+        struct transport_point *points, int max_points)
+{
+    int i, num_points, rc;
+    size_t size, max_size, threshold;
+    uint64_t start_ns;
+    struct transport_stats stats;
+    static const uint8_t zeros[BRAM_MAILBOX_SIZE];
+
+    max_size = BRAM_MAILBOX_SIZE;
+    if (max_size > trans->config.max_message) {
+        max_size = trans->config.max_message;
+    }
+    memcpy(&stats, &trans->stats, sizeof(stats));
+
+    threshold = 0;
+    num_points = 0;
+    for (size = 4; size <= max_size && num_points < max_points; size *= 2)
+    {
+        start_ns = get_time_ns();
+        for (i = 0; i < iterations; i++)
+        {
+            rc = pio_send(trans, zeros, size, timeout);
+            if (rc < 0) {
+                goto restore_stats;
+            }
+        }
+        rc = pio_wait_ack(trans, timeout);
+        if (rc < 0) {
+            goto restore_stats;
+        }
+        points[num_points].pio_us = (get_time_ns() - start_ns) / 1e3 /
+                                    iterations;
+
+        start_ns = get_time_ns();
+        for (i = 0; i < iterations; i++)
+        {
+            rc = dma_send(trans, zeros, size);
+            if (rc < 0) {
+                goto restore_stats;
+            }
+        }
+        points[num_points].dma_us = (get_time_ns() - start_ns) / 1e3 /
+                                    iterations;
+
+        points[num_points].size = size;
+        if (points[num_points].pio_us < points[num_points].dma_us) {
+            threshold = size;
+        }
+        num_points += 1;
+    }
+
+    trans->config.pio_threshold = threshold;
+    rc = num_points;
+
+restore_stats:
+    memcpy(&trans->stats, &stats, sizeof(stats));
+    return rc;
+}
+
+size_t transport_get_threshold(transport_t trans)
+{
+    return trans->config.pio_threshold;
+}
+
+void transport_get_stats(transport_t trans, struct transport_stats *stats)
+{
+    memcpy(stats, &trans->stats, sizeof(*stats));
+    return;
+}
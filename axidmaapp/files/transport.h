@@ -0,0 +1,182 @@
+/**
+ * @file transport.h
+ * @date Sunday, October 18, 2026 at 12:05:36 AM EDT
+ *
+ * This file defines the interface to the message transport, which passes
+ * messages to and from the logic either by programmed I/O through the BRAM's
+ * mailboxes, or by DMA.
+ *
+ * For a message of a few dozen bytes, a handful of stores into the BRAM cost
+ * far less than setting up a DMA transfer and waiting for its completion, but
+ * the stores cost more per byte. Each message up to the transport's threshold
+ * goes through a mailbox, and each larger one goes by DMA. The threshold can
+ * be found for the board by calibrating the transport, which times both paths
+ * over a range of sizes.
+ *
+ * The logic picks the path for the messages it sends with a threshold of its
+ * own. Each of its messages is put in its mailbox, or, if it goes by DMA, is
+ * announced there with #BRAM_MAILBOX_DMA and its length before it is sent.
+ *
+ * A transport must only be used by one thread.
+ *
+ * @bug No known bugs.
+ **/
+
+#ifndef TRANSPORT_H_
+#define TRANSPORT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>          // Signed size type
+
+#include "axidmaapp.h"          // Interface to the AXI DMA library
+#include "regbank.h"            // The BRAM holding the mailboxes
+
+// The default size of the largest message sent by programmed I/O
+#define TRANSPORT_DEFAULT_THRESHOLD     64
+
+/**
+ * Structure holding the parameters of a transport.
+ **/
+struct transport_config {
+    int tx_channel;             ///< DMA channel to send messages on.
+    int rx_channel;             ///< DMA channel to receive messages on.
+    size_t max_message;         ///< The largest message, in bytes.
+    size_t pio_threshold;       ///< The largest message sent by programmed
+                                ///< I/O, at most #BRAM_MAILBOX_SIZE.
+};
+
+/**
+ * Structure holding the counts of messages passed by each path.
+ **/
+struct transport_stats {
+    uint64_t pio_sent;          ///< Messages sent through the mailbox.
+    uint64_t dma_sent;          ///< Messages sent by DMA.
+    uint64_t pio_received;      ///< Messages received through the mailbox.
+    uint64_t dma_received;      ///< Messages received by DMA.
+};
+
+/**
+ * Structure holding the time taken to send a message of one size by each
+ * path, measured by #transport_calibrate.
+ **/
+struct transport_point {
+    size_t size;                ///< The size of the message, in bytes.
+    double pio_us;              ///< The time to send it by programmed I/O.
+    double dma_us;              ///< The time to send it by DMA.
+};
+
+/**
+ * The struct representing a transport. This is an opaque type.
+ **/
+struct transport;
+
+/**
+ * Type definition for a transport.
+ **/
+typedef struct transport* transport_t;
+
+/**
+ * Opens a transport over the given DMA channels and BRAM, allocating its DMA
+ * buffers.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] bram The bank mapping the BRAM, such as #bram_regs.
+ * @param[in] config The parameters of the transport.
+ * @return A handle to the transport on success, NULL on failure.
+ **/
+transport_t transport_open(axidma_dev_t dev, regbank_t bram,
+        const struct transport_config *config);
+
+/**
+ * Frees the transport's DMA buffers, and the transport.
+ *
+ * @param[in] trans A #transport_t returned by #transport_open.
+ **/
+void transport_close(transport_t trans);
+
+/**
+ * Sends a message to the logic, through the mailbox if it is no larger than
+ * the threshold, and by DMA otherwise.
+ *
+ * @param[in] trans A #transport_t returned by #transport_open.
+ * @param[in] msg The message to send.
+ * @param[in] len The number of bytes in the message.
+ * @param[in] timeout The time to wait for the logic to take the previous
+ *                    message out of the mailbox, in milliseconds, or a
+ *                    negative value to wait forever. A DMA transfer waits for
+ *                    as long as the driver does.
+ * @return 0 upon success, a negative errno value on failure. This is
+ *         -ETIMEDOUT if the mailbox was not freed in time.
+ **/
+int transport_send(transport_t trans, const void *msg, size_t len,
+        int timeout);
+
+/**
+ * Receives the next message from the logic, through the mailbox or by DMA,
+ * whichever the logic announced in the mailbox for it.
+ *
+ * A message sent by DMA must be no longer than the transport's largest
+ * message. A longer one is left on the DMA stream, for the caller to recover
+ * from.
+ *
+ * @param[in] trans A #transport_t returned by #transport_open.
+ * @param[out] buf The buffer to receive the message into.
+ * @param[in] len The size of \p buf, in bytes.
+ * @param[in] timeout The time to wait for a message in the mailbox, in
+ *                    milliseconds, or a negative value to wait forever. A DMA
+ *                    transfer waits for as long as the driver does.
+ * @return The number of bytes received upon success, a negative errno value on
+ *         failure. This is -ETIMEDOUT if no message arrived in time, and
+ *         -EMSGSIZE if the message was longer than \p len, in which case it is
+ *         dropped, or longer than the transport's largest message.
+ **/
+ssize_t transport_receive(transport_t trans, void *buf, size_t len,
+        int timeout);
+
+/**
+ * Finds the threshold for the board, by timing how long sending a message
+ * takes by each path, for sizes doubling from 4 bytes up to the size of the
+ * mailbox. The threshold is set to the largest size for which programmed I/O
+ * was the faster of the two.
+ *
+ * Messages through the mailbox are timed the way they are sent, waiting for
+ * the logic to acknowledge each one, so the logic must be taking them. Run
+ * the calibration against logic that loops the mailbox back, or that is idle
+ * and discards what it is sent, and never while it is doing real work. The
+ * calibration has side effects that outlast it:
+ *  - It puts messages of zeros in the live mailbox to the logic, which the
+ *    logic takes as real messages.
+ *  - It bumps the mailbox's sequence number once for each of them.
+ *  - It sends messages of zeros to the logic by DMA.
+ *
+ * @param[in] trans A #transport_t returned by #transport_open.
+ * @param[in] iterations The number of messages to time for each size and path.
+ * @param[in] timeout The time to wait for the logic to acknowledge each
+ *                    message in the mailbox, in milliseconds, or a negative
+ *                    value to wait forever.
+ * @param[out] points Filled with the times for each size.
+ * @param[in] max_points The number of entries in \p points.
+ * @return The number of sizes timed upon success, a negative errno value on
+ *         failure. This is -ETIMEDOUT if the logic did not take a message.
+ **/
+int transport_calibrate(transport_t trans, int iterations, int timeout,
+        struct transport_point *points, int max_points);
+
+/**
+ * Gets the largest message that is sent by programmed I/O.
+ *
+ * @param[in] trans A #transport_t returned by #transport_open.
+ * @return The threshold, in bytes.
+ **/
+size_t transport_get_threshold(transport_t trans);
+
+/**
+ * Gets the counts of messages passed by each path.
+ *
+ * @param[in] trans A #transport_t returned by #transport_open.
+ * @param[out] stats Filled with the transport's counters.
+ **/
+void transport_get_stats(transport_t trans, struct transport_stats *stats);
+
+#endif /* TRANSPORT_H_ */
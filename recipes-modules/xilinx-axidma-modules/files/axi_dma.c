@@ -56,6 +56,12 @@ static int axidma_probe(struct platform_device *pdev)
         goto free_axidma_dev;
     }
 
+    // Set up the pools for the device tree's memory regions, if it has any
+    rc = axidma_pool_init(pdev, axidma_dev);
+    if (rc < 0) {
+        goto destroy_dma_dev;
+    }
+
     // Assign the character device name, minor number, and number of devices
     axidma_dev->chrdev_name = chrdev_name;
     axidma_dev->minor_num = minor_num;
@@ -64,7 +70,7 @@ static int axidma_probe(struct platform_device *pdev)
     // Initialize the character device for the module.
     rc = axidma_chrdev_init(axidma_dev);
     if (rc < 0) {
-        goto destroy_dma_dev;
+        goto destroy_pools;
     }
 
     // Set the private data in the device to the AXI DMA device structure
@@ -72,6 +78,8 @@ static int axidma_probe(struct platform_device *pdev)
     printk("%s:%s[%d] end\n", __FILE__, __func__, __LINE__);
     return 0;
 
+destroy_pools:
+    axidma_pool_exit(axidma_dev);
 destroy_dma_dev:
     axidma_dma_exit(axidma_dev);
 free_axidma_dev:
@@ -90,8 +98,13 @@ static int axidma_remove(struct platform_device *pdev)
     // Cleanup the character device structures
     axidma_chrdev_exit(axidma_dev);
 
-    // Cleanup the DMA structures
+    /* Cleanup the DMA structures, which stops the transfers. Then free the
+     * buffers they held, before the pools that they came from go away. */
     axidma_dma_exit(axidma_dev);
+    axidma_flush_buffers(axidma_dev);
+
+    // Release the memory region pools
+    axidma_pool_exit(axidma_dev);
 
     // Free the device structure
     kfree(axidma_dev);
@@ -12,6 +12,11 @@
 
 // Kernel dependencies
 #include <linux/list.h>         // Linked list definitions and functions
+#include <linux/rculist.h>      // RCU-protected linked list functions
+#include <linux/rcupdate.h>     // RCU read locks and deferred frees
+#include <linux/kref.h>         // Reference counts for the DMA buffers
+#include <linux/llist.h>        // Lock-free list of buffers to release
+#include <linux/workqueue.h>    // Work item that releases the buffers
 #include <linux/sched.h>        // `Current` global variable for current task
 #include <linux/device.h>       // Device and class creation functions
 #include <linux/cdev.h>         // Character device functions
@@ -21,7 +26,6 @@
 #include <linux/uaccess.h>      // Userspace memory access functions
 #include <linux/slab.h>         // Kernel allocation functions
 #include <linux/errno.h>        // Linux error codes
-#include <linux/of_device.h>    // Device tree device related functions
 
 #include <linux/dma-buf.h>      // DMA shared buffers interface
 #include <linux/scatterlist.h>  // Scatter-gather table definitions
@@ -37,29 +41,60 @@
 // TODO: Maybe this can be improved?
 static struct axidma_device *axidma_dev;
 
+/* The part shared by the allocated and the imported DMA buffers. The buffer's
+ * list holds a reference to it, and so does each transfer that the engine
+ * may still be running on it. Its memory is only released once the last
+ * reference is dropped. */
+struct axidma_buffer {
+    struct kref kref;               // References to the buffer
+    struct llist_node free_node;    // Node in the list of buffers to release
+    void (*release)(struct axidma_buffer *buffer);  // Releases the memory
+};
+
 // A structure that represents a DMA buffer allocation
 struct axidma_dma_allocation {
+    struct axidma_buffer buffer;    // The reference count of the buffer
     size_t size;                // Size of the buffer
     void *user_addr;            // User virtual address of the buffer
-    void *kern_addr;            // Kernel virtual address of the buffer
+    void *kern_addr;            // Kernel virtual address, or a cookie for it
     dma_addr_t dma_addr;        // DMA bus address of the buffer
+    unsigned long attrs;        // The DMA attributes it was allocated with
+    struct device *dma_dev;     // The device it was allocated through
+    struct axidma_pool *pool;   // The pool it came from, or NULL for default
     struct list_head list;      // List node pointers for allocation list
+    struct rcu_head rcu;        // Defers the free until lookups are done
 };
 
 /* A structure that represents a DMA buffer allocation imported from another
  * driver in the kernel, through the DMA buffer sharing interface. */
 struct axidma_external_allocation {
+    struct axidma_buffer buffer;            // Reference count of the buffer
     int fd;                                 // File descritpor for buffer share
     struct dma_buf *dma_buf;                // Structure representing the buffer
     struct dma_buf_attachment *dma_attach;  // Structre represnting attachment
     size_t size;                            // Total size of the buffer
     void *user_addr;                        // Buffer's user virtual address
     struct sg_table *sg_table;              // DMA scatter-gather table
+    dma_addr_t dma_addr;                    // DMA bus address of the buffer
     struct list_head list;                  // Node pointers for the list
+    struct rcu_head rcu;                    // Defers the free until lookups
 };
 
 /*----------------------------------------------------------------------------
  * VMA Operations
+ *
+ * The lists of DMA buffers are read on every transfer, and only change when a
+ * buffer is allocated, freed, registered or unregistered. So the lookups walk
+ * them under RCU, without taking any lock, while the changes are serialized
+ * by the buffer lock. A lookup for a transfer takes a reference to the buffer
+ * that it finds, which the transfer holds until the engine is done with the
+ * buffer. Taking a buffer off its list drops the list's reference, and the
+ * buffer is released when the last reference goes. The entry itself is only
+ * freed after a grace period, once no lookup can still be looking at it.
+ *
+ * Transfers drop their references from the DMA engine's completion callback,
+ * where the buffer can't be released. So the last reference dropped by a
+ * transfer hands the buffer to a work item, which releases it instead.
  *----------------------------------------------------------------------------*/
 
 static bool valid_dma_request(void *dma_start, size_t dma_size, void *user_addr,
@@ -69,44 +104,121 @@ static bool valid_dma_request(void *dma_start, size_t dma_size, void *user_addr,
            (char *)user_addr + user_size <= (char *)dma_start + dma_size;
 }
 
-/* Converts the given user space virtual address to a DMA address. If the
- * conversion is unsuccessful, then (dma_addr_t)NULL is returned. */
-dma_addr_t axidma_uservirt_to_dma(struct axidma_device *dev, void *user_addr,
-                                  size_t size)
+// Releases the buffer's memory, once the last reference to it is dropped
+static void axidma_buffer_release(struct kref *kref)
+{
+    struct axidma_buffer *buffer;
+
+    buffer = container_of(kref, struct axidma_buffer, kref);
+    buffer->release(buffer);
+}
+
+// Hands the buffer to the work item to release, from any context
+static void axidma_buffer_defer_release(struct kref *kref)
+{
+    struct axidma_buffer *buffer;
+
+    buffer = container_of(kref, struct axidma_buffer, kref);
+    llist_add(&buffer->free_node, &axidma_dev->dead_buffers);
+    schedule_work(&axidma_dev->free_work);
+}
+
+// Releases the buffers whose last reference was dropped by a transfer
+static void axidma_free_work(struct work_struct *work)
+{
+    struct axidma_device *dev;
+    struct llist_node *dead;
+    struct axidma_buffer *buffer, *next;
+
+    dev = container_of(work, struct axidma_device, free_work);
+    dead = llist_del_all(&dev->dead_buffers);
+    llist_for_each_entry_safe(buffer, next, dead, free_node)
+    {
+        buffer->release(buffer);
+    }
+
+    return;
+}
+
+/* Finds the DMA buffer that the given user space virtual address range falls
+ * within, and takes a reference to it, which the caller must drop with
+ * axidma_put_buffer() once the DMA engine is done with the buffer. The DMA
+ * address of the range is returned in dma_addr. If no buffer is found, then
+ * NULL is returned. */
+struct axidma_buffer *axidma_get_buffer(struct axidma_device *dev,
+        void *user_addr, size_t size, dma_addr_t *dma_addr)
 {
     bool valid;
-    dma_addr_t offset;
-    struct list_head *iter;
+    struct axidma_buffer *buffer;
     struct axidma_dma_allocation *dma_alloc;
     struct axidma_external_allocation *dma_ext_alloc;
 
+    /* A buffer that was taken off its list, but that a lookup can still see,
+     * has no references left, and is skipped over. */
+    rcu_read_lock();
+
     // First iterate over DMA buffers allocated by this driver
-    list_for_each(iter, &dev->dmabuf_list)
+    list_for_each_entry_rcu(dma_alloc, &dev->dmabuf_list, list)
     {
-        dma_alloc = container_of(iter, struct axidma_dma_allocation, list);
         valid = valid_dma_request(dma_alloc->user_addr, dma_alloc->size,
                                   user_addr, size);
-        if (valid) {
-            offset = (dma_addr_t)(user_addr - dma_alloc->user_addr);
-            return dma_alloc->dma_addr + offset;
+        if (valid && kref_get_unless_zero(&dma_alloc->buffer.kref)) {
+            buffer = &dma_alloc->buffer;
+            *dma_addr = dma_alloc->dma_addr +
+                        (dma_addr_t)(user_addr - dma_alloc->user_addr);
+            goto unlock;
         }
     }
 
     // Otherwise, iterate over the DMA buffers allocated by other drivers
-    list_for_each(iter, &dev->external_dmabufs)
+    list_for_each_entry_rcu(dma_ext_alloc, &dev->external_dmabufs, list)
     {
-        dma_ext_alloc = container_of(iter, struct axidma_external_allocation,
-                                     list);
         valid = valid_dma_request(dma_ext_alloc->user_addr, dma_ext_alloc->size,
                                   user_addr, size);
-        if (valid) {
-            offset = (dma_addr_t)(user_addr - dma_ext_alloc->user_addr);
-            return sg_dma_address(&dma_ext_alloc->sg_table->sgl[0]) + offset;
+        if (valid && kref_get_unless_zero(&dma_ext_alloc->buffer.kref)) {
+            buffer = &dma_ext_alloc->buffer;
+            *dma_addr = dma_ext_alloc->dma_addr +
+                        (dma_addr_t)(user_addr - dma_ext_alloc->user_addr);
+            goto unlock;
         }
     }
 
-    // No matching allocation was found
-    return (dma_addr_t)NULL;
+    // If no matching allocation is found, no reference is taken
+    buffer = NULL;
+
+unlock:
+    rcu_read_unlock();
+    return buffer;
+}
+
+/* Drops a reference to a DMA buffer taken by axidma_get_buffer(). This can be
+ * called from any context, including the DMA engine's completion callback. */
+void axidma_put_buffer(struct axidma_buffer *buffer)
+{
+    kref_put(&buffer->kref, axidma_buffer_defer_release);
+}
+
+/* Waits for the buffers that transfers dropped the last references to, to be
+ * released. The transfers must already have been stopped. */
+void axidma_flush_buffers(struct axidma_device *dev)
+{
+    flush_work(&dev->free_work);
+}
+
+// Unmaps an imported buffer, and detaches from it
+static void axidma_release_external(struct axidma_buffer *buffer)
+{
+    struct axidma_external_allocation *dma_alloc;
+
+    dma_alloc = container_of(buffer, struct axidma_external_allocation,
+                             buffer);
+    dma_buf_unmap_attachment(dma_alloc->dma_attach, dma_alloc->sg_table,
+                             DMA_BIDIRECTIONAL);
+    dma_buf_detach(dma_alloc->dma_buf, dma_alloc->dma_attach);
+    dma_buf_put(dma_alloc->dma_buf);
+
+    // Free the structure once no lookup can be looking at it
+    kfree_rcu(dma_alloc, rcu);
 }
 
 static int axidma_get_external(struct axidma_device *dev,
@@ -131,8 +243,8 @@ static int axidma_get_external(struct axidma_device *dev,
         goto free_ext_alloc;
     }
 
-    // Attach ourselves to the DMA buffer, indicating usage
-    dma_alloc->dma_attach = dma_buf_attach(dma_alloc->dma_buf, dev->device);
+    // Attach the DMA engine to the buffer, so it is mapped for the engine
+    dma_alloc->dma_attach = dma_buf_attach(dma_alloc->dma_buf, dev->dma_dev);
     if (IS_ERR(dma_alloc->dma_attach)) {
         axidma_err("Unable to attach to the external DMA buffer.\n");
         rc = PTR_ERR(dma_alloc->dma_attach);
@@ -158,9 +270,14 @@ static int axidma_get_external(struct axidma_device *dev,
     }
 
     // Add ourselves the driver's list of external allocations
+    kref_init(&dma_alloc->buffer.kref);
+    dma_alloc->buffer.release = axidma_release_external;
     dma_alloc->size = ext_buf->size;
     dma_alloc->user_addr = ext_buf->user_addr;
-    list_add(&dma_alloc->list, &dev->external_dmabufs);
+    dma_alloc->dma_addr = sg_dma_address(&dma_alloc->sg_table->sgl[0]);
+    mutex_lock(&dev->dmabuf_lock);
+    list_add_rcu(&dma_alloc->list, &dev->external_dmabufs);
+    mutex_unlock(&dev->dmabuf_lock);
     return 0;
 
 unmap_ext_dma:
@@ -178,45 +295,84 @@ free_ext_alloc:
 static int axidma_put_external(struct axidma_device *dev, void *user_addr)
 {
     void *end_user_addr;
-    struct list_head *iter;
     struct axidma_external_allocation *dma_alloc;
 
     // Find the allocation corresponding to the user address
-    list_for_each(iter, &dev->external_dmabufs)
+    mutex_lock(&dev->dmabuf_lock);
+    list_for_each_entry(dma_alloc, &dev->external_dmabufs, list)
     {
-        dma_alloc = container_of(iter, struct axidma_external_allocation, list);
         end_user_addr = (char *)dma_alloc->user_addr + dma_alloc->size;
-
         if (dma_alloc->user_addr <= user_addr && user_addr <= end_user_addr) {
-            // Unmap the buffer, and detach ourselves from it
-            dma_buf_unmap_attachment(dma_alloc->dma_attach,
-                    dma_alloc->sg_table, DMA_BIDIRECTIONAL);
-            dma_buf_detach(dma_alloc->dma_buf, dma_alloc->dma_attach);
-            dma_buf_put(dma_alloc->dma_buf);
-
-            // Free the allocation structure
-            kfree(dma_alloc);
+            list_del_rcu(&dma_alloc->list);
+            mutex_unlock(&dev->dmabuf_lock);
+
+            /* Drop the list's reference. The buffer is unmapped once no
+             * transfer is using it. */
+            kref_put(&dma_alloc->buffer.kref, axidma_buffer_release);
             return 0;
         }
     }
+    mutex_unlock(&dev->dmabuf_lock);
 
     return -ENOENT;
 }
 
+// Counts the buffers allocated through the driver, and registered with it
+static void axidma_get_buffer_stats(struct axidma_device *dev,
+                                    struct axidma_buffer_stats *stats)
+{
+    struct axidma_dma_allocation *dma_alloc;
+    struct axidma_external_allocation *dma_ext_alloc;
+
+    memset(stats, 0, sizeof(*stats));
+    rcu_read_lock();
+    list_for_each_entry_rcu(dma_alloc, &dev->dmabuf_list, list)
+    {
+        stats->num_buffers += 1;
+        stats->buffer_bytes += dma_alloc->size;
+    }
+
+    list_for_each_entry_rcu(dma_ext_alloc, &dev->external_dmabufs, list)
+    {
+        stats->num_external += 1;
+        stats->external_bytes += dma_ext_alloc->size;
+    }
+    rcu_read_unlock();
+
+    return;
+}
+
+// Frees an allocated buffer, and gives its space back to its pool
+static void axidma_release_dma_alloc(struct axidma_buffer *buffer)
+{
+    struct axidma_dma_allocation *dma_alloc;
+
+    dma_alloc = container_of(buffer, struct axidma_dma_allocation, buffer);
+    dma_free_attrs(dma_alloc->dma_dev, dma_alloc->size, dma_alloc->kern_addr,
+                   dma_alloc->dma_addr, dma_alloc->attrs);
+    if (dma_alloc->pool != NULL) {
+        axidma_pool_uncharge(dma_alloc->pool, dma_alloc->size);
+    }
+
+    // Free the structure once no lookup can be looking at it
+    kfree_rcu(dma_alloc, rcu);
+}
+
 static void axidma_vma_close(struct vm_area_struct *vma)
 {
     struct axidma_device *dev;
     struct axidma_dma_allocation *dma_alloc;
 
-    // Get the AXI DMA allocation data and free the DMA buffer
+    // Get the AXI DMA allocation data, and take it off the list
     dev = axidma_dev;
     dma_alloc = vma->vm_private_data;
-    dma_free_coherent(&dev->pdev->dev, dma_alloc->size, dma_alloc->kern_addr,
-                      dma_alloc->dma_addr);
+    mutex_lock(&dev->dmabuf_lock);
+    list_del_rcu(&dma_alloc->list);
+    mutex_unlock(&dev->dmabuf_lock);
 
-    // Remove the allocation from the list, and free the structure
-    list_del(&dma_alloc->list);
-    kfree(dma_alloc);
+    /* Drop the list's reference. The buffer is freed once no transfer is
+     * using it, which may be after the process has unmapped it. */
+    kref_put(&dma_alloc->buffer.kref, axidma_buffer_release);
 
     return;
 }
@@ -248,6 +404,8 @@ static int axidma_open(struct inode *inode, struct file *file)
 
 static int axidma_release(struct inode *inode, struct file *file)
 {
+    // Give back any ring the process left attached
+    axidma_ring_release(file->private_data, file);
     file->private_data = NULL;
     return 0;
 }
@@ -257,10 +415,31 @@ static int axidma_mmap(struct file *file, struct vm_area_struct *vma)
     int rc;
     struct axidma_device *dev;
     struct axidma_dma_allocation *dma_alloc;
+    struct axidma_pool *pool;
 
     // Get the axidma device structure
     dev = file->private_data;
 
+    // The registers and memory of a userspace ring are at fixed offsets
+    if (vma->vm_pgoff == AXIDMA_RING_REGS_PGOFF ||
+            vma->vm_pgoff == AXIDMA_RING_MEM_PGOFF) {
+        return axidma_ring_mmap(dev, file, vma);
+    }
+
+    /* Buffers mapped past the pool offset come from the pool that the offset
+     * selects. The offset isn't part of the mapping, which starts at the
+     * beginning of the buffer. */
+    pool = NULL;
+    if (vma->vm_pgoff >= AXIDMA_POOL_PGOFF) {
+        pool = axidma_pool_get(dev, vma->vm_pgoff - AXIDMA_POOL_PGOFF);
+        if (pool == NULL) {
+            axidma_err("There is no memory region pool %lu.\n",
+                       vma->vm_pgoff - AXIDMA_POOL_PGOFF);
+            return -EINVAL;
+        }
+        vma->vm_pgoff = 0;
+    }
+
     // Allocate a structure to store data about the DMA mapping
     dma_alloc = kmalloc(sizeof(*dma_alloc), GFP_KERNEL);
     if (dma_alloc == NULL) {
@@ -270,16 +449,33 @@ static int axidma_mmap(struct file *file, struct vm_area_struct *vma)
     }
 
     // Set the user virtual address and the size
+    kref_init(&dma_alloc->buffer.kref);
+    dma_alloc->buffer.release = axidma_release_dma_alloc;
     dma_alloc->size = vma->vm_end - vma->vm_start;
     dma_alloc->user_addr = (void *)vma->vm_start;
 
-    // Configure the DMA device
-    of_dma_configure(dev->device, NULL);
-
-    // Allocate the requested region a contiguous and uncached for DMA
-    dma_alloc->kern_addr = dma_alloc_coherent(&dev->pdev->dev, dma_alloc->size,
-                                              &dma_alloc->dma_addr, GFP_KERNEL);
-    if (dma_alloc->kern_addr == NULL) {
+    /* Allocate the requested region as contiguous and uncached for DMA, for
+     * the DMA engine that will access it. Behind an IOMMU, it is only
+     * contiguous in the engine's address space, and is built from any pages.
+     * The kernel never touches the buffer, so it isn't mapped into the
+     * kernel, which would use up vmalloc space for large buffers. */
+    dma_alloc->pool = pool;
+    dma_alloc->dma_dev = (pool != NULL) ? pool->dev : dev->dma_dev;
+    dma_alloc->attrs = dev->iommu_backed ? DMA_ATTR_NO_KERNEL_MAPPING : 0;
+    dma_alloc->kern_addr = dma_alloc_attrs(dma_alloc->dma_dev, dma_alloc->size,
+            &dma_alloc->dma_addr, GFP_KERNEL, dma_alloc->attrs);
+    if (dma_alloc->kern_addr == NULL && pool != NULL) {
+        axidma_err("Unable to allocate DMA memory region of size %zu from "
+                   "pool %s.\n", dma_alloc->size, pool->name);
+        axidma_pool_failed(pool);
+        rc = -ENOMEM;
+        goto free_vma_data;
+    } else if (dma_alloc->kern_addr == NULL && dev->iommu_backed) {
+        axidma_err("Unable to allocate IOMMU-mapped DMA memory region of "
+                   "size %zu.\n", dma_alloc->size);
+        rc = -ENOMEM;
+        goto free_vma_data;
+    } else if (dma_alloc->kern_addr == NULL) {
         axidma_err("Unable to allocate contiguous DMA memory region of size "
                    "%zu.\n", dma_alloc->size);
         axidma_err("Please make sure that you specified cma=<size> on the "
@@ -289,8 +485,8 @@ static int axidma_mmap(struct file *file, struct vm_area_struct *vma)
     }
 
     // Map the region into userspace
-    rc = dma_mmap_coherent(&dev->pdev->dev, vma, dma_alloc->kern_addr,
-                           dma_alloc->dma_addr, dma_alloc->size);
+    rc = dma_mmap_attrs(dma_alloc->dma_dev, vma, dma_alloc->kern_addr,
+                        dma_alloc->dma_addr, dma_alloc->size, dma_alloc->attrs);
     if (rc < 0) {
         axidma_err("Unable to remap address %p to userspace address %p, size "
                    "%zu.\n", dma_alloc->kern_addr, dma_alloc->user_addr,
@@ -309,12 +505,17 @@ static int axidma_mmap(struct file *file, struct vm_area_struct *vma)
     vma->vm_flags |= VM_DONTCOPY;
 
     // Add the allocation to the driver's list of DMA buffers
-    list_add(&dma_alloc->list, &dev->dmabuf_list);
+    mutex_lock(&dev->dmabuf_lock);
+    list_add_rcu(&dma_alloc->list, &dev->dmabuf_list);
+    mutex_unlock(&dev->dmabuf_lock);
+    if (pool != NULL) {
+        axidma_pool_charge(pool, dma_alloc->size);
+    }
     return 0;
 
 free_dma_region:
-    dma_free_coherent(&dev->pdev->dev, dma_alloc->size, dma_alloc->kern_addr,
-                      dma_alloc->dma_addr);
+    dma_free_attrs(dma_alloc->dma_dev, dma_alloc->size, dma_alloc->kern_addr,
+                   dma_alloc->dma_addr, dma_alloc->attrs);
 free_vma_data:
     kfree(dma_alloc);
 ret:
@@ -352,6 +553,15 @@ static long axidma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
     struct axidma_inout_transaction inout_trans;
     struct axidma_video_transaction video_trans, *__user user_video_trans;
     struct axidma_chan chan_info;
+    struct axidma_vdma_config vdma_config;
+    struct axidma_frame_event frame_event;
+    struct axidma_video_stats video_stats;
+    struct axidma_ring_info ring_info;
+    struct axidma_ring_wait ring_wait;
+    struct axidma_ring_stats ring_stats;
+    struct axidma_progress progress;
+    struct axidma_buffer_stats buffer_stats;
+    struct axidma_pool_info pool_info;
 
     // Coerce the arguement as a userspace pointer
     arg_ptr = (void __user *)arg;
@@ -460,6 +670,15 @@ static long axidma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
                 return -EFAULT;
             }
 
+            // Check the number of frame buffers before sizing the array
+            if (video_trans.num_frame_buffers <= 0 ||
+                    video_trans.num_frame_buffers > AXIDMA_MAX_FRAME_BUFFERS) {
+                axidma_err("Invalid number of frame buffers %d, must be "
+                           "between 1 and %d.\n", video_trans.num_frame_buffers,
+                           AXIDMA_MAX_FRAME_BUFFERS);
+                return -EINVAL;
+            }
+
             // Allocate a kernel-space array for the frame buffers
             size = video_trans.num_frame_buffers *
                    sizeof(video_trans.frame_buffers[0]);
@@ -491,6 +710,15 @@ static long axidma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
                 return -EFAULT;
             }
 
+            // Check the number of frame buffers before sizing the array
+            if (video_trans.num_frame_buffers <= 0 ||
+                    video_trans.num_frame_buffers > AXIDMA_MAX_FRAME_BUFFERS) {
+                axidma_err("Invalid number of frame buffers %d, must be "
+                           "between 1 and %d.\n", video_trans.num_frame_buffers,
+                           AXIDMA_MAX_FRAME_BUFFERS);
+                return -EINVAL;
+            }
+
             // Allocate a kernel-space array for the frame buffers
             size = video_trans.num_frame_buffers *
                    sizeof(video_trans.frame_buffers[0]);
@@ -526,6 +754,174 @@ static long axidma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
             rc = axidma_put_external(dev, (void *)arg);
             break;
 
+        case AXIDMA_SET_VDMA_CONFIG:
+            if (copy_from_user(&vdma_config, arg_ptr,
+                               sizeof(vdma_config)) != 0) {
+                axidma_err("Unable to copy VDMA config from userspace for "
+                           "AXIDMA_SET_VDMA_CONFIG.\n");
+                return -EFAULT;
+            }
+            rc = axidma_set_vdma_config(dev, &vdma_config);
+            break;
+
+        case AXIDMA_GET_VDMA_CONFIG:
+            if (copy_from_user(&vdma_config, arg_ptr,
+                               sizeof(vdma_config)) != 0) {
+                axidma_err("Unable to copy VDMA config from userspace for "
+                           "AXIDMA_GET_VDMA_CONFIG.\n");
+                return -EFAULT;
+            }
+            rc = axidma_get_vdma_config(dev, &vdma_config);
+            if (rc < 0) {
+                break;
+            }
+            if (copy_to_user(arg_ptr, &vdma_config, sizeof(vdma_config))) {
+                axidma_err("Unable to copy VDMA config to userspace for "
+                           "AXIDMA_GET_VDMA_CONFIG.\n");
+                return -EFAULT;
+            }
+            break;
+
+        case AXIDMA_GET_VIDEO_FRAME:
+            if (copy_from_user(&frame_event, arg_ptr,
+                               sizeof(frame_event)) != 0) {
+                axidma_err("Unable to copy frame event from userspace for "
+                           "AXIDMA_GET_VIDEO_FRAME.\n");
+                return -EFAULT;
+            }
+            rc = axidma_get_video_frame(dev, &frame_event);
+            if (rc < 0) {
+                break;
+            }
+            if (copy_to_user(arg_ptr, &frame_event, sizeof(frame_event))) {
+                axidma_err("Unable to copy frame event to userspace for "
+                           "AXIDMA_GET_VIDEO_FRAME.\n");
+                return -EFAULT;
+            }
+            break;
+
+        case AXIDMA_PUT_VIDEO_FRAME:
+            if (copy_from_user(&frame_event, arg_ptr,
+                               sizeof(frame_event)) != 0) {
+                axidma_err("Unable to copy frame event from userspace for "
+                           "AXIDMA_PUT_VIDEO_FRAME.\n");
+                return -EFAULT;
+            }
+            rc = axidma_put_video_frame(dev, &frame_event);
+            break;
+
+        case AXIDMA_GET_VIDEO_STATS:
+            if (copy_from_user(&video_stats, arg_ptr,
+                               sizeof(video_stats)) != 0) {
+                axidma_err("Unable to copy video stats from userspace for "
+                           "AXIDMA_GET_VIDEO_STATS.\n");
+                return -EFAULT;
+            }
+            rc = axidma_get_video_stats(dev, &video_stats);
+            if (rc < 0) {
+                break;
+            }
+            if (copy_to_user(arg_ptr, &video_stats, sizeof(video_stats))) {
+                axidma_err("Unable to copy video stats to userspace for "
+                           "AXIDMA_GET_VIDEO_STATS.\n");
+                return -EFAULT;
+            }
+            break;
+
+        case AXIDMA_ATTACH_RING:
+            if (copy_from_user(&ring_info, arg_ptr, sizeof(ring_info)) != 0) {
+                axidma_err("Unable to copy ring info from userspace for "
+                           "AXIDMA_ATTACH_RING.\n");
+                return -EFAULT;
+            }
+            rc = axidma_ring_attach(dev, file, &ring_info);
+            if (rc < 0) {
+                break;
+            }
+            if (copy_to_user(arg_ptr, &ring_info, sizeof(ring_info))) {
+                axidma_err("Unable to copy ring info to userspace for "
+                           "AXIDMA_ATTACH_RING.\n");
+                axidma_ring_detach(dev, file, ring_info.channel_id);
+                return -EFAULT;
+            }
+            break;
+
+        case AXIDMA_DETACH_RING:
+            rc = axidma_ring_detach(dev, file, arg);
+            break;
+
+        case AXIDMA_WAIT_RING:
+            if (copy_from_user(&ring_wait, arg_ptr, sizeof(ring_wait)) != 0) {
+                axidma_err("Unable to copy wait info from userspace for "
+                           "AXIDMA_WAIT_RING.\n");
+                return -EFAULT;
+            }
+            rc = axidma_ring_wait(dev, file, &ring_wait);
+            break;
+
+        case AXIDMA_GET_RING_STATS:
+            if (copy_from_user(&ring_stats, arg_ptr,
+                               sizeof(ring_stats)) != 0) {
+                axidma_err("Unable to copy ring stats from userspace for "
+                           "AXIDMA_GET_RING_STATS.\n");
+                return -EFAULT;
+            }
+            rc = axidma_ring_get_stats(dev, &ring_stats);
+            if (rc < 0) {
+                break;
+            }
+            if (copy_to_user(arg_ptr, &ring_stats, sizeof(ring_stats))) {
+                axidma_err("Unable to copy ring stats to userspace for "
+                           "AXIDMA_GET_RING_STATS.\n");
+                return -EFAULT;
+            }
+            break;
+
+        case AXIDMA_GET_PROGRESS:
+            if (copy_from_user(&progress, arg_ptr, sizeof(progress)) != 0) {
+                axidma_err("Unable to copy progress from userspace for "
+                           "AXIDMA_GET_PROGRESS.\n");
+                return -EFAULT;
+            }
+            rc = axidma_get_progress(dev, &progress);
+            if (rc < 0) {
+                break;
+            }
+            if (copy_to_user(arg_ptr, &progress, sizeof(progress))) {
+                axidma_err("Unable to copy progress to userspace for "
+                           "AXIDMA_GET_PROGRESS.\n");
+                return -EFAULT;
+            }
+            break;
+
+        case AXIDMA_GET_BUFFER_STATS:
+            axidma_get_buffer_stats(dev, &buffer_stats);
+            if (copy_to_user(arg_ptr, &buffer_stats,
+                             sizeof(buffer_stats)) != 0) {
+                axidma_err("Unable to copy buffer stats to userspace for "
+                           "AXIDMA_GET_BUFFER_STATS.\n");
+                return -EFAULT;
+            }
+            rc = 0;
+            break;
+
+        case AXIDMA_GET_POOL_INFO:
+            if (copy_from_user(&pool_info, arg_ptr, sizeof(pool_info)) != 0) {
+                axidma_err("Unable to copy pool info from userspace for "
+                           "AXIDMA_GET_POOL_INFO.\n");
+                return -EFAULT;
+            }
+            rc = axidma_pool_get_info(dev, &pool_info);
+            if (rc < 0) {
+                break;
+            }
+            if (copy_to_user(arg_ptr, &pool_info, sizeof(pool_info))) {
+                axidma_err("Unable to copy pool info to userspace for "
+                           "AXIDMA_GET_POOL_INFO.\n");
+                return -EFAULT;
+            }
+            break;
+
         // Invalid command (already handled in preamble)
         default:
             return -ENOTTY;
@@ -591,6 +987,13 @@ int axidma_chrdev_init(struct axidma_device *dev)
     // Initialize the list for DMA mmap'ed allocations
     INIT_LIST_HEAD(&dev->dmabuf_list);
     INIT_LIST_HEAD(&dev->external_dmabufs);
+    mutex_init(&dev->dmabuf_lock);
+    init_llist_head(&dev->dead_buffers);
+    INIT_WORK(&dev->free_work, axidma_free_work);
+
+    // No userspace ring is attached to start with
+    dev->ring = NULL;
+    mutex_init(&dev->ring_lock);
 
     return 0;
 
@@ -0,0 +1,289 @@
+/**
+ * @file axidma_pool.c
+ * @date Saturday, October 17, 2026 at 06:12:41 PM EDT
+ *
+ * This file contains the memory region pools for the AXI DMA module. Boards
+ * often have more than one bank of memory that the DMA can reach, such as DDR
+ * attached to the programmable logic, or the on-chip memory, besides the main
+ * DDR. Each bank is described by a reserved memory region, which the device
+ * tree node points to with its `memory-region` phandles, and names with
+ * `memory-region-names`.
+ *
+ * The DMA API only allocates from a single region per device, so each pool
+ * gets a child device of its own, which the region is attached to. Buffers
+ * allocated through the child device come from the pool, and are mapped the
+ * same way as the ones from the default CMA region.
+ *
+ * @bug No known bugs.
+ **/
+
+// Kernel dependencies
+#include <linux/of.h>               // Device tree parsing functions
+#include <linux/of_device.h>        // Device tree DMA configuration
+#include <linux/of_reserved_mem.h>  // Reserved memory region functions
+#include <linux/device.h>           // Device creation functions
+#include <linux/slab.h>             // Kernel allocation functions
+#include <linux/string.h>           // String copying functions
+#include <linux/errno.h>            // Linux error codes
+#include <linux/spinlock.h>         // Spinlock definitions and functions
+#include <linux/platform_device.h>  // Platform device definitions
+
+// Local dependencies
+#include "axidma.h"                 // Local definitions
+#include "axidma_ioctl.h"           // IOCTL interface for the device
+
+/*----------------------------------------------------------------------------
+ * Internal Helper Functions
+ *----------------------------------------------------------------------------*/
+
+// Frees the child device of a pool, once its last reference is dropped
+static void axidma_pool_dev_release(struct device *dev)
+{
+    kfree(dev);
+}
+
+// Gets the name and size of the pool's region from the device tree
+static int axidma_pool_parse(struct device_node *np, struct axidma_pool *pool)
+{
+    const char *name;
+    struct device_node *region_np;
+    struct reserved_mem *rmem;
+
+    // Find the reserved memory region that the phandle points to
+    region_np = of_parse_phandle(np, "memory-region", pool->index);
+    if (region_np == NULL) {
+        axidma_node_err(np, "Unable to parse memory region %d.\n",
+                        pool->index);
+        return -EINVAL;
+    }
+
+    rmem = of_reserved_mem_lookup(region_np);
+    if (rmem == NULL) {
+        axidma_node_err(np, "Memory region %s is not a reserved memory "
+                        "region.\n", region_np->name);
+        of_node_put(region_np);
+        return -EINVAL;
+    }
+
+    // Use the region's node name if the pool isn't named
+    if (of_property_read_string_index(np, "memory-region-names", pool->index,
+                                      &name) < 0) {
+        name = region_np->name;
+    }
+    strlcpy(pool->name, name, sizeof(pool->name));
+    pool->size = rmem->size;
+
+    of_node_put(region_np);
+    return 0;
+}
+
+// Creates the child device of a pool, and attaches the region to it
+static int axidma_pool_attach(struct platform_device *pdev,
+                              struct axidma_device *dev,
+                              struct axidma_pool *pool)
+{
+    int rc;
+    struct device *parent;
+
+    parent = &pdev->dev;
+    pool->dev = kzalloc(sizeof(*pool->dev), GFP_KERNEL);
+    if (pool->dev == NULL) {
+        axidma_err("Unable to allocate the device for pool %s.\n",
+                   pool->name);
+        return -ENOMEM;
+    }
+
+    /* The buffers are used by the DMA engine, so the child device addresses
+     * memory the same way as the engine does. It keeps masks of its own. */
+    device_initialize(pool->dev);
+    dev_set_name(pool->dev, "%s:%s", dev_name(parent), pool->name);
+    pool->dev->parent = parent;
+    pool->dev->coherent_dma_mask = dev->dma_dev->coherent_dma_mask;
+    pool->dev->dma_mask = &pool->dev->coherent_dma_mask;
+    pool->dev->release = axidma_pool_dev_release;
+
+    rc = device_add(pool->dev);
+    if (rc < 0) {
+        axidma_err("Unable to add the device for pool %s.\n", pool->name);
+        goto put_device;
+    }
+
+    // Take on the engine's DMA ranges and coherency from its device tree node
+    rc = of_dma_configure(pool->dev, dev->dma_dev->of_node);
+    if (rc < 0) {
+        axidma_err("Unable to configure DMA for the device of pool %s.\n",
+                   pool->name);
+        goto del_device;
+    }
+
+    // Attach the reserved region, so it is allocated from through the device
+    rc = of_reserved_mem_device_init_by_idx(pool->dev, pdev->dev.of_node,
+                                            pool->index);
+    if (rc < 0) {
+        axidma_err("Unable to attach memory region %s to its pool.\n",
+                   pool->name);
+        axidma_err("Please make sure that the region is compatible with "
+                   "\"shared-dma-pool\".\n");
+        goto del_device;
+    }
+
+    return 0;
+
+del_device:
+    device_del(pool->dev);
+put_device:
+    put_device(pool->dev);
+    pool->dev = NULL;
+    return rc;
+}
+
+static void axidma_pool_detach(struct axidma_pool *pool)
+{
+    of_reserved_mem_device_release(pool->dev);
+    device_unregister(pool->dev);
+    pool->dev = NULL;
+}
+
+/*----------------------------------------------------------------------------
+ * Pool Accounting
+ *----------------------------------------------------------------------------*/
+
+// Gets the pool with the given index, or NULL if there isn't one
+struct axidma_pool *axidma_pool_get(struct axidma_device *dev, int index)
+{
+    if (index < 0 || index >= dev->num_pools) {
+        return NULL;
+    }
+    return &dev->pools[index];
+}
+
+// Counts a buffer allocated from the pool
+void axidma_pool_charge(struct axidma_pool *pool, size_t size)
+{
+    spin_lock(&pool->lock);
+    pool->num_buffers += 1;
+    pool->used_bytes += size;
+    spin_unlock(&pool->lock);
+}
+
+// Takes a buffer freed back to the pool out of its counts
+void axidma_pool_uncharge(struct axidma_pool *pool, size_t size)
+{
+    spin_lock(&pool->lock);
+    pool->num_buffers -= 1;
+    pool->used_bytes -= size;
+    spin_unlock(&pool->lock);
+}
+
+// Counts an allocation that the pool couldn't fit
+void axidma_pool_failed(struct axidma_pool *pool)
+{
+    spin_lock(&pool->lock);
+    pool->failures += 1;
+    spin_unlock(&pool->lock);
+}
+
+int axidma_pool_get_info(struct axidma_device *dev,
+                         struct axidma_pool_info *info)
+{
+    struct axidma_pool *pool;
+
+    pool = axidma_pool_get(dev, info->index);
+    if (pool == NULL) {
+        return -ENOENT;
+    }
+
+    strlcpy(info->name, pool->name, sizeof(info->name));
+    info->size = pool->size;
+
+    spin_lock(&pool->lock);
+    info->num_buffers = pool->num_buffers;
+    info->used_bytes = pool->used_bytes;
+    info->failures = pool->failures;
+    spin_unlock(&pool->lock);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Initialization and Cleanup
+ *----------------------------------------------------------------------------*/
+
+int axidma_pool_init(struct platform_device *pdev, struct axidma_device *dev)
+{
+    int rc, i, num_pools;
+    struct device_node *np;
+
+    // Without any memory regions, all buffers come from the default region
+    dev->pools = NULL;
+    dev->num_pools = 0;
+    np = pdev->dev.of_node;
+    num_pools = of_count_phandle_with_args(np, "memory-region", NULL);
+    if (num_pools <= 0) {
+        return 0;
+    } else if (num_pools > AXIDMA_MAX_POOLS) {
+        axidma_node_err(np, "Too many memory regions (%d), the limit is "
+                        "%d.\n", num_pools, AXIDMA_MAX_POOLS);
+        return -EINVAL;
+    }
+
+    /* The pools are physical memory, which the DMA can't address through an
+     * IOMMU's translations, so they are only used without one. */
+    if (dev->iommu_backed) {
+        axidma_err("The DMA engine is behind an IOMMU, so the memory regions "
+                   "will not be used.\n");
+        return 0;
+    }
+
+    dev->pools = kcalloc(num_pools, sizeof(dev->pools[0]), GFP_KERNEL);
+    if (dev->pools == NULL) {
+        axidma_err("Unable to allocate the memory region pools.\n");
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < num_pools; i++)
+    {
+        dev->pools[i].index = i;
+        spin_lock_init(&dev->pools[i].lock);
+
+        rc = axidma_pool_parse(np, &dev->pools[i]);
+        if (rc < 0) {
+            goto detach_pools;
+        }
+
+        rc = axidma_pool_attach(pdev, dev, &dev->pools[i]);
+        if (rc < 0) {
+            goto detach_pools;
+        }
+
+        axidma_info("Memory region pool %d, %s, has %llu KiB.\n", i,
+                    dev->pools[i].name,
+                    (unsigned long long)dev->pools[i].size / 1024);
+    }
+
+    dev->num_pools = num_pools;
+    return 0;
+
+detach_pools:
+    while (--i >= 0) {
+        axidma_pool_detach(&dev->pools[i]);
+    }
+    kfree(dev->pools);
+    dev->pools = NULL;
+    return rc;
+}
+
+void axidma_pool_exit(struct axidma_device *dev)
+{
+    int i;
+
+    for (i = 0; i < dev->num_pools; i++)
+    {
+        axidma_pool_detach(&dev->pools[i]);
+    }
+
+    kfree(dev->pools);
+    dev->pools = NULL;
+    dev->num_pools = 0;
+    return;
+}
@@ -48,3 +48,8 @@
 # required), if the driver fails to compile with an error like:
 #     `fatal error: linux/dma/xilinx_dma.h: No such file or directory`
 #XILINX_DMA_INCLUDE_PATH_FIXUP = yes
+
+# This specifies to build the capture and replay example programs with LZ4
+# compression of the captured packets, linking them against liblz4. Uncomment
+# this (no value is required) if liblz4 is available for the target.
+#AXIDMA_LZ4 = yes
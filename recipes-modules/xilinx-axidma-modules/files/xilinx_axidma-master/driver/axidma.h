@@ -14,6 +14,10 @@
 
 // Kernel dependencies
 #include <linux/list.h>         // Linked list definitions and functions
+#include <linux/mutex.h>            // Mutex definitions
+#include <linux/llist.h>            // Lock-free list definitions
+#include <linux/workqueue.h>        // Work item definitions
+#include <linux/spinlock.h>         // Spinlock definitions
 #include <linux/kernel.h>           // Contains the definition for printk
 #include <linux/device.h>           // Definitions for class and device structs
 #include <linux/cdev.h>             // Definitions for character device structs
@@ -45,6 +49,27 @@
 // Forward declaration of the callback data structure for DMA
 struct axidma_cb_data;
 
+// Forward declaration of the video transfer state structure for VDMA
+struct axidma_video_stream;
+
+// Forward declaration of the reference-counted DMA buffer structure
+struct axidma_buffer;
+
+// Forward declaration of the userspace ring structure
+struct axidma_ring;
+
+// A pool of DMA buffers, backed by one of the device's memory regions
+struct axidma_pool {
+    int index;                      // The index of the region in the device
+    char name[AXIDMA_POOL_NAME_LEN];    // The name of the pool
+    phys_addr_t size;               // The size of the region
+    struct device *dev;             // Child device the region is attached to
+    spinlock_t lock;                // Protects the counts of the pool
+    int num_buffers;                // Buffers allocated from the pool
+    u64 used_bytes;                 // Bytes in the allocated buffers
+    u64 failures;                   // Allocations the pool couldn't fit
+};
+
 // All of the meta-data needed for an axidma device
 struct axidma_device {
     int num_devices;                // The number of devices
@@ -61,11 +86,22 @@ struct axidma_device {
     int num_vdma_rx_chans;          // The number of receive  VDMA channels
     int num_chans;                  // The total number of DMA channels
     int notify_signal;              // Signal used to notify transfer completion
+    bool iommu_backed;              // Buffers are mapped through an IOMMU
     struct platform_device *pdev;   // The platofrm device from the device tree
+    struct device *dma_dev;         // DMA engine device buffers are mapped for
     struct axidma_cb_data *cb_data; // The callback data for each channel
     struct axidma_chan *channels;   // All available channels
+    struct axidma_vdma_config *vdma_configs;    // VDMA parameters per channel
+    struct axidma_video_stream *video_streams;  // Video transfer per channel
     struct list_head dmabuf_list;   // List of allocated DMA buffers
     struct list_head external_dmabufs;  // Buffers allocated in other drivers
+    struct mutex dmabuf_lock;       // Serializes changes to the buffer lists
+    struct llist_head dead_buffers; // Buffers left for the work to release
+    struct work_struct free_work;   // Releases buffers dropped by transfers
+    struct axidma_pool *pools;      // The memory region pools, if any
+    int num_pools;                  // The number of memory region pools
+    struct axidma_ring *ring;       // The attached userspace ring, if any
+    struct mutex ring_lock;         // Protects the userspace ring
 };
 
 /*----------------------------------------------------------------------------
@@ -82,6 +118,10 @@ struct axidma_device {
 // Function prototypes
 int axidma_chrdev_init(struct axidma_device *dev);
 void axidma_chrdev_exit(struct axidma_device *dev);
+struct axidma_buffer *axidma_get_buffer(struct axidma_device *dev,
+        void *user_addr, size_t size, dma_addr_t *dma_addr);
+void axidma_put_buffer(struct axidma_buffer *buffer);
+void axidma_flush_buffers(struct axidma_device *dev);
 
 /*----------------------------------------------------------------------------
  * DMA Device Definitions
@@ -109,8 +149,52 @@ int axidma_video_transfer(struct axidma_device *dev,
                           struct axidma_video_transaction *trans,
                           enum axidma_dir dir);
 int axidma_stop_channel(struct axidma_device *dev, struct axidma_chan *chan);
-dma_addr_t axidma_uservirt_to_dma(struct axidma_device *dev, void *user_addr,
-                                  size_t size);
+int axidma_get_progress(struct axidma_device *dev,
+                        struct axidma_progress *progress);
+int axidma_set_vdma_config(struct axidma_device *dev,
+                           struct axidma_vdma_config *config);
+int axidma_get_vdma_config(struct axidma_device *dev,
+                           struct axidma_vdma_config *config);
+int axidma_get_video_frame(struct axidma_device *dev,
+                           struct axidma_frame_event *event);
+int axidma_put_video_frame(struct axidma_device *dev,
+                           struct axidma_frame_event *event);
+int axidma_get_video_stats(struct axidma_device *dev,
+                           struct axidma_video_stats *stats);
+struct axidma_chan *axidma_get_chan(struct axidma_device *dev, int channel_id);
+bool axidma_chan_busy(struct axidma_device *dev, struct axidma_chan *chan);
+
+/*----------------------------------------------------------------------------
+ * Userspace Ring Definitions
+ *----------------------------------------------------------------------------*/
+
+// Function Prototypes
+int axidma_ring_attach(struct axidma_device *dev, struct file *file,
+                       struct axidma_ring_info *info);
+int axidma_ring_detach(struct axidma_device *dev, struct file *file,
+                       int channel_id);
+void axidma_ring_release(struct axidma_device *dev, struct file *file);
+bool axidma_ring_attached(struct axidma_device *dev, struct axidma_chan *chan);
+int axidma_ring_mmap(struct axidma_device *dev, struct file *file,
+                     struct vm_area_struct *vma);
+int axidma_ring_wait(struct axidma_device *dev, struct file *file,
+                     struct axidma_ring_wait *wait);
+int axidma_ring_get_stats(struct axidma_device *dev,
+                          struct axidma_ring_stats *stats);
+
+/*----------------------------------------------------------------------------
+ * Memory Region Pool Definitions
+ *----------------------------------------------------------------------------*/
+
+// Function Prototypes
+int axidma_pool_init(struct platform_device *pdev, struct axidma_device *dev);
+void axidma_pool_exit(struct axidma_device *dev);
+struct axidma_pool *axidma_pool_get(struct axidma_device *dev, int index);
+void axidma_pool_charge(struct axidma_pool *pool, size_t size);
+void axidma_pool_uncharge(struct axidma_pool *pool, size_t size);
+void axidma_pool_failed(struct axidma_pool *pool);
+int axidma_pool_get_info(struct axidma_device *dev,
+                         struct axidma_pool_info *info);
 
 /*----------------------------------------------------------------------------
  * Device Tree Definitions
@@ -124,5 +208,10 @@ dma_addr_t axidma_uservirt_to_dma(struct axidma_device *dev, void *user_addr,
 int axidma_of_num_channels(struct platform_device *pdev);
 int axidma_of_parse_dma_nodes(struct platform_device *pdev,
                               struct axidma_device *dev);
+int axidma_of_chan_regs(struct platform_device *pdev, int index,
+                        struct resource *res);
+int axidma_of_chan_irq(struct platform_device *pdev, int index);
+int axidma_of_chan_addr_width(struct platform_device *pdev, int index);
+int axidma_of_core_num_chans(struct platform_device *pdev, int index);
 
 #endif /* AXIDMA_H_ */
@@ -12,6 +12,9 @@
 // Kernel dependencies
 #include <linux/delay.h>            // Milliseconds to jiffies converstion
 #include <linux/wait.h>             // Completion related functions
+#include <linux/spinlock.h>         // Spinlock definitions and functions
+#include <linux/workqueue.h>        // Work queue definitions and functions
+#include <linux/ktime.h>            // Monotonic timestamps for frames
 
 /* <linux/signal.h> was moved to <linux/sched/signal.h> in the 4.11 kernel */
 #include <linux/version.h>
@@ -26,6 +29,9 @@
 #include <linux/errno.h>            // Linux error codes
 #include <linux/platform_device.h>  // Platform device definitions
 #include <linux/device.h>           // Device definitions and functions
+#include <linux/dma-mapping.h>      // DMA address masks
+#include <linux/iommu.h>            // IOMMU domain lookup
+#include <linux/io.h>               // I/O memory mapping and access functions
 
 /* Between 3.x and 4.x, the path to Xilinx's DMA include file changes. However,
  * in some 4.x kernels, the path is still the old one from 3.x. The macro is
@@ -47,6 +53,26 @@
 // The default timeout for DMA is 10 seconds
 #define AXIDMA_DMA_TIMEOUT      10000
 
+// The most segments that a receive asking to be segmented is split into
+#define AXIDMA_RX_MAX_SEGMENTS  64
+
+// The limits on the VDMA parameters, from the VDMA control register layout
+#define AXIDMA_VDMA_MAX_FRAME_DELAY     15
+#define AXIDMA_VDMA_MAX_GENLOCK_MASTER  15
+#define AXIDMA_VDMA_MAX_PARK_FRAME      31
+#define AXIDMA_VDMA_MAX_COALESCE        255
+#define AXIDMA_VDMA_MAX_DELAY           255
+#define AXIDMA_VDMA_MAX_FSYNC_SOURCE    2
+
+/* The VDMA registers for finding the frame store that the engine is working
+ * on, and the frame buffer address programmed into each store (see PG020) */
+#define AXIDMA_VDMA_PARK_PTR            0x28
+#define AXIDMA_VDMA_RD_STORE_SHIFT      16
+#define AXIDMA_VDMA_WR_STORE_SHIFT      24
+#define AXIDMA_VDMA_STORE_MASK          0x1f
+#define AXIDMA_VDMA_MM2S_START_ADDR     0x5c
+#define AXIDMA_VDMA_S2MM_START_ADDR     0xac
+
 // A convenient structure to pass between prep and start transfer functions
 struct axidma_transfer {
     int sg_len;                     // The length of the BD array
@@ -60,6 +86,8 @@ struct axidma_transfer {
     int notify_signal;              // The signal to use for async transfers
     struct task_struct *process;    // The process requesting the transfer
     struct axidma_cb_data *cb_data; // The callback data struct
+    struct axidma_buffer *buffer;   // The buffer, held until the transfer ends
+    struct axidma_vdma_config *vdma_config; // The VDMA parameters (VDMA only)
 
     // VDMA specific fields (kept as union for extensability)
     union {
@@ -67,12 +95,81 @@ struct axidma_transfer {
     };
 };
 
+// Gets the slot of the queued transaction's buffer
+#define AXIDMA_BUFFER_SLOT(n)   ((n) & (AXIDMA_MAX_QUEUED - 1))
+
 // The data to pass to the DMA transfer completion callback function
 struct axidma_cb_data {
     int channel_id;                 // The id of the channel used
     int notify_signal;              // For async, signal to send
     struct task_struct *process;    // The process to send the signal to
     struct completion *comp;        // For sync, the notification to kernel
+    dma_cookie_t cookie;            // The cookie of the last transaction
+    size_t length;                  // The length of the last transaction
+    spinlock_t lock;                // Protects the counts and buffers
+    u64 num_completed;              // Transactions completed on the channel
+    size_t residues[AXIDMA_PROGRESS_HISTORY];   // Residues of the last ones
+    u32 num_queued;                 // Buffers handed to the engine
+    u32 num_reserved;               // Slots claimed by unsubmitted ones
+    u32 num_released;               // Buffers given back by the engine
+    struct axidma_buffer *buffers[AXIDMA_MAX_QUEUED];   // Queued ones' buffers
+};
+
+// Gets the slot of the completed transaction's residue in the history
+#define AXIDMA_RESIDUE_SLOT(n)  ((n) & (AXIDMA_PROGRESS_HISTORY - 1))
+
+// The number of frames kept queued in the VDMA engine for a video transfer
+#define AXIDMA_VIDEO_QUEUE_DEPTH        2
+
+// The states that a frame buffer of a video transfer can be in
+enum axidma_frame_state {
+    AXIDMA_FRAME_FREE,              // Available to be queued to the engine
+    AXIDMA_FRAME_QUEUED,            // Queued to, or in use by, the engine
+    AXIDMA_FRAME_READY,             // Completed, but not yet taken by the user
+    AXIDMA_FRAME_HELD,              // Taken by the user, not to be touched
+};
+
+// A frame buffer that belongs to a video transfer
+struct axidma_frame_buffer {
+    struct axidma_video_stream *stream; // The video transfer of the buffer
+    int index;                      // The index of the buffer in the transfer
+    enum axidma_frame_state state;  // The current state of the buffer
+    dma_addr_t dma_addr;            // The DMA address of the buffer
+    struct axidma_buffer *buffer;   // The reference held on the buffer
+    u32 sequence;                   // Sequence number of its last frame
+    u32 released;                   // Order it was given back by the user
+    u64 timestamp;                  // Completion time of its last frame (ns)
+};
+
+/* The state of the video transfer on a VDMA channel. Frames are queued to the
+ * engine one at a time, so that each completed frame can be reported, and so
+ * that buffers held by the user are skipped over.
+ *
+ * In its default circular mode, the VDMA cycles through all of its frame
+ * stores by itself, including ones holding buffers that were since given to
+ * the user. So the engine is always run parked, which keeps it on the store
+ * of the last frame started. It stays there until the next frame is started,
+ * so the last completed frame can still be in use by the engine. That frame
+ * is only handed out once the engine's registers show it has moved on. */
+struct axidma_video_stream {
+    spinlock_t lock;                // Protects all of the fields below
+    wait_queue_head_t wait;         // Waiters for completed frames
+    bool active;                    // Indicates the video transfer is running
+    struct axidma_chan *chan;       // The VDMA channel of the transfer
+    struct axidma_video_frame frame;    // The frame information
+    int notify_signal;              // The signal to send on each frame
+    struct task_struct *process;    // The process to send the signal to
+    int num_buffers;                // The number of frame buffers
+    int num_queued;                 // The number of buffers queued
+    struct axidma_frame_buffer buffers[AXIDMA_MAX_FRAME_BUFFERS];
+    u32 sequence;                   // The sequence number of the last frame
+    u32 released;                   // The number of buffers given back
+    u64 frames_completed;           // Frames completed by the engine
+    u64 frames_dropped;             // Frames overwritten or discarded unread
+    u64 frames_starved;             // Times no buffer was free to be queued
+    struct work_struct refill_work; // Queues the next frames after completions
+    void __iomem *regs;             // The VDMA core's registers
+    int addr_width;                 // The VDMA's address width in bits
 };
 
 /*----------------------------------------------------------------------------
@@ -102,28 +199,51 @@ static enum dma_transfer_direction axidma_to_dma_dir(enum axidma_dir dma_dir)
  * DMA Operations Helper Functions
  *----------------------------------------------------------------------------*/
 
-static int axidma_init_sg_entry(struct axidma_device *dev,
-        struct scatterlist *sg_list, int index, void *buf, size_t buf_len)
+/* Gets the DMA address of the user's buffer, taking a reference to the DMA
+ * buffer that it falls within, so it can't be freed during the transfer. */
+static struct axidma_buffer *axidma_get_transfer_buffer(
+        struct axidma_device *dev, void *buf, size_t buf_len,
+        dma_addr_t *dma_addr)
 {
-    dma_addr_t dma_addr;
+    struct axidma_buffer *buffer;
 
-    // Get the DMA address from the user virtual address
-    dma_addr = axidma_uservirt_to_dma(dev, buf, buf_len);
-    if (dma_addr == (dma_addr_t)NULL) {
+    buffer = axidma_get_buffer(dev, buf, buf_len, dma_addr);
+    if (buffer == NULL) {
         axidma_err("Requested transfer address %p does not fall within a "
                    "previously allocated DMA buffer.\n", buf);
-        return -EFAULT;
     }
 
+    return buffer;
+}
+
+static void axidma_init_sg_entry(struct scatterlist *sg_list, int index,
+                                 dma_addr_t dma_addr, size_t buf_len)
+{
     // Initialize the scatter-gather table entry
     sg_dma_address(&sg_list[index]) = dma_addr;
     sg_dma_len(&sg_list[index]) = buf_len;
+}
 
-    return 0;
+/* Gives back the buffers of all of the transactions queued on the channel.
+ * Must be called once the channel has been stopped, so that the engine is no
+ * longer using them. */
+static void axidma_release_buffers(struct axidma_cb_data *cb_data)
+{
+    unsigned long flags;
+    struct axidma_buffer **slot;
+
+    spin_lock_irqsave(&cb_data->lock, flags);
+    while (cb_data->num_released != cb_data->num_queued)
+    {
+        slot = &cb_data->buffers[AXIDMA_BUFFER_SLOT(cb_data->num_released)];
+        axidma_put_buffer(*slot);
+        *slot = NULL;
+        cb_data->num_released += 1;
+    }
+    spin_unlock_irqrestore(&cb_data->lock, flags);
 }
 
-static struct axidma_chan *axidma_get_chan(struct axidma_device *dev,
-        int channel_id)
+struct axidma_chan *axidma_get_chan(struct axidma_device *dev, int channel_id)
 {
     int i;
     struct axidma_chan *chan;
@@ -140,42 +260,260 @@ static struct axidma_chan *axidma_get_chan(struct axidma_device *dev,
     return NULL;
 }
 
-static void axidma_dma_callback(void *data)
+/* Checks that the channel is not being driven by a userspace ring. A ring
+ * takes both of the channels of its DMA core. */
+static int axidma_check_ring(struct axidma_device *dev,
+                             struct axidma_chan *chan)
+{
+    if (axidma_ring_attached(dev, chan)) {
+        axidma_err("Channel %d, or the other channel of its DMA core, is "
+                   "attached to a userspace ring.\n", chan->channel_id);
+        return -EBUSY;
+    }
+
+    return 0;
+}
+
+// Checks if the last transaction started on the channel is still running
+bool axidma_chan_busy(struct axidma_device *dev, struct axidma_chan *chan)
 {
+    unsigned long flags;
+    dma_cookie_t cookie;
     struct axidma_cb_data *cb_data;
+
+    cb_data = &dev->cb_data[chan - dev->channels];
+    spin_lock_irqsave(&cb_data->lock, flags);
+    cookie = cb_data->cookie;
+    spin_unlock_irqrestore(&cb_data->lock, flags);
+
+    return dma_async_is_tx_complete(chan->chan, cookie, NULL,
+                                    NULL) == DMA_IN_PROGRESS;
+}
+
+// Gets the stored VDMA parameters for the given channel
+static struct axidma_vdma_config *axidma_chan_vdma_config(
+        struct axidma_device *dev, struct axidma_chan *chan)
+{
+    return &dev->vdma_configs[chan - dev->channels];
+}
+
+// Gets the callback data for the given channel
+static struct axidma_cb_data *axidma_chan_cb_data(struct axidma_device *dev,
+                                                  struct axidma_chan *chan)
+{
+    return &dev->cb_data[chan - dev->channels];
+}
+
+// Sends the notification signal for the channel to the process, if requested
+static void axidma_notify_process(int notify_signal, int channel_id,
+                                  struct task_struct *process)
+{
     struct siginfo sig_info;
 
+    if (!VALID_NOTIFY_SIGNAL(notify_signal) || process == NULL) {
+        return;
+    }
+
+    memset(&sig_info, 0, sizeof(sig_info));
+    sig_info.si_signo = notify_signal;
+    sig_info.si_code = SI_QUEUE;
+    sig_info.si_int = channel_id;
+    send_sig_info(notify_signal, &sig_info, process);
+}
+
+/* The engine reports the residue of the completed transaction, which for a
+ * receive is the part of the buffer that the packet didn't fill. It is kept
+ * before the process is notified, so the process can always find it. */
+static void axidma_dma_callback(void *data,
+                                const struct dmaengine_result *result)
+{
+    unsigned long flags;
+    struct axidma_cb_data *cb_data;
+    struct axidma_buffer **slot;
+
+    cb_data = data;
+    spin_lock_irqsave(&cb_data->lock, flags);
+    cb_data->residues[AXIDMA_RESIDUE_SLOT(cb_data->num_completed)] =
+            (result != NULL) ? result->residue : 0;
+    cb_data->num_completed += 1;
+
+    /* The engine completes the transactions in the order they were queued,
+     * so this one holds the oldest buffer. None are held after a stop. */
+    if (cb_data->num_released != cb_data->num_queued) {
+        slot = &cb_data->buffers[AXIDMA_BUFFER_SLOT(cb_data->num_released)];
+        axidma_put_buffer(*slot);
+        *slot = NULL;
+        cb_data->num_released += 1;
+    }
+    spin_unlock_irqrestore(&cb_data->lock, flags);
+
     /* For synchronous transfers, notify the kernel thread waiting. For
      * asynchronous transfers, send a signal to userspace if requested. */
-    cb_data = data;
     if (cb_data->comp != NULL) {
         complete(cb_data->comp);
-    } else if (VALID_NOTIFY_SIGNAL(cb_data->notify_signal)) {
-        memset(&sig_info, 0, sizeof(sig_info));
-        sig_info.si_signo = cb_data->notify_signal;
-        sig_info.si_code = SI_QUEUE;
-        sig_info.si_int = cb_data->channel_id;
-        send_sig_info(cb_data->notify_signal, &sig_info, cb_data->process);
+    } else {
+        axidma_notify_process(cb_data->notify_signal, cb_data->channel_id,
+                              cb_data->process);
     }
 }
 
-// Setup the config structure for VDMA
-static void axidma_setup_vdma_config(struct xilinx_vdma_config *dma_config)
+// Gets the number of bytes between rows of the frame buffer surface
+static size_t axidma_frame_stride(struct axidma_video_frame *frame)
+{
+    return (frame->stride == 0) ? frame->width * frame->depth : frame->stride;
+}
+
+/* Gets the number of bytes of the frame buffer that the frame spans, from the
+ * start of the buffer to the last byte of the frame's window. */
+static size_t axidma_frame_span(struct axidma_video_frame *frame)
+{
+    size_t stride;
+
+    stride = axidma_frame_stride(frame);
+    return (frame->y_offset + frame->height - 1) * stride +
+           (frame->x_offset + frame->width) * frame->depth;
+}
+
+// Checks that the frame's dimensions and window within its buffer are sane
+static int axidma_check_frame(struct axidma_video_frame *frame)
+{
+    if (frame->height <= 0 || frame->width <= 0 || frame->depth <= 0) {
+        axidma_err("Invalid frame dimensions %dx%dx%d.\n", frame->height,
+                   frame->width, frame->depth);
+        return -EINVAL;
+    } else if (frame->x_offset < 0 || frame->y_offset < 0) {
+        axidma_err("Invalid frame offset (%d, %d).\n", frame->x_offset,
+                   frame->y_offset);
+        return -EINVAL;
+    } else if (frame->stride != 0 && frame->stride <
+            (frame->x_offset + frame->width) * frame->depth) {
+        axidma_err("Frame stride %d is too small for a row of %d pixels at "
+                   "column %d.\n", frame->stride, frame->width,
+                   frame->x_offset);
+        return -EINVAL;
+    } else if (frame->stride == 0 && frame->x_offset != 0) {
+        axidma_err("A frame with a column offset must specify its stride.\n");
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+// Setup the config structure for VDMA from the channel's parameters
+static void axidma_setup_vdma_config(struct xilinx_vdma_config *dma_config,
+                                     struct axidma_vdma_config *config)
 {
     memset(dma_config, 0, sizeof(*dma_config));
-    dma_config->frm_dly = 0;            // Number of frames to delay
-    dma_config->gen_lock = 0;           // Genlock, VDMA runs on fsyncs
-    dma_config->master = 0;             // VDMA is the genlock master
-    dma_config->frm_cnt_en = 1;         // Interrupt based on frame count
-    dma_config->park = 0;               // Continuously process all frames
-    dma_config->park_frm = 0;           // Frame to stop (park) at (N/A)
-    dma_config->coalesc = 1;            // Interrupt after one frame completion
-    dma_config->delay = 0;              // Disable the delay counter interrupt
-    dma_config->reset = 0;              // Don't reset the channel
-    dma_config->ext_fsync = 0;          // VDMA handles synchronizes itself
+    dma_config->frm_dly = config->frame_delay;  // Number of frames to delay
+    dma_config->gen_lock = config->gen_lock;    // Genlock, VDMA runs on fsyncs
+    dma_config->master = config->genlock_master;    // Genlock master to follow
+    dma_config->frm_cnt_en = config->frame_count_irq;   // Frame count interrupt
+    dma_config->park = config->park;            // Park on a single frame
+    dma_config->park_frm = config->park_frame;  // Frame to stop (park) at
+    dma_config->coalesc = config->coalesce;     // Frames per interrupt
+    dma_config->delay = config->delay;          // Delay counter interrupt
+    dma_config->reset = 0;                      // Don't reset the channel
+    dma_config->ext_fsync = config->fsync_source;   // Frame sync source
+    return;
+}
+
+// The default VDMA parameters, a free-running channel interrupting every frame
+static void axidma_default_vdma_config(struct axidma_vdma_config *config,
+                                       int channel_id)
+{
+    memset(config, 0, sizeof(*config));
+    config->channel_id = channel_id;
+    config->gen_lock = false;
+    config->genlock_master = 0;
+    config->frame_delay = 0;
+    config->park = false;
+    config->park_frame = 0;
+    config->frame_count_irq = true;
+    config->coalesce = 1;
+    config->delay = 0;
+    config->fsync_source = 0;
     return;
 }
 
+// Checks that the VDMA parameters fit into the VDMA control register
+static int axidma_check_vdma_config(struct axidma_vdma_config *config)
+{
+    if (config->genlock_master < 0 ||
+            config->genlock_master > AXIDMA_VDMA_MAX_GENLOCK_MASTER) {
+        axidma_err("Invalid genlock master %d, must be between 0 and %d.\n",
+                   config->genlock_master, AXIDMA_VDMA_MAX_GENLOCK_MASTER);
+        return -EINVAL;
+    } else if (config->frame_delay < 0 ||
+            config->frame_delay > AXIDMA_VDMA_MAX_FRAME_DELAY) {
+        axidma_err("Invalid frame delay %d, must be between 0 and %d.\n",
+                   config->frame_delay, AXIDMA_VDMA_MAX_FRAME_DELAY);
+        return -EINVAL;
+    } else if (config->frame_delay != 0 && !config->gen_lock) {
+        axidma_err("A frame delay can only be used with genlock.\n");
+        return -EINVAL;
+    } else if (config->park_frame < 0 ||
+            config->park_frame > AXIDMA_VDMA_MAX_PARK_FRAME) {
+        axidma_err("Invalid park frame %d, must be between 0 and %d.\n",
+                   config->park_frame, AXIDMA_VDMA_MAX_PARK_FRAME);
+        return -EINVAL;
+    } else if (config->park && config->gen_lock) {
+        axidma_err("A VDMA channel cannot both park and use genlock.\n");
+        return -EINVAL;
+    } else if (config->coalesce < 1 ||
+            config->coalesce > AXIDMA_VDMA_MAX_COALESCE) {
+        axidma_err("Invalid frame coalescing %d, must be between 1 and %d.\n",
+                   config->coalesce, AXIDMA_VDMA_MAX_COALESCE);
+        return -EINVAL;
+    } else if (config->delay < 0 || config->delay > AXIDMA_VDMA_MAX_DELAY) {
+        axidma_err("Invalid delay %d, must be between 0 and %d.\n",
+                   config->delay, AXIDMA_VDMA_MAX_DELAY);
+        return -EINVAL;
+    } else if (config->fsync_source < 0 ||
+            config->fsync_source > AXIDMA_VDMA_MAX_FSYNC_SOURCE) {
+        axidma_err("Invalid frame sync source %d, must be between 0 and %d.\n",
+                   config->fsync_source, AXIDMA_VDMA_MAX_FSYNC_SOURCE);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+// Gets the DMA address of the first pixel of the frame's window in its buffer
+static dma_addr_t axidma_frame_addr(struct axidma_video_frame *frame,
+                                    dma_addr_t buf_addr)
+{
+    return buf_addr + frame->y_offset * axidma_frame_stride(frame) +
+           frame->x_offset * frame->depth;
+}
+
+/* Prepares an interleaved VDMA transfer of the frame, whose frame buffer
+ * starts at the given DMA address. The frame must already have been checked. */
+static struct dma_async_tx_descriptor *axidma_prep_vdma_frame(
+        struct dma_chan *chan, struct axidma_video_frame *frame,
+        dma_addr_t buf_addr, enum dma_transfer_direction dma_dir,
+        enum dma_ctrl_flags dma_flags)
+{
+    struct dma_interleaved_template dma_template;
+    dma_addr_t frame_addr;
+    size_t stride, row_size;
+
+    /* Each line of the frame is one chunk, and the gap between chunks skips
+     * over the part of the surface outside the frame's window. */
+    stride = axidma_frame_stride(frame);
+    row_size = frame->width * frame->depth;
+    frame_addr = axidma_frame_addr(frame, buf_addr);
+
+    memset(&dma_template, 0, sizeof(dma_template));
+    dma_template.dst_start = frame_addr;
+    dma_template.src_start = frame_addr;
+    dma_template.dir = dma_dir;
+    dma_template.numf = frame->height;
+    dma_template.frame_size = 1;
+    dma_template.sgl[0].size = row_size;
+    dma_template.sgl[0].icg = stride - row_size;
+    return dmaengine_prep_interleaved_dma(chan, &dma_template, dma_flags);
+}
+
 static int axidma_prep_transfer(struct axidma_chan *axidma_chan,
                                 struct axidma_transfer *dma_tfr)
 {
@@ -185,14 +523,16 @@ static int axidma_prep_transfer(struct axidma_chan *axidma_chan,
     struct completion *dma_comp;
     struct xilinx_vdma_config vdma_config;
     struct axidma_cb_data *cb_data;
-    struct dma_interleaved_template dma_template;
+    struct axidma_video_frame *frame;
     enum dma_transfer_direction dma_dir;
     enum dma_ctrl_flags dma_flags;
     struct scatterlist *sg_list;
     int sg_len;
+    size_t length;
     dma_cookie_t dma_cookie;
+    unsigned long flags;
     char *direction, *type;
-    int rc;
+    int rc, i;
 
     // Get the fields from the structures
     chan = axidma_chan->chan;
@@ -205,6 +545,20 @@ static int axidma_prep_transfer(struct axidma_chan *axidma_chan,
     type = axidma_type_to_string(dma_tfr->type);
     cb_data = dma_tfr->cb_data;
 
+    /* Claim a slot for the transaction's buffer before preparing it, so that a
+     * full queue is refused without disturbing the transactions on it. */
+    spin_lock_irqsave(&cb_data->lock, flags);
+    if (cb_data->num_queued + cb_data->num_reserved - cb_data->num_released >=
+            AXIDMA_MAX_QUEUED) {
+        spin_unlock_irqrestore(&cb_data->lock, flags);
+        axidma_err("There are already %d transactions queued on the %s %s "
+                   "channel.\n", AXIDMA_MAX_QUEUED, type, direction);
+        rc = -EBUSY;
+        goto put_buffer;
+    }
+    cb_data->num_reserved += 1;
+    spin_unlock_irqrestore(&cb_data->lock, flags);
+
     /* For VDMA transfers, we configure the channel, then prepare an interlaved
      * transfer. For DMA, we simply prepare a slave scatter-gather transfer. */
     dma_flags = DMA_CTRL_ACK | DMA_PREP_INTERRUPT;
@@ -212,30 +566,35 @@ static int axidma_prep_transfer(struct axidma_chan *axidma_chan,
         dma_txnd = dmaengine_prep_slave_sg(chan, sg_list, sg_len, dma_dir,
                                            dma_flags);
     } else {
-        axidma_setup_vdma_config(&vdma_config);
+        // Check that the frame's window fits in the frame buffer
+        frame = &dma_tfr->frame;
+        rc = axidma_check_frame(frame);
+        if (rc < 0) {
+            goto unreserve_slot;
+        } else if (axidma_frame_span(frame) > sg_dma_len(&sg_list[0])) {
+            axidma_err("The %dx%d frame at (%d, %d) does not fit in the %u "
+                       "byte frame buffer.\n", frame->width, frame->height,
+                       frame->x_offset, frame->y_offset,
+                       sg_dma_len(&sg_list[0]));
+            rc = -EINVAL;
+            goto unreserve_slot;
+        }
+
+        axidma_setup_vdma_config(&vdma_config, dma_tfr->vdma_config);
         rc = xilinx_vdma_channel_set_config(chan, &vdma_config);
         if (rc < 0) {
             axidma_err("Unable to set the config for channel.\n");
-            goto stop_dma;
+            goto unreserve_slot;
         }
 
-        memset(&dma_template, 0, sizeof(dma_template));
-        dma_template.dst_start = sg_dma_address(&sg_list[0]);
-        dma_template.src_start = sg_dma_address(&sg_list[0]);
-        dma_template.dir = dma_dir;
-        dma_template.numf = dma_tfr->frame.height;
-        dma_template.frame_size = 1;
-        dma_template.sgl[0].size = dma_tfr->frame.width *
-                dma_tfr->frame.depth;
-        dma_template.sgl[0].icg = 0;
-        dma_txnd = dmaengine_prep_interleaved_dma(chan, &dma_template,
-                dma_flags);
+        dma_txnd = axidma_prep_vdma_frame(chan, frame,
+                sg_dma_address(&sg_list[0]), dma_dir, dma_flags);
     }
     if (dma_txnd == NULL) {
         axidma_err("Unable to prepare the dma engine for the %s %s buffer.\n",
                    type, direction);
         rc = -EBUSY;
-        goto stop_dma;
+        goto unreserve_slot;
     }
 
     /* If we're going to wait for this channel, initialize the completion for
@@ -247,15 +606,37 @@ static int axidma_prep_transfer(struct axidma_chan *axidma_chan,
         cb_data->process = NULL;
         init_completion(cb_data->comp);
         dma_txnd->callback_param = cb_data;
-        dma_txnd->callback = axidma_dma_callback;
+        dma_txnd->callback_result = axidma_dma_callback;
     } else {
         cb_data->comp = NULL;
         cb_data->notify_signal = dma_tfr->notify_signal;
         cb_data->process = dma_tfr->process;
         dma_txnd->callback_param = cb_data;
-        dma_txnd->callback = axidma_dma_callback;
+        dma_txnd->callback_result = axidma_dma_callback;
+    }
+
+    // Find the transaction's length, which is kept for its progress
+    length = 0;
+    for (i = 0; i < sg_len; i++)
+    {
+        length += sg_dma_len(&sg_list[i]);
     }
+
+    /* Queue the transaction's buffer, in the same order as the transaction,
+     * for the callback to give back when it completes. Its cookie and length
+     * are kept along with it, for the progress to read. */
+    spin_lock_irqsave(&cb_data->lock, flags);
+    cb_data->num_reserved -= 1;
     dma_cookie = dmaengine_submit(dma_txnd);
+    if (!dma_submit_error(dma_cookie)) {
+        cb_data->buffers[AXIDMA_BUFFER_SLOT(cb_data->num_queued)] =
+                dma_tfr->buffer;
+        cb_data->num_queued += 1;
+        cb_data->cookie = dma_cookie;
+        cb_data->length = length;
+        dma_tfr->buffer = NULL;
+    }
+    spin_unlock_irqrestore(&cb_data->lock, flags);
     if (dma_submit_error(dma_cookie)) {
         axidma_err("Unable to submit the %s %s transaction to the engine.\n",
                    direction, type);
@@ -267,8 +648,18 @@ static int axidma_prep_transfer(struct axidma_chan *axidma_chan,
     dma_tfr->cookie = dma_cookie;
     return 0;
 
+unreserve_slot:
+    spin_lock_irqsave(&cb_data->lock, flags);
+    cb_data->num_reserved -= 1;
+    spin_unlock_irqrestore(&cb_data->lock, flags);
 stop_dma:
     dmaengine_terminate_all(chan);
+    axidma_release_buffers(cb_data);
+put_buffer:
+    if (dma_tfr->buffer != NULL) {
+        axidma_put_buffer(dma_tfr->buffer);
+        dma_tfr->buffer = NULL;
+    }
     return rc;
 }
 
@@ -313,6 +704,351 @@ static int axidma_start_transfer(struct axidma_chan *chan,
 
 stop_dma:
     dmaengine_terminate_all(chan->chan);
+    axidma_release_buffers(dma_tfr->cb_data);
+    return rc;
+}
+
+/*----------------------------------------------------------------------------
+ * Video Streaming Helper Functions
+ *----------------------------------------------------------------------------*/
+
+// Gets the video transfer state for the given VDMA channel
+static struct axidma_video_stream *axidma_chan_video_stream(
+        struct axidma_device *dev, struct axidma_chan *chan)
+{
+    return &dev->video_streams[chan - dev->channels];
+}
+
+/* Finds the next buffer for the engine to use. Free buffers are preferred, in
+ * the order that the user gave them back. Failing that, receive channels
+ * recycle the oldest completed frame that the user hasn't taken yet, dropping
+ * it. Transmit channels instead repeat the newest frame sent, but only once the
+ * engine has nothing left queued, so that frames are never sent out of order.
+ * Buffers held by the user are never touched. Must be called with the stream's
+ * lock held. */
+static struct axidma_frame_buffer *axidma_video_next_buffer(
+        struct axidma_video_stream *stream)
+{
+    int i;
+    struct axidma_frame_buffer *buffer, *first_free, *oldest, *newest;
+
+    first_free = NULL;
+    oldest = NULL;
+    newest = NULL;
+    for (i = 0; i < stream->num_buffers; i++)
+    {
+        buffer = &stream->buffers[i];
+        if (buffer->state == AXIDMA_FRAME_FREE && (first_free == NULL ||
+                (s32)(buffer->released - first_free->released) < 0)) {
+            first_free = buffer;
+        } else if (buffer->state == AXIDMA_FRAME_READY) {
+            if (oldest == NULL ||
+                    (s32)(buffer->sequence - oldest->sequence) < 0) {
+                oldest = buffer;
+            }
+            if (newest == NULL ||
+                    (s32)(buffer->sequence - newest->sequence) > 0) {
+                newest = buffer;
+            }
+        }
+    }
+
+    if (first_free != NULL) {
+        return first_free;
+    } else if (stream->chan->dir == AXIDMA_READ) {
+        if (oldest != NULL) {
+            stream->frames_dropped += 1;
+        } else {
+            stream->frames_starved += 1;
+        }
+        return oldest;
+    } else if (stream->num_queued > 0) {
+        return NULL;
+    }
+
+    stream->frames_starved += 1;
+    return newest;
+}
+
+/* Checks if the engine is working on the given buffer, by reading the frame
+ * store it is parked on, and the buffer address programmed into that store.
+ * Must be called with the stream's lock held. */
+static bool axidma_video_engine_on(struct axidma_video_stream *stream,
+                                   struct axidma_frame_buffer *buffer)
+{
+    u32 park_ptr, store;
+    u64 store_addr;
+    unsigned int start_addr, shift, reg_size;
+
+    if (stream->chan->dir == AXIDMA_WRITE) {
+        start_addr = AXIDMA_VDMA_MM2S_START_ADDR;
+        shift = AXIDMA_VDMA_RD_STORE_SHIFT;
+    } else {
+        start_addr = AXIDMA_VDMA_S2MM_START_ADDR;
+        shift = AXIDMA_VDMA_WR_STORE_SHIFT;
+    }
+
+    // Each store's address takes two registers with wide addressing
+    reg_size = (stream->addr_width > 32) ? 8 : 4;
+    park_ptr = ioread32(stream->regs + AXIDMA_VDMA_PARK_PTR);
+    store = (park_ptr >> shift) & AXIDMA_VDMA_STORE_MASK;
+    store_addr = ioread32(stream->regs + start_addr + store * reg_size);
+    if (reg_size == 8) {
+        store_addr |= (u64)ioread32(stream->regs + start_addr +
+                                    store * reg_size + 4) << 32;
+    }
+
+    return store_addr == axidma_frame_addr(&stream->frame, buffer->dma_addr);
+}
+
+// Maps the VDMA core's registers for the stream, done once at probe time
+static int axidma_video_map_regs(struct axidma_device *dev,
+                                 struct axidma_video_stream *stream,
+                                 struct axidma_chan *chan)
+{
+    int rc;
+    struct resource regs_res;
+
+    rc = axidma_of_chan_regs(dev->pdev, chan - dev->channels, &regs_res);
+    if (rc < 0) {
+        return rc;
+    }
+
+    stream->addr_width = axidma_of_chan_addr_width(dev->pdev,
+                                                   chan - dev->channels);
+    stream->regs = ioremap(regs_res.start, resource_size(&regs_res));
+    if (stream->regs == NULL) {
+        axidma_err("Unable to map the registers of VDMA channel %d.\n",
+                   chan->channel_id);
+        return -ENOMEM;
+    }
+
+    return 0;
+}
+
+static void axidma_video_callback(void *data);
+
+// Prepares and submits a single frame transfer into the given buffer
+static int axidma_video_queue(struct axidma_video_stream *stream,
+                              struct axidma_frame_buffer *buffer)
+{
+    struct dma_chan *chan;
+    struct dma_async_tx_descriptor *dma_txnd;
+    enum dma_transfer_direction dma_dir;
+    enum dma_ctrl_flags dma_flags;
+    dma_cookie_t dma_cookie;
+
+    chan = stream->chan->chan;
+    dma_dir = axidma_to_dma_dir(stream->chan->dir);
+    dma_flags = DMA_CTRL_ACK | DMA_PREP_INTERRUPT;
+    dma_txnd = axidma_prep_vdma_frame(chan, &stream->frame, buffer->dma_addr,
+                                      dma_dir, dma_flags);
+    if (dma_txnd == NULL) {
+        axidma_err("Unable to prepare the dma engine for frame buffer %d.\n",
+                   buffer->index);
+        return -EBUSY;
+    }
+
+    dma_txnd->callback = axidma_video_callback;
+    dma_txnd->callback_param = buffer;
+    dma_cookie = dmaengine_submit(dma_txnd);
+    if (dma_submit_error(dma_cookie)) {
+        axidma_err("Unable to submit frame buffer %d to the engine.\n",
+                   buffer->index);
+        return -EBUSY;
+    }
+
+    return 0;
+}
+
+/* Keeps the engine's queue full, up to the queue depth or the number of frame
+ * buffers. Buffers are claimed under the lock, but prepared outside of it,
+ * since preparing a descriptor may sleep. Must be called in process context. */
+static int axidma_video_refill(struct axidma_video_stream *stream)
+{
+    int rc, depth;
+    unsigned long flags;
+    struct axidma_frame_buffer *buffer;
+
+    rc = 0;
+    depth = min(AXIDMA_VIDEO_QUEUE_DEPTH, stream->num_buffers);
+    while (true)
+    {
+        // Claim the next buffer for the engine, if it needs one
+        spin_lock_irqsave(&stream->lock, flags);
+        if (!stream->active || stream->num_queued >= depth) {
+            spin_unlock_irqrestore(&stream->lock, flags);
+            break;
+        }
+        buffer = axidma_video_next_buffer(stream);
+        if (buffer == NULL) {
+            spin_unlock_irqrestore(&stream->lock, flags);
+            break;
+        }
+        buffer->state = AXIDMA_FRAME_QUEUED;
+        stream->num_queued += 1;
+        spin_unlock_irqrestore(&stream->lock, flags);
+
+        // Hand it to the engine, giving it back if that fails
+        rc = axidma_video_queue(stream, buffer);
+        if (rc < 0) {
+            spin_lock_irqsave(&stream->lock, flags);
+            buffer->state = AXIDMA_FRAME_FREE;
+            stream->num_queued -= 1;
+            spin_unlock_irqrestore(&stream->lock, flags);
+            break;
+        }
+    }
+
+    dma_async_issue_pending(stream->chan->chan);
+
+    // Starting a frame moves the engine off the last one, which can be taken
+    wake_up_interruptible(&stream->wait);
+    return rc;
+}
+
+// Refills the engine's queue after frames complete, outside of the callback
+static void axidma_video_refill_work(struct work_struct *work)
+{
+    struct axidma_video_stream *stream;
+
+    stream = container_of(work, struct axidma_video_stream, refill_work);
+    axidma_video_refill(stream);
+}
+
+/* The completion callback for each frame of a video transfer. The frame is
+ * marked ready and stamped, and waiters are woken. The engine is handed its
+ * next buffer from a work item, so that it keeps streaming. */
+static void axidma_video_callback(void *data)
+{
+    unsigned long flags;
+    struct axidma_frame_buffer *buffer;
+    struct axidma_video_stream *stream;
+
+    buffer = data;
+    stream = buffer->stream;
+
+    spin_lock_irqsave(&stream->lock, flags);
+    if (!stream->active || buffer->state != AXIDMA_FRAME_QUEUED) {
+        spin_unlock_irqrestore(&stream->lock, flags);
+        return;
+    }
+    stream->num_queued -= 1;
+    stream->sequence += 1;
+    stream->frames_completed += 1;
+    buffer->state = AXIDMA_FRAME_READY;
+    buffer->sequence = stream->sequence;
+    buffer->timestamp = ktime_get_ns();
+    spin_unlock_irqrestore(&stream->lock, flags);
+
+    schedule_work(&stream->refill_work);
+    wake_up_interruptible(&stream->wait);
+    axidma_notify_process(stream->notify_signal, stream->chan->channel_id,
+                          stream->process);
+}
+
+/* Takes a completed frame for the user, filling in the event. By default,
+ * frames are taken in order. When the latest is requested, older completed
+ * frames are skipped over and given back to the engine. Transmit channels can
+ * also take buffers that have not been sent yet, to fill them. */
+static int axidma_video_take(struct axidma_video_stream *stream,
+                             struct axidma_frame_event *event)
+{
+    int i;
+    bool latest, newer;
+    unsigned long flags;
+    struct axidma_frame_buffer *buffer, *chosen;
+
+    spin_lock_irqsave(&stream->lock, flags);
+    if (!stream->active) {
+        spin_unlock_irqrestore(&stream->lock, flags);
+        return -ENODATA;
+    }
+
+    // Find the oldest or newest completed frame, depending on the flags
+    chosen = NULL;
+    latest = (event->flags & AXIDMA_FRAME_LATEST) != 0;
+    for (i = 0; i < stream->num_buffers; i++)
+    {
+        buffer = &stream->buffers[i];
+        if (buffer->state != AXIDMA_FRAME_READY ||
+                axidma_video_engine_on(stream, buffer)) {
+            continue;
+        }
+
+        newer = chosen != NULL &&
+                (s32)(buffer->sequence - chosen->sequence) > 0;
+        if (chosen == NULL || newer == latest) {
+            chosen = buffer;
+        }
+    }
+
+    /* Transmit channels fall back to a buffer that the engine hasn't used yet.
+     * Free buffers that the user gave back are still waiting to be sent. */
+    for (i = 0; chosen == NULL && stream->chan->dir == AXIDMA_WRITE &&
+            i < stream->num_buffers; i++)
+    {
+        buffer = &stream->buffers[i];
+        if (buffer->state == AXIDMA_FRAME_FREE && buffer->released == 0) {
+            chosen = buffer;
+        }
+    }
+
+    if (chosen == NULL) {
+        spin_unlock_irqrestore(&stream->lock, flags);
+        return -EAGAIN;
+    }
+
+    /* When skipping to the latest received frame, the frames before it are
+     * discarded. Transmit channels have nothing to discard. */
+    latest = latest && stream->chan->dir == AXIDMA_READ;
+    for (i = 0; latest && i < stream->num_buffers; i++)
+    {
+        buffer = &stream->buffers[i];
+        if (buffer != chosen && buffer->state == AXIDMA_FRAME_READY) {
+            buffer->state = AXIDMA_FRAME_FREE;
+            stream->frames_dropped += 1;
+        }
+    }
+
+    chosen->state = AXIDMA_FRAME_HELD;
+    event->buffer_index = chosen->index;
+    event->sequence = chosen->sequence;
+    event->timestamp = chosen->timestamp;
+    spin_unlock_irqrestore(&stream->lock, flags);
+
+    return 0;
+}
+
+/* Ends any video transfer on the channel, and stops the channel. All frame
+ * buffers are given back, and anyone waiting on a frame is woken up. */
+static int axidma_video_stop(struct axidma_video_stream *stream,
+                             struct axidma_chan *chan)
+{
+    int rc, i;
+    unsigned long flags;
+
+    // Keep any more frames from being queued, then stop the engine
+    spin_lock_irqsave(&stream->lock, flags);
+    stream->active = false;
+    spin_unlock_irqrestore(&stream->lock, flags);
+    cancel_work_sync(&stream->refill_work);
+    rc = dmaengine_terminate_all(chan->chan);
+
+    // The engine is done with the frame buffers, so they can be given back
+    spin_lock_irqsave(&stream->lock, flags);
+    stream->num_queued = 0;
+    for (i = 0; i < stream->num_buffers; i++)
+    {
+        stream->buffers[i].state = AXIDMA_FRAME_FREE;
+        if (stream->buffers[i].buffer != NULL) {
+            axidma_put_buffer(stream->buffers[i].buffer);
+            stream->buffers[i].buffer = NULL;
+        }
+    }
+    spin_unlock_irqrestore(&stream->lock, flags);
+
+    wake_up_interruptible(&stream->wait);
     return rc;
 }
 
@@ -352,12 +1088,18 @@ int axidma_set_signal(struct axidma_device *dev, int signal)
     return 0;
 }
 
+/* Receives into the buffer. The receive is one descriptor unless the caller
+ * asks for it to be split into segments, so that the DMA engine reports its
+ * progress as each segment completes. Each descriptor ends at the end of a
+ * packet, so a segmented receive is only for streams that aren't framed. */
 int axidma_read_transfer(struct axidma_device *dev,
                          struct axidma_transaction *trans)
 {
-    int rc;
+    int rc, i, num_segs;
+    size_t seg_size, offset;
+    dma_addr_t dma_addr;
     struct axidma_chan *rx_chan;
-    struct scatterlist sg_list;
+    struct scatterlist *sg_list;
     struct axidma_transfer rx_tfr;
 
     // Get the channel with the given channel id
@@ -368,44 +1110,72 @@ int axidma_read_transfer(struct axidma_device *dev,
         return -ENODEV;
     }
 
-    // Setup the scatter-gather list for the transfer (only one entry)
-    sg_init_table(&sg_list, 1);
-    rc = axidma_init_sg_entry(dev, &sg_list, 0, trans->buf,
-                              trans->buf_len);
+    // The channel cannot be driven by a userspace ring
+    rc = axidma_check_ring(dev, rx_chan);
     if (rc < 0) {
         return rc;
     }
 
+    /* Setup the scatter-gather list for the transfer, one entry per segment.
+     * VDMA takes the frame buffer as a single entry. */
+    seg_size = max_t(size_t, trans->buf_len, 1);
+    if (trans->segment_size > 0 && rx_chan->type == AXIDMA_DMA) {
+        seg_size = max_t(size_t, trans->segment_size,
+                DIV_ROUND_UP(trans->buf_len, AXIDMA_RX_MAX_SEGMENTS));
+    }
+    num_segs = max_t(int, DIV_ROUND_UP(trans->buf_len, seg_size), 1);
+    sg_list = kmalloc_array(num_segs, sizeof(*sg_list), GFP_KERNEL);
+    if (sg_list == NULL) {
+        axidma_err("Unable to allocate the scatter-gather list.\n");
+        return -ENOMEM;
+    }
+
+    // The segments all fall within the buffer, which is held for the transfer
+    rx_tfr.buffer = axidma_get_transfer_buffer(dev, trans->buf, trans->buf_len,
+                                               &dma_addr);
+    if (rx_tfr.buffer == NULL) {
+        rc = -EFAULT;
+        goto free_sg_list;
+    }
+    sg_init_table(sg_list, num_segs);
+    for (i = 0, offset = 0; i < num_segs; i++, offset += seg_size)
+    {
+        axidma_init_sg_entry(sg_list, i, dma_addr + offset,
+                             min(seg_size, trans->buf_len - offset));
+    }
+
     // Setup receive transfer structure for DMA
-    rx_tfr.sg_list = &sg_list;
-    rx_tfr.sg_len = 1;
+    rx_tfr.sg_list = sg_list;
+    rx_tfr.sg_len = num_segs;
     rx_tfr.dir = rx_chan->dir;
     rx_tfr.type = rx_chan->type;
     rx_tfr.wait = trans->wait;
     rx_tfr.channel_id = trans->channel_id;
     rx_tfr.notify_signal = dev->notify_signal;
     rx_tfr.process = get_current();
-    rx_tfr.cb_data = &dev->cb_data[trans->channel_id];
+    rx_tfr.cb_data = axidma_chan_cb_data(dev, rx_chan);
+    rx_tfr.vdma_config = axidma_chan_vdma_config(dev, rx_chan);
 
-    // Prepare the receive transfer
+    /* Prepare the receive transfer, which copies the list into descriptors,
+     * and takes over the reference to the buffer */
     rc = axidma_prep_transfer(rx_chan, &rx_tfr);
     if (rc < 0) {
-        return rc;
+        goto free_sg_list;
     }
 
     // Submit the receive transfer, and wait for it to complete
     rc = axidma_start_transfer(rx_chan, &rx_tfr);
-    if (rc < 0) {
-        return rc;
-    }
 
-    return 0;
+free_sg_list:
+    kfree(sg_list);
+    return rc;
 }
 
 int axidma_write_transfer(struct axidma_device *dev,
                           struct axidma_transaction *trans)
 {
     int rc;
+    dma_addr_t dma_addr;
     struct axidma_chan *tx_chan;
     struct scatterlist sg_list;
     struct axidma_transfer tx_tfr;
@@ -418,14 +1188,21 @@ int axidma_write_transfer(struct axidma_device *dev,
         return -ENODEV;
     }
 
-    // Setup the scatter-gather list for the transfer (only one entry)
-    sg_init_table(&sg_list, 1);
-    rc = axidma_init_sg_entry(dev, &sg_list, 0, trans->buf,
-                              trans->buf_len);
+    // The channel cannot be driven by a userspace ring
+    rc = axidma_check_ring(dev, tx_chan);
     if (rc < 0) {
         return rc;
     }
 
+    // Setup the scatter-gather list for the transfer (only one entry)
+    tx_tfr.buffer = axidma_get_transfer_buffer(dev, trans->buf, trans->buf_len,
+                                               &dma_addr);
+    if (tx_tfr.buffer == NULL) {
+        return -EFAULT;
+    }
+    sg_init_table(&sg_list, 1);
+    axidma_init_sg_entry(&sg_list, 0, dma_addr, trans->buf_len);
+
     // Setup transmit transfer structure for DMA
     tx_tfr.sg_list = &sg_list;
     tx_tfr.sg_len = 1;
@@ -435,9 +1212,10 @@ int axidma_write_transfer(struct axidma_device *dev,
     tx_tfr.channel_id = trans->channel_id;
     tx_tfr.notify_signal = dev->notify_signal;
     tx_tfr.process = get_current();
-    tx_tfr.cb_data = &dev->cb_data[trans->channel_id];
+    tx_tfr.cb_data = axidma_chan_cb_data(dev, tx_chan);
+    tx_tfr.vdma_config = axidma_chan_vdma_config(dev, tx_chan);
 
-    // Prepare the transmit transfer
+    // Prepare the transmit transfer, which takes over the buffer's reference
     rc = axidma_prep_transfer(tx_chan, &tx_tfr);
     if (rc < 0) {
         return rc;
@@ -458,6 +1236,7 @@ int axidma_rw_transfer(struct axidma_device *dev,
                        struct axidma_inout_transaction *trans)
 {
     int rc;
+    dma_addr_t tx_dma_addr, rx_dma_addr;
     struct axidma_chan *tx_chan, *rx_chan;
     struct scatterlist tx_sg_list, rx_sg_list;
     struct axidma_transfer tx_tfr, rx_tfr;
@@ -477,20 +1256,33 @@ int axidma_rw_transfer(struct axidma_device *dev,
         return -ENODEV;
     }
 
-    // Setup the scatter-gather list for the transfers (only one entry)
-    sg_init_table(&tx_sg_list, 1);
-    rc = axidma_init_sg_entry(dev, &tx_sg_list, 0, trans->tx_buf,
-                              trans->tx_buf_len);
+    // Neither channel can be driven by a userspace ring
+    rc = axidma_check_ring(dev, tx_chan);
     if (rc < 0) {
         return rc;
     }
-    sg_init_table(&rx_sg_list, 1);
-    rc = axidma_init_sg_entry(dev, &rx_sg_list, 0, trans->rx_buf,
-                              trans->rx_buf_len);
+    rc = axidma_check_ring(dev, rx_chan);
     if (rc < 0) {
         return rc;
     }
 
+    // Setup the scatter-gather list for the transfers (only one entry)
+    tx_tfr.buffer = axidma_get_transfer_buffer(dev, trans->tx_buf,
+            trans->tx_buf_len, &tx_dma_addr);
+    if (tx_tfr.buffer == NULL) {
+        return -EFAULT;
+    }
+    rx_tfr.buffer = axidma_get_transfer_buffer(dev, trans->rx_buf,
+            trans->rx_buf_len, &rx_dma_addr);
+    if (rx_tfr.buffer == NULL) {
+        axidma_put_buffer(tx_tfr.buffer);
+        return -EFAULT;
+    }
+    sg_init_table(&tx_sg_list, 1);
+    axidma_init_sg_entry(&tx_sg_list, 0, tx_dma_addr, trans->tx_buf_len);
+    sg_init_table(&rx_sg_list, 1);
+    axidma_init_sg_entry(&rx_sg_list, 0, rx_dma_addr, trans->rx_buf_len);
+
     // Setup receive and trasmit transfer structures for DMA
     tx_tfr.sg_list = &tx_sg_list,
     tx_tfr.sg_len = 1,
@@ -500,7 +1292,8 @@ int axidma_rw_transfer(struct axidma_device *dev,
     tx_tfr.channel_id = trans->tx_channel_id,
     tx_tfr.notify_signal = dev->notify_signal,
     tx_tfr.process = get_current(),
-    tx_tfr.cb_data = &dev->cb_data[trans->tx_channel_id];
+    tx_tfr.cb_data = axidma_chan_cb_data(dev, tx_chan);
+    tx_tfr.vdma_config = axidma_chan_vdma_config(dev, tx_chan);
 
     // Add in the frame information for VDMA transfers
     if (tx_chan->type == AXIDMA_VDMA) {
@@ -515,16 +1308,18 @@ int axidma_rw_transfer(struct axidma_device *dev,
     rx_tfr.channel_id = trans->rx_channel_id,
     rx_tfr.notify_signal = dev->notify_signal,
     rx_tfr.process = get_current(),
-    rx_tfr.cb_data = &dev->cb_data[trans->rx_channel_id];
+    rx_tfr.cb_data = axidma_chan_cb_data(dev, rx_chan);
+    rx_tfr.vdma_config = axidma_chan_vdma_config(dev, rx_chan);
 
     // Add in the frame information for VDMA transfers
     if (tx_chan->type == AXIDMA_VDMA) {
         memcpy(&rx_tfr.frame, &trans->rx_frame, sizeof(rx_tfr.frame));
     }
 
-    // Prep both the receive and transmit transfers
+    // Prep both the receive and transmit transfers, which take the buffers
     rc = axidma_prep_transfer(tx_chan, &tx_tfr);
     if (rc < 0) {
+        axidma_put_buffer(rx_tfr.buffer);
         return rc;
     }
     rc = axidma_prep_transfer(rx_chan, &rx_tfr);
@@ -551,74 +1346,123 @@ int axidma_video_transfer(struct axidma_device *dev,
 {
     int rc, i;
     size_t image_size;
+    unsigned long flags;
+    dma_addr_t dma_addr;
+    struct axidma_buffer *buffer;
     struct axidma_chan *chan;
-    struct scatterlist *sg_list;
+    struct axidma_video_stream *stream;
+    struct axidma_vdma_config *config;
+    struct xilinx_vdma_config vdma_config;
 
-    // Setup transmit transfer structure for DMA
-    struct axidma_transfer transfer = {
-        .sg_len = trans->num_frame_buffers,
-        .dir = dir,
-        .type = AXIDMA_VDMA,
-        .wait = false,
-        .channel_id = trans->channel_id,
-        .notify_signal = dev->notify_signal,
-        .process = get_current(),
-        .frame = trans->frame,
-    };
+    // Get the channel with the given id
+    chan = axidma_get_chan(dev, trans->channel_id);
+    if (chan == NULL || chan->dir != dir || chan->type != AXIDMA_VDMA) {
+        axidma_err("Invalid device id %d for VDMA %s channel.\n",
+                   trans->channel_id, axidma_dir_to_string(dir));
+        return -ENODEV;
+    }
+    stream = axidma_chan_video_stream(dev, chan);
+    config = axidma_chan_vdma_config(dev, chan);
 
-    // Allocate an array to store the scatter list structures for the buffers
-    transfer.sg_list = kmalloc(transfer.sg_len * sizeof(*sg_list), GFP_KERNEL);
-    if (transfer.sg_list == NULL) {
-        axidma_err("Unable to allocate memory for the scatter-gather list.\n");
-        rc = -ENOMEM;
-        goto ret;
+    // Check the frame, and find the amount of each frame buffer that it spans
+    rc = axidma_check_frame(&trans->frame);
+    if (rc < 0) {
+        return rc;
     }
+    image_size = axidma_frame_span(&trans->frame);
 
-    // For each frame, setup a scatter-gather entry
-    image_size = trans->frame.width * trans->frame.height * trans->frame.depth;
-    for (i = 0; i < transfer.sg_len; i++)
-    {
-        rc = axidma_init_sg_entry(dev, transfer.sg_list, i,
-                                  trans->frame_buffers[i], image_size);
-        if (rc < 0) {
-            goto free_sg_list;
-        }
+    /* The engine is parked on each frame as it is started, so that it only
+     * ever uses buffers in the driver's queue. That can't follow genlock. */
+    if (config->gen_lock) {
+        axidma_err("A video transfer cannot use genlock, since its channel "
+                   "must be parked.\n");
+        return -EINVAL;
     }
 
-    // Get the channel with the given id
-    chan = axidma_get_chan(dev, trans->channel_id);
-    if (chan == NULL && chan->dir != dir &&
-            chan->type != AXIDMA_VDMA) {
-        axidma_err("Invalid device id %d for VDMA %s channel.\n",
-                   trans->channel_id, axidma_dir_to_string(chan->dir));
-        rc = -ENODEV;
-        goto free_sg_list;
+    // Only one video transfer can run on a channel at a time
+    spin_lock_irqsave(&stream->lock, flags);
+    if (stream->active) {
+        spin_unlock_irqrestore(&stream->lock, flags);
+        axidma_err("A video transfer is already running on channel %d.\n",
+                   trans->channel_id);
+        return -EBUSY;
     }
-    transfer.cb_data = &dev->cb_data[trans->channel_id];
 
-    // Prepare the transmit transfer
-    rc = axidma_prep_transfer(chan, &transfer);
+    // Setup the video transfer, and find the DMA address of each frame buffer
+    stream->chan = chan;
+    stream->frame = trans->frame;
+    stream->notify_signal = dev->notify_signal;
+    stream->process = get_current();
+    stream->num_buffers = trans->num_frame_buffers;
+    stream->num_queued = 0;
+    stream->sequence = 0;
+    stream->released = 0;
+    stream->frames_completed = 0;
+    stream->frames_dropped = 0;
+    stream->frames_starved = 0;
+    for (i = 0; i < stream->num_buffers; i++)
+    {
+        // Each frame buffer is held until the video transfer is stopped
+        buffer = axidma_get_buffer(dev, trans->frame_buffers[i], image_size,
+                                   &dma_addr);
+        if (buffer == NULL) {
+            axidma_err("Frame buffer %d at %p does not fall within a "
+                       "previously allocated DMA buffer.\n", i,
+                       trans->frame_buffers[i]);
+            while (i-- > 0)
+            {
+                axidma_put_buffer(stream->buffers[i].buffer);
+                stream->buffers[i].buffer = NULL;
+            }
+            stream->num_buffers = 0;
+            spin_unlock_irqrestore(&stream->lock, flags);
+            return -EFAULT;
+        }
+
+        stream->buffers[i].stream = stream;
+        stream->buffers[i].index = i;
+        stream->buffers[i].state = AXIDMA_FRAME_FREE;
+        stream->buffers[i].dma_addr = dma_addr;
+        stream->buffers[i].buffer = buffer;
+        stream->buffers[i].sequence = 0;
+        stream->buffers[i].released = 0;
+        stream->buffers[i].timestamp = 0;
+    }
+    stream->active = true;
+    spin_unlock_irqrestore(&stream->lock, flags);
+
+    /* Apply the channel's VDMA parameters, parked. The DMA engine moves the
+     * park pointer to the store of each frame that it starts. */
+    axidma_setup_vdma_config(&vdma_config, config);
+    vdma_config.park = 1;
+    rc = xilinx_vdma_channel_set_config(chan->chan, &vdma_config);
     if (rc < 0) {
-        goto free_sg_list;
+        axidma_err("Unable to set the config for channel.\n");
+        goto stop_stream;
     }
 
-    // Submit the transfer, and immediately return
-    rc = axidma_start_transfer(chan, &transfer);
+    // Queue up the first frames, and start the engine
+    rc = axidma_video_refill(stream);
+    if (rc < 0) {
+        goto stop_stream;
+    }
 
-free_sg_list:
-    kfree(transfer.sg_list);
-ret:
     return 0;
+
+stop_stream:
+    axidma_video_stop(stream, chan);
+    return rc;
 }
 
 int axidma_stop_channel(struct axidma_device *dev,
                         struct axidma_chan *chan_info)
 {
+    int rc;
     struct axidma_chan *chan;
 
     // Get the transmit and receive channels with the given ids.
     chan = axidma_get_chan(dev, chan_info->channel_id);
-    if (chan == NULL && chan->type != chan_info->type &&
+    if (chan == NULL || chan->type != chan_info->type ||
             chan->dir != chan_info->dir) {
         axidma_err("Invalid channel id %d for %s %s channel.\n",
             chan_info->channel_id, axidma_type_to_string(chan_info->type),
@@ -626,8 +1470,253 @@ int axidma_stop_channel(struct axidma_device *dev,
         return -ENODEV;
     }
 
-    // Terminate all DMA transactions on the given channel
-    return dmaengine_terminate_all(chan->chan);
+    // A ring's channel is halted when the ring is detached instead
+    rc = axidma_check_ring(dev, chan);
+    if (rc < 0) {
+        return rc;
+    }
+
+    /* Terminate all DMA transactions on the given channel. For VDMA, this also
+     * ends any video transfer, and releases anyone waiting on its frames. */
+    if (chan->type == AXIDMA_VDMA) {
+        rc = axidma_video_stop(axidma_chan_video_stream(dev, chan), chan);
+    } else {
+        rc = dmaengine_terminate_all(chan->chan);
+    }
+
+    // Give back the buffers of the transactions that were stopped
+    axidma_release_buffers(axidma_chan_cb_data(dev, chan));
+    return rc;
+}
+
+/* Gets the progress of the channel's last transaction from the residue that
+ * the DMA engine reports. The residue is only known for the descriptors in
+ * the engine's active list, so a transaction that hasn't been started, or
+ * that the engine can't report on, counts nothing until it completes. Once
+ * it has completed, the residue passed to the callback gives the bytes that
+ * were actually received. */
+int axidma_get_progress(struct axidma_device *dev,
+                        struct axidma_progress *progress)
+{
+    unsigned long flags;
+    size_t residue;
+    dma_cookie_t cookie;
+    struct axidma_chan *chan;
+    struct axidma_cb_data *cb_data;
+    struct dma_tx_state state;
+    enum dma_status status;
+
+    chan = axidma_get_chan(dev, progress->channel_id);
+    if (chan == NULL || chan->type != AXIDMA_DMA) {
+        axidma_err("Invalid device id %d for DMA channel.\n",
+                   progress->channel_id);
+        return -ENODEV;
+    }
+
+    /* Copy out the last transaction, and the residues of the transactions
+     * completed so far, all at the same point in time. */
+    cb_data = axidma_chan_cb_data(dev, chan);
+    spin_lock_irqsave(&cb_data->lock, flags);
+    cookie = cb_data->cookie;
+    progress->length = cb_data->length;
+    progress->num_completed = cb_data->num_completed;
+    memcpy(progress->residues, cb_data->residues, sizeof(cb_data->residues));
+    spin_unlock_irqrestore(&cb_data->lock, flags);
+
+    if (cookie <= 0) {
+        progress->complete = true;
+        progress->transferred = 0;
+        return 0;
+    }
+
+    memset(&state, 0, sizeof(state));
+    status = dmaengine_tx_status(chan->chan, cookie, &state);
+    if (status == DMA_ERROR) {
+        return -EIO;
+    }
+
+    /* Transactions complete in order, so a completed last transaction is the
+     * last one counted. */
+    progress->complete = (status == DMA_COMPLETE);
+    if (progress->complete) {
+        residue = (progress->num_completed == 0) ? 0 : progress->residues[
+                AXIDMA_RESIDUE_SLOT(progress->num_completed - 1)];
+        progress->transferred = progress->length -
+                min(residue, progress->length);
+    } else if (state.residue == 0 || state.residue > progress->length) {
+        progress->transferred = 0;
+    } else {
+        progress->transferred = progress->length - state.residue;
+    }
+
+    return 0;
+}
+
+int axidma_get_video_frame(struct axidma_device *dev,
+                           struct axidma_frame_event *event)
+{
+    int rc;
+    long time_remain;
+    struct axidma_chan *chan;
+    struct axidma_video_stream *stream;
+
+    // Get the VDMA channel with the given id
+    chan = axidma_get_chan(dev, event->channel_id);
+    if (chan == NULL || chan->type != AXIDMA_VDMA) {
+        axidma_err("Invalid channel id %d for VDMA channel.\n",
+                   event->channel_id);
+        return -ENODEV;
+    }
+    stream = axidma_chan_video_stream(dev, chan);
+
+    // Take a completed frame right away if there is one
+    rc = axidma_video_take(stream, event);
+    if (rc != -EAGAIN || event->timeout == 0) {
+        return rc;
+    }
+
+    // Otherwise, wait for one up to the timeout, or forever if it's negative
+    if (event->timeout < 0) {
+        time_remain = wait_event_interruptible(stream->wait,
+                (rc = axidma_video_take(stream, event)) != -EAGAIN);
+    } else {
+        time_remain = wait_event_interruptible_timeout(stream->wait,
+                (rc = axidma_video_take(stream, event)) != -EAGAIN,
+                msecs_to_jiffies(event->timeout));
+        if (time_remain == 0) {
+            return -ETIMEDOUT;
+        }
+    }
+    if (time_remain < 0) {
+        return time_remain;
+    }
+
+    return rc;
+}
+
+int axidma_put_video_frame(struct axidma_device *dev,
+                           struct axidma_frame_event *event)
+{
+    unsigned long flags;
+    struct axidma_chan *chan;
+    struct axidma_video_stream *stream;
+
+    // Get the VDMA channel with the given id
+    chan = axidma_get_chan(dev, event->channel_id);
+    if (chan == NULL || chan->type != AXIDMA_VDMA) {
+        axidma_err("Invalid channel id %d for VDMA channel.\n",
+                   event->channel_id);
+        return -ENODEV;
+    }
+    stream = axidma_chan_video_stream(dev, chan);
+
+    // Only a buffer that the user holds can be released
+    spin_lock_irqsave(&stream->lock, flags);
+    if (!stream->active || event->buffer_index < 0 ||
+            event->buffer_index >= stream->num_buffers ||
+            stream->buffers[event->buffer_index].state != AXIDMA_FRAME_HELD) {
+        spin_unlock_irqrestore(&stream->lock, flags);
+        axidma_err("Frame buffer %d is not held on channel %d.\n",
+                   event->buffer_index, event->channel_id);
+        return -EINVAL;
+    }
+
+    // Make the buffer available again, and queue it if the engine needs one
+    stream->released += 1;
+    stream->buffers[event->buffer_index].state = AXIDMA_FRAME_FREE;
+    stream->buffers[event->buffer_index].released = stream->released;
+    spin_unlock_irqrestore(&stream->lock, flags);
+
+    return axidma_video_refill(stream);
+}
+
+int axidma_get_video_stats(struct axidma_device *dev,
+                           struct axidma_video_stats *stats)
+{
+    int i;
+    unsigned long flags;
+    struct axidma_chan *chan;
+    struct axidma_video_stream *stream;
+
+    // Get the VDMA channel with the given id
+    chan = axidma_get_chan(dev, stats->channel_id);
+    if (chan == NULL || chan->type != AXIDMA_VDMA) {
+        axidma_err("Invalid channel id %d for VDMA channel.\n",
+                   stats->channel_id);
+        return -ENODEV;
+    }
+    stream = axidma_chan_video_stream(dev, chan);
+
+    // Take a consistent snapshot of the transfer's state
+    spin_lock_irqsave(&stream->lock, flags);
+    stats->active = stream->active;
+    stats->sequence = stream->sequence;
+    stats->frames_completed = stream->frames_completed;
+    stats->frames_dropped = stream->frames_dropped;
+    stats->frames_starved = stream->frames_starved;
+    stats->frames_ready = 0;
+    stats->frames_held = 0;
+    for (i = 0; i < stream->num_buffers; i++)
+    {
+        if (stream->buffers[i].state == AXIDMA_FRAME_READY) {
+            stats->frames_ready += 1;
+        } else if (stream->buffers[i].state == AXIDMA_FRAME_HELD) {
+            stats->frames_held += 1;
+        }
+    }
+    spin_unlock_irqrestore(&stream->lock, flags);
+
+    return 0;
+}
+
+int axidma_set_vdma_config(struct axidma_device *dev,
+                           struct axidma_vdma_config *config)
+{
+    int rc;
+    struct axidma_chan *chan;
+    struct xilinx_vdma_config vdma_config;
+
+    // Get the VDMA channel with the given id
+    chan = axidma_get_chan(dev, config->channel_id);
+    if (chan == NULL || chan->type != AXIDMA_VDMA) {
+        axidma_err("Invalid channel id %d for VDMA channel.\n",
+                   config->channel_id);
+        return -ENODEV;
+    }
+
+    // Validate the parameters, then apply them to the channel right away
+    rc = axidma_check_vdma_config(config);
+    if (rc < 0) {
+        return rc;
+    }
+    axidma_setup_vdma_config(&vdma_config, config);
+    rc = xilinx_vdma_channel_set_config(chan->chan, &vdma_config);
+    if (rc < 0) {
+        axidma_err("Unable to set the config for VDMA channel %d.\n",
+                   config->channel_id);
+        return rc;
+    }
+
+    // Keep the parameters, so they are re-applied on each new transfer
+    memcpy(axidma_chan_vdma_config(dev, chan), config, sizeof(*config));
+    return 0;
+}
+
+int axidma_get_vdma_config(struct axidma_device *dev,
+                           struct axidma_vdma_config *config)
+{
+    struct axidma_chan *chan;
+
+    // Get the VDMA channel with the given id
+    chan = axidma_get_chan(dev, config->channel_id);
+    if (chan == NULL || chan->type != AXIDMA_VDMA) {
+        axidma_err("Invalid channel id %d for VDMA channel.\n",
+                   config->channel_id);
+        return -ENODEV;
+    }
+
+    memcpy(config, axidma_chan_vdma_config(dev, chan), sizeof(*config));
+    return 0;
 }
 
 /*----------------------------------------------------------------------------
@@ -666,16 +1755,69 @@ release_channels:
     return rc;
 }
 
+// Gets the IOMMU domain that the device's addresses are translated through
+static struct iommu_domain *axidma_translating_domain(struct device *dev)
+{
+    struct iommu_domain *domain;
+
+    // An identity domain passes the addresses through as they are
+    domain = iommu_get_domain_for_dev(dev);
+    if (domain == NULL || domain->type == IOMMU_DOMAIN_IDENTITY) {
+        return NULL;
+    }
+    return domain;
+}
+
+/* Finds the device that the buffers are allocated and mapped for. The DMA
+ * engine makes the accesses, so it is the engine's device that is behind any
+ * IOMMU (the SMMU on ZynqMP), not this driver's. When it is, the DMA API maps
+ * the buffers to contiguous I/O virtual addresses, so they can be built from
+ * any pages rather than carved out of CMA. A buffer can be used on any of
+ * the channels, so the engines of all of them must see memory the same way,
+ * either untranslated, or through the same IOMMU domain. */
+static int axidma_find_dma_dev(struct axidma_device *dev)
+{
+    int i;
+    struct device *chan_dev;
+    struct iommu_domain *domain;
+
+    dev->dma_dev = dev->channels[0].chan->device->dev;
+    domain = axidma_translating_domain(dev->dma_dev);
+    for (i = 1; i < dev->num_chans; i++)
+    {
+        chan_dev = dev->channels[i].chan->device->dev;
+        if (axidma_translating_domain(chan_dev) != domain) {
+            axidma_err("The DMA engines of channels %d and %d are not in the "
+                       "same IOMMU domain, so they can't share buffers.\n",
+                       dev->channels[0].channel_id,
+                       dev->channels[i].channel_id);
+            return -EINVAL;
+        }
+    }
+
+    dev->iommu_backed = (domain != NULL);
+    if (dev->iommu_backed) {
+        axidma_info("The DMA engine is behind an IOMMU, DMA buffers will not "
+                    "need contiguous memory.\n");
+    }
+    return 0;
+}
+
 int axidma_dma_init(struct platform_device *pdev, struct axidma_device *dev)
 {
-    int rc;
+    int rc, i;
     size_t elem_size;
     u64 dma_mask;
 
+    /* Set the masks for both the buffers and the streaming mappings, falling
+     * back to 32 bits if the platform can't address as much as dma_addr_t. */
     dma_mask = DMA_BIT_MASK(8 * sizeof(dma_addr_t));
-    rc = dma_set_coherent_mask(&dev->pdev->dev, dma_mask);
+    rc = dma_set_mask_and_coherent(&dev->pdev->dev, dma_mask);
     if (rc < 0) {
-        axidma_err("Unable to set the DMA coherent mask.\n");
+        rc = dma_set_mask_and_coherent(&dev->pdev->dev, DMA_BIT_MASK(32));
+    }
+    if (rc < 0) {
+        axidma_err("Unable to set the DMA masks.\n");
         return rc;
     }
 
@@ -695,23 +1837,73 @@ int axidma_dma_init(struct platform_device *pdev, struct axidma_device *dev)
 
     // Allocate an array to store all callback structures, for async
     elem_size = sizeof(dev->cb_data[0]);
-    dev->cb_data = kmalloc(dev->num_chans * elem_size, GFP_KERNEL);
+    dev->cb_data = kcalloc(dev->num_chans, elem_size, GFP_KERNEL);
     if (dev->cb_data == NULL) {
         axidma_err("Unable to allocate memory for callback structures.\n");
         rc = -ENOMEM;
         goto free_channels;
     }
 
+    // Allocate an array to store the VDMA parameters of each channel
+    elem_size = sizeof(dev->vdma_configs[0]);
+    dev->vdma_configs = kmalloc(dev->num_chans * elem_size, GFP_KERNEL);
+    if (dev->vdma_configs == NULL) {
+        axidma_err("Unable to allocate memory for VDMA config structures.\n");
+        rc = -ENOMEM;
+        goto free_callback_data;
+    }
+
+    // Allocate an array to store the video transfer state of each channel
+    elem_size = sizeof(dev->video_streams[0]);
+    dev->video_streams = kzalloc(dev->num_chans * elem_size, GFP_KERNEL);
+    if (dev->video_streams == NULL) {
+        axidma_err("Unable to allocate memory for video stream structures.\n");
+        rc = -ENOMEM;
+        goto free_vdma_configs;
+    }
+
     // Parse the type and direction of each DMA channel from the device tree
     rc = axidma_of_parse_dma_nodes(pdev, dev);
     if (rc < 0) {
-        return rc;
+        goto free_video_streams;
+    }
+
+    // Start every channel with the default VDMA parameters, and no video
+    for (i = 0; i < dev->num_chans; i++)
+    {
+        axidma_default_vdma_config(&dev->vdma_configs[i],
+                                   dev->channels[i].channel_id);
+        spin_lock_init(&dev->cb_data[i].lock);
+        spin_lock_init(&dev->video_streams[i].lock);
+        init_waitqueue_head(&dev->video_streams[i].wait);
+        INIT_WORK(&dev->video_streams[i].refill_work,
+                  axidma_video_refill_work);
     }
 
     // Exclusively request all of the channels in the device tree entry
     rc = axidma_request_channels(pdev, dev);
     if (rc < 0) {
-        goto free_callback_data;
+        goto free_video_streams;
+    }
+
+    // Find the device that the buffers are allocated for
+    rc = axidma_find_dma_dev(dev);
+    if (rc < 0) {
+        goto release_channels;
+    }
+
+    /* Map the registers of each VDMA channel up front, which video transfers
+     * read to find the frames in use by the engine. */
+    for (i = 0; i < dev->num_chans; i++)
+    {
+        if (dev->channels[i].type != AXIDMA_VDMA) {
+            continue;
+        }
+        rc = axidma_video_map_regs(dev, &dev->video_streams[i],
+                                   &dev->channels[i]);
+        if (rc < 0) {
+            goto unmap_regs;
+        }
     }
 
     axidma_info("DMA: Found %d transmit channels and %d receive channels.\n",
@@ -720,6 +1912,22 @@ int axidma_dma_init(struct platform_device *pdev, struct axidma_device *dev)
                 dev->num_vdma_tx_chans, dev->num_vdma_rx_chans);
     return 0;
 
+unmap_regs:
+    for (i = 0; i < dev->num_chans; i++)
+    {
+        if (dev->video_streams[i].regs != NULL) {
+            iounmap(dev->video_streams[i].regs);
+        }
+    }
+release_channels:
+    for (i = 0; i < dev->num_chans; i++)
+    {
+        dma_release_channel(dev->channels[i].chan);
+    }
+free_video_streams:
+    kfree(dev->video_streams);
+free_vdma_configs:
+    kfree(dev->vdma_configs);
 free_callback_data:
     kfree(dev->cb_data);
 free_channels:
@@ -732,17 +1940,23 @@ void axidma_dma_exit(struct axidma_device *dev)
     int i;
     struct dma_chan *chan;
 
-    // Stop all running DMA transactions on all channels, and release
+    // Stop all running DMA and video transactions on all channels, and release
     for (i = 0; i < dev->num_chans; i++)
     {
         chan = dev->channels[i].chan;
-        dmaengine_terminate_all(chan);
+        axidma_video_stop(&dev->video_streams[i], &dev->channels[i]);
+        axidma_release_buffers(&dev->cb_data[i]);
+        if (dev->video_streams[i].regs != NULL) {
+            iounmap(dev->video_streams[i].regs);
+        }
         dma_release_channel(chan);
     }
 
-    // Free the channel and callback data arrays
+    // Free the channel, callback data, VDMA parameter, and video stream arrays
     kfree(dev->channels);
     kfree(dev->cb_data);
+    kfree(dev->vdma_configs);
+    kfree(dev->video_streams);
 
     return;
 }
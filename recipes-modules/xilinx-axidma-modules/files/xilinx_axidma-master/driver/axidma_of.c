@@ -12,6 +12,8 @@
 
 // Kernel Dependencies
 #include <linux/of.h>               // Device tree parsing functions
+#include <linux/of_address.h>       // Device tree address translation
+#include <linux/of_irq.h>           // Device tree interrupt mapping
 #include <linux/platform_device.h>  // Platform device definitions
 
 // Local Dependencies
@@ -260,3 +262,110 @@ int axidma_of_parse_dma_nodes(struct platform_device *pdev,
     // Check that all channels have unique channel ID's
     return axidma_check_unique_ids(dev);
 }
+
+int axidma_of_chan_regs(struct platform_device *pdev, int index,
+                        struct resource *res)
+{
+    int rc;
+    struct of_phandle_args phandle_args;
+    struct device_node *driver_node;
+
+    // Get the DMA node of the index'th channel in the 'dmas' property
+    driver_node = pdev->dev.of_node;
+    rc = of_parse_phandle_with_args(driver_node, "dmas", "#dma-cells", index,
+                                    &phandle_args);
+    if (rc < 0) {
+        axidma_node_err(driver_node, "Unable to get phandle %d from the "
+                        "'dmas' property.\n", index);
+        return rc;
+    }
+
+    // The DMA core's register window is the first entry in its 'reg' property
+    rc = of_address_to_resource(phandle_args.np, 0, res);
+    if (rc < 0) {
+        axidma_node_err(phandle_args.np, "Unable to read the 'reg' "
+                        "property.\n");
+    }
+    of_node_put(phandle_args.np);
+
+    return rc;
+}
+
+// Gets the number of channels built into the DMA core of the given channel
+int axidma_of_core_num_chans(struct platform_device *pdev, int index)
+{
+    int rc, num_chans;
+    struct of_phandle_args phandle_args;
+
+    rc = of_parse_phandle_with_args(pdev->dev.of_node, "dmas", "#dma-cells",
+                                    index, &phandle_args);
+    if (rc < 0) {
+        axidma_node_err(pdev->dev.of_node, "Unable to get phandle %d from "
+                        "the 'dmas' property.\n", index);
+        return rc;
+    }
+
+    // Each channel of the core is a child node of it
+    num_chans = of_get_child_count(phandle_args.np);
+    of_node_put(phandle_args.np);
+
+    return num_chans;
+}
+
+// Gets the address width of the DMA core, which is 32 bits unless specified
+int axidma_of_chan_addr_width(struct platform_device *pdev, int index)
+{
+    int rc;
+    u32 addr_width;
+    struct of_phandle_args phandle_args;
+
+    rc = of_parse_phandle_with_args(pdev->dev.of_node, "dmas", "#dma-cells",
+                                    index, &phandle_args);
+    if (rc < 0) {
+        return 32;
+    }
+
+    if (of_property_read_u32(phandle_args.np, "xlnx,addrwidth",
+                             &addr_width) < 0) {
+        addr_width = 32;
+    }
+    of_node_put(phandle_args.np);
+
+    return addr_width;
+}
+
+int axidma_of_chan_irq(struct platform_device *pdev, int index)
+{
+    int rc, irq;
+    struct of_phandle_args phandle_args;
+    struct device_node *driver_node, *dma_chan_node;
+
+    // Get the DMA node of the index'th channel in the 'dmas' property
+    driver_node = pdev->dev.of_node;
+    rc = of_parse_phandle_with_args(driver_node, "dmas", "#dma-cells", index,
+                                    &phandle_args);
+    if (rc < 0) {
+        axidma_node_err(driver_node, "Unable to get phandle %d from the "
+                        "'dmas' property.\n", index);
+        return rc;
+    }
+
+    // The interrupt is on the channel's node, the first or second child
+    dma_chan_node = of_get_next_child(phandle_args.np, NULL);
+    if (dma_chan_node != NULL && phandle_args.args_count >= 1 &&
+            phandle_args.args[0] == 1) {
+        dma_chan_node = of_get_next_child(phandle_args.np, dma_chan_node);
+    }
+    of_node_put(phandle_args.np);
+    if (dma_chan_node == NULL) {
+        axidma_node_err(driver_node, "Unable to find the channel node of "
+                        "phandle %d.\n", index);
+        return -ENODEV;
+    }
+
+    // A channel without an 'interrupts' property maps to 0
+    irq = irq_of_parse_and_map(dma_chan_node, 0);
+    of_node_put(dma_chan_node);
+
+    return irq;
+}
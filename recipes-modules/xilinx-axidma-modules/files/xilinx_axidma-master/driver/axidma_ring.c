@@ -0,0 +1,725 @@
+/**
+ * @file axidma_ring.c
+ * @date Saturday, October 17, 2026 at 02:36:10 PM EDT
+ *
+ * This file contains the implementation of userspace rings for the AXI DMA
+ * module. A ring hands a single DMA channel over to a process, which drives
+ * the channel's scatter-gather engine directly through its registers, without
+ * going through the kernel's DMA engine. The driver only sets up the ring,
+ * maps it and the registers into the process, and gives the channel back to
+ * the DMA engine when the process is done with it.
+ *
+ * The process polls the ring while it has traffic. Once the ring has been
+ * idle for a while, the process waits on the channel's interrupt instead, in
+ * the way NAPI does for network devices. The interrupt is enabled only for
+ * the wait, and is disabled again by the handler that wakes the process. The
+ * interrupt line is shared with the DMA engine's driver, which acknowledges
+ * the channel's interrupts as well.
+ *
+ * @bug No known bugs.
+ **/
+
+// Kernel dependencies
+#include <linux/io.h>               // I/O memory mapping and access functions
+#include <linux/iopoll.h>           // Register polling functions
+#include <linux/mm.h>               // Memory types and remapping functions
+#include <linux/fs.h>               // File operations and file types
+#include <linux/slab.h>             // Kernel allocation functions
+#include <linux/errno.h>            // Linux error codes
+#include <linux/mutex.h>            // Mutex definitions and functions
+#include <linux/ioport.h>           // Resource structure and functions
+#include <linux/dma-mapping.h>      // Coherent DMA memory functions
+#include <linux/interrupt.h>        // Interrupt handler functions
+#include <linux/spinlock.h>         // Spinlock definitions and functions
+#include <linux/wait.h>             // Wait queue functions
+#include <linux/ktime.h>            // Monotonic timestamps for the stats
+#include <linux/delay.h>            // Milliseconds to jiffies conversion
+
+// Local dependencies
+#include "axidma.h"                 // Local definitions
+#include "axidma_ioctl.h"           // IOCTL interface for the device
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The offsets of the channels' registers in the AXI DMA core's window
+#define AXIDMA_MM2S_REGS_OFFSET     0x00
+#define AXIDMA_S2MM_REGS_OFFSET     0x30
+
+// The offsets of the control and status registers for a channel
+#define AXIDMA_DMACR                0x00
+#define AXIDMA_DMASR                0x04
+
+// The fields of the control and status registers (see Xilinx PG021)
+#define AXIDMA_DMACR_RUNSTOP        (1 << 0)
+#define AXIDMA_DMACR_RESET          (1 << 2)
+#define AXIDMA_DMACR_IRQ_MASK       (0x7 << 12)
+#define AXIDMA_DMASR_HALTED         (1 << 0)
+#define AXIDMA_DMASR_IDLE           (1 << 1)
+#define AXIDMA_DMASR_SG_INCLUDED    (1 << 3)
+#define AXIDMA_DMASR_ERR_MASK       0x770
+#define AXIDMA_DMASR_IRQ_MASK       (0x7 << 12)
+
+// The offset of the status word in a descriptor, and its completion bit
+#define AXIDMA_DESC_STATUS          0x1C
+#define AXIDMA_DESC_CMPLT           (1U << 31)
+
+// The time to wait for the channel to halt or reset, in microseconds
+#define AXIDMA_RING_TIMEOUT_US      10000
+
+// The largest buffer length that a descriptor can hold
+#define AXIDMA_RING_MAX_BUFFER_SIZE ((1 << 26) - 1)
+
+/* The size of the register window mapped into the process. Both channels'
+ * registers are in the first page of the core's window, and the rest of the
+ * window is left unmapped. */
+#define AXIDMA_RING_REGS_SIZE       PAGE_SIZE
+
+// The state of a userspace ring attached to a DMA channel
+struct axidma_ring {
+    struct axidma_device *dev;      // The device the ring belongs to
+    struct file *owner;             // The file of the process that owns it
+    struct axidma_chan *chan;       // The channel the ring is attached to
+    struct axidma_chan *sibling;    // The core's other channel, if it has one
+    struct resource regs_res;       // The DMA core's register window
+    void __iomem *regs;             // The kernel mapping of the window
+    void __iomem *chan_regs;        // The channel's registers in the window
+    int regs_offset;                // The offset of the channel's registers
+    u32 saved_dmacr;                // The control register before attaching
+    struct device *dma_dev;         // The DMA engine the ring is mapped for
+    void *kern_addr;                // Kernel virtual address of the ring
+    dma_addr_t dma_addr;            // DMA bus address of the ring
+    size_t size;                    // The size of the ring's memory
+    int num_descs;                  // The number of descriptors in the ring
+    int num_maps;                   // The number of mappings of the ring
+    int num_waiters;                // The number of waits in progress
+    int irq;                        // The channel's interrupt, or 0 if none
+    wait_queue_head_t wait;         // Waiters for the channel's interrupt
+    spinlock_t irq_lock;            // Protects all of the fields below
+    bool armed;                     // The channel's interrupt is enabled
+    bool irq_mode;                  // A wait on the interrupt is in progress
+    u64 mode_start;                 // When the current mode was entered (ns)
+    struct axidma_ring_stats stats; // The counters of the completion modes
+};
+
+/*----------------------------------------------------------------------------
+ * Channel Register Functions
+ *----------------------------------------------------------------------------*/
+
+// Halts the ring's channel, with its interrupts disabled
+static int axidma_ring_halt(struct axidma_ring *ring)
+{
+    u32 dmacr, dmasr;
+
+    dmacr = ioread32(ring->chan_regs + AXIDMA_DMACR);
+    dmacr &= ~(AXIDMA_DMACR_RUNSTOP | AXIDMA_DMACR_IRQ_MASK);
+    iowrite32(dmacr, ring->chan_regs + AXIDMA_DMACR);
+
+    return readl_poll_timeout(ring->chan_regs + AXIDMA_DMASR, dmasr,
+            dmasr & AXIDMA_DMASR_HALTED, 1, AXIDMA_RING_TIMEOUT_US);
+}
+
+/* Resets the DMA core, to clear an error on the ring's channel. This resets
+ * both of the core's channels, which is safe since the ring holds both of
+ * them. The other channel's control register is restored afterwards, for the
+ * DMA engine to use it again once the ring is detached. */
+static int axidma_ring_reset(struct axidma_ring *ring)
+{
+    int rc;
+    u32 dmacr, other_dmacr;
+    void __iomem *other_regs;
+
+    other_regs = ring->regs + ((ring->regs_offset == AXIDMA_MM2S_REGS_OFFSET) ?
+                 AXIDMA_S2MM_REGS_OFFSET : AXIDMA_MM2S_REGS_OFFSET);
+    other_dmacr = ioread32(other_regs + AXIDMA_DMACR);
+
+    iowrite32(AXIDMA_DMACR_RESET, ring->chan_regs + AXIDMA_DMACR);
+    rc = readl_poll_timeout(ring->chan_regs + AXIDMA_DMACR, dmacr,
+            !(dmacr & AXIDMA_DMACR_RESET), 1, AXIDMA_RING_TIMEOUT_US);
+    if (rc < 0) {
+        axidma_err("Timed out resetting the DMA core of channel %d.\n",
+                   ring->chan->channel_id);
+        return rc;
+    }
+
+    iowrite32(other_dmacr & ~AXIDMA_DMACR_RUNSTOP, other_regs + AXIDMA_DMACR);
+    return 0;
+}
+
+/* Halts the channel, and gives it back to the DMA engine in the state it was
+ * attached in. Any error that the process left the channel in is cleared. */
+static void axidma_ring_restore(struct axidma_ring *ring)
+{
+    u32 dmasr;
+
+    if (axidma_ring_halt(ring) < 0) {
+        axidma_err("Timed out halting channel %d.\n", ring->chan->channel_id);
+    }
+
+    dmasr = ioread32(ring->chan_regs + AXIDMA_DMASR);
+    if (dmasr & AXIDMA_DMASR_ERR_MASK) {
+        axidma_ring_reset(ring);
+    }
+
+    iowrite32(ring->saved_dmacr & ~AXIDMA_DMACR_RUNSTOP,
+              ring->chan_regs + AXIDMA_DMACR);
+}
+
+/*----------------------------------------------------------------------------
+ * Adaptive Completion Functions
+ *----------------------------------------------------------------------------*/
+
+// Enables or disables the channel's interrupts. Called with the IRQ lock held.
+static void axidma_ring_set_armed(struct axidma_ring *ring, bool armed)
+{
+    u32 dmacr;
+
+    dmacr = ioread32(ring->chan_regs + AXIDMA_DMACR);
+    if (armed) {
+        iowrite32(AXIDMA_DMASR_IRQ_MASK, ring->chan_regs + AXIDMA_DMASR);
+        dmacr |= AXIDMA_DMACR_IRQ_MASK;
+    } else {
+        dmacr &= ~AXIDMA_DMACR_IRQ_MASK;
+    }
+    iowrite32(dmacr, ring->chan_regs + AXIDMA_DMACR);
+    ring->armed = armed;
+}
+
+/* Switches the ring between polling and waiting on the interrupt, adding the
+ * time spent in the mode it leaves to that mode's total. Called with the IRQ
+ * lock held. */
+static void axidma_ring_set_mode(struct axidma_ring *ring, bool irq_mode)
+{
+    u64 now;
+
+    now = ktime_get_ns();
+    if (ring->irq_mode) {
+        ring->stats.irq_time_ns += now - ring->mode_start;
+        ring->stats.poll_switches += 1;
+    } else {
+        ring->stats.poll_time_ns += now - ring->mode_start;
+        ring->stats.irq_switches += 1;
+    }
+    ring->irq_mode = irq_mode;
+    ring->mode_start = now;
+}
+
+/* Handles the channel's interrupt while a wait is in progress. The interrupt
+ * is disabled at once, and the process is left to poll the ring again. The
+ * line is shared, so the interrupt is only claimed when it was enabled. */
+static irqreturn_t axidma_ring_irq(int irq, void *data)
+{
+    struct axidma_ring *ring;
+    unsigned long flags;
+
+    ring = data;
+    spin_lock_irqsave(&ring->irq_lock, flags);
+    if (!ring->armed) {
+        spin_unlock_irqrestore(&ring->irq_lock, flags);
+        return IRQ_NONE;
+    }
+
+    axidma_ring_set_armed(ring, false);
+    iowrite32(AXIDMA_DMASR_IRQ_MASK, ring->chan_regs + AXIDMA_DMASR);
+    ring->stats.interrupts += 1;
+    spin_unlock_irqrestore(&ring->irq_lock, flags);
+
+    wake_up(&ring->wait);
+    return IRQ_HANDLED;
+}
+
+// Checks if the engine has completed the given descriptor
+static bool axidma_ring_desc_done(struct axidma_ring *ring, int desc_index)
+{
+    u32 status;
+
+    status = READ_ONCE(*(u32 *)(ring->kern_addr + desc_index *
+                AXIDMA_RING_DESC_SIZE + AXIDMA_DESC_STATUS));
+    return (status & AXIDMA_DESC_CMPLT) != 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Ring Management Functions
+ *----------------------------------------------------------------------------*/
+
+// Detaches the ring, freeing it. Must be called with the ring lock held.
+static void axidma_ring_free(struct axidma_device *dev)
+{
+    struct axidma_ring *ring;
+
+    ring = dev->ring;
+    axidma_ring_restore(ring);
+    if (ring->irq > 0) {
+        free_irq(ring->irq, ring);
+    }
+    iounmap(ring->regs);
+    dma_free_coherent(ring->dma_dev, ring->size, ring->kern_addr,
+                      ring->dma_addr);
+    kfree(ring);
+    dev->ring = NULL;
+}
+
+/* Takes the other channel of the ring's DMA core along with the ring's own.
+ * The core can only be reset as a whole, and both channels' registers share
+ * the page mapped into the process, so the ring must hold the entire core.
+ * This fails if the other channel is in use, or isn't one of the driver's. */
+static int axidma_ring_claim_core(struct axidma_device *dev,
+                                  struct axidma_ring *ring)
+{
+    int i, num_chans;
+    u32 dmasr;
+    struct resource res;
+    struct axidma_chan *chan;
+    void __iomem *other_regs;
+
+    num_chans = axidma_of_core_num_chans(dev->pdev, ring->chan - dev->channels);
+    if (num_chans < 0) {
+        return num_chans;
+    } else if (num_chans == 1) {
+        ring->sibling = NULL;
+        return 0;
+    }
+
+    // Find the driver's channel with the other direction in the same core
+    ring->sibling = NULL;
+    for (i = 0; i < dev->num_chans; i++)
+    {
+        chan = &dev->channels[i];
+        if (chan == ring->chan || chan->type != AXIDMA_DMA ||
+                chan->dir == ring->chan->dir) {
+            continue;
+        } else if (axidma_of_chan_regs(dev->pdev, i, &res) == 0 &&
+                res.start == ring->regs_res.start) {
+            ring->sibling = chan;
+            break;
+        }
+    }
+    if (ring->sibling == NULL) {
+        axidma_err("The other channel of the DMA core of channel %d does not "
+                   "belong to this driver.\n", ring->chan->channel_id);
+        return -EBUSY;
+    }
+
+    // The other channel must be stopped, or have nothing left to do
+    other_regs = ring->regs + ((ring->regs_offset == AXIDMA_MM2S_REGS_OFFSET) ?
+                 AXIDMA_S2MM_REGS_OFFSET : AXIDMA_MM2S_REGS_OFFSET);
+    dmasr = ioread32(other_regs + AXIDMA_DMASR);
+    if (axidma_chan_busy(dev, ring->sibling) ||
+            !(dmasr & (AXIDMA_DMASR_HALTED | AXIDMA_DMASR_IDLE))) {
+        axidma_err("Channel %d, on the same DMA core as channel %d, is in "
+                   "use.\n", ring->sibling->channel_id,
+                   ring->chan->channel_id);
+        return -EBUSY;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * VMA Operations
+ *----------------------------------------------------------------------------*/
+
+static void axidma_ring_vma_open(struct vm_area_struct *vma)
+{
+    struct axidma_ring *ring;
+
+    ring = vma->vm_private_data;
+    mutex_lock(&ring->dev->ring_lock);
+    ring->num_maps += 1;
+    mutex_unlock(&ring->dev->ring_lock);
+}
+
+static void axidma_ring_vma_close(struct vm_area_struct *vma)
+{
+    struct axidma_ring *ring;
+
+    ring = vma->vm_private_data;
+    mutex_lock(&ring->dev->ring_lock);
+    ring->num_maps -= 1;
+    mutex_unlock(&ring->dev->ring_lock);
+}
+
+// The VMA operations for the ring's registers and memory
+static const struct vm_operations_struct axidma_ring_vm_ops = {
+    .open = axidma_ring_vma_open,
+    .close = axidma_ring_vma_close,
+};
+
+/*----------------------------------------------------------------------------
+ * Public Interface
+ *----------------------------------------------------------------------------*/
+
+int axidma_ring_attach(struct axidma_device *dev, struct file *file,
+                       struct axidma_ring_info *info)
+{
+    int rc;
+    u64 ring_size;
+    struct axidma_chan *chan;
+    struct axidma_ring *ring;
+
+    // Check that the channel can have a ring, and the ring's dimensions
+    chan = axidma_get_chan(dev, info->channel_id);
+    if (chan == NULL || chan->type != AXIDMA_DMA) {
+        axidma_err("Invalid device id %d for DMA channel.\n",
+                   info->channel_id);
+        return -ENODEV;
+    } else if (info->num_descriptors < AXIDMA_RING_MIN_DESCRIPTORS ||
+               info->num_descriptors > AXIDMA_RING_MAX_DESCRIPTORS) {
+        axidma_err("Invalid number of descriptors %d, must be between %d and "
+                   "%d.\n", info->num_descriptors, AXIDMA_RING_MIN_DESCRIPTORS,
+                   AXIDMA_RING_MAX_DESCRIPTORS);
+        return -EINVAL;
+    } else if (info->buffer_size == 0 ||
+               info->buffer_size > AXIDMA_RING_MAX_BUFFER_SIZE) {
+        axidma_err("Invalid ring buffer size %zu, must be between 1 and %d.\n",
+                   info->buffer_size, AXIDMA_RING_MAX_BUFFER_SIZE);
+        return -EINVAL;
+    }
+
+    info->buffer_stride = ALIGN(info->buffer_size, AXIDMA_RING_DESC_SIZE);
+    ring_size = (u64)info->num_descriptors *
+                (AXIDMA_RING_DESC_SIZE + info->buffer_stride);
+    if (ring_size > SIZE_MAX - PAGE_SIZE) {
+        axidma_err("Ring of %d buffers of size %zu is too large.\n",
+                   info->num_descriptors, info->buffer_size);
+        return -EINVAL;
+    }
+
+    // Only one process can drive a channel directly at a time
+    mutex_lock(&dev->ring_lock);
+    if (dev->ring != NULL) {
+        axidma_err("A ring is already attached to channel %d.\n",
+                   dev->ring->chan->channel_id);
+        rc = -EBUSY;
+        goto unlock;
+    }
+
+    ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+    if (ring == NULL) {
+        axidma_err("Unable to allocate the ring structure.\n");
+        rc = -ENOMEM;
+        goto unlock;
+    }
+    ring->dev = dev;
+    ring->owner = file;
+    ring->chan = chan;
+    ring->size = PAGE_ALIGN(ring_size);
+    ring->num_descs = info->num_descriptors;
+    init_waitqueue_head(&ring->wait);
+    spin_lock_init(&ring->irq_lock);
+    ring->stats.channel_id = chan->channel_id;
+
+    // Find the channel's registers, which must be mappable by the process
+    rc = axidma_of_chan_regs(dev->pdev, chan - dev->channels,
+                             &ring->regs_res);
+    if (rc < 0) {
+        goto free_ring;
+    } else if (!PAGE_ALIGNED(ring->regs_res.start)) {
+        axidma_err("The registers of channel %d are not page aligned.\n",
+                   chan->channel_id);
+        rc = -EINVAL;
+        goto free_ring;
+    }
+    ring->regs = ioremap(ring->regs_res.start,
+                         resource_size(&ring->regs_res));
+    if (ring->regs == NULL) {
+        axidma_err("Unable to map the registers of channel %d.\n",
+                   chan->channel_id);
+        rc = -ENOMEM;
+        goto free_ring;
+    }
+    ring->regs_offset = (chan->dir == AXIDMA_WRITE) ?
+                        AXIDMA_MM2S_REGS_OFFSET : AXIDMA_S2MM_REGS_OFFSET;
+    ring->chan_regs = ring->regs + ring->regs_offset;
+
+    // The ring takes the whole DMA core, which has to be free
+    rc = axidma_ring_claim_core(dev, ring);
+    if (rc < 0) {
+        goto unmap_regs;
+    }
+
+    // The ring's descriptors are handled by the scatter-gather engine
+    if (!(ioread32(ring->chan_regs + AXIDMA_DMASR) &
+                AXIDMA_DMASR_SG_INCLUDED)) {
+        axidma_err("Channel %d does not have a scatter-gather engine.\n",
+                   chan->channel_id);
+        rc = -EOPNOTSUPP;
+        goto unmap_regs;
+    }
+
+    /* Allocate the descriptors and buffers together, as coherent memory. The
+     * channel's DMA engine reads and writes them, so they are allocated for
+     * the engine's device, which is the one behind any IOMMU. */
+    ring->dma_dev = chan->chan->device->dev;
+    ring->kern_addr = dma_alloc_coherent(ring->dma_dev, ring->size,
+                                         &ring->dma_addr, GFP_KERNEL);
+    if (ring->kern_addr == NULL) {
+        axidma_err("Unable to allocate contiguous DMA memory region of size "
+                   "%zu for the ring.\n", ring->size);
+        rc = -ENOMEM;
+        goto unmap_regs;
+    }
+    memset(ring->kern_addr, 0, ring->size);
+
+    // Take the channel from the DMA engine, and halt it for the process
+    dmaengine_terminate_all(chan->chan);
+    ring->saved_dmacr = ioread32(ring->chan_regs + AXIDMA_DMACR);
+    rc = axidma_ring_halt(ring);
+    if (rc < 0) {
+        axidma_err("Timed out halting channel %d.\n", chan->channel_id);
+        goto restore_chan;
+    }
+
+    /* Share the channel's interrupt with the DMA engine's driver, for waits.
+     * Without one, the process can still poll the ring. */
+    ring->irq = axidma_of_chan_irq(dev->pdev, chan - dev->channels);
+    if (ring->irq > 0) {
+        rc = request_irq(ring->irq, axidma_ring_irq, IRQF_SHARED,
+                         MODULE_NAME, ring);
+        if (rc < 0) {
+            axidma_err("Unable to request interrupt %d for channel %d.\n",
+                       ring->irq, chan->channel_id);
+            goto restore_chan;
+        }
+    }
+    ring->mode_start = ktime_get_ns();
+
+    info->ring_size = ring->size;
+    info->regs_size = AXIDMA_RING_REGS_SIZE;
+    info->regs_offset = ring->regs_offset;
+    info->ring_dma_addr = ring->dma_addr;
+    dev->ring = ring;
+    mutex_unlock(&dev->ring_lock);
+    return 0;
+
+restore_chan:
+    axidma_ring_restore(ring);
+    dma_free_coherent(ring->dma_dev, ring->size, ring->kern_addr,
+                      ring->dma_addr);
+unmap_regs:
+    iounmap(ring->regs);
+free_ring:
+    kfree(ring);
+unlock:
+    mutex_unlock(&dev->ring_lock);
+    return rc;
+}
+
+int axidma_ring_detach(struct axidma_device *dev, struct file *file,
+                       int channel_id)
+{
+    int rc;
+
+    // Only the process that attached the ring can detach it
+    mutex_lock(&dev->ring_lock);
+    if (dev->ring == NULL || dev->ring->chan->channel_id != channel_id) {
+        axidma_err("No ring is attached to channel %d.\n", channel_id);
+        rc = -ENODEV;
+    } else if (dev->ring->owner != file) {
+        axidma_err("The ring on channel %d belongs to another process.\n",
+                   channel_id);
+        rc = -EPERM;
+    } else if (dev->ring->num_maps > 0) {
+        axidma_err("The ring on channel %d is still mapped.\n", channel_id);
+        rc = -EBUSY;
+    } else if (dev->ring->num_waiters > 0) {
+        axidma_err("The ring on channel %d is being waited on.\n",
+                   channel_id);
+        rc = -EBUSY;
+    } else {
+        axidma_ring_free(dev);
+        rc = 0;
+    }
+    mutex_unlock(&dev->ring_lock);
+
+    return rc;
+}
+
+void axidma_ring_release(struct axidma_device *dev, struct file *file)
+{
+    /* The mappings hold a reference to the file, so they're all gone by the
+     * time it's released, and the ring can be freed. */
+    mutex_lock(&dev->ring_lock);
+    if (dev->ring != NULL && dev->ring->owner == file) {
+        axidma_ring_free(dev);
+    }
+    mutex_unlock(&dev->ring_lock);
+}
+
+bool axidma_ring_attached(struct axidma_device *dev, struct axidma_chan *chan)
+{
+    bool attached;
+
+    mutex_lock(&dev->ring_lock);
+    attached = dev->ring != NULL && (dev->ring->chan == chan ||
+                                     dev->ring->sibling == chan);
+    mutex_unlock(&dev->ring_lock);
+
+    return attached;
+}
+
+int axidma_ring_mmap(struct axidma_device *dev, struct file *file,
+                     struct vm_area_struct *vma)
+{
+    int rc;
+    size_t size;
+    struct axidma_ring *ring;
+
+    mutex_lock(&dev->ring_lock);
+    ring = dev->ring;
+    if (ring == NULL || ring->owner != file) {
+        axidma_err("No ring is attached by this process to map.\n");
+        rc = -ENODEV;
+        goto unlock;
+    }
+
+    // Map either the registers, uncached, or the ring's memory
+    size = vma->vm_end - vma->vm_start;
+    if (vma->vm_pgoff == AXIDMA_RING_REGS_PGOFF) {
+        if (size > AXIDMA_RING_REGS_SIZE) {
+            axidma_err("Mapping of size %zu is larger than the registers.\n",
+                       size);
+            rc = -EINVAL;
+            goto unlock;
+        }
+        vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+        rc = io_remap_pfn_range(vma, vma->vm_start,
+                ring->regs_res.start >> PAGE_SHIFT, size, vma->vm_page_prot);
+    } else {
+        if (size > ring->size) {
+            axidma_err("Mapping of size %zu is larger than the ring.\n", size);
+            rc = -EINVAL;
+            goto unlock;
+        }
+        vma->vm_pgoff = 0;
+        rc = dma_mmap_coherent(ring->dma_dev, vma, ring->kern_addr,
+                               ring->dma_addr, ring->size);
+    }
+    if (rc < 0) {
+        axidma_err("Unable to map the ring into userspace.\n");
+        goto unlock;
+    }
+
+    // Count the mappings, so the ring isn't detached while they remain
+    vma->vm_ops = &axidma_ring_vm_ops;
+    vma->vm_private_data = ring;
+    vma->vm_flags |= VM_DONTCOPY;
+    ring->num_maps += 1;
+    rc = 0;
+
+unlock:
+    mutex_unlock(&dev->ring_lock);
+    return rc;
+}
+
+/* Enables the channel's interrupt, then checks the descriptor, so that a
+ * completion just before the interrupt was enabled is not missed. The ring
+ * can't be freed during the wait, since detaching it fails while there are
+ * waiters, and releasing the file waits for the ioctl to return. */
+int axidma_ring_wait(struct axidma_device *dev, struct file *file,
+                     struct axidma_ring_wait *wait)
+{
+    int rc;
+    long timeout, time_remain;
+    unsigned long flags;
+    struct axidma_ring *ring;
+
+    mutex_lock(&dev->ring_lock);
+    ring = dev->ring;
+    if (ring == NULL || ring->chan->channel_id != wait->channel_id) {
+        axidma_err("No ring is attached to channel %d.\n", wait->channel_id);
+        rc = -ENODEV;
+    } else if (ring->owner != file) {
+        axidma_err("The ring on channel %d belongs to another process.\n",
+                   wait->channel_id);
+        rc = -EPERM;
+    } else if (wait->desc_index < 0 || wait->desc_index >= ring->num_descs) {
+        axidma_err("Invalid descriptor %d for the ring of %d descriptors.\n",
+                   wait->desc_index, ring->num_descs);
+        rc = -EINVAL;
+    } else if (ring->irq <= 0) {
+        rc = -EOPNOTSUPP;
+    } else {
+        ring->num_waiters += 1;
+        rc = 0;
+    }
+    mutex_unlock(&dev->ring_lock);
+    if (rc < 0) {
+        return rc;
+    }
+
+    // Arm the interrupt, unless the descriptor completed in the meantime
+    spin_lock_irqsave(&ring->irq_lock, flags);
+    axidma_ring_set_armed(ring, true);
+    mb();
+    if (axidma_ring_desc_done(ring, wait->desc_index)) {
+        axidma_ring_set_armed(ring, false);
+        spin_unlock_irqrestore(&ring->irq_lock, flags);
+        rc = 0;
+        goto done;
+    }
+    axidma_ring_set_mode(ring, true);
+    spin_unlock_irqrestore(&ring->irq_lock, flags);
+
+    timeout = (wait->timeout < 0) ? MAX_SCHEDULE_TIMEOUT :
+              msecs_to_jiffies(wait->timeout);
+    time_remain = wait_event_interruptible_timeout(ring->wait, !ring->armed,
+                                                   timeout);
+    if (time_remain < 0) {
+        rc = time_remain;
+    } else if (time_remain == 0 && ring->armed) {
+        rc = -ETIMEDOUT;
+    } else {
+        rc = 0;
+    }
+
+    // Go back to polling, disarming the interrupt if it didn't arrive
+    spin_lock_irqsave(&ring->irq_lock, flags);
+    if (ring->armed) {
+        axidma_ring_set_armed(ring, false);
+    }
+    axidma_ring_set_mode(ring, false);
+    spin_unlock_irqrestore(&ring->irq_lock, flags);
+
+done:
+    mutex_lock(&dev->ring_lock);
+    ring->num_waiters -= 1;
+    mutex_unlock(&dev->ring_lock);
+    return rc;
+}
+
+int axidma_ring_get_stats(struct axidma_device *dev,
+                          struct axidma_ring_stats *stats)
+{
+    int rc;
+    u64 elapsed;
+    unsigned long flags;
+    struct axidma_ring *ring;
+
+    mutex_lock(&dev->ring_lock);
+    ring = dev->ring;
+    if (ring == NULL || ring->chan->channel_id != stats->channel_id) {
+        axidma_err("No ring is attached to channel %d.\n",
+                   stats->channel_id);
+        rc = -ENODEV;
+        goto unlock;
+    }
+
+    // Count the time in the current mode so far
+    spin_lock_irqsave(&ring->irq_lock, flags);
+    *stats = ring->stats;
+    elapsed = ktime_get_ns() - ring->mode_start;
+    stats->irq_mode = ring->irq_mode;
+    if (ring->irq_mode) {
+        stats->irq_time_ns += elapsed;
+    } else {
+        stats->poll_time_ns += elapsed;
+    }
+    spin_unlock_irqrestore(&ring->irq_lock, flags);
+    rc = 0;
+
+unlock:
+    mutex_unlock(&dev->ring_lock);
+    return rc;
+}
@@ -15,6 +15,23 @@
  * the a given number of times to calculate the performance statistics. All of
  * these options are configurable from the command line.
  *
+ * With the -p option, the transfers are then run again through an offload
+ * pipeline that keeps several blocks in flight, and the speedup over the
+ * lock-step transfers is reported. With the -w option, they are run striped
+ * across several pairs of channels, and the throughput of each channel is
+ * reported as well. With the -j option, they are run as independent jobs,
+ * scheduled across several pairs of channels, and the utilisation and queue
+ * wait time of each pair are reported.
+ *
+ * With the -T option, a workload trace is replayed instead, each line of which
+ * is a one-way transfer with its own size, direction, channel, and time since
+ * the previous one, and the throughput and latency percentiles of the
+ * transfers are reported. The trace is replayed open-loop by default, where
+ * each transfer is started at its time whether or not the earlier ones have
+ * completed, and its latency is counted from that time. With -C it is
+ * replayed closed-loop, where each transfer is started its time after the
+ * previous one completes.
+ *
  * NOTE: This program assumes that there are only two DMA channels being used by
  * the PL fabric, one that consumes data and sends it to the PL fabric logic,
  * and another that sends the output of the PL fabric back to memory. If you
@@ -27,8 +44,10 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <string.h>             // Strlen function
+#include <time.h>               // Clock for the trace's timing
 
 #include <fcntl.h>              // Flags for open()
 #include <sys/stat.h>           // Open() system call
@@ -39,8 +58,11 @@
 #include <sys/time.h>           // Timing functions and definitions
 #include <getopt.h>             // Option parsing
 #include <errno.h>              // Error codes
+#include <assert.h>             // Assert macro
+#include <signal.h>             // Signal handling for the soak test
 
 #include "libaxidma.h"          // Interface to the AXI DMA
+#include "libaxidma_sched.h"    // Job scheduler for several channel pairs
 #include "util.h"               // Miscellaneous utilities
 #include "conversion.h"         // Miscellaneous conversion utilities
 
@@ -55,11 +77,104 @@
 // The default number of transfers to benchmark
 #define DEFAULT_NUM_TRANSFERS       1000
 
+// The time to wait for a block to come back through the pipeline
+#define PIPELINE_TIMEOUT            10000
+
+// The default size of the chunks of a striped transfer, and its timeout
+#define DEFAULT_CHUNK_SIZE          (256 * 1024)
+#define STRIPE_TIMEOUT              10000
+
+// The time to wait for all of the scheduled jobs to be done
+#define SCHED_TIMEOUT               60000
+
+/* The most transfers that a trace keeps queued on each channel, the time to
+ * wait for the last of them, and how long to sleep between checks on them */
+#define TRACE_MAX_QUEUED            8
+#define TRACE_TIMEOUT               10000
+#define TRACE_POLL_NS               20000
+
+// The longest line of a trace
+#define TRACE_LINE_SIZE             256
+
+/* The size of the soak test's small transfers, which its latency is sampled
+ * on, and the number of samples a series must drift over to be flagged */
+#define SOAK_SMALL_SIZE             4096
+#define SOAK_DRIFT_SAMPLES          10
+
 // The pattern that we fill into the buffers
 #define TEST_PATTERN(i) ((int)(0x1234ACDE ^ (i)))
 
 // The DMA context passed to the helper thread, who handles remainder channels
 
+// A transfer of a workload trace
+struct trace_record {
+    size_t size;                // The size of the transfer
+    bool transmit;              // The transfer is to the PL fabric
+    int channel;                // The channel, or -1 for the default one
+    uint64_t gap_ns;            // The time since the previous transfer
+    uint64_t start_ns;          // When it was due to start, or started
+    uint64_t done_ns;           // When it completed
+    struct trace_channel *chan; // The channel's state
+};
+
+// A channel used by a trace, with its buffer and the transfers queued on it
+struct trace_channel {
+    int channel_id;             // The device id of the channel
+    void *buf;                  // The buffer shared by its transfers
+    size_t buf_size;            // The size of the buffer
+    int queued;                 // The number of transfers queued on it
+    int completed;              // The number of those that have completed
+    int done;                   // Transfers completed, set by the callback
+    int records[TRACE_MAX_QUEUED];          // The queued transfers
+    uint64_t done_ns[TRACE_MAX_QUEUED];     // When they completed
+};
+
+// The series of the soak test that are checked for drift
+enum soak_series {
+    SOAK_DRIFT_THROUGHPUT,      // The throughput of all of the transfers
+    SOAK_DRIFT_LATENCY,         // The latency of the small transfers
+    SOAK_DRIFT_RSS,             // The resident memory of the process
+    SOAK_DRIFT_CMA,             // The free CMA memory
+    SOAK_DRIFT_BUFFERS,         // The buffers allocated through the driver
+    SOAK_DRIFT_EXTERNAL,        // The buffers registered with the driver
+    SOAK_NUM_DRIFTS,
+};
+
+// A series of the soak test, and the run of samples it is on
+struct soak_drift {
+    const char *name;           // The name to report it under
+    int direction;              // 1 if growing is worse, -1 if shrinking is
+    double last;                // The last sample
+    double run_start;           // The sample the run started on
+    int run_length;             // The samples in the run that weren't better
+    int samples;                // The number of samples taken
+    bool flagged;               // The run has been reported as drift
+};
+
+// The workload and the counts of the soak test
+struct soak_state {
+    int tx_channel;             // The channel to transmit on
+    int rx_channel;             // The channel to receive on
+    void *tx_buf;               // The long-lived transmit buffer
+    size_t tx_size;             // The size of the transmit buffer
+    void *rx_buf;               // The long-lived receive buffer
+    size_t rx_size;             // The size of the receive buffer
+    void *small_tx_buf;         // The buffer for the small transmits
+    void *small_rx_buf;         // The buffer for the small receives
+    size_t alloc_size;          // The size of the short-lived buffers
+    uint64_t bytes;             // Bytes moved since the last sample
+    uint64_t transfers;         // Transfers since the last sample
+    uint64_t *latencies;        // Small transfer latencies since the last one
+    int num_latencies;          // The number of latencies
+    int max_latencies;          // The space for latencies
+    unsigned long long alloc_failures;      // Failed short-lived allocations
+    struct soak_drift drift[SOAK_NUM_DRIFTS];   // The series checked
+    bool drifted;               // Any series has been flagged
+};
+
+// Indicates if the soak test is still running, cleared by a signal
+static volatile bool soak_running = true;
+
 /*----------------------------------------------------------------------------
  * Command-line Interface
  *----------------------------------------------------------------------------*/
@@ -74,7 +189,11 @@ static void print_usage(bool help)
             "[-r <(V)DMA rx channel>] [-i <Tx transfer size (MiB)>] "
             "[-b <Tx transfer size (bytes)>] [-f <Tx frame size (HxWxD)>] "
             "[-o <Rx transfer size (MiB)>] [-s <Rx transfer size (bytes)>] "
-            "[-g <Rx frame size (HxWxD)>] [-n <number transfers>]\n");
+            "[-g <Rx frame size (HxWxD)>] [-n <number transfers>] "
+            "[-p <pipeline depth>] [-w <stripe width>] "
+            "[-c <stripe chunk size (bytes)>] [-j <scheduled pairs>] "
+            "[-T <workload trace> [-C]] [-S <soak interval> [-L <soak log>]]"
+            "\n");
     if (!help) {
         return;
     }
@@ -107,6 +226,35 @@ static void print_usage(bool help)
     fprintf(stream, "\t-n <number transfers>:\t\t\tThe number of DMA transfers "
             "to perform to do the benchmark. Default is %d transfers.\n",
             DEFAULT_NUM_TRANSFERS);
+    fprintf(stream, "\t-p <pipeline depth>:\t\t\tAlso run the transfers "
+            "through a pipeline that keeps this many blocks in flight, and "
+            "report the speedup. Only for AXI DMA.\n");
+    fprintf(stream, "\t-w <stripe width>:\t\t\tAlso run the transfers "
+            "striped across this many pairs of channels, and report the "
+            "throughput of each. Only for AXI DMA.\n");
+    fprintf(stream, "\t-c <stripe chunk size (bytes)>:\tThe size of the "
+            "chunks that striped transfers are split into. Default is %d "
+            "bytes.\n", DEFAULT_CHUNK_SIZE);
+    fprintf(stream, "\t-j <scheduled pairs>:\t\t\tAlso run the transfers as "
+            "jobs scheduled across this many pairs of channels, and report "
+            "the utilisation of each. Only for AXI DMA.\n");
+    fprintf(stream, "\t-T <workload trace>:\t\t\tReplay a workload trace "
+            "instead, and report the throughput and latency percentiles of "
+            "its transfers. Each line of the trace is a transfer, as 'size,"
+            "direction,channel,interarrival', where the direction is tx or rx, "
+            "the channel is -1 for the one given by -t or -r, and the "
+            "interarrival is the time since the previous transfer in "
+            "microseconds. Only for AXI DMA.\n");
+    fprintf(stream, "\t-C:\t\t\t\tReplay the trace closed-loop, starting "
+            "each transfer its interarrival time after the previous one "
+            "completes. Default is open-loop, starting each transfer at its "
+            "time regardless.\n");
+    fprintf(stream, "\t-S <soak interval>:\t\t\tRun a mixed workload until "
+            "interrupted, sampling the throughput, latency, process memory, "
+            "CMA free memory, and driver buffer counts every this many "
+            "seconds, and warning of any that drift. Only for AXI DMA.\n");
+    fprintf(stream, "\t-L <soak log>:\t\t\t\tThe file to write the soak "
+            "samples to, as CSV. Default is stdout.\n");
     return;
 }
 
@@ -114,7 +262,10 @@ static void print_usage(bool help)
  * and number of transfer to use for the benchmark if specified. */
 static int parse_args(int argc, char **argv, int *tx_channel, int *rx_channel,
         size_t *tx_size, struct axidma_video_frame *tx_frame, size_t *rx_size,
-        struct axidma_video_frame *rx_frame, int *num_transfers, bool *use_vdma)
+        struct axidma_video_frame *rx_frame, int *num_transfers, bool *use_vdma,
+        int *pipeline_depth, int *stripe_width, size_t *chunk_size,
+        int *sched_pairs, char **trace_path, bool *closed_loop,
+        int *soak_interval, char **soak_log)
 {
     double double_arg;
     int int_arg;
@@ -129,13 +280,28 @@ static int parse_args(int argc, char **argv, int *tx_channel, int *rx_channel,
     tx_frame->height = -1;
     tx_frame->width = -1;
     tx_frame->depth = -1;
+    tx_frame->stride = 0;
+    tx_frame->x_offset = 0;
+    tx_frame->y_offset = 0;
     *rx_size = DEFAULT_TRANSFER_SIZE;
     rx_frame->height = -1;
     rx_frame->width = -1;
     rx_frame->depth = -1;
+    rx_frame->stride = 0;
+    rx_frame->x_offset = 0;
+    rx_frame->y_offset = 0;
     *num_transfers = DEFAULT_NUM_TRANSFERS;
-
-    while ((option = getopt(argc, argv, "vt:r:i:b:f:o:s:g:n:h")) != (char)-1)
+    *pipeline_depth = 0;
+    *stripe_width = 0;
+    *chunk_size = DEFAULT_CHUNK_SIZE;
+    *sched_pairs = 0;
+    *trace_path = NULL;
+    *closed_loop = false;
+    *soak_interval = 0;
+    *soak_log = NULL;
+
+    while ((option = getopt(argc, argv, "vt:r:i:b:f:o:s:g:n:p:w:c:j:T:CS:L:h"))
+            != (char)-1)
     {
         switch (option)
         {
@@ -238,6 +404,84 @@ static int parse_args(int argc, char **argv, int *tx_channel, int *rx_channel,
                 *num_transfers = int_arg;
                 break;
 
+            // Parse the pipeline depth argument
+            case 'p':
+                if (parse_int(option, optarg, &int_arg) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                } else if (int_arg <= 0) {
+                    fprintf(stderr, "Error: The pipeline depth must be "
+                            "positive.\n");
+                    return -EINVAL;
+                }
+                *pipeline_depth = int_arg;
+                break;
+
+            // Parse the stripe width argument
+            case 'w':
+                if (parse_int(option, optarg, &int_arg) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                } else if (int_arg <= 0) {
+                    fprintf(stderr, "Error: The stripe width must be "
+                            "positive.\n");
+                    return -EINVAL;
+                }
+                *stripe_width = int_arg;
+                break;
+
+            // Parse the stripe chunk size argument
+            case 'c':
+                if (parse_int(option, optarg, &int_arg) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                } else if (int_arg <= 0) {
+                    fprintf(stderr, "Error: The chunk size must be "
+                            "positive.\n");
+                    return -EINVAL;
+                }
+                *chunk_size = int_arg;
+                break;
+
+            // Parse the number of scheduled pairs argument
+            case 'j':
+                if (parse_int(option, optarg, &int_arg) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                } else if (int_arg <= 0) {
+                    fprintf(stderr, "Error: The number of scheduled pairs "
+                            "must be positive.\n");
+                    return -EINVAL;
+                }
+                *sched_pairs = int_arg;
+                break;
+
+            // Parse the workload trace argument
+            case 'T':
+                *trace_path = optarg;
+                break;
+
+            case 'C':
+                *closed_loop = true;
+                break;
+
+            // Parse the soak test's sample interval and log
+            case 'S':
+                if (parse_int(option, optarg, &int_arg) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                } else if (int_arg <= 0) {
+                    fprintf(stderr, "Error: The soak interval must be "
+                            "positive.\n");
+                    return -EINVAL;
+                }
+                *soak_interval = int_arg;
+                break;
+
+            case 'L':
+                *soak_log = optarg;
+                break;
+
             // Print detailed usage message
             case 'h':
                 print_usage(true);
@@ -268,6 +512,33 @@ static int parse_args(int argc, char **argv, int *tx_channel, int *rx_channel,
         return -EINVAL;
     }
 
+    if (*use_vdma && (*pipeline_depth > 0 || *stripe_width > 0 ||
+                      *sched_pairs > 0)) {
+        fprintf(stderr, "Error: The -p, -w and -j options can not be used "
+                "with -v.\n");
+        return -EINVAL;
+    }
+
+    if (*trace_path != NULL && (*use_vdma || *pipeline_depth > 0 ||
+                                *stripe_width > 0 || *sched_pairs > 0)) {
+        fprintf(stderr, "Error: The -T option can not be used with -v, -p, -w "
+                "or -j.\n");
+        return -EINVAL;
+    } else if (*trace_path == NULL && *closed_loop) {
+        fprintf(stderr, "Error: The -C option can only be used with -T.\n");
+        return -EINVAL;
+    }
+
+    if (*soak_interval > 0 && (*use_vdma || *pipeline_depth > 0 ||
+            *stripe_width > 0 || *sched_pairs > 0 || *trace_path != NULL)) {
+        fprintf(stderr, "Error: The -S option can not be used with -v, -p, -w, "
+                "-j or -T.\n");
+        return -EINVAL;
+    } else if (*soak_interval == 0 && *soak_log != NULL) {
+        fprintf(stderr, "Error: The -L option can only be used with -S.\n");
+        return -EINVAL;
+    }
+
     return 0;
 }
 
@@ -411,7 +682,8 @@ static int single_transfer_test(axidma_dev_t dev, int tx_channel, void *tx_buf,
  * of each channel in MiB/s. */
 static int time_dma(axidma_dev_t dev, int tx_channel, void *tx_buf, int tx_size,
         struct axidma_video_frame *tx_frame, int rx_channel, void *rx_buf,
-        int rx_size, struct axidma_video_frame *rx_frame, int num_transfers)
+        int rx_size, struct axidma_video_frame *rx_frame, int num_transfers,
+        double *elapsed)
 {
     int i, rc;
     struct timeval start_time, end_time;
@@ -447,9 +719,997 @@ static int time_dma(axidma_dev_t dev, int tx_channel, void *tx_buf, int tx_size,
     printf("\tReceive Throughput: %0.2f MiB/s\n", rx_data_rate);
     printf("\tTotal Throughput: %0.2f MiB/s\n", tx_data_rate + rx_data_rate);
 
+    *elapsed = elapsed_time;
     return 0;
 }
 
+/* Profiles the same transfers through an offload pipeline, which keeps up to
+ * depth blocks in flight, reporting the throughput, the occupancy of each
+ * stage, and the speedup over the lock-step transfers. */
+static int time_pipeline(axidma_dev_t dev, int tx_channel, int tx_size,
+        int rx_channel, int rx_size, int num_transfers, int depth,
+        double lockstep_time)
+{
+    int rc, submitted, received;
+    axidma_pipeline_t pipe;
+    struct axidma_pipeline_occupancy occupancy;
+    struct timeval start_time, end_time;
+    double elapsed_time, tx_data_rate, rx_data_rate;
+
+    pipe = axidma_pipeline_create(dev, tx_channel, rx_channel, depth, tx_size,
+            rx_size);
+    if (pipe == NULL) {
+        fprintf(stderr, "Failed to create a pipeline of depth %d.\n", depth);
+        return -ENOMEM;
+    }
+
+    // Begin timing
+    gettimeofday(&start_time, NULL);
+
+    // Keep the pipeline full, taking the blocks out of it in order
+    rc = 0;
+    submitted = 0;
+    for (received = 0; received < num_transfers; received++)
+    {
+        while (submitted < num_transfers &&
+               axidma_pipeline_input(pipe) != NULL)
+        {
+            rc = axidma_pipeline_submit(pipe, tx_size);
+            if (rc < 0) {
+                fprintf(stderr, "DMA failed on transfer %d, not reporting "
+                        "timing results.\n", submitted+1);
+                goto destroy_pipe;
+            }
+            submitted += 1;
+        }
+
+        if (axidma_pipeline_output(pipe, PIPELINE_TIMEOUT) == NULL) {
+            rc = -errno;
+            fprintf(stderr, "Transfer %d did not come back through the "
+                    "pipeline, not reporting timing results.\n", received+1);
+            goto destroy_pipe;
+        }
+        axidma_pipeline_release(pipe);
+    }
+
+    // End timing
+    gettimeofday(&end_time, NULL);
+    axidma_pipeline_get_occupancy(pipe, &occupancy);
+
+    // Compute the throughput of each channel
+    elapsed_time = TVAL_TO_SEC(end_time) - TVAL_TO_SEC(start_time);
+    tx_data_rate = BYTE_TO_MIB(tx_size) * num_transfers / elapsed_time;
+    rx_data_rate = BYTE_TO_MIB(rx_size) * num_transfers / elapsed_time;
+
+    // Report the statistics to the user
+    printf("\nPipelined DMA Timing Statistics (depth %d):\n", depth);
+    printf("\tElapsed Time: %0.2f s\n", elapsed_time);
+    printf("\tTransmit Throughput: %0.2f MiB/s\n", tx_data_rate);
+    printf("\tReceive Throughput: %0.2f MiB/s\n", rx_data_rate);
+    printf("\tTotal Throughput: %0.2f MiB/s\n", tx_data_rate + rx_data_rate);
+    printf("\tAverage Blocks Sending: %0.2f\n", occupancy.avg_sending);
+    printf("\tAverage Blocks Processing: %0.2f\n", occupancy.avg_processing);
+    printf("\tSpeedup over Lock-Step: %0.2fx\n", lockstep_time / elapsed_time);
+
+destroy_pipe:
+    axidma_pipeline_destroy(pipe);
+    return rc;
+}
+
+// Prints the throughput of a striped stream's channels, and of the whole of it
+static void print_stripe_stats(axidma_stripe_t stripe, const char *name,
+        const int *channels, int width)
+{
+    int i;
+    struct axidma_stripe_stats channel_stats[width], total;
+
+    axidma_stripe_get_stats(stripe, channel_stats, &total);
+    for (i = 0; i < width; i++)
+    {
+        printf("\t%s Channel %d Throughput: %0.2f MiB/s\n", name, channels[i],
+               BYTE_TO_MIB(channel_stats[i].bytes) /
+               (channel_stats[i].time_ns / 1e9));
+    }
+    printf("\t%s Aggregate Throughput: %0.2f MiB/s\n", name,
+           BYTE_TO_MIB(total.bytes) / (total.time_ns / 1e9));
+    return;
+}
+
+/* Profiles the same transfers striped across the lowest numbered width pairs
+ * of channels, reporting the throughput of each channel, the aggregate
+ * throughput, and the speedup over the lock-step transfers. */
+static int time_stripe(axidma_dev_t dev, void *tx_buf, int tx_size,
+        void *rx_buf, int rx_size, int num_transfers, int width,
+        size_t chunk_size, double lockstep_time)
+{
+    int i, rc;
+    const array_t *tx_chans, *rx_chans;
+    axidma_stripe_t tx_stripe, rx_stripe;
+    struct timeval start_time, end_time;
+    double elapsed_time;
+
+    tx_chans = axidma_get_dma_tx(dev);
+    rx_chans = axidma_get_dma_rx(dev);
+    if (tx_chans->len < width || rx_chans->len < width) {
+        fprintf(stderr, "Error: A stripe width of %d needs %d transmit and "
+                "receive channels.\n", width, width);
+        return -ENODEV;
+    }
+
+    tx_stripe = axidma_stripe_create(dev, tx_chans->data, width, chunk_size);
+    if (tx_stripe == NULL) {
+        fprintf(stderr, "Failed to create the transmit stripe.\n");
+        return -ENOMEM;
+    }
+    rx_stripe = axidma_stripe_create(dev, rx_chans->data, width, chunk_size);
+    if (rx_stripe == NULL) {
+        fprintf(stderr, "Failed to create the receive stripe.\n");
+        rc = -ENOMEM;
+        goto destroy_tx_stripe;
+    }
+
+    // Begin timing
+    gettimeofday(&start_time, NULL);
+
+    // Perform n transfers, each striped across all of the channels
+    for (i = 0; i < num_transfers; i++)
+    {
+        rc = axidma_stripe_twoway(tx_stripe, tx_buf, tx_size, rx_stripe,
+                rx_buf, rx_size, STRIPE_TIMEOUT);
+        if (rc < 0) {
+            fprintf(stderr, "Striped DMA failed on transfer %d, not reporting "
+                    "timing results.\n", i+1);
+            goto destroy_rx_stripe;
+        }
+    }
+
+    // End timing
+    gettimeofday(&end_time, NULL);
+    elapsed_time = TVAL_TO_SEC(end_time) - TVAL_TO_SEC(start_time);
+
+    // Report the statistics to the user
+    printf("\nStriped DMA Timing Statistics (width %d, %zu byte chunks):\n",
+           width, chunk_size);
+    printf("\tElapsed Time: %0.2f s\n", elapsed_time);
+    print_stripe_stats(tx_stripe, "Transmit", tx_chans->data, width);
+    print_stripe_stats(rx_stripe, "Receive", rx_chans->data, width);
+    printf("\tSpeedup over Lock-Step: %0.2fx\n", lockstep_time / elapsed_time);
+
+destroy_rx_stripe:
+    axidma_stripe_destroy(rx_stripe);
+destroy_tx_stripe:
+    axidma_stripe_destroy(tx_stripe);
+    return rc;
+}
+
+/* Profiles the same transfers as independent jobs, scheduled across the
+ * lowest numbered pairs of channels, reporting the utilisation and queue wait
+ * time of each pair, and the speedup over the lock-step transfers. The data
+ * is not checked, so all of the jobs share the same buffers. */
+static int time_sched(axidma_dev_t dev, void *tx_buf, int tx_size,
+        void *rx_buf, int rx_size, int num_transfers, int num_pairs,
+        double lockstep_time)
+{
+    int i, rc;
+    const array_t *tx_chans, *rx_chans;
+    axidma_sched_t sched;
+    struct axidma_job *jobs;
+    struct axidma_sched_stats stats;
+    struct timeval start_time, end_time;
+    double elapsed_time, avg_wait;
+
+    tx_chans = axidma_get_dma_tx(dev);
+    rx_chans = axidma_get_dma_rx(dev);
+    if (tx_chans->len < num_pairs || rx_chans->len < num_pairs) {
+        fprintf(stderr, "Error: Scheduling across %d pairs needs %d transmit "
+                "and receive channels.\n", num_pairs, num_pairs);
+        return -ENODEV;
+    }
+
+    jobs = calloc(num_transfers, sizeof(jobs[0]));
+    if (jobs == NULL) {
+        return -ENOMEM;
+    }
+    sched = axidma_sched_create(dev, tx_chans->data, rx_chans->data,
+            num_pairs, num_transfers);
+    if (sched == NULL) {
+        fprintf(stderr, "Failed to create the job scheduler.\n");
+        rc = -ENOMEM;
+        goto free_jobs;
+    }
+
+    // Begin timing
+    gettimeofday(&start_time, NULL);
+
+    // Submit all of the jobs, then wait for them to be done
+    for (i = 0; i < num_transfers; i++)
+    {
+        jobs[i].tx_buf = tx_buf;
+        jobs[i].tx_len = tx_size;
+        jobs[i].rx_buf = rx_buf;
+        jobs[i].rx_len = rx_size;
+        rc = axidma_sched_submit(sched, &jobs[i]);
+        assert(rc == 0);
+    }
+    rc = axidma_sched_drain(sched, SCHED_TIMEOUT);
+    if (rc < 0) {
+        fprintf(stderr, "The scheduled jobs did not finish, not reporting "
+                "timing results.\n");
+        goto destroy_sched;
+    }
+    for (i = 0; i < num_transfers; i++)
+    {
+        if (jobs[i].status < 0) {
+            fprintf(stderr, "DMA failed on job %d, not reporting timing "
+                    "results.\n", i+1);
+            rc = jobs[i].status;
+            goto destroy_sched;
+        }
+    }
+
+    // End timing
+    gettimeofday(&end_time, NULL);
+    elapsed_time = TVAL_TO_SEC(end_time) - TVAL_TO_SEC(start_time);
+
+    // Report the statistics to the user
+    printf("\nScheduled DMA Timing Statistics (%d pairs):\n", num_pairs);
+    printf("\tElapsed Time: %0.2f s\n", elapsed_time);
+    for (i = 0; i < num_pairs; i++)
+    {
+        axidma_sched_get_stats(sched, i, &stats);
+        avg_wait = (stats.jobs == 0) ? 0.0 :
+                   (double)stats.wait_ns / stats.jobs / 1e6;
+        printf("\tPair %d (channels %d/%d): %llu jobs, %llu stolen, "
+               "%0.1f%% utilised, %0.3f ms average wait, %0.3f ms "
+               "maximum wait\n", i, tx_chans->data[i], rx_chans->data[i],
+               (unsigned long long)stats.jobs,
+               (unsigned long long)stats.stolen, stats.utilisation * 100.0,
+               avg_wait, stats.max_wait_ns / 1e6);
+    }
+    printf("\tTotal Throughput: %0.2f MiB/s\n",
+           BYTE_TO_MIB(tx_size + rx_size) * num_transfers / elapsed_time);
+    printf("\tSpeedup over Lock-Step: %0.2fx\n", lockstep_time / elapsed_time);
+
+destroy_sched:
+    axidma_sched_destroy(sched);
+free_jobs:
+    free(jobs);
+    return rc;
+}
+
+/*----------------------------------------------------------------------------
+ * Workload Trace Replay
+ *----------------------------------------------------------------------------*/
+
+// Gets the current time in nanoseconds
+static uint64_t get_time_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* Parses a line of a trace into the record. Returns 1 if the line holds a
+ * transfer, 0 if it is blank or a comment, and -EINVAL otherwise. */
+static int parse_trace_line(char *line, struct trace_record *record)
+{
+    char direction[8];
+    double gap_us;
+    long long size;
+
+    line += strspn(line, " \t");
+    if (*line == '#' || *line == '\n' || *line == '\r' || *line == '\0') {
+        return 0;
+    }
+
+    if (sscanf(line, "%lld , %7[a-z] , %d , %lf", &size, direction,
+               &record->channel, &gap_us) != 4 || size <= 0 || gap_us < 0 ||
+            (strcmp(direction, "tx") != 0 && strcmp(direction, "rx") != 0)) {
+        return -EINVAL;
+    }
+
+    record->size = size;
+    record->transmit = strcmp(direction, "tx") == 0;
+    record->gap_ns = gap_us * 1000;
+    return 1;
+}
+
+/* Reads the records of a trace from the file. The first line may be a header
+ * naming the columns, which is skipped. */
+static int load_trace(const char *path, struct trace_record **records,
+        int *num_records)
+{
+    int rc, line_num, capacity;
+    char line[TRACE_LINE_SIZE];
+    FILE *file;
+    struct trace_record *grown;
+
+    file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Unable to open the workload trace");
+        return -errno;
+    }
+
+    *records = NULL;
+    *num_records = 0;
+    capacity = 0;
+    rc = 0;
+    for (line_num = 1; fgets(line, sizeof(line), file) != NULL; line_num++)
+    {
+        if (*num_records == capacity) {
+            capacity = (capacity == 0) ? 256 : capacity * 2;
+            grown = realloc(*records, capacity * sizeof(**records));
+            if (grown == NULL) {
+                rc = -ENOMEM;
+                break;
+            }
+            *records = grown;
+        }
+
+        rc = parse_trace_line(line, &(*records)[*num_records]);
+        if (rc < 0 && line_num == 1) {
+            rc = 0;
+        } else if (rc < 0) {
+            fprintf(stderr, "Error: Line %d of the workload trace is not "
+                    "'size,direction,channel,interarrival'.\n", line_num);
+            break;
+        }
+        *num_records += rc;
+        rc = 0;
+    }
+
+    fclose(file);
+    if (rc == 0 && *num_records == 0) {
+        fprintf(stderr, "Error: The workload trace holds no transfers.\n");
+        rc = -EINVAL;
+    }
+    if (rc < 0) {
+        free(*records);
+    }
+    return rc;
+}
+
+// Checks if the channel is one of the channels in the array
+static bool has_channel(const array_t *chans, int channel)
+{
+    int i;
+
+    for (i = 0; i < chans->len; i++)
+    {
+        if (chans->data[i] == channel) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Finds the channel of each record, checking that it goes in the record's
+ * direction, and gives each channel a buffer as big as its largest transfer.
+ * The transfers on a channel share its buffer, since the data isn't checked. */
+static int setup_trace_channels(axidma_dev_t dev, struct trace_record *records,
+        int num_records, int tx_channel, int rx_channel,
+        struct trace_channel *chans, int *num_chans)
+{
+    int i, j;
+    const array_t *tx_chans, *rx_chans;
+    struct trace_record *record;
+
+    tx_chans = axidma_get_dma_tx(dev);
+    rx_chans = axidma_get_dma_rx(dev);
+    *num_chans = 0;
+    for (i = 0; i < num_records; i++)
+    {
+        record = &records[i];
+        if (record->channel == -1) {
+            record->channel = record->transmit ? tx_channel : rx_channel;
+        }
+        if (!has_channel(record->transmit ? tx_chans : rx_chans,
+                         record->channel)) {
+            fprintf(stderr, "Error: Transfer %d of the workload trace is on "
+                    "channel %d, which is not a DMA %s channel.\n", i+1,
+                    record->channel, record->transmit ? "transmit" : "receive");
+            return -ENODEV;
+        }
+
+        for (j = 0; j < *num_chans; j++)
+        {
+            if (chans[j].channel_id == record->channel) {
+                break;
+            }
+        }
+        if (j == *num_chans) {
+            memset(&chans[j], 0, sizeof(chans[j]));
+            chans[j].channel_id = record->channel;
+            *num_chans += 1;
+        }
+        if (record->size > chans[j].buf_size) {
+            chans[j].buf_size = record->size;
+        }
+        record->chan = &chans[j];
+    }
+
+    for (j = 0; j < *num_chans; j++)
+    {
+        chans[j].buf = axidma_malloc(dev, chans[j].buf_size);
+        if (chans[j].buf == NULL) {
+            fprintf(stderr, "Unable to allocate a %zu byte buffer for channel "
+                    "%d.\n", chans[j].buf_size, chans[j].channel_id);
+            return -ENOMEM;
+        }
+    }
+    return 0;
+}
+
+// Stamps a completed transfer of a trace, called from the signal handler
+static void trace_done(int channel_id, void *data)
+{
+    int done;
+    struct trace_channel *chan;
+
+    (void)channel_id;
+    chan = data;
+    done = __atomic_load_n(&chan->done, __ATOMIC_RELAXED);
+    chan->done_ns[done % TRACE_MAX_QUEUED] = get_time_ns();
+    __atomic_add_fetch(&chan->done, 1, __ATOMIC_RELEASE);
+    return;
+}
+
+/* Hands the completion times of a channel's transfers to their records. Each
+ * channel completes its transfers in the order they were queued. */
+static void trace_harvest(struct trace_record *records,
+        struct trace_channel *chan)
+{
+    int done;
+
+    done = __atomic_load_n(&chan->done, __ATOMIC_ACQUIRE);
+    for (; chan->completed < done; chan->completed++)
+    {
+        records[chan->records[chan->completed % TRACE_MAX_QUEUED]].done_ns =
+                chan->done_ns[chan->completed % TRACE_MAX_QUEUED];
+    }
+}
+
+/* Starts each transfer at its time, as measured from the start of the replay,
+ * whether or not the earlier ones have completed. A transfer is held back if
+ * its channel already has the most transfers queued, but its latency is still
+ * counted from its time. The completion signals interrupt the sleeps, so the
+ * completions are harvested as they come in. */
+static int replay_open_loop(axidma_dev_t dev, struct trace_record *records,
+        int num_records, struct trace_channel *chans, int num_chans)
+{
+    int i, j, outstanding;
+    uint64_t due_ns, now_ns;
+    struct timespec pause;
+    struct trace_record *record;
+    struct trace_channel *chan;
+
+    pause.tv_sec = 0;
+    due_ns = get_time_ns();
+    for (i = 0; i < num_records; i++)
+    {
+        record = &records[i];
+        chan = record->chan;
+        due_ns += record->gap_ns;
+        record->start_ns = due_ns;
+        while (true)
+        {
+            for (j = 0; j < num_chans; j++)
+            {
+                trace_harvest(records, &chans[j]);
+            }
+            now_ns = get_time_ns();
+            if (now_ns >= due_ns &&
+                    chan->queued - chan->completed < TRACE_MAX_QUEUED) {
+                break;
+            }
+
+            pause.tv_nsec = TRACE_POLL_NS;
+            if (now_ns < due_ns && due_ns - now_ns < TRACE_POLL_NS) {
+                pause.tv_nsec = due_ns - now_ns;
+            }
+            nanosleep(&pause, NULL);
+        }
+
+        chan->records[chan->queued % TRACE_MAX_QUEUED] = i;
+        if (axidma_oneway_transfer(dev, chan->channel_id, chan->buf,
+                record->size, false) < 0) {
+            fprintf(stderr, "DMA failed on transfer %d of the trace, not "
+                    "reporting timing results.\n", i+1);
+            return -errno;
+        }
+        chan->queued += 1;
+    }
+
+    // Wait for the last of the transfers to complete
+    pause.tv_nsec = TRACE_POLL_NS;
+    now_ns = get_time_ns();
+    do
+    {
+        outstanding = 0;
+        for (j = 0; j < num_chans; j++)
+        {
+            trace_harvest(records, &chans[j]);
+            outstanding += chans[j].queued - chans[j].completed;
+        }
+        if (outstanding > 0) {
+            nanosleep(&pause, NULL);
+        }
+    } while (outstanding > 0 &&
+             get_time_ns() - now_ns < (uint64_t)TRACE_TIMEOUT * 1000000);
+
+    if (outstanding > 0) {
+        fprintf(stderr, "%d transfers of the trace did not complete, not "
+                "reporting timing results.\n", outstanding);
+        return -ETIMEDOUT;
+    }
+    return 0;
+}
+
+/* Starts each transfer its time after the previous one completes, with only
+ * one transfer in flight at a time. */
+static int replay_closed_loop(axidma_dev_t dev, struct trace_record *records,
+        int num_records)
+{
+    int i;
+    struct timespec pause;
+    struct trace_record *record;
+
+    for (i = 0; i < num_records; i++)
+    {
+        record = &records[i];
+        if (record->gap_ns > 0) {
+            pause.tv_sec = record->gap_ns / 1000000000;
+            pause.tv_nsec = record->gap_ns % 1000000000;
+            while (nanosleep(&pause, &pause) < 0 && errno == EINTR)
+            {
+            }
+        }
+
+        record->start_ns = get_time_ns();
+        if (axidma_oneway_transfer(dev, record->channel, record->chan->buf,
+                record->size, true) < 0) {
+            fprintf(stderr, "DMA failed on transfer %d of the trace, not "
+                    "reporting timing results.\n", i+1);
+            return -errno;
+        }
+        record->done_ns = get_time_ns();
+    }
+
+    return 0;
+}
+
+// Orders latencies from shortest to longest
+static int compare_latency(const void *a, const void *b)
+{
+    uint64_t x, y;
+
+    x = *(const uint64_t *)a;
+    y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Gets the latency that the given fraction of the sorted latencies are within
+static double percentile_us(const uint64_t *latencies, int count,
+        double fraction)
+{
+    int index;
+
+    index = (int)(fraction * count + 0.999999) - 1;
+    if (index < 0) {
+        index = 0;
+    }
+    return latencies[index] / 1e3;
+}
+
+/* Replays the workload trace open-loop or closed-loop, reporting the
+ * throughput in each direction, and the percentiles of the latency of the
+ * transfers, from when each was due to start until it completed. */
+static int time_trace(axidma_dev_t dev, const char *path, int tx_channel,
+        int rx_channel, bool closed_loop)
+{
+    int i, rc, num_records, num_chans;
+    uint64_t start_ns, tx_bytes, rx_bytes, latency_total;
+    uint64_t *latencies;
+    double elapsed_time;
+    struct trace_record *records;
+    struct trace_channel *chans;
+
+    rc = load_trace(path, &records, &num_records);
+    if (rc < 0) {
+        return rc;
+    }
+    chans = calloc(num_records, sizeof(*chans));
+    latencies = calloc(num_records, sizeof(*latencies));
+    if (chans == NULL || latencies == NULL) {
+        rc = -ENOMEM;
+        goto free_records;
+    }
+    rc = setup_trace_channels(dev, records, num_records, tx_channel,
+                              rx_channel, chans, &num_chans);
+    if (rc < 0) {
+        goto free_chans;
+    }
+
+    printf("Replaying %d transfers %s-loop from '%s'.\n\n", num_records,
+           closed_loop ? "closed" : "open", path);
+    for (i = 0; i < num_chans; i++)
+    {
+        axidma_set_callback(dev, chans[i].channel_id, trace_done, &chans[i]);
+    }
+    start_ns = get_time_ns();
+    if (closed_loop) {
+        rc = replay_closed_loop(dev, records, num_records);
+    } else {
+        rc = replay_open_loop(dev, records, num_records, chans, num_chans);
+    }
+    elapsed_time = (get_time_ns() - start_ns) / 1e9;
+    for (i = 0; i < num_chans; i++)
+    {
+        if (rc < 0) {
+            axidma_stop_transfer(dev, chans[i].channel_id);
+        }
+        axidma_set_callback(dev, chans[i].channel_id, NULL, NULL);
+    }
+    if (rc < 0) {
+        goto free_chans;
+    }
+
+    // Gather the bytes moved in each direction, and the latencies
+    tx_bytes = 0;
+    rx_bytes = 0;
+    latency_total = 0;
+    for (i = 0; i < num_records; i++)
+    {
+        *(records[i].transmit ? &tx_bytes : &rx_bytes) += records[i].size;
+        latencies[i] = records[i].done_ns - records[i].start_ns;
+        latency_total += latencies[i];
+    }
+    qsort(latencies, num_records, sizeof(*latencies), compare_latency);
+
+    // Report the statistics to the user
+    printf("Trace Replay Timing Statistics (%s-loop):\n",
+           closed_loop ? "closed" : "open");
+    printf("\tElapsed Time: %0.2f s\n", elapsed_time);
+    printf("\tTransfer Rate: %0.2f transfers/s\n", num_records / elapsed_time);
+    printf("\tTransmit Throughput: %0.2f MiB/s\n",
+           BYTE_TO_MIB(tx_bytes) / elapsed_time);
+    printf("\tReceive Throughput: %0.2f MiB/s\n",
+           BYTE_TO_MIB(rx_bytes) / elapsed_time);
+    printf("\tAverage Latency: %0.2f us\n",
+           (double)latency_total / num_records / 1e3);
+    printf("\tLatency Percentiles: %0.2f us (50%%), %0.2f us (90%%), "
+           "%0.2f us (99%%), %0.2f us (99.9%%), %0.2f us (max)\n",
+           percentile_us(latencies, num_records, 0.5),
+           percentile_us(latencies, num_records, 0.9),
+           percentile_us(latencies, num_records, 0.99),
+           percentile_us(latencies, num_records, 0.999),
+           latencies[num_records-1] / 1e3);
+
+free_chans:
+    for (i = 0; chans != NULL && i < num_records; i++)
+    {
+        if (chans[i].buf != NULL) {
+            axidma_free(dev, chans[i].buf, chans[i].buf_size);
+        }
+    }
+    free(chans);
+    free(latencies);
+free_records:
+    free(records);
+    return rc;
+}
+
+/*----------------------------------------------------------------------------
+ * Soak Test
+ *----------------------------------------------------------------------------*/
+
+// Stops the soak test, which otherwise runs until interrupted
+static void soak_signal_handler(int signal)
+{
+    (void)signal;
+    soak_running = false;
+}
+
+// Gets the resident set size of the process in KiB, or -1 if it's not known
+static long long soak_rss_kib()
+{
+    long long pages;
+    FILE *file;
+
+    file = fopen("/proc/self/statm", "r");
+    if (file == NULL) {
+        return -1;
+    }
+    if (fscanf(file, "%*s %lld", &pages) != 1) {
+        pages = -1;
+    }
+    fclose(file);
+
+    return (pages < 0) ? -1 : pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Gets the free CMA memory in KiB, or -1 if the kernel has no CMA
+static long long soak_cma_free_kib()
+{
+    long long value;
+    char line[TRACE_LINE_SIZE];
+    FILE *file;
+
+    file = fopen("/proc/meminfo", "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    value = -1;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (sscanf(line, "CmaFree: %lld kB", &value) == 1) {
+            break;
+        }
+    }
+    fclose(file);
+
+    return value;
+}
+
+/* Follows one of the series for drift, which is a run of samples that never
+ * get better, and have gotten worse overall. The direction is positive for a
+ * series that gets worse as it grows. A series is only flagged once per run,
+ * and can be flagged again after it gets better. */
+static void soak_check_drift(struct soak_drift *drift, double value)
+{
+    if (drift->samples == 0 || drift->direction * (value - drift->last) < 0) {
+        drift->run_start = value;
+        drift->run_length = 0;
+        drift->flagged = false;
+    } else {
+        drift->run_length += 1;
+    }
+    drift->last = value;
+    drift->samples += 1;
+
+    if (!drift->flagged && drift->run_length >= SOAK_DRIFT_SAMPLES &&
+            drift->direction * (value - drift->run_start) > 0) {
+        fprintf(stderr, "Warning: %s has drifted for %d samples, from %0.2f "
+                "to %0.2f.\n", drift->name, drift->run_length,
+                drift->run_start, value);
+        drift->flagged = true;
+    }
+}
+
+// Times a two-way transfer, adding it to the soak test's counts
+static int soak_transfer(axidma_dev_t dev, struct soak_state *soak,
+        void *tx_buf, size_t tx_size, void *rx_buf, size_t rx_size,
+        bool sample_latency)
+{
+    int rc;
+    uint64_t start_ns;
+    uint64_t *grown;
+
+    start_ns = get_time_ns();
+    rc = axidma_twoway_transfer(dev, soak->tx_channel, tx_buf, tx_size, NULL,
+            soak->rx_channel, rx_buf, rx_size, NULL, true);
+    if (rc < 0) {
+        return rc;
+    }
+
+    soak->transfers += 1;
+    soak->bytes += tx_size + rx_size;
+    if (!sample_latency) {
+        return 0;
+    }
+
+    if (soak->num_latencies == soak->max_latencies) {
+        soak->max_latencies = (soak->max_latencies == 0) ? 1024 :
+                              2 * soak->max_latencies;
+        grown = realloc(soak->latencies,
+                        soak->max_latencies * sizeof(*soak->latencies));
+        if (grown == NULL) {
+            return -ENOMEM;
+        }
+        soak->latencies = grown;
+    }
+    soak->latencies[soak->num_latencies++] = get_time_ns() - start_ns;
+    return 0;
+}
+
+/* Runs a round of the mixed workload: a transfer of the full size from the
+ * long-lived buffers, a small transfer whose latency is sampled, and a
+ * transfer through buffers allocated for just that transfer. The size of the
+ * short-lived buffers doubles each round, up to the full size, so that the
+ * CMA area sees a spread of allocation sizes. */
+static int soak_round(axidma_dev_t dev, struct soak_state *soak)
+{
+    int rc;
+    void *tx_buf, *rx_buf;
+
+    rc = soak_transfer(dev, soak, soak->tx_buf, soak->tx_size, soak->rx_buf,
+            soak->rx_size, false);
+    if (rc < 0) {
+        return rc;
+    }
+    rc = soak_transfer(dev, soak, soak->small_tx_buf, SOAK_SMALL_SIZE,
+            soak->small_rx_buf, SOAK_SMALL_SIZE, true);
+    if (rc < 0) {
+        return rc;
+    }
+
+    soak->alloc_size *= 2;
+    if (soak->alloc_size > soak->tx_size || soak->alloc_size > soak->rx_size) {
+        soak->alloc_size = SOAK_SMALL_SIZE;
+    }
+    tx_buf = axidma_malloc(dev, soak->alloc_size);
+    rx_buf = axidma_malloc(dev, soak->alloc_size);
+    if (tx_buf != NULL && rx_buf != NULL) {
+        rc = soak_transfer(dev, soak, tx_buf, soak->alloc_size, rx_buf,
+                soak->alloc_size, false);
+    } else {
+        soak->alloc_failures += 1;
+    }
+    if (rx_buf != NULL) {
+        axidma_free(dev, rx_buf, soak->alloc_size);
+    }
+    if (tx_buf != NULL) {
+        axidma_free(dev, tx_buf, soak->alloc_size);
+    }
+
+    return rc;
+}
+
+/* Writes out a sample of the time series, covering the rounds since the last
+ * one, and checks each series for drift. */
+static void soak_sample(axidma_dev_t dev, struct soak_state *soak, FILE *log,
+        double elapsed, double interval)
+{
+    int i;
+    double p50_us, p99_us, max_us;
+    long long rss_kib, cma_free_kib;
+    struct axidma_buffer_stats buffer_stats;
+
+    p50_us = -1;
+    p99_us = -1;
+    max_us = -1;
+    if (soak->num_latencies > 0) {
+        qsort(soak->latencies, soak->num_latencies, sizeof(*soak->latencies),
+              compare_latency);
+        p50_us = percentile_us(soak->latencies, soak->num_latencies, 0.5);
+        p99_us = percentile_us(soak->latencies, soak->num_latencies, 0.99);
+        max_us = soak->latencies[soak->num_latencies-1] / 1e3;
+    }
+
+    rss_kib = soak_rss_kib();
+    cma_free_kib = soak_cma_free_kib();
+    if (axidma_get_buffer_stats(dev, &buffer_stats) < 0) {
+        memset(&buffer_stats, 0, sizeof(buffer_stats));
+        buffer_stats.num_buffers = -1;
+        buffer_stats.num_external = -1;
+    }
+
+    fprintf(log, "%0.1f,%0.2f,%0.1f,%0.2f,%0.2f,%0.2f,%lld,%lld,%d,%llu,%d,"
+            "%llu\n", elapsed, BYTE_TO_MIB(soak->bytes) / interval,
+            soak->transfers / interval, p50_us, p99_us, max_us, rss_kib,
+            cma_free_kib, buffer_stats.num_buffers,
+            buffer_stats.buffer_bytes / 1024, buffer_stats.num_external,
+            soak->alloc_failures);
+    fflush(log);
+
+    soak_check_drift(&soak->drift[SOAK_DRIFT_THROUGHPUT],
+                     BYTE_TO_MIB(soak->bytes) / interval);
+    soak_check_drift(&soak->drift[SOAK_DRIFT_LATENCY], p99_us);
+    soak_check_drift(&soak->drift[SOAK_DRIFT_RSS], rss_kib);
+    soak_check_drift(&soak->drift[SOAK_DRIFT_CMA], cma_free_kib);
+    soak_check_drift(&soak->drift[SOAK_DRIFT_BUFFERS],
+                     buffer_stats.num_buffers);
+    soak_check_drift(&soak->drift[SOAK_DRIFT_EXTERNAL],
+                     buffer_stats.num_external);
+
+    // Start the counts over for the next sample
+    soak->bytes = 0;
+    soak->transfers = 0;
+    soak->num_latencies = 0;
+    for (i = 0; i < SOAK_NUM_DRIFTS; i++)
+    {
+        if (soak->drift[i].flagged) {
+            soak->drifted = true;
+        }
+    }
+}
+
+/* Runs the mixed workload until interrupted, sampling the throughput, the
+ * latency of the small transfers, and the use of memory and DMA buffers
+ * every interval. The samples are written as CSV to the log, or to stdout,
+ * and a warning is printed whenever one of the series drifts. */
+static int run_soak(axidma_dev_t dev, int tx_channel, void *tx_buf,
+        size_t tx_size, int rx_channel, void *rx_buf, size_t rx_size,
+        int interval, const char *log_path)
+{
+    int rc;
+    uint64_t start_ns, sample_ns, now_ns;
+    FILE *log;
+    struct soak_state soak;
+    static const char *const names[SOAK_NUM_DRIFTS] = {
+        "Throughput", "99th percentile latency", "RSS", "CMA free memory",
+        "Driver buffers", "External buffers",
+    };
+    static const int directions[SOAK_NUM_DRIFTS] = {-1, 1, 1, -1, 1, 1};
+
+    memset(&soak, 0, sizeof(soak));
+    for (rc = 0; rc < SOAK_NUM_DRIFTS; rc++)
+    {
+        soak.drift[rc].name = names[rc];
+        soak.drift[rc].direction = directions[rc];
+    }
+    soak.tx_channel = tx_channel;
+    soak.rx_channel = rx_channel;
+    soak.tx_buf = tx_buf;
+    soak.tx_size = tx_size;
+    soak.rx_buf = rx_buf;
+    soak.rx_size = rx_size;
+    soak.alloc_size = SOAK_SMALL_SIZE;
+
+    log = (log_path == NULL) ? stdout : fopen(log_path, "w");
+    if (log == NULL) {
+        fprintf(stderr, "Unable to open the soak log '%s': %s.\n", log_path,
+                strerror(errno));
+        return -errno;
+    }
+
+    soak.small_tx_buf = axidma_malloc(dev, SOAK_SMALL_SIZE);
+    soak.small_rx_buf = axidma_malloc(dev, SOAK_SMALL_SIZE);
+    if (soak.small_tx_buf == NULL || soak.small_rx_buf == NULL) {
+        fprintf(stderr, "Unable to allocate the soak test's small buffers.\n");
+        rc = -ENOMEM;
+        goto free_bufs;
+    }
+
+    printf("Soaking until interrupted, sampling every %d s.\n\n", interval);
+    fprintf(log, "elapsed_s,mib_per_s,transfers_per_s,p50_us,p99_us,max_us,"
+            "rss_kib,cma_free_kib,driver_buffers,driver_buffer_kib,"
+            "external_buffers,alloc_failures\n");
+    signal(SIGINT, soak_signal_handler);
+    signal(SIGTERM, soak_signal_handler);
+
+    rc = 0;
+    start_ns = get_time_ns();
+    sample_ns = start_ns;
+    while (soak_running)
+    {
+        rc = soak_round(dev, &soak);
+        if (rc < 0) {
+            fprintf(stderr, "DMA failed during the soak test: %s.\n",
+                    strerror(-rc));
+            break;
+        }
+
+        now_ns = get_time_ns();
+        if (now_ns - sample_ns >= (uint64_t)interval * 1000000000) {
+            soak_sample(dev, &soak, log, (now_ns - start_ns) / 1e9,
+                        (now_ns - sample_ns) / 1e9);
+            sample_ns = now_ns;
+        }
+    }
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    printf("\nSoak test ran for %0.1f s, %s.\n",
+           (get_time_ns() - start_ns) / 1e9,
+           soak.drifted ? "with drift flagged" : "with no drift flagged");
+
+free_bufs:
+    if (soak.small_rx_buf != NULL) {
+        axidma_free(dev, soak.small_rx_buf, SOAK_SMALL_SIZE);
+    }
+    if (soak.small_tx_buf != NULL) {
+        axidma_free(dev, soak.small_tx_buf, SOAK_SMALL_SIZE);
+    }
+    free(soak.latencies);
+    if (log != stdout) {
+        fclose(log);
+    }
+    return rc;
+}
+
 /*----------------------------------------------------------------------------
  * Main Function
  *----------------------------------------------------------------------------*/
@@ -457,10 +1717,12 @@ static int time_dma(axidma_dev_t dev, int tx_channel, void *tx_buf, int tx_size,
 int main(int argc, char **argv)
 {
     int rc;
-    int num_transfers;
-    int tx_channel, rx_channel;
-    size_t tx_size, rx_size;
-    bool use_vdma;
+    int num_transfers, pipeline_depth, stripe_width, sched_pairs;
+    int tx_channel, rx_channel, soak_interval;
+    size_t tx_size, rx_size, chunk_size;
+    bool use_vdma, closed_loop;
+    char *trace_path, *soak_log;
+    double lockstep_time;
     char *tx_buf, *rx_buf;
     axidma_dev_t axidma_dev;
     const array_t *tx_chans, *rx_chans;
@@ -469,12 +1731,17 @@ int main(int argc, char **argv)
     // Check if the user overrided the default transfer size and number
     if (parse_args(argc, argv, &tx_channel, &rx_channel, &tx_size,
             &transmit_frame, &rx_size, &receive_frame, &num_transfers,
-            &use_vdma) < 0) {
+            &use_vdma, &pipeline_depth, &stripe_width, &chunk_size,
+            &sched_pairs, &trace_path, &closed_loop, &soak_interval,
+            &soak_log) < 0) {
         rc = 1;
         goto ret;
     }
     printf("AXI DMA Benchmark Parameters:\n");
-    if (!use_vdma) {
+    if (trace_path != NULL) {
+        printf("\tWorkload Trace: %s (%s-loop)\n", trace_path,
+               closed_loop ? "closed" : "open");
+    } else if (!use_vdma) {
         printf("\tTransmit Buffer Size: %0.2f MiB\n", BYTE_TO_MIB(tx_size));
         printf("\tReceive Buffer Size: %0.2f MiB\n", BYTE_TO_MIB(rx_size));
     } else {
@@ -485,7 +1752,22 @@ int main(int argc, char **argv)
                 receive_frame.height, receive_frame.width, receive_frame.depth,
                 BYTE_TO_MIB(rx_size));
     }
-    printf("\tNumber of DMA Transfers: %d transfers\n\n", num_transfers);
+    if (soak_interval > 0) {
+        printf("\tSoak Sample Interval: %d s\n", soak_interval);
+    } else if (trace_path == NULL) {
+        printf("\tNumber of DMA Transfers: %d transfers\n", num_transfers);
+    }
+    if (pipeline_depth > 0) {
+        printf("\tPipeline Depth: %d blocks\n", pipeline_depth);
+    }
+    if (stripe_width > 0) {
+        printf("\tStripe Width: %d channels\n", stripe_width);
+        printf("\tStripe Chunk Size: %zu bytes\n", chunk_size);
+    }
+    if (sched_pairs > 0) {
+        printf("\tScheduled Channel Pairs: %d pairs\n", sched_pairs);
+    }
+    printf("\n");
 
     // Initialize the AXI DMA device
     axidma_dev = axidma_init();
@@ -495,6 +1777,20 @@ int main(int argc, char **argv)
         goto ret;
     }
 
+    // Replay the workload trace in place of the fixed-size transfers
+    if (trace_path != NULL) {
+        tx_chans = axidma_get_dma_tx(axidma_dev);
+        rx_chans = axidma_get_dma_rx(axidma_dev);
+        if (tx_channel == -1 && rx_channel == -1 && tx_chans->len > 0 &&
+                rx_chans->len > 0) {
+            tx_channel = tx_chans->data[0];
+            rx_channel = rx_chans->data[0];
+        }
+        rc = time_trace(axidma_dev, trace_path, tx_channel, rx_channel,
+                closed_loop);
+        goto destroy_axidma;
+    }
+
     // Map memory regions for the transmit and receive buffers
     tx_buf = axidma_malloc(axidma_dev, tx_size);
     if (tx_buf == NULL) {
@@ -549,10 +1845,45 @@ int main(int argc, char **argv)
     }
     printf("Single transfer test successfully completed!\n");
 
+    // Run the mixed workload in place of the benchmark, until interrupted
+    if (soak_interval > 0) {
+        rc = run_soak(axidma_dev, tx_channel, tx_buf, tx_size, rx_channel,
+                rx_buf, rx_size, soak_interval, soak_log);
+        goto free_rx_buf;
+    }
+
     // Time the DMA eingine
     printf("Beginning performance analysis of the DMA engine.\n\n");
     rc = time_dma(axidma_dev, tx_channel, tx_buf, tx_size, tx_frame,
-            rx_channel, rx_buf, rx_size, rx_frame, num_transfers);
+            rx_channel, rx_buf, rx_size, rx_frame, num_transfers,
+            &lockstep_time);
+    if (rc < 0) {
+        goto free_rx_buf;
+    }
+
+    // Run the same transfers with several blocks in flight
+    if (pipeline_depth > 0) {
+        rc = time_pipeline(axidma_dev, tx_channel, tx_size, rx_channel,
+                rx_size, num_transfers, pipeline_depth, lockstep_time);
+        if (rc < 0) {
+            goto free_rx_buf;
+        }
+    }
+
+    // Run the same transfers striped across several pairs of channels
+    if (stripe_width > 0) {
+        rc = time_stripe(axidma_dev, tx_buf, tx_size, rx_buf, rx_size,
+                num_transfers, stripe_width, chunk_size, lockstep_time);
+        if (rc < 0) {
+            goto free_rx_buf;
+        }
+    }
+
+    // Run the same transfers as jobs scheduled across several pairs
+    if (sched_pairs > 0) {
+        rc = time_sched(axidma_dev, tx_buf, tx_size, rx_buf, rx_size,
+                num_transfers, sched_pairs, lockstep_time);
+    }
 
 free_rx_buf:
     axidma_free(axidma_dev, rx_buf, rx_size);
@@ -0,0 +1,862 @@
+/**
+ * @file axidma_bridge.c
+ * @date Sunday, October 18, 2026 at 02:12:37 AM EDT
+ *
+ * This program bridges UDP datagrams through the PL fabric. Each datagram
+ * received on the listening port is read straight into a DMA buffer and sent
+ * through the fabric, and the buffer that it comes back in is sent on to the
+ * destination, without the CPU copying the data in between.
+ *
+ * Datagrams are read in batches with recvmmsg(), and sent in batches with
+ * sendmmsg(), using MSG_ZEROCOPY where the kernel supports it. A buffer sent
+ * with zero copy is held until the kernel reports the send as complete on
+ * the socket's error queue, and is then recycled into the pool. Where zero
+ * copy is not supported, the kernel copies the buffer as it sends it, so it
+ * is recycled straight away.
+ *
+ * With -s, the fabric is simulated by copying each buffer in software, so the
+ * bridge can be tried out over loopback without the hardware.
+ *
+ * @bug No known bugs.
+ **/
+
+#define _GNU_SOURCE             // Recvmmsg() and sendmmsg()
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include <unistd.h>             // Close() system call
+#include <string.h>             // Memory setting and copying
+#include <getopt.h>             // Option parsing
+#include <errno.h>              // Error codes
+#include <signal.h>             // Signal handling functions
+#include <poll.h>               // Waiting on the sockets
+#include <time.h>               // Clock for the rates
+#include <netdb.h>              // Looking up the destination
+#include <netinet/in.h>         // Internet addresses
+#include <sys/socket.h>         // Socket functions
+#include <linux/errqueue.h>     // Zero copy completions
+
+#include "util.h"               // Miscellaneous utilities
+#include "conversion.h"         // Convert bytes to MiBs
+#include "libaxidma.h"          // Interface to the AXI DMA library
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// Zero copy sends, in case the C library's headers predate them
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY                 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY                0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY       5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED  1
+#endif
+
+// The default number of buffers, datagrams per batch, and largest datagram
+#define DEFAULT_NUM_SLOTS           256
+#define DEFAULT_BATCH               32
+#define DEFAULT_SLOT_SIZE           2048
+
+// How long to wait on the sockets before checking for a signal, in ms
+#define POLL_TIMEOUT                100
+
+// How long to wait for the last zero copy sends to complete, in ms
+#define DRAIN_TIMEOUT               1000
+
+// The counters of the bridge
+struct bridge_stats {
+    uint64_t packets;           // Datagrams received
+    uint64_t bytes;             // Bytes received
+    uint64_t forwarded;         // Datagrams sent on to the destination
+    uint64_t dropped;           // Datagrams lost to a failed DMA or send
+    uint64_t recv_calls;        // Batches received
+    uint64_t send_calls;        // Batches sent
+    uint64_t zerocopy_sent;     // Datagrams sent with zero copy
+    uint64_t zerocopy_done;     // Zero copy sends that have completed
+    uint64_t zerocopy_copied;   // Completed ones the kernel copied anyway
+    uint64_t copied_sent;       // Datagrams sent without zero copy
+};
+
+// The state of the bridge
+struct bridge {
+    axidma_dev_t dev;           // The AXI DMA device, NULL when simulated
+    int tx_channel;             // The channel sending datagrams to the fabric
+    int rx_channel;             // The channel receiving them back
+    int in_fd;                  // The socket datagrams are received on
+    int out_fd;                 // The socket datagrams are sent on
+    bool zerocopy;              // Datagrams are sent with MSG_ZEROCOPY
+    int batch;                  // The most datagrams in a batch
+    size_t slot_size;           // The size of each buffer
+    int num_slots;              // The number of buffers in the pool
+    char *pool;                 // The memory of all the buffers
+    int *free_slots;            // The stack of free buffers
+    int num_free;               // The number of free buffers
+    int *inflight;              // The ring of buffers in zero copy sends
+    bool *completed;            // The sends in the ring that have completed
+    int inflight_head;          // The oldest zero copy send in the ring
+    int num_inflight;           // The number of zero copy sends in the ring
+    uint32_t head_id;           // The kernel's id for the oldest send
+    struct mmsghdr *in_msgs;    // The batch of datagrams being received
+    struct iovec *in_iovs;      // The buffers of the received datagrams
+    int *in_slots;              // The slots of the received datagrams
+    struct mmsghdr *out_msgs;   // The batch of datagrams being sent
+    struct iovec *out_iovs;     // The buffers of the sent datagrams
+    int *out_slots;             // The slots of the sent datagrams
+    struct bridge_stats stats;  // The bridge's counters
+};
+
+/* Indicates if the program is still running. Used to communicate between the
+ * signal handlers and the main thread. */
+static volatile bool running = true;
+
+static void signal_handler(int signal)
+{
+    switch (signal) {
+        case SIGINT:
+        case SIGTERM:
+        case SIGQUIT:
+            running = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * Command Line Interface
+ *----------------------------------------------------------------------------*/
+
+// Prints the usage for this program
+static void print_usage(bool help)
+{
+    FILE* stream = (help) ? stdout : stderr;
+
+    fprintf(stream, "Usage: axidma_bridge <listen port> <destination "
+            "host:port> [-t <DMA tx channel>] [-r <DMA rx channel>] [-b "
+            "<batch>] [-n <buffers>] [-m <max datagram>] [-c <count>] "
+            "[-s].\n");
+    if (!help) {
+        return;
+    }
+
+    fprintf(stream, "\t<listen port>:\t\tThe UDP port to receive datagrams "
+            "on.\n");
+    fprintf(stream, "\t<destination host:port>:\tThe UDP address to send the "
+            "datagrams to once they come back from the PL fabric.\n");
+    fprintf(stream, "\t-t <DMA tx channel>:\tThe device id of the DMA channel "
+            "to send the datagrams to the PL fabric on. Default is to use the "
+            "lowest numbered channel available.\n");
+    fprintf(stream, "\t-r <DMA rx channel>:\tThe device id of the DMA channel "
+            "to receive the datagrams back on. Default is to use the lowest "
+            "numbered channel available.\n");
+    fprintf(stream, "\t-b <batch>:\t\tThe most datagrams to receive or send "
+            "in one system call. Default is %d.\n", DEFAULT_BATCH);
+    fprintf(stream, "\t-n <buffers>:\t\tThe number of DMA buffers in the "
+            "pool. Default is %d.\n", DEFAULT_NUM_SLOTS);
+    fprintf(stream, "\t-m <max datagram>:\tThe size of each DMA buffer, which "
+            "is the largest datagram bridged. Larger ones are dropped. Default "
+            "is %d bytes.\n", DEFAULT_SLOT_SIZE);
+    fprintf(stream, "\t-c <count>:\t\tThe number of datagrams to bridge "
+            "before exiting. Default is to run until interrupted.\n");
+    fprintf(stream, "\t-s:\t\t\tSimulate the PL fabric by copying each "
+            "buffer in software, without an AXI DMA device.\n");
+    return;
+}
+
+// Parses the command line arguments
+static int parse_args(int argc, char **argv, struct bridge *br,
+        char **listen_port, char **destination, int *count, bool *simulate)
+{
+    char option;
+    int int_arg;
+    int rc;
+
+    // Set the default values for the arguments
+    br->tx_channel = -1;
+    br->rx_channel = -1;
+    br->batch = DEFAULT_BATCH;
+    br->num_slots = DEFAULT_NUM_SLOTS;
+    br->slot_size = DEFAULT_SLOT_SIZE;
+    *count = -1;
+    *simulate = false;
+
+    while ((option = getopt(argc, argv, "t:r:b:n:m:c:sh")) != (char)-1)
+    {
+        switch (option)
+        {
+            // Parse the transmit channel device id
+            case 't':
+                rc = parse_int(option, optarg, &int_arg);
+                if (rc < 0) {
+                    print_usage(false);
+                    return rc;
+                }
+                br->tx_channel = int_arg;
+                break;
+
+            // Parse the receive channel device id
+            case 'r':
+                rc = parse_int(option, optarg, &int_arg);
+                if (rc < 0) {
+                    print_usage(false);
+                    return rc;
+                }
+                br->rx_channel = int_arg;
+                break;
+
+            // Parse the size of the batches
+            case 'b':
+                rc = parse_int(option, optarg, &int_arg);
+                if (rc < 0 || int_arg <= 0) {
+                    fprintf(stderr, "Error: The batch must be positive.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                br->batch = int_arg;
+                break;
+
+            // Parse the number of buffers
+            case 'n':
+                rc = parse_int(option, optarg, &int_arg);
+                if (rc < 0 || int_arg < 2) {
+                    fprintf(stderr, "Error: At least 2 buffers are needed.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                br->num_slots = int_arg;
+                break;
+
+            // Parse the largest datagram
+            case 'm':
+                rc = parse_int(option, optarg, &int_arg);
+                if (rc < 0 || int_arg <= 0) {
+                    fprintf(stderr, "Error: The largest datagram must be "
+                            "positive.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                br->slot_size = int_arg;
+                break;
+
+            // Parse the number of datagrams to bridge
+            case 'c':
+                rc = parse_int(option, optarg, &int_arg);
+                if (rc < 0 || int_arg <= 0) {
+                    fprintf(stderr, "Error: The count must be positive.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                *count = int_arg;
+                break;
+
+            case 's':
+                *simulate = true;
+                break;
+
+            case 'h':
+                print_usage(true);
+                exit(0);
+
+            default:
+                print_usage(false);
+                return -EINVAL;
+        }
+    }
+
+    // If one of -t or -r is specified, then both must be
+    if ((br->tx_channel == -1) ^ (br->rx_channel == -1)) {
+        fprintf(stderr, "Error: Either both -t and -r must be specified, or "
+                "neither.\n");
+        print_usage(false);
+        return -EINVAL;
+    }
+
+    // Check that there are exactly the two positional arguments
+    if (optind != argc-2) {
+        fprintf(stderr, "Error: Expected a listen port and a destination.\n");
+        print_usage(false);
+        return -EINVAL;
+    }
+
+    *listen_port = argv[optind];
+    *destination = argv[optind+1];
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Sockets
+ *----------------------------------------------------------------------------*/
+
+// Opens the socket that datagrams are received on
+static int open_ingress(const char *port)
+{
+    int fd, rc;
+    struct addrinfo hints, *addr;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_PASSIVE;
+    rc = getaddrinfo(NULL, port, &hints, &addr);
+    if (rc != 0) {
+        fprintf(stderr, "Error: Invalid listen port '%s': %s.\n", port,
+                gai_strerror(rc));
+        return -EINVAL;
+    }
+
+    fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (fd < 0) {
+        perror("Unable to create the listening socket");
+        rc = -errno;
+    } else if (bind(fd, addr->ai_addr, addr->ai_addrlen) < 0) {
+        perror("Unable to bind the listening socket");
+        rc = -errno;
+        assert(close(fd) == 0);
+    } else {
+        rc = fd;
+    }
+
+    freeaddrinfo(addr);
+    return rc;
+}
+
+/* Opens the socket that datagrams are sent on, connected to the destination,
+ * and turns on zero copy sends if the kernel supports them. */
+static int open_egress(char *destination, bool *zerocopy)
+{
+    int fd, rc, one;
+    char *port;
+    struct addrinfo hints, *addr;
+
+    port = strrchr(destination, ':');
+    if (port == NULL) {
+        fprintf(stderr, "Error: The destination must be host:port.\n");
+        return -EINVAL;
+    }
+    *port = '\0';
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    rc = getaddrinfo(destination, port + 1, &hints, &addr);
+    *port = ':';
+    if (rc != 0) {
+        fprintf(stderr, "Error: Invalid destination '%s': %s.\n", destination,
+                gai_strerror(rc));
+        return -EINVAL;
+    }
+
+    fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (fd < 0) {
+        perror("Unable to create the sending socket");
+        rc = -errno;
+        goto free_addr;
+    } else if (connect(fd, addr->ai_addr, addr->ai_addrlen) < 0) {
+        perror("Unable to connect the sending socket");
+        rc = -errno;
+        assert(close(fd) == 0);
+        goto free_addr;
+    }
+
+    one = 1;
+    *zerocopy = setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one,
+                           sizeof(one)) == 0;
+    rc = fd;
+
+free_addr:
+    freeaddrinfo(addr);
+    return rc;
+}
+
+/*----------------------------------------------------------------------------
+ * Buffer Pool
+ *----------------------------------------------------------------------------*/
+
+// Gets the memory of a buffer in the pool
+static inline char *slot_buf(struct bridge *br, int slot)
+{
+    return br->pool + (size_t)slot * br->slot_size;
+}
+
+// Takes a free buffer from the pool, which must not be empty
+static inline int take_slot(struct bridge *br)
+{
+    assert(br->num_free > 0);
+    br->num_free -= 1;
+    return br->free_slots[br->num_free];
+}
+
+// Puts a buffer back in the pool
+static inline void put_slot(struct bridge *br, int slot)
+{
+    br->free_slots[br->num_free] = slot;
+    br->num_free += 1;
+}
+
+/* Allocates the pool of buffers, from the DMA device, or from regular memory
+ * when the fabric is simulated, and the arrays for the batches. */
+static int create_pool(struct bridge *br)
+{
+    int i;
+    size_t pool_size;
+
+    pool_size = (size_t)br->num_slots * br->slot_size;
+    if (br->dev != NULL) {
+        br->pool = axidma_malloc(br->dev, pool_size);
+    } else if (posix_memalign((void **)&br->pool, getpagesize(),
+            pool_size) != 0) {
+        br->pool = NULL;
+    }
+    if (br->pool == NULL) {
+        fprintf(stderr, "Unable to allocate the pool of buffers.\n");
+        return -ENOMEM;
+    }
+
+    br->free_slots = calloc(br->num_slots, sizeof(*br->free_slots));
+    br->inflight = calloc(br->num_slots, sizeof(*br->inflight));
+    br->completed = calloc(br->num_slots, sizeof(*br->completed));
+    br->in_msgs = calloc(br->batch, sizeof(*br->in_msgs));
+    br->in_iovs = calloc(br->batch, sizeof(*br->in_iovs));
+    br->in_slots = calloc(br->batch, sizeof(*br->in_slots));
+    br->out_msgs = calloc(br->batch, sizeof(*br->out_msgs));
+    br->out_iovs = calloc(br->batch, sizeof(*br->out_iovs));
+    br->out_slots = calloc(br->batch, sizeof(*br->out_slots));
+    if (br->free_slots == NULL || br->inflight == NULL ||
+            br->completed == NULL || br->in_msgs == NULL ||
+            br->in_iovs == NULL || br->in_slots == NULL ||
+            br->out_msgs == NULL || br->out_iovs == NULL ||
+            br->out_slots == NULL) {
+        fprintf(stderr, "Unable to allocate the batches.\n");
+        return -ENOMEM;
+    }
+
+    for (i = br->num_slots - 1; i >= 0; i--)
+    {
+        put_slot(br, i);
+    }
+    for (i = 0; i < br->batch; i++)
+    {
+        br->in_msgs[i].msg_hdr.msg_iov = &br->in_iovs[i];
+        br->in_msgs[i].msg_hdr.msg_iovlen = 1;
+        br->out_msgs[i].msg_hdr.msg_iov = &br->out_iovs[i];
+        br->out_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    return 0;
+}
+
+// Frees the pool of buffers and the arrays for the batches
+static void destroy_pool(struct bridge *br)
+{
+    if (br->pool != NULL && br->dev != NULL) {
+        axidma_free(br->dev, br->pool, (size_t)br->num_slots * br->slot_size);
+    } else {
+        free(br->pool);
+    }
+
+    free(br->free_slots);
+    free(br->inflight);
+    free(br->completed);
+    free(br->in_msgs);
+    free(br->in_iovs);
+    free(br->in_slots);
+    free(br->out_msgs);
+    free(br->out_iovs);
+    free(br->out_slots);
+    return;
+}
+
+/*----------------------------------------------------------------------------
+ * Zero Copy Completions
+ *----------------------------------------------------------------------------*/
+
+/* Marks the zero copy sends with the kernel's ids from first to last as
+ * completed. The kernel numbers each send on the socket in turn, so the ids
+ * of the sends in the ring follow on from the id of its head. */
+static void complete_sends(struct bridge *br, uint32_t first, uint32_t last,
+        bool copied)
+{
+    uint32_t id, offset;
+
+    for (id = first; id != last + 1; id++)
+    {
+        offset = id - br->head_id;
+        if (offset >= (uint32_t)br->num_inflight) {
+            continue;
+        }
+
+        br->completed[(br->inflight_head + offset) % br->num_slots] = true;
+        br->stats.zerocopy_done += 1;
+        br->stats.zerocopy_copied += copied ? 1 : 0;
+    }
+}
+
+/* Reads the completions on the error queue of the sending socket, then
+ * recycles the buffers at the head of the ring that have completed. */
+static void reap_completions(struct bridge *br)
+{
+    char control[128];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct sock_extended_err *err;
+    int head;
+
+    if (br->num_inflight == 0) {
+        return;
+    }
+
+    while (true)
+    {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(br->out_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;
+        }
+
+        for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+             cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            err = (struct sock_extended_err *)CMSG_DATA(cmsg);
+            if (err->ee_errno != 0 ||
+                    err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            complete_sends(br, err->ee_info, err->ee_data,
+                           err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED);
+        }
+    }
+
+    head = br->inflight_head;
+    while (br->num_inflight > 0 && br->completed[head])
+    {
+        br->completed[head] = false;
+        put_slot(br, br->inflight[head]);
+        head = (head + 1) % br->num_slots;
+        br->head_id += 1;
+        br->num_inflight -= 1;
+    }
+    br->inflight_head = head;
+}
+
+// Waits for completions on the sending socket, then reaps them
+static void wait_completions(struct bridge *br, int timeout)
+{
+    struct pollfd pfd;
+
+    // Errors are always polled for, so no events need to be asked for
+    pfd.fd = br->out_fd;
+    pfd.events = 0;
+    poll(&pfd, 1, timeout);
+    reap_completions(br);
+}
+
+/*----------------------------------------------------------------------------
+ * Bridging
+ *----------------------------------------------------------------------------*/
+
+/* Sends the datagram through the PL fabric, and receives it back into the
+ * other buffer, or copies it when the fabric is simulated. */
+static int run_dma(struct bridge *br, char *tx_buf, char *rx_buf, size_t len)
+{
+    if (br->dev == NULL) {
+        memcpy(rx_buf, tx_buf, len);
+        return 0;
+    }
+
+    return axidma_twoway_transfer(br->dev, br->tx_channel, tx_buf, len, NULL,
+            br->rx_channel, rx_buf, len, NULL, true);
+}
+
+/* Sends the batch of datagrams on to the destination. If the kernel runs out
+ * of memory to pin buffers with, the sends in flight are waited on. If it
+ * will not pin a DMA buffer at all, zero copy is turned off for good. A
+ * datagram the kernel rejects is dropped, so the rest of the batch still
+ * goes out. */
+static void send_batch(struct bridge *br, int count)
+{
+    int sent, n, i, tail;
+
+    sent = 0;
+    while (sent < count)
+    {
+        n = sendmmsg(br->out_fd, &br->out_msgs[sent], count - sent,
+                     br->zerocopy ? MSG_ZEROCOPY : 0);
+        if (n < 0 && br->zerocopy && errno == ENOBUFS &&
+                br->num_inflight > 0) {
+            wait_completions(br, POLL_TIMEOUT);
+            continue;
+        } else if (n < 0 && br->zerocopy && (errno == ENOBUFS ||
+                errno == EFAULT || errno == EOPNOTSUPP)) {
+            fprintf(stderr, "Warning: Zero copy sends failed (%s), falling "
+                    "back to copying.\n", strerror(errno));
+            br->zerocopy = false;
+            continue;
+        } else if (n < 0) {
+            br->stats.dropped += 1;
+            put_slot(br, br->out_slots[sent]);
+            sent += 1;
+            continue;
+        }
+
+        br->stats.send_calls += 1;
+        for (i = sent; i < sent + n; i++)
+        {
+            if (br->zerocopy) {
+                tail = (br->inflight_head + br->num_inflight) % br->num_slots;
+                br->inflight[tail] = br->out_slots[i];
+                br->num_inflight += 1;
+                br->stats.zerocopy_sent += 1;
+            } else {
+                put_slot(br, br->out_slots[i]);
+                br->stats.copied_sent += 1;
+            }
+        }
+        br->stats.forwarded += n;
+        sent += n;
+    }
+}
+
+/* Receives a batch of datagrams straight into free buffers, runs each one
+ * through the fabric into another free buffer, then sends those on. Each
+ * datagram needs two buffers, so the batch is cut short when the pool is
+ * low, until zero copy sends complete. */
+static int bridge_batch(struct bridge *br)
+{
+    int i, n, received, forwarding, rx_slot;
+    size_t len;
+
+    n = br->num_free / 2;
+    if (n > br->batch) {
+        n = br->batch;
+    }
+    if (n == 0) {
+        wait_completions(br, POLL_TIMEOUT);
+        return 0;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        br->in_slots[i] = take_slot(br);
+        br->in_iovs[i].iov_base = slot_buf(br, br->in_slots[i]);
+        br->in_iovs[i].iov_len = br->slot_size;
+        br->in_msgs[i].msg_hdr.msg_flags = 0;
+    }
+    received = recvmmsg(br->in_fd, br->in_msgs, n, MSG_DONTWAIT, NULL);
+    if (received < 0) {
+        received = 0;
+    } else {
+        br->stats.recv_calls += 1;
+    }
+
+    forwarding = 0;
+    for (i = 0; i < received; i++)
+    {
+        len = br->in_msgs[i].msg_len;
+        br->stats.packets += 1;
+        br->stats.bytes += len;
+        if (br->in_msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            br->stats.dropped += 1;
+            continue;
+        }
+
+        rx_slot = take_slot(br);
+        if (run_dma(br, slot_buf(br, br->in_slots[i]), slot_buf(br, rx_slot),
+                len) < 0) {
+            br->stats.dropped += 1;
+            put_slot(br, rx_slot);
+            continue;
+        }
+
+        br->out_iovs[forwarding].iov_base = slot_buf(br, rx_slot);
+        br->out_iovs[forwarding].iov_len = len;
+        br->out_slots[forwarding] = rx_slot;
+        forwarding += 1;
+    }
+
+    // The datagrams have been through the fabric, so their buffers are free
+    for (i = 0; i < n; i++)
+    {
+        put_slot(br, br->in_slots[i]);
+    }
+
+    send_batch(br, forwarding);
+    return received;
+}
+
+// Gets the current time in seconds
+static double get_time()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/* Bridges datagrams until the count is reached or the program is interrupted,
+ * then waits for the last zero copy sends and prints the counters. */
+static int run_bridge(struct bridge *br, int count)
+{
+    int rc;
+    double start, elapsed;
+    uint64_t copies_avoided;
+    struct pollfd pfd;
+
+    pfd.fd = br->in_fd;
+    pfd.events = POLLIN;
+    start = get_time();
+    while (running && (count < 0 || br->stats.packets < (uint64_t)count))
+    {
+        reap_completions(br);
+        rc = poll(&pfd, 1, POLL_TIMEOUT);
+        if (rc < 0 && errno != EINTR) {
+            perror("Unable to poll the listening socket");
+            return -errno;
+        } else if (rc > 0) {
+            bridge_batch(br);
+        }
+    }
+    elapsed = get_time() - start;
+
+    start = get_time();
+    while (br->num_inflight > 0 && get_time() - start < DRAIN_TIMEOUT / 1e3)
+    {
+        wait_completions(br, POLL_TIMEOUT);
+    }
+
+    /* Each datagram is received straight into a DMA buffer, where a copy
+     * would be needed into one, and each zero copy send the kernel did not
+     * copy saves a copy out of one. */
+    copies_avoided = br->stats.packets + br->stats.zerocopy_done -
+                     br->stats.zerocopy_copied;
+    printf("AXI DMA Bridge Results:\n");
+    printf("\tDatagrams Received: %llu (%.2f MiB)\n",
+           (unsigned long long)br->stats.packets,
+           BYTE_TO_MIB(br->stats.bytes));
+    printf("\tDatagrams Forwarded: %llu\n",
+           (unsigned long long)br->stats.forwarded);
+    printf("\tDatagrams Dropped: %llu\n",
+           (unsigned long long)br->stats.dropped);
+    printf("\tRate: %.0f datagrams/s, %.2f MiB/s\n",
+           br->stats.packets / elapsed, BYTE_TO_MIB(br->stats.bytes) /
+           elapsed);
+    printf("\tAverage Batches: %.1f received, %.1f sent\n",
+           br->stats.recv_calls == 0 ? 0.0 :
+           (double)br->stats.packets / br->stats.recv_calls,
+           br->stats.send_calls == 0 ? 0.0 :
+           (double)br->stats.forwarded / br->stats.send_calls);
+    printf("\tZero Copy Sends: %llu (%llu completed, %llu copied by the "
+           "kernel)\n", (unsigned long long)br->stats.zerocopy_sent,
+           (unsigned long long)br->stats.zerocopy_done,
+           (unsigned long long)br->stats.zerocopy_copied);
+    printf("\tCopied Sends: %llu\n",
+           (unsigned long long)br->stats.copied_sent);
+    printf("\tCopies Avoided: %llu\n", (unsigned long long)copies_avoided);
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Main
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    int rc, count;
+    bool simulate;
+    char *listen_port, *destination;
+    struct bridge br;
+    const array_t *tx_chans, *rx_chans;
+
+    // Parse the input arguments
+    memset(&br, 0, sizeof(br));
+    if (parse_args(argc, argv, &br, &listen_port, &destination, &count,
+                   &simulate) < 0) {
+        rc = 1;
+        goto ret;
+    }
+
+    // Open the sockets on either side of the bridge
+    br.in_fd = open_ingress(listen_port);
+    if (br.in_fd < 0) {
+        rc = 1;
+        goto ret;
+    }
+    br.out_fd = open_egress(destination, &br.zerocopy);
+    if (br.out_fd < 0) {
+        rc = 1;
+        goto close_ingress;
+    }
+
+    // Initialize the AXI DMA device, and pick the channels
+    if (!simulate) {
+        br.dev = axidma_init();
+        if (br.dev == NULL) {
+            fprintf(stderr, "Error: Failed to initialize the AXI DMA "
+                    "device.\n");
+            rc = 1;
+            goto close_egress;
+        }
+
+        tx_chans = axidma_get_dma_tx(br.dev);
+        rx_chans = axidma_get_dma_rx(br.dev);
+        if (tx_chans->len < 1 || rx_chans->len < 1) {
+            fprintf(stderr, "Error: No transmit or receive channels were "
+                    "found.\n");
+            rc = 1;
+            goto destroy_axidma;
+        }
+        if (br.tx_channel == -1 && br.rx_channel == -1) {
+            br.tx_channel = tx_chans->data[0];
+            br.rx_channel = rx_chans->data[0];
+        }
+    }
+
+    rc = create_pool(&br);
+    if (rc < 0) {
+        rc = 1;
+        goto destroy_pool;
+    }
+
+    printf("AXI DMA Bridge Info:\n");
+    if (simulate) {
+        printf("\tPL Fabric: Simulated\n");
+    } else {
+        printf("\tTransmit Channel: %d\n", br.tx_channel);
+        printf("\tReceive Channel: %d\n", br.rx_channel);
+    }
+    printf("\tListening Port: %s\n", listen_port);
+    printf("\tDestination: %s\n", destination);
+    printf("\tBuffers: %d of %zu bytes\n", br.num_slots, br.slot_size);
+    printf("\tBatch: %d datagrams\n", br.batch);
+    printf("\tZero Copy Sends: %s\n\n", br.zerocopy ? "Yes" : "No");
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGQUIT, signal_handler);
+    rc = run_bridge(&br, count);
+    rc = (rc < 0) ? 1 : 0;
+
+destroy_pool:
+    destroy_pool(&br);
+destroy_axidma:
+    if (br.dev != NULL) {
+        axidma_destroy(br.dev);
+    }
+close_egress:
+    assert(close(br.out_fd) == 0);
+close_ingress:
+    assert(close(br.in_fd) == 0);
+ret:
+    return rc;
+}
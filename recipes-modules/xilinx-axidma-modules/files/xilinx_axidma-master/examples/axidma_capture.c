@@ -0,0 +1,876 @@
+/**
+ * @file axidma_capture.c
+ * @date Sunday, October 18, 2026 at 03:21:57 AM EDT
+ *
+ * This program records the data received on a DMA channel into a capture
+ * file, which can be fed back through a transmit channel with axidma_replay.
+ * Each transfer received is one packet of the capture, and is timestamped as
+ * it completes. A transfer ends early at the end of a packet from the logic,
+ * and only the bytes it actually received, from the residue that the driver
+ * keeps for it, are stored.
+ *
+ * The main thread keeps a transfer queued into each free DMA buffer, so the
+ * channel is never left idle while there is a buffer to receive into. A
+ * writer thread appends the received buffers to the file in order, with
+ * O_DIRECT writes straight from the DMA buffers, then frees them to be
+ * received into again. With -z, a pool of threads compresses the buffers
+ * with LZ4 on the way to the writer. The index of the packets is kept in
+ * memory, and written at the end of the file when the capture is closed.
+ *
+ * @bug No known bugs.
+ **/
+
+#define _GNU_SOURCE             // O_DIRECT
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include <fcntl.h>              // Flags for open()
+#include <sys/stat.h>           // Open() system call
+#include <sys/types.h>          // Types for open()
+#include <unistd.h>             // Pwrite() and close() system calls
+#include <string.h>             // Memory setting and copying
+#include <getopt.h>             // Option parsing
+#include <errno.h>              // Error codes
+#include <signal.h>             // Signal handling functions
+#include <time.h>               // Clocks for the timestamps
+#include <pthread.h>            // Writer and compression threads
+
+#ifdef AXIDMA_LZ4
+#include <lz4.h>                // LZ4 compression
+#endif
+
+#include "util.h"               // Miscellaneous utilities
+#include "conversion.h"         // Convert bytes to MiBs
+#include "capture.h"            // Capture file format
+#include "libaxidma.h"          // Interface to the AXI DMA library
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The default size of each transfer, and number of DMA buffers
+#define DEFAULT_TRANSFER_SIZE   (1024 * 1024)
+#define DEFAULT_NUM_SLOTS       16
+
+// How long the main thread sleeps between checks on the transfers, in ns
+#define RECEIVE_POLL_NS         20000
+
+// The states that a DMA buffer goes through, in order
+enum slot_state {
+    SLOT_FREE,                  // Waiting for a transfer to be queued
+    SLOT_RECEIVING,             // A transfer into it is queued
+    SLOT_RECEIVED,              // Received, waiting to be compressed
+    SLOT_PACKING,               // Being compressed
+    SLOT_READY,                 // Waiting to be written out
+};
+
+// A DMA buffer, and the packet in it
+struct capture_slot {
+    char *buf;                  // The DMA buffer the packet is received into
+    char *packed;               // The buffer it is compressed into, if any
+    const char *stored;         // Which of the two is written out
+    uint32_t length;            // The number of bytes received
+    uint32_t stored_length;     // The number of bytes written out
+    uint64_t timestamp_ns;      // When the packet was received
+    enum slot_state state;      // Where the buffer is in the capture
+};
+
+// The state of the capture
+struct capture {
+    axidma_dev_t dev;           // The AXI DMA device
+    int channel;                // The channel the packets are received on
+    size_t size;                // The size of each transfer
+    size_t buf_size;            // The size of each buffer, in whole blocks
+    int num_slots;              // The number of DMA buffers
+    struct capture_slot *slots; // The ring of DMA buffers
+    int num_packers;            // The number of compression threads
+    pthread_t *packers;         // The compression threads
+    pthread_t writer;           // The thread writing the file
+    pthread_mutex_t lock;       // Guards the buffers and the counters
+    pthread_cond_t cond;        // Signalled when a buffer changes state
+    bool receiving_done;        // No more packets will be received
+    uint64_t received;          // The number of packets received
+    uint64_t written;           // The number of packets written out
+    int error;                  // The first error writing the file, or 0
+    int fd;                     // The capture file
+    bool direct;                // The file is open with O_DIRECT
+    char *bounce;               // Used when the DMA buffers can't be written
+    uint64_t offset;            // Where the next packet is written
+    struct capture_header header;   // The header of the file
+    struct capture_entry *index;    // The index of the packets written
+    uint64_t index_capacity;    // The number of entries allocated
+    uint64_t stored_bytes;      // The bytes of packets written, unpadded
+    uint64_t stalls;            // Times every buffer was waiting on the file
+    unsigned int done;          // Transfers completed, set by the callback
+    uint64_t first_transfer;    // The driver's number for the first transfer
+    uint64_t *done_ns;          // When each buffer's transfer completed
+};
+
+/* Indicates if the program is still running. Used to communicate between the
+ * signal handlers and the main thread. */
+static volatile bool running = true;
+
+static void signal_handler(int signal)
+{
+    switch (signal) {
+        case SIGINT:
+        case SIGTERM:
+        case SIGQUIT:
+            running = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * Command Line Interface
+ *----------------------------------------------------------------------------*/
+
+// Prints the usage for this program
+static void print_usage(bool help)
+{
+    FILE* stream = (help) ? stdout : stderr;
+
+    fprintf(stream, "Usage: axidma_capture <output path> [-r <DMA rx "
+            "channel>] [-s <transfer size> | -o <transfer size>] [-n "
+            "<buffers>] [-c <count>] [-z <threads>].\n");
+    if (!help) {
+        return;
+    }
+
+    fprintf(stream, "\t<output path>:\t\tThe path to write the capture file "
+            "to. Can be a relative or absolute path.\n");
+    fprintf(stream, "\t-r <DMA rx channel>:\tThe device id of the DMA channel "
+            "to capture. Default is to use the lowest numbered channel "
+            "available.\n");
+    fprintf(stream, "\t-s <transfer size>:\tThe size of each transfer, which "
+            "is one packet of the capture, in bytes. Default is %.2f MiB.\n",
+            BYTE_TO_MIB(DEFAULT_TRANSFER_SIZE));
+    fprintf(stream, "\t-o <transfer size>:\tThe size of each transfer in "
+            "MiBs. This is a floating-point value.\n");
+    fprintf(stream, "\t-n <buffers>:\t\tThe number of DMA buffers to receive "
+            "into while others are written out, at most %d. Default is %d.\n",
+            AXIDMA_PROGRESS_HISTORY, DEFAULT_NUM_SLOTS);
+    fprintf(stream, "\t-c <count>:\t\tThe number of packets to capture. "
+            "Default is to capture until interrupted.\n");
+    fprintf(stream, "\t-z <threads>:\t\tCompress the packets with LZ4, using "
+            "the given number of threads.%s\n",
+#ifdef AXIDMA_LZ4
+            ""
+#else
+            " Not available in this build."
+#endif
+            );
+    return;
+}
+
+// Parses the command line arguments
+static int parse_args(int argc, char **argv, struct capture *cap,
+        char **path, int *count)
+{
+    char option;
+    int int_arg;
+    double double_arg;
+    bool s_specified, o_specified;
+
+    // Set the default values for the arguments
+    cap->channel = -1;
+    cap->size = DEFAULT_TRANSFER_SIZE;
+    cap->num_slots = DEFAULT_NUM_SLOTS;
+    cap->num_packers = 0;
+    *count = -1;
+    s_specified = false;
+    o_specified = false;
+
+    while ((option = getopt(argc, argv, "r:s:o:n:c:z:h")) != (char)-1)
+    {
+        switch (option)
+        {
+            // Parse the receive channel device id
+            case 'r':
+                if (parse_int(option, optarg, &int_arg) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                cap->channel = int_arg;
+                break;
+
+            // Parse the transfer size (in bytes)
+            case 's':
+                if (parse_int(option, optarg, &int_arg) < 0 || int_arg <= 0) {
+                    fprintf(stderr, "Error: The transfer size must be "
+                            "positive.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                cap->size = int_arg;
+                s_specified = true;
+                break;
+
+            // Parse the transfer size (in MiBs)
+            case 'o':
+                if (parse_double(option, optarg, &double_arg) < 0 ||
+                        double_arg <= 0 || double_arg >= 4096) {
+                    fprintf(stderr, "Error: The transfer size must be "
+                            "positive, and under 4 GiB.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                cap->size = MIB_TO_BYTE(double_arg);
+                o_specified = true;
+                break;
+
+            // Parse the number of buffers
+            case 'n':
+                if (parse_int(option, optarg, &int_arg) < 0 || int_arg < 2 ||
+                        int_arg > AXIDMA_PROGRESS_HISTORY) {
+                    fprintf(stderr, "Error: Between 2 and %d buffers are "
+                            "needed.\n", AXIDMA_PROGRESS_HISTORY);
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                cap->num_slots = int_arg;
+                break;
+
+            // Parse the number of packets to capture
+            case 'c':
+                if (parse_int(option, optarg, &int_arg) < 0 || int_arg <= 0) {
+                    fprintf(stderr, "Error: The count must be positive.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                *count = int_arg;
+                break;
+
+            // Parse the number of compression threads
+            case 'z':
+                if (parse_int(option, optarg, &int_arg) < 0 || int_arg <= 0) {
+                    fprintf(stderr, "Error: The number of compression threads "
+                            "must be positive.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+#ifndef AXIDMA_LZ4
+                fprintf(stderr, "Error: This build has no LZ4 support. "
+                        "Rebuild with AXIDMA_LZ4 defined to use -z.\n");
+                return -EINVAL;
+#endif
+                cap->num_packers = int_arg;
+                break;
+
+            case 'h':
+                print_usage(true);
+                exit(0);
+
+            default:
+                print_usage(false);
+                return -EINVAL;
+        }
+    }
+
+    // Only one of -s and -o can be specified
+    if (s_specified && o_specified) {
+        fprintf(stderr, "Error: Only one of -s and -o can be specified.\n");
+        print_usage(false);
+        return -EINVAL;
+    }
+
+    // Check that there is exactly the output path left
+    if (optind != argc-1) {
+        fprintf(stderr, "Error: Expected exactly one output path.\n");
+        print_usage(false);
+        return -EINVAL;
+    }
+
+    *path = argv[optind];
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Capture File Writing
+ *----------------------------------------------------------------------------*/
+
+// Gets the current time in nanoseconds on the given clock
+static uint64_t get_time_ns(clockid_t clock)
+{
+    struct timespec now;
+
+    clock_gettime(clock, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* Writes whole blocks to the file at the offset. If the file is open with
+ * O_DIRECT and the kernel cannot write straight from the buffer, as happens
+ * when the DMA buffers are mapped as device memory, the blocks are copied to
+ * a bounce buffer from then on. */
+static int write_blocks(struct capture *cap, const char *buf, size_t len,
+        uint64_t offset)
+{
+    ssize_t rc;
+    size_t written;
+
+    written = 0;
+    while (written < len)
+    {
+        rc = pwrite(cap->fd, buf + written, len - written, offset + written);
+        if (rc < 0 && errno == EFAULT && cap->direct && buf != cap->bounce &&
+                len <= cap->buf_size) {
+            fprintf(stderr, "Warning: Unable to write straight from the DMA "
+                    "buffers, copying them instead.\n");
+            memcpy(cap->bounce, buf, len);
+            buf = cap->bounce;
+            continue;
+        } else if (rc < 0 && errno == EINTR) {
+            continue;
+        } else if (rc < 0) {
+            return -errno;
+        }
+        written += rc;
+    }
+
+    return 0;
+}
+
+// Writes the header in the first block of the file
+static int write_header(struct capture *cap)
+{
+    memset(cap->bounce, 0, CAPTURE_ALIGN);
+    memcpy(cap->bounce, &cap->header, sizeof(cap->header));
+    return write_blocks(cap, cap->bounce, CAPTURE_ALIGN, 0);
+}
+
+/* Writes the index after the last packet, then rewrites the header with its
+ * offset, which is what marks the capture as closed. */
+static int write_index(struct capture *cap)
+{
+    int rc;
+    char *buf;
+    size_t index_size, written, len;
+
+    index_size = cap->header.num_packets * sizeof(struct capture_entry);
+    written = 0;
+    while (written < index_size)
+    {
+        // Copy the index to the bounce buffer a chunk at a time
+        len = index_size - written;
+        if (len > cap->buf_size) {
+            len = cap->buf_size;
+        }
+        buf = cap->bounce;
+        memcpy(buf, (char *)cap->index + written, len);
+        memset(buf + len, 0, CAPTURE_ALIGN_UP(len) - len);
+        rc = write_blocks(cap, buf, CAPTURE_ALIGN_UP(len),
+                          cap->offset + written);
+        if (rc < 0) {
+            return rc;
+        }
+        written += len;
+    }
+
+    cap->header.index_offset = cap->offset;
+    rc = write_header(cap);
+    if (rc < 0) {
+        return rc;
+    }
+    return fsync(cap->fd) < 0 ? -errno : 0;
+}
+
+// Adds the packet just written to the index, growing it as needed
+static int add_entry(struct capture *cap, struct capture_slot *slot)
+{
+    struct capture_entry *index, *entry;
+    uint64_t capacity;
+
+    if (cap->header.num_packets == cap->index_capacity) {
+        capacity = cap->index_capacity == 0 ? 1024 : cap->index_capacity * 2;
+        index = realloc(cap->index, capacity * sizeof(*index));
+        if (index == NULL) {
+            return -ENOMEM;
+        }
+        cap->index = index;
+        cap->index_capacity = capacity;
+    }
+
+    entry = &cap->index[cap->header.num_packets];
+    entry->offset = cap->offset;
+    entry->timestamp_ns = slot->timestamp_ns;
+    entry->length = slot->length;
+    entry->stored_length = slot->stored_length;
+    cap->header.num_packets += 1;
+    return 0;
+}
+
+/* Writes the received packets out in order, freeing each buffer once it is
+ * written. After an error, the rest of the packets are dropped, so that the
+ * receiving stops as well. */
+static void *writer_thread(void *arg)
+{
+    int rc;
+    uint32_t len;
+    struct capture *cap;
+    struct capture_slot *slot;
+
+    cap = arg;
+    pthread_mutex_lock(&cap->lock);
+    while (true)
+    {
+        slot = &cap->slots[cap->written % cap->num_slots];
+        if (cap->written < cap->received && slot->state == SLOT_READY) {
+            pthread_mutex_unlock(&cap->lock);
+            len = CAPTURE_ALIGN_UP(slot->stored_length);
+            rc = cap->error ? 0 : write_blocks(cap, slot->stored, len,
+                                               cap->offset);
+            if (rc == 0 && !cap->error) {
+                rc = add_entry(cap, slot);
+            }
+            pthread_mutex_lock(&cap->lock);
+
+            if (rc < 0 && !cap->error) {
+                cap->error = rc;
+            } else if (rc == 0 && !cap->error) {
+                cap->offset += len;
+                cap->stored_bytes += slot->stored_length;
+            }
+            slot->state = SLOT_FREE;
+            cap->written += 1;
+            pthread_cond_broadcast(&cap->cond);
+            continue;
+        } else if (cap->receiving_done && cap->written == cap->received) {
+            break;
+        }
+
+        pthread_cond_wait(&cap->cond, &cap->lock);
+    }
+    pthread_mutex_unlock(&cap->lock);
+
+    return NULL;
+}
+
+#ifdef AXIDMA_LZ4
+/* Compresses any received packet, keeping it raw if compressing does not make
+ * it smaller, and hands it to the writer. The packets are compressed in any
+ * order, and the writer puts them back in order. */
+static void *packer_thread(void *arg)
+{
+    int len;
+    uint64_t i;
+    struct capture *cap;
+    struct capture_slot *slot;
+
+    cap = arg;
+    pthread_mutex_lock(&cap->lock);
+    while (true)
+    {
+        slot = NULL;
+        for (i = cap->written; i < cap->received; i++)
+        {
+            if (cap->slots[i % cap->num_slots].state == SLOT_RECEIVED) {
+                slot = &cap->slots[i % cap->num_slots];
+                break;
+            }
+        }
+
+        if (slot != NULL) {
+            slot->state = SLOT_PACKING;
+            pthread_mutex_unlock(&cap->lock);
+            len = LZ4_compress_default(slot->buf, slot->packed, slot->length,
+                                       LZ4_compressBound(cap->size));
+            if (len > 0 && (uint32_t)len < slot->length) {
+                memset(slot->packed + len, 0, CAPTURE_ALIGN_UP(len) - len);
+                slot->stored = slot->packed;
+                slot->stored_length = len;
+            }
+            pthread_mutex_lock(&cap->lock);
+            slot->state = SLOT_READY;
+            pthread_cond_broadcast(&cap->cond);
+            continue;
+        } else if (cap->receiving_done) {
+            break;
+        }
+
+        pthread_cond_wait(&cap->cond, &cap->lock);
+    }
+    pthread_mutex_unlock(&cap->lock);
+
+    return NULL;
+}
+#endif /* AXIDMA_LZ4 */
+
+/*----------------------------------------------------------------------------
+ * Receiving
+ *----------------------------------------------------------------------------*/
+
+/* Stamps the completed transfer, called from the signal handler. The channel
+ * completes transfers in the order they were queued, so the count of them
+ * says which buffer it was. */
+static void receive_done(int channel_id, void *data)
+{
+    unsigned int done;
+    struct capture *cap;
+
+    (void)channel_id;
+    cap = data;
+    done = __atomic_load_n(&cap->done, __ATOMIC_RELAXED);
+    cap->done_ns[done % cap->num_slots] = get_time_ns(CLOCK_REALTIME);
+    __atomic_add_fetch(&cap->done, 1, __ATOMIC_RELEASE);
+    return;
+}
+
+/* Keeps a transfer queued into every free buffer, and hands the completed
+ * ones on, until the count is reached, the program is interrupted, or
+ * writing the file fails. The completion signals interrupt the sleep between
+ * checks, so the buffers are usually handed on as soon as they complete. */
+static int receive_packets(struct capture *cap, int count)
+{
+    int rc;
+    unsigned int issued, completed, done;
+    uint64_t total;
+    int64_t first;
+    ssize_t length;
+    bool stalled;
+    struct capture_slot *slot;
+    struct timespec pause;
+
+    // The driver numbers the transfers, which finds the length of each one
+    first = axidma_transfers_completed(cap->dev, cap->channel);
+    if (first < 0) {
+        return first;
+    }
+    cap->first_transfer = first;
+
+    issued = 0;
+    completed = 0;
+    total = 0;
+    stalled = false;
+    rc = 0;
+    pause.tv_sec = 0;
+    pause.tv_nsec = RECEIVE_POLL_NS;
+    pthread_mutex_lock(&cap->lock);
+    while (running && cap->error == 0)
+    {
+        done = __atomic_load_n(&cap->done, __ATOMIC_ACQUIRE);
+        while (completed != done)
+        {
+            length = axidma_received_length(cap->dev, cap->channel,
+                    cap->first_transfer + completed, cap->size);
+            if (length < 0) {
+                rc = length;
+                goto stop;
+            }
+
+            // Clear the rest of the last block, which is written out with it
+            slot = &cap->slots[completed % cap->num_slots];
+            memset(slot->buf + length, 0, CAPTURE_ALIGN_UP(length) - length);
+            slot->timestamp_ns = cap->done_ns[completed % cap->num_slots];
+            slot->length = length;
+            slot->stored = slot->buf;
+            slot->stored_length = length;
+            slot->state = cap->num_packers > 0 ? SLOT_RECEIVED : SLOT_READY;
+            completed += 1;
+            cap->received += 1;
+        }
+        pthread_cond_broadcast(&cap->cond);
+        if (count >= 0 && cap->received == (uint64_t)count) {
+            break;
+        }
+
+        while ((count < 0 || total < (uint64_t)count) &&
+               cap->slots[issued % cap->num_slots].state == SLOT_FREE)
+        {
+            slot = &cap->slots[issued % cap->num_slots];
+            slot->state = SLOT_RECEIVING;
+            pthread_mutex_unlock(&cap->lock);
+            rc = axidma_oneway_transfer(cap->dev, cap->channel, slot->buf,
+                                        cap->size, false);
+            pthread_mutex_lock(&cap->lock);
+            if (rc < 0) {
+                rc = -errno;
+                slot->state = SLOT_FREE;
+                goto stop;
+            }
+            issued += 1;
+            total += 1;
+        }
+
+        // Count each time the channel runs dry because of the file
+        if (issued == completed && !stalled) {
+            cap->stalls += 1;
+        }
+        stalled = issued == completed;
+
+        pthread_mutex_unlock(&cap->lock);
+        nanosleep(&pause, NULL);
+        pthread_mutex_lock(&cap->lock);
+    }
+
+stop:
+    // The transfers still queued are stopped, and their buffers dropped
+    if (issued != completed) {
+        axidma_stop_transfer(cap->dev, cap->channel);
+        for (; completed != issued; completed++)
+        {
+            cap->slots[completed % cap->num_slots].state = SLOT_FREE;
+        }
+    }
+    cap->receiving_done = true;
+    pthread_cond_broadcast(&cap->cond);
+    pthread_mutex_unlock(&cap->lock);
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------
+ * Setup
+ *----------------------------------------------------------------------------*/
+
+/* Opens the capture file for O_DIRECT writes, falling back to buffered
+ * writes on file systems that do not support them. */
+static int open_capture(struct capture *cap, const char *path)
+{
+    cap->direct = true;
+    cap->fd = open(path, O_WRONLY|O_CREAT|O_TRUNC|O_DIRECT,
+                   S_IWUSR|S_IRUSR|S_IRGRP|S_IWGRP|S_IROTH);
+    if (cap->fd < 0 && errno == EINVAL) {
+        fprintf(stderr, "Warning: The file system does not support O_DIRECT, "
+                "using buffered writes.\n");
+        cap->direct = false;
+        cap->fd = open(path, O_WRONLY|O_CREAT|O_TRUNC,
+                       S_IWUSR|S_IRUSR|S_IRGRP|S_IWGRP|S_IROTH);
+    }
+    if (cap->fd < 0) {
+        perror("Error opening the capture file");
+        return -errno;
+    }
+
+    return 0;
+}
+
+/* Allocates the DMA buffers, the buffers they are compressed into, and the
+ * bounce buffer. The tail of each buffer past the transfer is zeroed once,
+ * since the transfers never write it, so the padding is always zeros. */
+static int create_slots(struct capture *cap)
+{
+    int i;
+    size_t packed_size;
+
+    cap->buf_size = CAPTURE_ALIGN_UP(cap->size);
+    cap->slots = calloc(cap->num_slots, sizeof(*cap->slots));
+    cap->done_ns = calloc(cap->num_slots, sizeof(*cap->done_ns));
+    if (cap->slots == NULL || cap->done_ns == NULL ||
+            posix_memalign((void **)&cap->bounce, CAPTURE_ALIGN,
+                           cap->buf_size) != 0) {
+        return -ENOMEM;
+    }
+
+    packed_size = 0;
+#ifdef AXIDMA_LZ4
+    packed_size = CAPTURE_ALIGN_UP(LZ4_compressBound(cap->size));
+#endif
+    for (i = 0; i < cap->num_slots; i++)
+    {
+        cap->slots[i].buf = axidma_malloc(cap->dev, cap->buf_size);
+        if (cap->slots[i].buf == NULL) {
+            return -ENOMEM;
+        }
+        memset(cap->slots[i].buf + cap->size, 0, cap->buf_size - cap->size);
+
+        if (cap->num_packers > 0 && posix_memalign(
+                (void **)&cap->slots[i].packed, CAPTURE_ALIGN,
+                packed_size) != 0) {
+            return -ENOMEM;
+        }
+    }
+
+    return 0;
+}
+
+// Frees the buffers allocated by create_slots()
+static void destroy_slots(struct capture *cap)
+{
+    int i;
+
+    for (i = 0; cap->slots != NULL && i < cap->num_slots; i++)
+    {
+        if (cap->slots[i].buf != NULL) {
+            axidma_free(cap->dev, cap->slots[i].buf, cap->buf_size);
+        }
+        free(cap->slots[i].packed);
+    }
+    free(cap->slots);
+    free(cap->done_ns);
+    free(cap->bounce);
+    free(cap->index);
+    return;
+}
+
+/* Starts the writer and the compression threads. They are started with every
+ * signal blocked, so that the completion signals and the interrupts go to the
+ * main thread, whose sleep they are meant to cut short. If only some of the
+ * compression threads start, the capture carries on with those. */
+static int start_threads(struct capture *cap)
+{
+    int i, rc;
+    sigset_t mask, old_mask;
+
+    sigfillset(&mask);
+    pthread_sigmask(SIG_SETMASK, &mask, &old_mask);
+    rc = pthread_create(&cap->writer, NULL, writer_thread, cap);
+#ifdef AXIDMA_LZ4
+    for (i = 0; rc == 0 && i < cap->num_packers; i++)
+    {
+        if (pthread_create(&cap->packers[i], NULL, packer_thread, cap) != 0) {
+            fprintf(stderr, "Warning: Only %d compression threads could be "
+                    "started.\n", i);
+            cap->num_packers = i;
+        }
+    }
+#else
+    (void)i;
+#endif
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+
+    return -rc;
+}
+
+// Waits for the writer and the compression threads to finish
+static void join_threads(struct capture *cap)
+{
+    int i;
+
+    for (i = 0; i < cap->num_packers; i++)
+    {
+        pthread_join(cap->packers[i], NULL);
+    }
+    pthread_join(cap->writer, NULL);
+    return;
+}
+
+/*----------------------------------------------------------------------------
+ * Main
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    int rc, count;
+    char *path;
+    double start, elapsed;
+    struct capture cap;
+    const array_t *rx_chans;
+
+    // Parse the input arguments
+    memset(&cap, 0, sizeof(cap));
+    if (parse_args(argc, argv, &cap, &path, &count) < 0) {
+        rc = 1;
+        goto ret;
+    }
+    pthread_mutex_init(&cap.lock, NULL);
+    pthread_cond_init(&cap.cond, NULL);
+
+    if (open_capture(&cap, path) < 0) {
+        rc = 1;
+        goto ret;
+    }
+
+    // Initialize the AXI DMA device, and pick the channel
+    cap.dev = axidma_init();
+    if (cap.dev == NULL) {
+        fprintf(stderr, "Error: Failed to initialize the AXI DMA device.\n");
+        rc = 1;
+        goto close_file;
+    }
+    rx_chans = axidma_get_dma_rx(cap.dev);
+    if (rx_chans->len < 1) {
+        fprintf(stderr, "Error: No receive channels were found.\n");
+        rc = 1;
+        goto destroy_axidma;
+    }
+    if (cap.channel == -1) {
+        cap.channel = rx_chans->data[0];
+    }
+
+    cap.packers = calloc(cap.num_packers + 1, sizeof(*cap.packers));
+    if (cap.packers == NULL || create_slots(&cap) < 0) {
+        fprintf(stderr, "Unable to allocate the capture's buffers.\n");
+        rc = 1;
+        goto destroy_slots;
+    }
+
+    // Write out an empty header, which marks the capture as not yet closed
+    memcpy(cap.header.magic, CAPTURE_MAGIC, sizeof(cap.header.magic));
+    cap.header.version = CAPTURE_VERSION;
+    cap.header.flags = cap.num_packers > 0 ? CAPTURE_FLAG_LZ4 : 0;
+    cap.header.start_ns = get_time_ns(CLOCK_REALTIME);
+    cap.header.max_length = cap.size;
+    cap.offset = CAPTURE_ALIGN;
+    if (write_header(&cap) < 0) {
+        perror("Unable to write the capture's header");
+        rc = 1;
+        goto destroy_slots;
+    }
+
+    printf("AXI DMA Capture Info:\n");
+    printf("\tReceive Channel: %d\n", cap.channel);
+    printf("\tTransfer Size: %.2f MiB\n", BYTE_TO_MIB(cap.size));
+    printf("\tBuffers: %d\n", cap.num_slots);
+    printf("\tCompression Threads: %d\n", cap.num_packers);
+    printf("\tDirect I/O: %s\n\n", cap.direct ? "Yes" : "No");
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGQUIT, signal_handler);
+    if (start_threads(&cap) < 0) {
+        fprintf(stderr, "Unable to start the capture's threads.\n");
+        rc = 1;
+        goto destroy_slots;
+    }
+
+    // Capture until done, then wait for the file to catch up
+    axidma_set_callback(cap.dev, cap.channel, receive_done, &cap);
+    start = get_time_ns(CLOCK_MONOTONIC) / 1e9;
+    rc = receive_packets(&cap, count);
+    join_threads(&cap);
+    elapsed = get_time_ns(CLOCK_MONOTONIC) / 1e9 - start;
+    axidma_set_callback(cap.dev, cap.channel, NULL, NULL);
+    if (rc < 0) {
+        fprintf(stderr, "Error: A receive transfer failed: %s.\n",
+                strerror(-rc));
+    }
+    if (cap.error < 0) {
+        fprintf(stderr, "Error: Writing the capture failed: %s.\n",
+                strerror(-cap.error));
+    }
+
+    // Close the capture with whatever was written, even after an error
+    if (write_index(&cap) < 0) {
+        perror("Unable to write the capture's index");
+        rc = 1;
+        goto destroy_slots;
+    }
+
+    printf("AXI DMA Capture Results:\n");
+    printf("\tPackets Captured: %llu (%.2f MiB)\n",
+           (unsigned long long)cap.header.num_packets,
+           BYTE_TO_MIB(cap.header.num_packets * cap.size));
+    printf("\tStored Size: %.2f MiB\n", BYTE_TO_MIB(cap.stored_bytes));
+    printf("\tRate: %.2f packets/s, %.2f MiB/s\n",
+           cap.header.num_packets / elapsed,
+           BYTE_TO_MIB(cap.header.num_packets * cap.size) / elapsed);
+    printf("\tReceive Stalls: %llu\n", (unsigned long long)cap.stalls);
+    rc = (rc < 0 || cap.error < 0) ? 1 : 0;
+
+destroy_slots:
+    destroy_slots(&cap);
+    free(cap.packers);
+destroy_axidma:
+    axidma_destroy(cap.dev);
+close_file:
+    assert(close(cap.fd) == 0);
+ret:
+    return rc;
+}
@@ -0,0 +1,311 @@
+/**
+ * @file axidma_convert_benchmark.c
+ * @date Saturday, October 17, 2026 at 11:02:47 AM EDT
+ *
+ * This is a simple program that benchmarks the pixel format conversions of the
+ * AXI DMA library. Each supported conversion is run on a frame of random
+ * pixels a given number of times, and its rate is reported in megapixels per
+ * second, so that it can be compared against the frame rate of a video
+ * transfer.
+ *
+ * By default, the converted frames are written into buffers allocated from the
+ * AXI DMA device, the same as a conversion into a VDMA frame buffer. Since
+ * these are not cached on all systems, the program can also convert into
+ * regular memory, to separate the cost of the conversion from the memory.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>             // Strerror function
+
+#include <sys/time.h>           // Timing functions and definitions
+#include <getopt.h>             // Option parsing
+#include <unistd.h>             // Sysconf function
+#include <errno.h>              // Error codes
+
+#include "libaxidma.h"          // Interface to the AXI DMA
+#include "libaxidma_video.h"    // Pixel format conversions
+#include "util.h"               // Miscellaneous utilities
+#include "conversion.h"         // Miscellaneous conversion utilities
+
+/*----------------------------------------------------------------------------
+ * Internal Definitons
+ *----------------------------------------------------------------------------*/
+
+// The default frame size (1080p) and number of conversions of each frame
+#define DEFAULT_WIDTH               1920
+#define DEFAULT_HEIGHT              1080
+#define DEFAULT_NUM_CONVERSIONS     100
+
+// The conversions that are benchmarked
+static const enum axidma_pixel_format conversions[][2] = {
+    {AXIDMA_PIXEL_RGB888, AXIDMA_PIXEL_XRGB8888},
+    {AXIDMA_PIXEL_XRGB8888, AXIDMA_PIXEL_RGB888},
+    {AXIDMA_PIXEL_YUYV, AXIDMA_PIXEL_XRGB8888},
+    {AXIDMA_PIXEL_YUYV, AXIDMA_PIXEL_RGB888},
+    {AXIDMA_PIXEL_RAW10, AXIDMA_PIXEL_RAW16},
+};
+
+// The largest number of bytes in a pixel, across all the formats
+#define MAX_PIXEL_SIZE              4
+
+// The options for the benchmark, given on the command line
+struct benchmark_options {
+    int width;                  // The width of the frames in pixels
+    int height;                 // The height of the frames in pixels
+    int num_conversions;        // The number of times to convert each frame
+    int num_threads;            // The number of threads for each conversion
+    bool use_dma_memory;        // Convert into memory from the AXI DMA device
+};
+
+/*----------------------------------------------------------------------------
+ * Command-line Interface
+ *----------------------------------------------------------------------------*/
+
+// Prints the usage for this program
+static void print_usage(bool help)
+{
+    FILE* stream = (help) ? stdout : stderr;
+
+    fprintf(stream, "Usage: axidma_convert_benchmark [-w <frame width>] "
+            "[-i <frame height>] [-n <number conversions>] [-j <number "
+            "threads>] [-m]\n");
+    if (!help) {
+        return;
+    }
+
+    fprintf(stream, "\t-w <frame width>:\t\tThe width of the frames to "
+            "convert, in pixels. Default is %d.\n", DEFAULT_WIDTH);
+    fprintf(stream, "\t-i <frame height>:\t\tThe height of the frames to "
+            "convert, in pixels. Default is %d.\n", DEFAULT_HEIGHT);
+    fprintf(stream, "\t-n <number conversions>:\tThe number of times to "
+            "convert the frame for each format. Default is %d.\n",
+            DEFAULT_NUM_CONVERSIONS);
+    fprintf(stream, "\t-j <number threads>:\t\tThe number of threads to split "
+            "each conversion across. Default is the number of cores.\n");
+    fprintf(stream, "\t-m:\t\t\t\tConvert into regular memory instead of "
+            "memory allocated from the AXI DMA device.\n");
+    return;
+}
+
+/* Parses the command line arguments overriding the default frame size, number
+ * of conversions, and number of threads. */
+static int parse_args(int argc, char **argv, struct benchmark_options *opts)
+{
+    char option;
+
+    // Set the default options
+    opts->width = DEFAULT_WIDTH;
+    opts->height = DEFAULT_HEIGHT;
+    opts->num_conversions = DEFAULT_NUM_CONVERSIONS;
+    opts->num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    opts->use_dma_memory = true;
+
+    while ((option = getopt(argc, argv, "w:i:n:j:mh")) != (char)-1)
+    {
+        switch (option)
+        {
+            // Parse the frame width
+            case 'w':
+                if (parse_int(option, optarg, &opts->width) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the frame height
+            case 'i':
+                if (parse_int(option, optarg, &opts->height) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the number of conversions
+            case 'n':
+                if (parse_int(option, optarg, &opts->num_conversions) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the number of threads
+            case 'j':
+                if (parse_int(option, optarg, &opts->num_threads) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            case 'm':
+                opts->use_dma_memory = false;
+                break;
+
+            case 'h':
+                print_usage(true);
+                exit(0);
+
+            default:
+                print_usage(false);
+                return -EINVAL;
+        }
+    }
+
+    // The width must suit all of the formats, so RAW10 limits it
+    if (opts->width <= 0 || opts->width % 4 != 0 || opts->height <= 0) {
+        fprintf(stderr, "Error: The frame width must be a positive multiple "
+                "of 4, and the height must be positive.\n");
+        return -EINVAL;
+    } else if (opts->num_conversions <= 0) {
+        fprintf(stderr, "Error: The number of conversions must be "
+                "positive.\n");
+        return -EINVAL;
+    }
+    opts->num_threads = (opts->num_threads > 0) ? opts->num_threads : 1;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Benchmark
+ *----------------------------------------------------------------------------*/
+
+/* Times the conversion of a frame between the two formats, reporting the rate
+ * in megapixels per second. */
+static int time_conversion(struct benchmark_options *opts,
+        enum axidma_pixel_format src_format,
+        enum axidma_pixel_format dst_format, void *src_buf, void *dst_buf)
+{
+    int i, rc;
+    double elapsed_time, pixel_rate, data_rate;
+    size_t frame_size;
+    struct timeval start_time, end_time;
+    struct axidma_image src, dst;
+
+    src.format = src_format;
+    src.width = opts->width;
+    src.height = opts->height;
+    src.stride = 0;
+    src.data = src_buf;
+    dst = src;
+    dst.format = dst_format;
+    dst.data = dst_buf;
+
+    // Convert the frame the given number of times
+    gettimeofday(&start_time, NULL);
+    for (i = 0; i < opts->num_conversions; i++)
+    {
+        rc = axidma_convert_image(&src, &dst, opts->num_threads);
+        if (rc < 0) {
+            fprintf(stderr, "Unable to convert %s to %s: %s\n",
+                    axidma_pixel_format_name(src_format),
+                    axidma_pixel_format_name(dst_format), strerror(-rc));
+            return rc;
+        }
+    }
+    gettimeofday(&end_time, NULL);
+
+    // Compute the rates in pixels, and in bytes read and written
+    elapsed_time = TVAL_TO_SEC(end_time) - TVAL_TO_SEC(start_time);
+    pixel_rate = (double)opts->width * opts->height * opts->num_conversions /
+                 elapsed_time / 1e6;
+    frame_size = (axidma_pixel_row_size(src_format, opts->width) +
+                  axidma_pixel_row_size(dst_format, opts->width)) *
+                 opts->height;
+    data_rate = BYTE_TO_MIB(frame_size) * opts->num_conversions /
+                elapsed_time;
+
+    printf("\t%-8s -> %-8s  %8.2f MP/s  %8.2f MiB/s  %6.2f ms/frame\n",
+           axidma_pixel_format_name(src_format),
+           axidma_pixel_format_name(dst_format), pixel_rate, data_rate,
+           elapsed_time * 1000 / opts->num_conversions);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Main Function
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    int rc;
+    size_t i, buf_size;
+    uint8_t *src_buf, *dst_buf;
+    axidma_dev_t axidma_dev;
+    struct benchmark_options opts;
+
+    // Check if the user overrided the default options
+    if (parse_args(argc, argv, &opts) < 0) {
+        rc = 1;
+        goto ret;
+    }
+    printf("AXI DMA Conversion Benchmark Parameters:\n");
+    printf("\tFrame Size: %dx%d\n", opts.width, opts.height);
+    printf("\tNumber of Conversions: %d\n", opts.num_conversions);
+    printf("\tNumber of Threads: %d\n", opts.num_threads);
+    printf("\tInstruction Set: %s\n", axidma_conversion_isa());
+    printf("\tDestination Memory: %s\n\n", (opts.use_dma_memory) ?
+           "AXI DMA" : "regular");
+
+    // The source is always regular memory, as it would be for a camera's frame
+    axidma_dev = NULL;
+    buf_size = (size_t)opts.width * opts.height * MAX_PIXEL_SIZE;
+    src_buf = malloc(buf_size);
+    if (src_buf == NULL) {
+        perror("Unable to allocate the source frame");
+        rc = 1;
+        goto ret;
+    }
+    for (i = 0; i < buf_size; i++)
+    {
+        src_buf[i] = rand();
+    }
+
+    // Allocate the destination frame, from the AXI DMA device if requested
+    if (opts.use_dma_memory) {
+        axidma_dev = axidma_init();
+        if (axidma_dev == NULL) {
+            fprintf(stderr, "Failed to initialize the AXI DMA device.\n");
+            rc = 1;
+            goto free_src_buf;
+        }
+        dst_buf = axidma_malloc(axidma_dev, buf_size);
+    } else {
+        dst_buf = malloc(buf_size);
+    }
+    if (dst_buf == NULL) {
+        perror("Unable to allocate the destination frame");
+        rc = 1;
+        goto destroy_axidma;
+    }
+
+    // Time each of the conversions
+    printf("Conversion Rates:\n");
+    rc = 0;
+    for (i = 0; rc == 0 && i < sizeof(conversions) / sizeof(conversions[0]);
+         i++)
+    {
+        rc = time_conversion(&opts, conversions[i][0], conversions[i][1],
+                             src_buf, dst_buf);
+    }
+    rc = (rc < 0) ? 1 : 0;
+
+    if (opts.use_dma_memory) {
+        axidma_free(axidma_dev, dst_buf, buf_size);
+    } else {
+        free(dst_buf);
+    }
+destroy_axidma:
+    if (axidma_dev != NULL) {
+        axidma_destroy(axidma_dev);
+    }
+free_src_buf:
+    free(src_buf);
+ret:
+    return rc;
+}
@@ -5,11 +5,15 @@
  * @author Jared Choi (jaewonch)
  *
  * This program displays the input image onto the display. The program
- * assumes that the PL fabric is programmed to have an AXI DMA module hooked
+ * assumes that the PL fabric is programmed to have an AXI VDMA module hooked
  * up to either a VGA or HDMI controller.
  *
- * The program reads the image into DMA memory, then repeatedly sends it out
- * over the PL fabric to display it on the device.
+ * The input is a sequence of raw frames, either a file of concatenated frames
+ * or standard input, which is streamed out over the PL fabric at the target
+ * frame rate. A single image is simply a sequence of one frame. The frames are
+ * triple-buffered, so the frame being displayed is never written, and a
+ * reader thread reads ahead into the free frame buffers while the others are
+ * displayed. Once the input runs out, the last frame stays on the display.
  *
  * @bug No known bugs.
  **/
@@ -24,18 +28,70 @@
 #include <sys/mman.h>           // Mmap system call
 #include <sys/ioctl.h>          // IOCTL system call
 #include <unistd.h>             // Close() system call
-#include <sys/time.h>           // Timing functions and definitions
+#include <time.h>               // Monotonic clock and sleep functions
 #include <getopt.h>             // Option parsing
 #include <errno.h>              // Error codes
 #include <signal.h>             // Signal handling functions
 #include <string.h>             // Memory copy/move functions
+#include <pthread.h>            // Threads, mutexes, and condition variables
 
+#include "util.h"               // Miscellaneous utilities
 #include "axidma_ioctl.h"       // The AXI DMA IOCTL interface
 
 // The default image size is 640x480
 #define DEFAULT_IMAGE_WIDTH     640
 #define DEFAULT_IMAGE_HEIGHT    480
 
+// The default frame rate to display frames at, in frames per second
+#define DEFAULT_FRAME_RATE      60
+
+/* Triple-buffering is the minimum, so that a frame can be read in while one is
+ * being displayed, and the next one is waiting to be. */
+#define MIN_FRAME_BUFFERS       3
+#define DEFAULT_FRAME_BUFFERS   MIN_FRAME_BUFFERS
+
+// The time to wait on frames before checking if the program was interrupted
+#define WAIT_TIMEOUT_MS         100
+
+// The interval at which the display statistics are reported, in seconds
+#define REPORT_INTERVAL         1
+
+#define NSEC_PER_SEC            1000000000LL
+
+// The options given by the user
+struct display_options {
+    char *image_path;           // The path to the frames, or "-" for stdin
+    int image_width;            // The width of each frame in pixels
+    int image_height;           // The height of each frame in pixels
+    int tx_channel;             // The VDMA channel to display frames on
+    int frame_rate;             // The target frame rate, 0 for no pacing
+    int num_buffers;            // The number of frame buffers to use
+    bool loop;                  // Replay the file once it runs out of frames
+};
+
+/* The frames that have been read ahead, waiting to be displayed, in order.
+ * This is shared between the reader thread and the display loop. */
+struct frame_queue {
+    pthread_mutex_t lock;       // Protects all of the fields below
+    pthread_cond_t cond;        // Signaled when a frame is added
+    int *buffers;               // Circular buffer of frame buffer indices
+    int size;                   // The capacity of the queue
+    int head;                   // The index of the oldest frame
+    int count;                  // The number of frames in the queue
+    bool done;                  // The reader has no more frames to add
+};
+
+// The state of the display, shared with the reader thread
+struct display {
+    int axidma_fd;              // The AXI DMA device
+    int image_fd;               // The source of the frames
+    bool loop;                  // Replay the file once it runs out of frames
+    int tx_channel;             // The VDMA channel frames are displayed on
+    int frame_size;             // The size of each frame in bytes
+    char **frame_bufs;          // The addresses of the frame buffers
+    struct frame_queue queue;   // Frames read ahead, waiting to be displayed
+};
+
 /* Indicates if the program is still running. Used to communicate between the
  * signal handlers and the main thread. */
 static volatile bool running = true;
@@ -59,48 +115,36 @@ static void print_usage(bool help)
     FILE *stream = (help) ? stdout : stderr;
 
     fprintf(stream, "Usage: axidma_display_image <image path> [-w <image "
-            "width>] [-i <image height>].\n");
+            "width>] [-i <image height>] [-t <VDMA tx channel>] [-r <frame "
+            "rate>] [-b <frame buffers>] [-l].\n");
 
     if (!help) {
         return;
     }
 
-    fprintf(stream, "\t<image path>:\t\tThe path to the image file to display. "
-            "Can either be a relative or absolute path.\n");
+    fprintf(stream, "\t<image path>:\t\tThe path to the raw frames to "
+            "display, one after another. Can either be a relative or absolute "
+            "path, or '-' to read the frames from standard input.\n");
     fprintf(stream, "\t-w <image width>:\tThe width of the image file. Default "
             "is %d.\n", DEFAULT_IMAGE_WIDTH);
     fprintf(stream, "\t-i <image height>:\tThe height of the image file. "
             "Default is %d.\n", DEFAULT_IMAGE_HEIGHT);
-    fprintf(stream, "\t-t <DMA tx channel>:\tThe device id of the "
-            "DMA channel to use for transmitting the image. Default is to use "
+    fprintf(stream, "\t-t <VDMA tx channel>:\tThe device id of the "
+            "VDMA channel to use for transmitting the image. Default is to use "
             "the lowest numbered channel available.\n");
+    fprintf(stream, "\t-r <frame rate>:\tThe target rate to display frames "
+            "at, in frames per second, or 0 to display them as fast as they "
+            "can be read. Default is %d.\n", DEFAULT_FRAME_RATE);
+    fprintf(stream, "\t-b <frame buffers>:\tThe number of frame buffers to "
+            "use. More buffers allow the reader to get further ahead. Default "
+            "is %d, the minimum.\n", DEFAULT_FRAME_BUFFERS);
+    fprintf(stream, "\t-l:\t\t\tLoop back to the first frame once the file "
+            "runs out. Cannot be used with standard input.\n");
     return;
 }
 
-// Parses the arg string as a double for the given option
-static int parse_int(char option, char *arg_str, int *data)
+static int parse_args(int argc, char **argv, struct display_options *opts)
 {
-    int rc;
-
-    rc = sscanf(optarg, "%d", data);
-    if (rc < 0) {
-        perror("Unable to parse argument");
-        return rc;
-    } else if (rc != 1) {
-        fprintf(stderr, "Error: Unable to parse argument '-%c %s' as an "
-                "integer.\n", option, arg_str);
-        print_usage(false);
-        return -EINVAL;
-    }
-
-    return 0;
-}
-
-static int parse_args(int argc, char **argv, char **image_path,
-                      int *image_width, int *image_height, int *tx_channel)
-{
-    int rc;
-    int width, height, tx_channel_id;
     char option;
 
     // Check that there are enough command line arguments
@@ -112,39 +156,60 @@ static int parse_args(int argc, char **argv, char **image_path,
 
     /* Set the default image width and height and the dummy value for
      * the transmit channel id. */
-    *image_width = DEFAULT_IMAGE_WIDTH;
-    *image_height = DEFAULT_IMAGE_HEIGHT;
-    *tx_channel = -1;
-
-    while ((option = getopt(argc, argv, "w:i:t:h")) != (char)-1)
+    opts->image_width = DEFAULT_IMAGE_WIDTH;
+    opts->image_height = DEFAULT_IMAGE_HEIGHT;
+    opts->tx_channel = -1;
+    opts->frame_rate = DEFAULT_FRAME_RATE;
+    opts->num_buffers = DEFAULT_FRAME_BUFFERS;
+    opts->loop = false;
+
+    while ((option = getopt(argc, argv, "w:i:t:r:b:lh")) != (char)-1)
     {
         switch (option)
         {
             // Parse the image width
             case 'w':
-                rc = parse_int(option, optarg, &width);
-                if (rc < 0) {
-                    return rc;
+                if (parse_int(option, optarg, &opts->image_width) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
                 }
-                *image_width = width;
                 break;
 
             // Parse the image height
             case 'i':
-                rc = parse_int(option, optarg, &height);
-                if (rc < 0) {
-                    return rc;
+                if (parse_int(option, optarg, &opts->image_height) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
                 }
-                *image_height = height;
                 break;
 
             // Parse the transmit channel device id
             case 't':
-                rc = parse_int(option, optarg, &tx_channel_id);
-                if (rc < 0) {
-                    return rc;
+                if (parse_int(option, optarg, &opts->tx_channel) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the target frame rate
+            case 'r':
+                if (parse_int(option, optarg, &opts->frame_rate) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                break;
+
+            // Parse the number of frame buffers
+            case 'b':
+                if (parse_int(option, optarg, &opts->num_buffers) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
                 }
-                *tx_channel = tx_channel_id;
+                break;
+
+            // Loop back to the start of the file when it runs out
+            case 'l':
+                opts->loop = true;
                 break;
 
             case 'h':
@@ -165,23 +230,43 @@ static int parse_args(int argc, char **argv, char **image_path,
     }
 
     // Check that the image dimensions are non-zero
-    if (*image_width <= 0) {
+    if (opts->image_width <= 0) {
         fprintf(stderr, "Error: Image width must be positive.\n");
         print_usage(false);
         return -EINVAL;
     }
-    if (*image_height <= 0) {
+    if (opts->image_height <= 0) {
         fprintf(stderr, "Error: Image hieght must be positive.\n");
         print_usage(false);
         return -EINVAL;
     }
 
+    // Check the frame rate and the number of frame buffers
+    if (opts->frame_rate < 0) {
+        fprintf(stderr, "Error: Frame rate must be non-negative.\n");
+        print_usage(false);
+        return -EINVAL;
+    }
+    if (opts->num_buffers < MIN_FRAME_BUFFERS ||
+            opts->num_buffers > AXIDMA_MAX_FRAME_BUFFERS) {
+        fprintf(stderr, "Error: The number of frame buffers must be between "
+                "%d and %d.\n", MIN_FRAME_BUFFERS, AXIDMA_MAX_FRAME_BUFFERS);
+        print_usage(false);
+        return -EINVAL;
+    }
+
     // Parse out the image path
-    *image_path = argv[optind];
+    opts->image_path = argv[optind];
+    if (opts->loop && strcmp(opts->image_path, "-") == 0) {
+        fprintf(stderr, "Error: Standard input cannot be looped.\n");
+        print_usage(false);
+        return -EINVAL;
+    }
+
     return 0;
 }
 
-static int find_dma_channel(int axidma_fd)
+static int find_vdma_channel(int axidma_fd)
 {
     int rc, i;
     struct axidma_chan *channels, *chan;
@@ -212,32 +297,296 @@ static int find_dma_channel(int axidma_fd)
         return rc;
     }
 
-    // Search for the first available transmit DMA channel
+    // Search for the first available transmit VDMA channel
     for (i = 0; i < num_chan.num_channels; i++)
     {
         chan = &channel_info.channels[i];
-        if (chan->dir == AXIDMA_WRITE && chan->type == AXIDMA_DMA) {
+        if (chan->dir == AXIDMA_WRITE && chan->type == AXIDMA_VDMA) {
             free(channels);
             return chan->channel_id;
         }
     }
 
     free(channels);
-    fprintf(stderr, "No transmit DMA channels are present.\n");
+    fprintf(stderr, "No transmit VDMA channels are present.\n");
     return -ENODEV;
 }
 
-int main(int argc, char **argv)
+/*----------------------------------------------------------------------------
+ * Frame Queue
+ *----------------------------------------------------------------------------*/
+
+static int init_queue(struct frame_queue *queue, int size)
+{
+    queue->buffers = malloc(size * sizeof(queue->buffers[0]));
+    if (queue->buffers == NULL) {
+        fprintf(stderr, "Unable to allocate the frame queue.\n");
+        return -ENOMEM;
+    }
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->cond, NULL);
+    queue->size = size;
+    queue->head = 0;
+    queue->count = 0;
+    queue->done = false;
+    return 0;
+}
+
+static void destroy_queue(struct frame_queue *queue)
+{
+    pthread_cond_destroy(&queue->cond);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->buffers);
+    return;
+}
+
+// Adds a frame that has been read in to the back of the queue
+static void push_frame(struct frame_queue *queue, int buffer_index)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->buffers[(queue->head + queue->count) % queue->size] = buffer_index;
+    queue->count += 1;
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+    return;
+}
+
+// Marks that the reader will not add any more frames to the queue
+static void finish_queue(struct frame_queue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->done = true;
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+    return;
+}
+
+/* Takes the next frame from the front of the queue, waiting for the reader if
+ * it is empty. Returns the frame buffer index, or -1 if the reader is done or
+ * the program was interrupted. If the queue was empty, the frame is late. */
+static int pop_frame(struct frame_queue *queue, bool *late)
+{
+    int buffer_index;
+    struct timespec timeout;
+
+    pthread_mutex_lock(&queue->lock);
+    *late = (queue->count == 0 && !queue->done);
+    while (queue->count == 0 && !queue->done && running)
+    {
+        clock_gettime(CLOCK_REALTIME, &timeout);
+        timeout.tv_nsec += WAIT_TIMEOUT_MS * 1000000LL;
+        timeout.tv_sec += timeout.tv_nsec / NSEC_PER_SEC;
+        timeout.tv_nsec %= NSEC_PER_SEC;
+        pthread_cond_timedwait(&queue->cond, &queue->lock, &timeout);
+    }
+
+    if (queue->count == 0) {
+        pthread_mutex_unlock(&queue->lock);
+        return -1;
+    }
+
+    buffer_index = queue->buffers[queue->head];
+    queue->head = (queue->head + 1) % queue->size;
+    queue->count -= 1;
+    pthread_mutex_unlock(&queue->lock);
+    return buffer_index;
+}
+
+/*----------------------------------------------------------------------------
+ * Frame Reader
+ *----------------------------------------------------------------------------*/
+
+/* Reads the next frame from the input into the buffer, rewinding the file at
+ * the end if looping. Returns 1 if a frame was read, 0 at the end of the
+ * frames, and a negative number on failure. */
+static int read_frame(struct display *disp, char *frame_buf)
+{
+    int rc;
+
+    rc = robust_read(disp->image_fd, frame_buf, disp->frame_size);
+    if (rc == 0 && disp->loop) {
+        if (lseek(disp->image_fd, 0, SEEK_SET) < 0) {
+            perror("Unable to rewind the image file");
+            return -errno;
+        }
+        rc = robust_read(disp->image_fd, frame_buf, disp->frame_size);
+    }
+
+    if (rc < 0) {
+        perror("Unable to read image file");
+        return rc;
+    } else if (rc > 0 && rc < disp->frame_size) {
+        fprintf(stderr, "Warning: Ignoring %d bytes of a partial frame at the "
+                "end of the input.\n", rc);
+        return 0;
+    }
+
+    return (rc == 0) ? 0 : 1;
+}
+
+/* The reader thread. This takes each frame buffer once the engine is done
+ * displaying it, reads the next frame into it, and queues it to be displayed.
+ * Thus, the input is read ahead while the other frames are being displayed. */
+static void *frame_reader(void *arg)
 {
     int rc;
-    char *image_path;
+    struct display *disp;
+    struct axidma_frame_event event;
+
+    disp = arg;
+    while (running)
+    {
+        // Take the next frame buffer that is no longer being displayed
+        memset(&event, 0, sizeof(event));
+        event.channel_id = disp->tx_channel;
+        event.timeout = WAIT_TIMEOUT_MS;
+        rc = ioctl(disp->axidma_fd, AXIDMA_GET_VIDEO_FRAME, &event);
+        if (rc < 0 && errno == ETIMEDOUT) {
+            continue;
+        } else if (rc < 0) {
+            perror("Unable to get a frame buffer to read into");
+            break;
+        }
+
+        /* Read the next frame into it. At the end of the frames, the buffer
+         * is kept, so the last frame displayed is left alone. */
+        rc = read_frame(disp, disp->frame_bufs[event.buffer_index]);
+        if (rc <= 0) {
+            break;
+        }
+        push_frame(&disp->queue, event.buffer_index);
+    }
+
+    finish_queue(&disp->queue);
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ * Display Loop
+ *----------------------------------------------------------------------------*/
+
+static long long timespec_to_ns(struct timespec *time)
+{
+    return time->tv_sec * NSEC_PER_SEC + time->tv_nsec;
+}
+
+static void ns_to_timespec(long long ns, struct timespec *time)
+{
+    time->tv_sec = ns / NSEC_PER_SEC;
+    time->tv_nsec = ns % NSEC_PER_SEC;
+    return;
+}
+
+// Prints out the achieved frame rate and the frame counts
+static void report_stats(struct display *disp, const char *label, int frames,
+                         long long elapsed_ns, int late_frames)
+{
+    double fps;
+    struct axidma_video_stats stats;
+
+    memset(&stats, 0, sizeof(stats));
+    stats.channel_id = disp->tx_channel;
+    if (ioctl(disp->axidma_fd, AXIDMA_GET_VIDEO_STATS, &stats) < 0) {
+        perror("Unable to get the video statistics");
+    }
+
+    fps = (elapsed_ns > 0) ? frames * (double)NSEC_PER_SEC / elapsed_ns : 0;
+    printf("%s: %d frames at %.2f fps, %d late. The display has repeated %llu "
+           "frames so far.\n", label, frames, fps, late_frames,
+           stats.frames_starved);
+    return;
+}
+
+/* Displays the frames in the queue, one at each tick of the frame rate. A
+ * frame is late if it hasn't been read in by the time it should be displayed.
+ * Returns the number of frames displayed, or a negative number on failure. */
+static int display_frames(struct display *disp, int frame_rate)
+{
+    int buffer_index, frames, late_frames;
+    int interval_frames, interval_late;
+    long long period_ns, deadline_ns, now_ns, start_ns, report_ns;
+    bool late;
+    struct timespec now, deadline;
+    struct axidma_frame_event event;
+
+    period_ns = (frame_rate > 0) ? NSEC_PER_SEC / frame_rate : 0;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    start_ns = timespec_to_ns(&now);
+    deadline_ns = start_ns;
+    report_ns = start_ns;
+    frames = 0;
+    late_frames = 0;
+    interval_frames = 0;
+    interval_late = 0;
+
+    while (running)
+    {
+        // Wait until the frame is due
+        if (period_ns > 0) {
+            ns_to_timespec(deadline_ns, &deadline);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline,
+                                   NULL) == EINTR && running);
+        }
+
+        // Take the next frame that has been read in, and give it to the engine
+        buffer_index = pop_frame(&disp->queue, &late);
+        if (buffer_index < 0) {
+            break;
+        }
+
+        memset(&event, 0, sizeof(event));
+        event.channel_id = disp->tx_channel;
+        event.buffer_index = buffer_index;
+        if (ioctl(disp->axidma_fd, AXIDMA_PUT_VIDEO_FRAME, &event) < 0) {
+            perror("Unable to queue the frame for display");
+            return -errno;
+        }
+
+        frames += 1;
+        interval_frames += 1;
+        if (late && period_ns > 0) {
+            late_frames += 1;
+            interval_late += 1;
+        }
+
+        /* Schedule the next frame. If we've fallen more than a frame behind,
+         * start over from now, rather than rushing to catch up. */
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        now_ns = timespec_to_ns(&now);
+        deadline_ns += period_ns;
+        if (now_ns - deadline_ns > period_ns) {
+            deadline_ns = now_ns;
+        }
+
+        // Periodically report how the display is keeping up
+        if (now_ns - report_ns >= REPORT_INTERVAL * NSEC_PER_SEC) {
+            report_stats(disp, "Interval", interval_frames, now_ns - report_ns,
+                         interval_late);
+            report_ns = now_ns;
+            interval_frames = 0;
+            interval_late = 0;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    report_stats(disp, "Total", frames, timespec_to_ns(&now) - start_ns,
+                 late_frames);
+    return frames;
+}
+
+int main(int argc, char **argv)
+{
+    int rc, i;
     int axidma_fd, image_fd;
-    int tx_channel;
-    int image_width, image_height, image_byte_size;
-    char *image_buf;
-    int bytes_remain;
+    int frame_size;
+    size_t buffers_size;
+    char *buffers_mem;
     sigset_t sig_mask;
+    pthread_t reader;
     struct stat image_stat;
+    struct display_options opts;
+    struct display disp;
     struct axidma_video_transaction trans;
     struct axidma_chan chan_info;
 
@@ -246,23 +595,45 @@ int main(int argc, char **argv)
 	signal(SIGTERM, signal_handler);
 	signal(SIGQUIT, signal_handler);
 
-    // Parse out the image path and image size
-    if (parse_args(argc, argv, &image_path, &image_width, &image_height,
-                   &tx_channel) < 0) {
+    // Parse out the image path, image size, and display options
+    if (parse_args(argc, argv, &opts) < 0) {
         rc = 1;
         goto ret;
     }
-    image_byte_size = image_width * image_height * sizeof(int);
+    frame_size = opts.image_width * opts.image_height * sizeof(int);
 
-    // Try opening the image
-    image_fd = open(image_path, O_RDONLY);
+    // Try opening the image, or use standard input
+    if (strcmp(opts.image_path, "-") == 0) {
+        image_fd = STDIN_FILENO;
+    } else {
+        image_fd = open(opts.image_path, O_RDONLY);
+    }
     if (image_fd < 0) {
         perror("Error opening image file");
-        fprintf(stderr, "Image File: %s.\n", image_path);
+        fprintf(stderr, "Image File: %s.\n", opts.image_path);
         rc = 1;
         goto ret;
     }
 
+    // Check the file size of the image, if it's a regular file
+    rc = fstat(image_fd, &image_stat);
+    if (rc < 0) {
+        perror("Unable to get file statistics");
+        rc = 1;
+        goto close_image;
+    } else if (S_ISREG(image_stat.st_mode) &&
+            image_stat.st_size < (off_t)frame_size) {
+        fprintf(stderr, "Error: File is not large enough for a %dx%d image.\n",
+                opts.image_width, opts.image_height);
+        rc = 1;
+        goto close_image;
+    } else if (S_ISREG(image_stat.st_mode) &&
+            image_stat.st_size % frame_size != 0) {
+        printf("Warning: File is not a whole number of %dx%d frames. The "
+               "partial frame will be ignored.\n", opts.image_width,
+               opts.image_height);
+    }
+
     // Open the AXI dma device, initializing anything necessary
     axidma_fd = open("/dev/axidma", O_RDWR|O_EXCL);
     if (axidma_fd < 0) {
@@ -273,90 +644,124 @@ int main(int argc, char **argv)
 
     /* If the user didn't specify the transmit channel, use the lowest numbered
      * one by default. */
-    if (tx_channel == -1) {
-        tx_channel = find_dma_channel(axidma_fd);
-        if (tx_channel < 0) {
-            rc = tx_channel;
-            goto close_image;
+    if (opts.tx_channel == -1) {
+        opts.tx_channel = find_vdma_channel(axidma_fd);
+        if (opts.tx_channel < 0) {
+            rc = 1;
+            goto close_axidma;
         }
     }
 
-    // Map two frame buffers to display the image
-    image_buf = mmap(NULL, image_byte_size, PROT_READ|PROT_WRITE,
-                      MAP_SHARED, axidma_fd, 0);
-    if (image_buf == MAP_FAILED) {
+    // Map the frame buffers for the display, all from one region
+    buffers_size = (size_t)opts.num_buffers * frame_size;
+    buffers_mem = mmap(NULL, buffers_size, PROT_READ|PROT_WRITE, MAP_SHARED,
+                       axidma_fd, 0);
+    if (buffers_mem == MAP_FAILED) {
         perror("Unable to mmap memory region from AXI DMA device");
         rc = 1;
         goto close_axidma;
     }
 
-    // Check the file size of the image
-    rc = fstat(image_fd, &image_stat);
-    if (rc < 0) {
-        perror("Unable to get file statistics");
+    // Setup the state shared with the reader thread
+    disp.axidma_fd = axidma_fd;
+    disp.image_fd = image_fd;
+    disp.loop = opts.loop;
+    disp.tx_channel = opts.tx_channel;
+    disp.frame_size = frame_size;
+    disp.frame_bufs = malloc(opts.num_buffers * sizeof(disp.frame_bufs[0]));
+    if (disp.frame_bufs == NULL) {
+        fprintf(stderr, "Unable to allocate the frame buffer array.\n");
         rc = 1;
-        goto free_image_buf;
-    } else if (image_stat.st_size < (off_t)image_byte_size) {
-        fprintf(stderr, "Error: File is not large enough for a %dx%d image.\n",
-                image_width, image_height);
+        goto free_buffers_mem;
+    }
+    for (i = 0; i < opts.num_buffers; i++)
+    {
+        disp.frame_bufs[i] = buffers_mem + (size_t)i * frame_size;
+    }
+    if (init_queue(&disp.queue, opts.num_buffers) < 0) {
         rc = 1;
-        goto free_image_buf;
-    } else if (image_stat.st_size > (off_t)image_byte_size) {
-        printf("Warning: File is too large for a %dx%d image. It will be "
-               "truncated.\n", image_width, image_height);
+        goto free_frame_bufs;
     }
 
-    // Read the image into the buffer (accounting for EINTR's)
-    bytes_remain = image_byte_size;
-    do {
-        rc = read(image_fd, image_buf+image_byte_size-bytes_remain,
-                  bytes_remain);
-        bytes_remain = (rc > 0) ? bytes_remain - rc : bytes_remain;
-    } while ((rc > 0 || rc == -EINTR) && bytes_remain > 0);
-
-    // Check for errors
-    if (rc < 0) {
-        perror("Unable to read image file");
-        rc = -1;
-        goto free_image_buf;
+    /* Read in the first frame, and start every frame buffer out with it. The
+     * engine shows it until the reader has caught up. */
+    rc = read_frame(&disp, disp.frame_bufs[0]);
+    if (rc <= 0) {
+        fprintf(stderr, "Error: The input does not contain any frames.\n");
+        rc = 1;
+        goto destroy_queue;
+    }
+    for (i = 1; i < opts.num_buffers; i++)
+    {
+        memcpy(disp.frame_bufs[i], disp.frame_bufs[0], frame_size);
     }
 
     // Initiate a video transfer to the PL fabric
-    trans.channel_id = tx_channel;
-    trans.num_frame_buffers = 1;
-    trans.frame_buffers = (void **)&image_buf;
-    trans.frame.width = image_width;
-    trans.frame.height = image_height;
+    trans.channel_id = opts.tx_channel;
+    trans.num_frame_buffers = opts.num_buffers;
+    trans.frame_buffers = (void **)disp.frame_bufs;
+    trans.frame.width = opts.image_width;
+    trans.frame.height = opts.image_height;
     trans.frame.depth = sizeof(int);
+    trans.frame.stride = 0;
+    trans.frame.x_offset = 0;
+    trans.frame.y_offset = 0;
     if (ioctl(axidma_fd, AXIDMA_DMA_VIDEO_WRITE, &trans) < 0) {
         perror("Failed to perform a DMA video write transaction");
-        rc = -1;
-        goto free_image_buf;
+        rc = 1;
+        goto destroy_queue;
     }
     printf("Image display beginning.\n");
 
-    // Wait until the user interrupts us
+    // Start reading ahead, with the signals left to the main thread
+    sigemptyset(&sig_mask);
+    sigaddset(&sig_mask, SIGINT);
+    sigaddset(&sig_mask, SIGTERM);
+    sigaddset(&sig_mask, SIGQUIT);
+    pthread_sigmask(SIG_BLOCK, &sig_mask, NULL);
+    rc = pthread_create(&reader, NULL, frame_reader, &disp);
+    pthread_sigmask(SIG_UNBLOCK, &sig_mask, NULL);
+    if (rc != 0) {
+        fprintf(stderr, "Unable to create the frame reader thread: %s.\n",
+                strerror(rc));
+        rc = 1;
+        goto stop_display;
+    }
+
+    // Display the frames, then hold the last one until the user interrupts us
+    rc = display_frames(&disp, opts.frame_rate);
+    if (rc < 0) {
+        running = false;
+        pthread_join(reader, NULL);
+        rc = 1;
+        goto stop_display;
+    } else if (running) {
+        printf("End of the frames, holding the last frame.\n");
+    }
     sigemptyset(&sig_mask);
     while (running)
     {
         sigsuspend(&sig_mask);
     }
     printf("Display shutting down.\n");
+    pthread_join(reader, NULL);
+    rc = 0;
 
-    // Stop the DMA transfer
-    chan_info.channel_id = tx_channel;
+stop_display:
+    // Stop the VDMA transfer
+    chan_info.channel_id = opts.tx_channel;
     chan_info.dir = AXIDMA_WRITE;
-    chan_info.type = AXIDMA_DMA;
+    chan_info.type = AXIDMA_VDMA;
     if (ioctl(axidma_fd, AXIDMA_STOP_DMA_CHANNEL, &chan_info) < 0) {
-        perror("Unable to stop DMA transmit transfer");
-        rc = -1;
-        goto free_image_buf;
+        perror("Unable to stop VDMA transmit transfer");
+        rc = 1;
     }
-
-    rc = 0;
-
-free_image_buf:
-    munmap(image_buf, image_byte_size);
+destroy_queue:
+    destroy_queue(&disp.queue);
+free_frame_bufs:
+    free(disp.frame_bufs);
+free_buffers_mem:
+    munmap(buffers_mem, buffers_size);
 close_axidma:
     close(axidma_fd);
 close_image:
@@ -0,0 +1,853 @@
+/**
+ * @file axidma_latency.c
+ * @date Sunday, October 18, 2026 at 05:12:40 AM EDT
+ *
+ * This program measures the worst-case latency of small DMA transfers, in the
+ * style of cyclictest. A measurement thread wakes up periodically, runs a
+ * small transfer through the DMA transmit and receive channels, and measures
+ * the time from when it should have woken up to when the transfer completed.
+ * The thread runs under SCHED_FIFO, optionally pinned to a CPU, with all of
+ * the program's memory locked, so that the latencies seen are those of the
+ * system rather than of paging or the scheduler's fairness.
+ *
+ * The latencies are counted in a histogram with a bucket for each
+ * microsecond, which can be written to a file for plotting. Background
+ * threads can load the CPUs, the memory bus, and the timer interrupts while
+ * the test runs. With -b, the test stops the kernel's function tracer and
+ * ends the first time a latency goes over the given bound, so the trace holds
+ * what led up to it.
+ *
+ * @bug No known bugs.
+ **/
+
+#define _GNU_SOURCE             // CPU affinity for the measurement thread
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include <fcntl.h>              // Flags for open()
+#include <unistd.h>             // Write() and close() system calls
+#include <string.h>             // Memory setting and copying
+#include <getopt.h>             // Option parsing
+#include <errno.h>              // Error codes
+#include <signal.h>             // Signal handling functions
+#include <time.h>               // Clocks for the timing
+#include <sched.h>              // Real-time scheduling and CPU affinity
+#include <pthread.h>            // Measurement and stress threads
+#include <sys/mman.h>           // Mlockall() system call
+
+#include "util.h"               // Miscellaneous utilities
+#include "libaxidma.h"          // Interface to the AXI DMA library
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The default size of the transfers, period, priority, and histogram size
+#define DEFAULT_TRANSFER_SIZE   64
+#define DEFAULT_INTERVAL_US     1000
+#define DEFAULT_PRIORITY        80
+#define DEFAULT_HISTOGRAM_US    1000
+
+// The size of each of the two buffers copied between by a memory stressor
+#define MEMORY_STRESS_SIZE      (32 * 1024 * 1024)
+
+// How often the timer interrupt stressors wake up, in ns
+#define IRQ_STRESS_PERIOD_NS    20000
+
+// How often the main thread checks on the test, and reports progress, in ns
+#define STATUS_POLL_NS          100000000
+#define STATUS_POLLS            10
+
+// The directories that the kernel's tracing files may be found in
+static const char *const trace_dirs[] = {
+    "/sys/kernel/tracing",
+    "/sys/kernel/debug/tracing",
+};
+
+// The parameters and results of the latency test
+struct latency_test {
+    axidma_dev_t dev;           // The AXI DMA device
+    int tx_channel;             // The channel the transfers are sent on
+    int rx_channel;             // The channel the transfers come back on
+    size_t size;                // The size of each transfer
+    void *tx_buf;               // The DMA buffer sent from
+    void *rx_buf;               // The DMA buffer received into
+    int interval_us;            // The period of the transfers
+    int loops;                  // The number of transfers, 0 for no limit
+    int duration;               // Seconds to run for, 0 for no limit
+    int priority;               // The SCHED_FIFO priority, 0 for SCHED_OTHER
+    int cpu;                    // The CPU to pin to, -1 for any
+    int histogram_us;           // The number of buckets in the histogram
+    int break_us;               // The latency that stops the test, 0 for none
+    int trace_on_fd;            // The tracer's tracing_on file, or -1
+    int trace_marker_fd;        // The tracer's trace_marker file, or -1
+    bool quiet;                 // Don't report progress while running
+
+    uint64_t *histogram;        // The count of latencies in each microsecond
+    uint64_t overflows;         // Latencies past the end of the histogram
+    uint64_t samples;           // The number of latencies measured
+    uint64_t total_ns;          // The sum of the latencies
+    uint64_t min_ns;            // The shortest latency
+    uint64_t max_ns;            // The longest latency
+    uint64_t max_sample;        // The sample the longest latency was seen on
+    uint64_t max_wakeup_ns;     // The longest time to wake up
+    uint64_t break_ns;          // The latency that went over the bound, if any
+    int error;                  // The errno of a failed transfer, if any
+    bool finished;              // Set by the measurement thread when done
+};
+
+// The background load to run while the test runs
+struct stress {
+    int cpu_threads;            // Threads spinning on the CPU
+    int memory_threads;         // Threads copying between large buffers
+    int irq_threads;            // Threads waking on a fast timer
+    int num_threads;            // The number of threads started
+    pthread_t *threads;         // The threads started
+};
+
+/* Indicates if the program is still running. Used to communicate between the
+ * signal handlers and the threads. */
+static volatile bool running = true;
+
+static void signal_handler(int signal)
+{
+    switch (signal) {
+        case SIGINT:
+        case SIGTERM:
+        case SIGQUIT:
+            running = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * Command Line Interface
+ *----------------------------------------------------------------------------*/
+
+// Prints the usage for this program
+static void print_usage(bool help)
+{
+    FILE* stream = (help) ? stdout : stderr;
+
+    fprintf(stream, "Usage: axidma_latency [-t <DMA tx channel>] [-r <DMA rx "
+            "channel>] [-s <transfer size>] [-i <interval>] [-l <loops>] "
+            "[-D <duration>] [-p <priority>] [-a <cpu>] [-H <histogram "
+            "size>] [-o <histogram file>] [-b <break latency>] [-C <cpu "
+            "stressors>] [-M <memory stressors>] [-I <irq stressors>] "
+            "[-q].\n");
+    if (!help) {
+        return;
+    }
+
+    fprintf(stream, "\t-t <DMA tx channel>:\tThe device id of the DMA channel "
+            "to send the transfers on. Default is the lowest numbered "
+            "channel.\n");
+    fprintf(stream, "\t-r <DMA rx channel>:\tThe device id of the DMA channel "
+            "to receive the transfers on. Default is the lowest numbered "
+            "channel.\n");
+    fprintf(stream, "\t-s <transfer size>:\tThe size of each transfer in "
+            "bytes. Default is %d.\n", DEFAULT_TRANSFER_SIZE);
+    fprintf(stream, "\t-i <interval>:\t\tThe period of the transfers in "
+            "microseconds. Default is %d.\n", DEFAULT_INTERVAL_US);
+    fprintf(stream, "\t-l <loops>:\t\tThe number of transfers to run. Default "
+            "is to run until interrupted.\n");
+    fprintf(stream, "\t-D <duration>:\t\tThe number of seconds to run for. "
+            "Default is to run until interrupted.\n");
+    fprintf(stream, "\t-p <priority>:\t\tThe SCHED_FIFO priority of the "
+            "measurement thread, or 0 to run it under SCHED_OTHER. Default is "
+            "%d.\n", DEFAULT_PRIORITY);
+    fprintf(stream, "\t-a <cpu>:\t\tThe CPU to pin the measurement thread "
+            "to. Default is to let it run on any CPU.\n");
+    fprintf(stream, "\t-H <histogram size>:\tThe number of one microsecond "
+            "buckets in the histogram. Default is %d.\n",
+            DEFAULT_HISTOGRAM_US);
+    fprintf(stream, "\t-o <histogram file>:\tWrite the histogram to the "
+            "file, as lines of '<latency us> <count>', or to stdout for "
+            "'-'.\n");
+    fprintf(stream, "\t-b <break latency>:\tStop the kernel's tracer and end "
+            "the test the first time a latency goes over this many "
+            "microseconds.\n");
+    fprintf(stream, "\t-C <cpu stressors>:\tThe number of threads to spin "
+            "on the CPUs while the test runs. Default is 0.\n");
+    fprintf(stream, "\t-M <memory stressors>:\tThe number of threads to copy "
+            "between %d MiB buffers while the test runs. Default is 0.\n",
+            MEMORY_STRESS_SIZE / (1024 * 1024));
+    fprintf(stream, "\t-I <irq stressors>:\tThe number of threads to wake on "
+            "a %d us timer while the test runs. Default is 0.\n",
+            IRQ_STRESS_PERIOD_NS / 1000);
+    fprintf(stream, "\t-q:\t\t\tDon't report progress while the test runs.\n");
+    return;
+}
+
+// Parses a non-negative integer argument
+static int parse_count(char option, char *arg_str, int *data, bool positive)
+{
+    if (parse_int(option, arg_str, data) < 0) {
+        return -EINVAL;
+    } else if (*data < 0 || (positive && *data == 0)) {
+        fprintf(stderr, "Error: The argument to -%c must be %s.\n", option,
+                positive ? "positive" : "non-negative");
+        return -EINVAL;
+    }
+    return 0;
+}
+
+// Parses the command line arguments
+static int parse_args(int argc, char **argv, struct latency_test *test,
+        struct stress *stress, char **histogram_path)
+{
+    char option;
+    int int_arg, rc;
+
+    // Set the default values for the arguments
+    test->tx_channel = -1;
+    test->rx_channel = -1;
+    test->size = DEFAULT_TRANSFER_SIZE;
+    test->interval_us = DEFAULT_INTERVAL_US;
+    test->priority = DEFAULT_PRIORITY;
+    test->cpu = -1;
+    test->histogram_us = DEFAULT_HISTOGRAM_US;
+    *histogram_path = NULL;
+
+    rc = 0;
+    while (rc == 0 &&
+           (option = getopt(argc, argv, "t:r:s:i:l:D:p:a:H:o:b:C:M:I:qh"))
+                != (char)-1)
+    {
+        switch (option)
+        {
+            // Parse the channel device ids
+            case 't':
+                rc = parse_int(option, optarg, &test->tx_channel);
+                break;
+            case 'r':
+                rc = parse_int(option, optarg, &test->rx_channel);
+                break;
+
+            // Parse the size and period of the transfers
+            case 's':
+                rc = parse_count(option, optarg, &int_arg, true);
+                test->size = int_arg;
+                break;
+            case 'i':
+                rc = parse_count(option, optarg, &test->interval_us, true);
+                break;
+
+            // Parse how long to run the test for
+            case 'l':
+                rc = parse_count(option, optarg, &test->loops, false);
+                break;
+            case 'D':
+                rc = parse_count(option, optarg, &test->duration, false);
+                break;
+
+            // Parse the scheduling of the measurement thread
+            case 'p':
+                rc = parse_count(option, optarg, &test->priority, false);
+                if (rc == 0 && test->priority > sched_get_priority_max(
+                        SCHED_FIFO)) {
+                    fprintf(stderr, "Error: The priority must be at most "
+                            "%d.\n", sched_get_priority_max(SCHED_FIFO));
+                    rc = -EINVAL;
+                }
+                break;
+            case 'a':
+                rc = parse_count(option, optarg, &test->cpu, false);
+                break;
+
+            // Parse the histogram and the trace trigger
+            case 'H':
+                rc = parse_count(option, optarg, &test->histogram_us, true);
+                break;
+            case 'o':
+                *histogram_path = optarg;
+                break;
+            case 'b':
+                rc = parse_count(option, optarg, &test->break_us, true);
+                break;
+
+            // Parse the background load
+            case 'C':
+                rc = parse_count(option, optarg, &stress->cpu_threads, false);
+                break;
+            case 'M':
+                rc = parse_count(option, optarg, &stress->memory_threads,
+                                 false);
+                break;
+            case 'I':
+                rc = parse_count(option, optarg, &stress->irq_threads, false);
+                break;
+
+            case 'q':
+                test->quiet = true;
+                break;
+
+            case 'h':
+                print_usage(true);
+                exit(0);
+
+            default:
+                rc = -EINVAL;
+                break;
+        }
+    }
+
+    if (rc < 0) {
+        print_usage(false);
+        return rc;
+    } else if (optind != argc) {
+        fprintf(stderr, "Error: Unexpected argument '%s'.\n", argv[optind]);
+        print_usage(false);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Background Load
+ *----------------------------------------------------------------------------*/
+
+// Spins on the CPU until the test ends
+static void *cpu_stress_thread(void *arg)
+{
+    volatile uint64_t value;
+
+    (void)arg;
+    value = 1;
+    while (running)
+    {
+        value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return NULL;
+}
+
+/* Copies back and forth between two buffers much larger than the caches until
+ * the test ends, keeping the memory bus busy. */
+static void *memory_stress_thread(void *arg)
+{
+    char *bufs;
+
+    (void)arg;
+    bufs = malloc(2 * MEMORY_STRESS_SIZE);
+    if (bufs == NULL) {
+        fprintf(stderr, "Warning: Unable to allocate the memory stressor's "
+                "buffers.\n");
+        return NULL;
+    }
+
+    memset(bufs, 0x5a, 2 * MEMORY_STRESS_SIZE);
+    while (running)
+    {
+        memcpy(bufs + MEMORY_STRESS_SIZE, bufs, MEMORY_STRESS_SIZE);
+        memcpy(bufs, bufs + MEMORY_STRESS_SIZE, MEMORY_STRESS_SIZE);
+    }
+
+    free(bufs);
+    return NULL;
+}
+
+/* Sleeps on a short period until the test ends, so the high-resolution timer
+ * interrupt fires on each period. */
+static void *irq_stress_thread(void *arg)
+{
+    struct timespec next;
+
+    (void)arg;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (running)
+    {
+        next.tv_nsec += IRQ_STRESS_PERIOD_NS;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_sec += 1;
+            next.tv_nsec -= 1000000000;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    return NULL;
+}
+
+// Starts the background load, with no signals delivered to its threads
+static int start_stress(struct stress *stress)
+{
+    int i, rc, total;
+    sigset_t mask, old_mask;
+    void *(*thread_fn)(void *);
+
+    total = stress->cpu_threads + stress->memory_threads + stress->irq_threads;
+    stress->threads = calloc(total, sizeof(*stress->threads));
+    if (total > 0 && stress->threads == NULL) {
+        return -ENOMEM;
+    }
+
+    sigfillset(&mask);
+    pthread_sigmask(SIG_SETMASK, &mask, &old_mask);
+    rc = 0;
+    for (i = 0; rc == 0 && i < total; i++)
+    {
+        if (i < stress->cpu_threads) {
+            thread_fn = cpu_stress_thread;
+        } else if (i < stress->cpu_threads + stress->memory_threads) {
+            thread_fn = memory_stress_thread;
+        } else {
+            thread_fn = irq_stress_thread;
+        }
+
+        rc = pthread_create(&stress->threads[i], NULL, thread_fn, NULL);
+        if (rc == 0) {
+            stress->num_threads += 1;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+
+    return -rc;
+}
+
+// Waits for the background load to stop, once the test has ended
+static void stop_stress(struct stress *stress)
+{
+    int i;
+
+    for (i = 0; i < stress->num_threads; i++)
+    {
+        pthread_join(stress->threads[i], NULL);
+    }
+    free(stress->threads);
+    return;
+}
+
+/*----------------------------------------------------------------------------
+ * Trace Trigger
+ *----------------------------------------------------------------------------*/
+
+/* Opens the kernel tracer's files ahead of the test, so that stopping it
+ * costs no more than a write. */
+static int open_tracer(struct latency_test *test)
+{
+    int i;
+    char path[128];
+
+    for (i = 0; i < (int)(sizeof(trace_dirs) / sizeof(trace_dirs[0])); i++)
+    {
+        snprintf(path, sizeof(path), "%s/tracing_on", trace_dirs[i]);
+        test->trace_on_fd = open(path, O_WRONLY);
+        if (test->trace_on_fd < 0) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/trace_marker", trace_dirs[i]);
+        test->trace_marker_fd = open(path, O_WRONLY);
+        return 0;
+    }
+
+    return -errno;
+}
+
+// Marks the latency in the trace, and stops the tracer
+static void trigger_tracer(struct latency_test *test, uint64_t latency_ns)
+{
+    int len;
+    char marker[96];
+
+    if (test->trace_marker_fd >= 0) {
+        len = snprintf(marker, sizeof(marker), "axidma_latency: hit %llu us, "
+                "over the %d us bound\n",
+                (unsigned long long)(latency_ns / 1000), test->break_us);
+        (void)!write(test->trace_marker_fd, marker, len);
+    }
+    if (test->trace_on_fd >= 0) {
+        (void)!write(test->trace_on_fd, "0", 1);
+    }
+    return;
+}
+
+// Closes the kernel tracer's files
+static void close_tracer(struct latency_test *test)
+{
+    if (test->trace_marker_fd >= 0) {
+        assert(close(test->trace_marker_fd) == 0);
+    }
+    if (test->trace_on_fd >= 0) {
+        assert(close(test->trace_on_fd) == 0);
+    }
+    return;
+}
+
+/*----------------------------------------------------------------------------
+ * Latency Measurement
+ *----------------------------------------------------------------------------*/
+
+// Converts a time to nanoseconds
+static uint64_t timespec_ns(const struct timespec *time)
+{
+    return (uint64_t)time->tv_sec * 1000000000 + time->tv_nsec;
+}
+
+// Counts a latency in the histogram and the statistics
+static void record_latency(struct latency_test *test, uint64_t latency_ns,
+        uint64_t wakeup_ns)
+{
+    uint64_t bucket;
+
+    bucket = latency_ns / 1000;
+    if (bucket < (uint64_t)test->histogram_us) {
+        test->histogram[bucket] += 1;
+    } else {
+        test->overflows += 1;
+    }
+
+    if (test->samples == 0 || latency_ns < test->min_ns) {
+        test->min_ns = latency_ns;
+    }
+    if (latency_ns > test->max_ns) {
+        test->max_ns = latency_ns;
+        test->max_sample = test->samples;
+    }
+    if (wakeup_ns > test->max_wakeup_ns) {
+        test->max_wakeup_ns = wakeup_ns;
+    }
+    test->total_ns += latency_ns;
+    test->samples += 1;
+}
+
+/* Wakes up on each period, and times a transfer through the channels from
+ * when the thread should have woken up to when the transfer completes. The
+ * periods are absolute, so a late wakeup doesn't push back the ones after
+ * it, though periods missed entirely are skipped. */
+static void *measure_thread(void *arg)
+{
+    uint64_t period_ns, next_ns, wakeup_ns, done_ns, end_ns;
+    struct timespec next, now;
+    struct latency_test *test;
+
+    test = arg;
+    period_ns = (uint64_t)test->interval_us * 1000;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    next_ns = timespec_ns(&now) + period_ns;
+    end_ns = timespec_ns(&now) + (uint64_t)test->duration * 1000000000;
+
+    while (running && (test->loops == 0 ||
+                       test->samples < (uint64_t)test->loops))
+    {
+        next.tv_sec = next_ns / 1000000000;
+        next.tv_nsec = next_ns % 1000000000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next,
+                               NULL) == EINTR)
+        {
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        wakeup_ns = timespec_ns(&now) - next_ns;
+
+        if (axidma_twoway_transfer(test->dev, test->tx_channel, test->tx_buf,
+                test->size, NULL, test->rx_channel, test->rx_buf, test->size,
+                NULL, true) < 0) {
+            test->error = errno;
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        done_ns = timespec_ns(&now);
+        record_latency(test, done_ns - next_ns, wakeup_ns);
+
+        if (test->break_us > 0 &&
+                done_ns - next_ns > (uint64_t)test->break_us * 1000) {
+            trigger_tracer(test, done_ns - next_ns);
+            test->break_ns = done_ns - next_ns;
+            break;
+        } else if (test->duration > 0 && done_ns >= end_ns) {
+            break;
+        }
+
+        // Move on to the next period that hasn't started yet
+        do
+        {
+            next_ns += period_ns;
+        } while (next_ns <= done_ns);
+    }
+
+    __atomic_store_n(&test->finished, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* Starts the measurement thread under SCHED_FIFO at the test's priority,
+ * pinned to its CPU, with no signals delivered to it. */
+static int start_measurement(struct latency_test *test, pthread_t *thread)
+{
+    int rc;
+    cpu_set_t cpus;
+    sigset_t mask, old_mask;
+    pthread_attr_t attr;
+    struct sched_param param;
+
+    pthread_attr_init(&attr);
+    if (test->priority > 0) {
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = test->priority;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+    if (test->cpu >= 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(test->cpu, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+
+    sigfillset(&mask);
+    pthread_sigmask(SIG_SETMASK, &mask, &old_mask);
+    rc = pthread_create(thread, &attr, measure_thread, test);
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    pthread_attr_destroy(&attr);
+
+    return -rc;
+}
+
+/*----------------------------------------------------------------------------
+ * Reporting
+ *----------------------------------------------------------------------------*/
+
+/* Gets the latency that the given fraction of the samples are within, to the
+ * microsecond of the histogram's buckets. Returns -1 if it lies past the end
+ * of the histogram. */
+static long percentile_us(const struct latency_test *test, double fraction)
+{
+    int bucket;
+    uint64_t count, target;
+
+    target = (uint64_t)(fraction * test->samples + 0.999999);
+    count = 0;
+    for (bucket = 0; bucket < test->histogram_us; bucket++)
+    {
+        count += test->histogram[bucket];
+        if (count >= target) {
+            return bucket;
+        }
+    }
+    return -1;
+}
+
+// Prints the percentile, or the histogram's bound if it lies past it
+static void print_percentile(const struct latency_test *test, const char *name,
+        double fraction)
+{
+    long latency;
+
+    latency = percentile_us(test, fraction);
+    if (latency < 0) {
+        printf("\t%s Latency: > %d us\n", name, test->histogram_us);
+    } else {
+        printf("\t%s Latency: %ld us\n", name, latency);
+    }
+}
+
+// Writes the histogram out for plotting, one bucket per line
+static int write_histogram(const struct latency_test *test, const char *path)
+{
+    int bucket;
+    FILE *file;
+
+    file = (strcmp(path, "-") == 0) ? stdout : fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Unable to open '%s' for the histogram: %s.\n",
+                path, strerror(errno));
+        return -errno;
+    }
+
+    fprintf(file, "# latency_us count\n");
+    for (bucket = 0; bucket < test->histogram_us; bucket++)
+    {
+        fprintf(file, "%d %llu\n", bucket,
+                (unsigned long long)test->histogram[bucket]);
+    }
+    fprintf(file, "# samples %llu\n", (unsigned long long)test->samples);
+    fprintf(file, "# overflows %llu\n", (unsigned long long)test->overflows);
+    fprintf(file, "# max_us %llu\n", (unsigned long long)(test->max_ns / 1000));
+
+    if (file != stdout) {
+        fclose(file);
+    }
+    return 0;
+}
+
+// Prints the statistics of the latencies
+static void print_results(const struct latency_test *test)
+{
+    if (test->samples == 0) {
+        printf("No transfers completed.\n");
+        return;
+    }
+
+    printf("AXI DMA Latency Results:\n");
+    printf("\tSamples: %llu\n", (unsigned long long)test->samples);
+    printf("\tMinimum Latency: %.2f us\n", test->min_ns / 1e3);
+    printf("\tAverage Latency: %.2f us\n",
+           (double)test->total_ns / test->samples / 1e3);
+    printf("\tMaximum Latency: %.2f us (sample %llu)\n", test->max_ns / 1e3,
+           (unsigned long long)test->max_sample);
+    printf("\tMaximum Wakeup Latency: %.2f us\n", test->max_wakeup_ns / 1e3);
+    print_percentile(test, "99%", 0.99);
+    print_percentile(test, "99.9%", 0.999);
+    print_percentile(test, "99.99%", 0.9999);
+    print_percentile(test, "99.999%", 0.99999);
+    printf("\tHistogram Overflows: %llu\n",
+           (unsigned long long)test->overflows);
+    if (test->break_ns > 0) {
+        printf("\tStopped%s on a %.2f us latency, over the %d us bound.\n",
+               test->trace_on_fd >= 0 ? " the tracer" : "",
+               test->break_ns / 1e3, test->break_us);
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * Main
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    int rc, polls;
+    char *histogram_path;
+    pthread_t thread;
+    struct timespec pause;
+    struct latency_test test;
+    struct stress stress;
+    const array_t *tx_chans, *rx_chans;
+
+    // Parse the input arguments
+    memset(&test, 0, sizeof(test));
+    memset(&stress, 0, sizeof(stress));
+    test.trace_on_fd = -1;
+    test.trace_marker_fd = -1;
+    if (parse_args(argc, argv, &test, &stress, &histogram_path) < 0) {
+        rc = 1;
+        goto ret;
+    }
+
+    test.histogram = calloc(test.histogram_us, sizeof(*test.histogram));
+    if (test.histogram == NULL) {
+        rc = 1;
+        goto ret;
+    }
+    if (test.break_us > 0 && open_tracer(&test) < 0) {
+        fprintf(stderr, "Warning: Unable to open the kernel tracer, the test "
+                "will end on the bound without stopping it.\n");
+    }
+
+    // Initialize the AXI DMA device, and pick the channels
+    test.dev = axidma_init();
+    if (test.dev == NULL) {
+        fprintf(stderr, "Error: Failed to initialize the AXI DMA device.\n");
+        rc = 1;
+        goto close_tracer;
+    }
+    tx_chans = axidma_get_dma_tx(test.dev);
+    rx_chans = axidma_get_dma_rx(test.dev);
+    if (tx_chans->len < 1 || rx_chans->len < 1) {
+        fprintf(stderr, "Error: No transmit or receive channels were "
+                "found.\n");
+        rc = 1;
+        goto destroy_axidma;
+    }
+    if (test.tx_channel == -1) {
+        test.tx_channel = tx_chans->data[0];
+    }
+    if (test.rx_channel == -1) {
+        test.rx_channel = rx_chans->data[0];
+    }
+
+    test.tx_buf = axidma_malloc(test.dev, test.size);
+    test.rx_buf = axidma_malloc(test.dev, test.size);
+    if (test.tx_buf == NULL || test.rx_buf == NULL) {
+        fprintf(stderr, "Unable to allocate the DMA buffers.\n");
+        rc = 1;
+        goto free_bufs;
+    }
+    memset(test.tx_buf, 0xa5, test.size);
+    memset(test.rx_buf, 0, test.size);
+
+    // Keep the test's memory from being paged out, including what it touches
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        fprintf(stderr, "Warning: Unable to lock the program's memory: %s.\n",
+                strerror(errno));
+    }
+
+    printf("AXI DMA Latency Parameters:\n");
+    printf("\tTransmit Channel: %d\n", test.tx_channel);
+    printf("\tReceive Channel: %d\n", test.rx_channel);
+    printf("\tTransfer Size: %zu bytes\n", test.size);
+    printf("\tInterval: %d us\n", test.interval_us);
+    printf("\tScheduling: %s, priority %d, CPU %s\n",
+           test.priority > 0 ? "SCHED_FIFO" : "SCHED_OTHER", test.priority,
+           test.cpu >= 0 ? "pinned" : "any");
+    printf("\tStressors: %d CPU, %d memory, %d IRQ\n\n", stress.cpu_threads,
+           stress.memory_threads, stress.irq_threads);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGQUIT, signal_handler);
+    if (start_stress(&stress) < 0) {
+        fprintf(stderr, "Warning: Only %d of the stress threads started.\n",
+                stress.num_threads);
+    }
+    rc = start_measurement(&test, &thread);
+    if (rc < 0) {
+        fprintf(stderr, "Error: Unable to start the measurement thread: %s.%s"
+                "\n", strerror(-rc), rc == -EPERM ? " Real-time scheduling "
+                "needs root, or -p 0." : "");
+        running = false;
+        stop_stress(&stress);
+        rc = 1;
+        goto free_bufs;
+    }
+
+    // Report progress until the test ends, or is interrupted
+    pause.tv_sec = 0;
+    pause.tv_nsec = STATUS_POLL_NS;
+    for (polls = 1; !__atomic_load_n(&test.finished, __ATOMIC_ACQUIRE);
+         polls++)
+    {
+        nanosleep(&pause, NULL);
+        if (!test.quiet && polls % STATUS_POLLS == 0) {
+            printf("\rSamples: %llu, Max: %llu us    ",
+                   (unsigned long long)test.samples,
+                   (unsigned long long)(test.max_ns / 1000));
+            fflush(stdout);
+        }
+    }
+    pthread_join(thread, NULL);
+    running = false;
+    stop_stress(&stress);
+    if (!test.quiet) {
+        printf("\n\n");
+    }
+
+    if (test.error != 0) {
+        fprintf(stderr, "Error: Transfer %llu failed: %s.\n",
+                (unsigned long long)test.samples, strerror(test.error));
+    }
+    print_results(&test);
+    rc = (test.error != 0) ? 1 : 0;
+    if (histogram_path != NULL && write_histogram(&test, histogram_path) < 0) {
+        rc = 1;
+    }
+
+free_bufs:
+    if (test.rx_buf != NULL) {
+        axidma_free(test.dev, test.rx_buf, test.size);
+    }
+    if (test.tx_buf != NULL) {
+        axidma_free(test.dev, test.tx_buf, test.size);
+    }
+destroy_axidma:
+    axidma_destroy(test.dev);
+close_tracer:
+    close_tracer(&test);
+    free(test.histogram);
+ret:
+    return rc;
+}
@@ -0,0 +1,433 @@
+/**
+ * @file axidma_replay.c
+ * @date Sunday, October 18, 2026 at 04:02:15 AM EDT
+ *
+ * This program feeds a capture file written by axidma_capture back through a
+ * DMA transmit channel, either with the timing that the packets were
+ * captured with, or as fast as the channel will take them.
+ *
+ * The capture is mapped, and each packet is copied, or decompressed, from the
+ * mapping into a free DMA buffer ahead of its time, so that it can be queued
+ * on the channel as soon as its time comes. A transfer stays queued on each
+ * buffer until the channel completes it.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include <string.h>             // Memory setting and copying
+#include <getopt.h>             // Option parsing
+#include <errno.h>              // Error codes
+#include <signal.h>             // Signal handling functions
+#include <time.h>               // Clocks for the timing
+
+#ifdef AXIDMA_LZ4
+#include <lz4.h>                // LZ4 decompression
+#endif
+
+#include "util.h"               // Miscellaneous utilities
+#include "conversion.h"         // Convert bytes to MiBs
+#include "capture.h"            // Capture file format
+#include "libaxidma.h"          // Interface to the AXI DMA library
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The default number of DMA buffers
+#define DEFAULT_NUM_BUFS        16
+
+// How long to sleep between checks for a free buffer, in ns
+#define REPLAY_POLL_NS          20000
+
+// The state of the replay
+struct replay {
+    axidma_dev_t dev;           // The AXI DMA device
+    int channel;                // The channel the packets are sent on
+    struct capture_file cap;    // The capture being replayed
+    int num_bufs;               // The number of DMA buffers
+    char **bufs;                // The ring of DMA buffers
+    size_t buf_size;            // The size of each DMA buffer
+    bool timed;                 // Keep to the capture's timing
+    int loops;                  // The number of times to replay the capture
+    unsigned int issued;        // Transfers queued on the channel
+    unsigned int done;          // Transfers completed, set by the callback
+    uint64_t packets;           // Packets sent
+    uint64_t bytes;             // Bytes sent
+    uint64_t late_total_ns;     // The sum of how late each packet was sent
+    uint64_t late_max_ns;       // The latest that a packet was sent
+};
+
+/* Indicates if the program is still running. Used to communicate between the
+ * signal handlers and the main thread. */
+static volatile bool running = true;
+
+static void signal_handler(int signal)
+{
+    switch (signal) {
+        case SIGINT:
+        case SIGTERM:
+        case SIGQUIT:
+            running = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * Command Line Interface
+ *----------------------------------------------------------------------------*/
+
+// Prints the usage for this program
+static void print_usage(bool help)
+{
+    FILE* stream = (help) ? stdout : stderr;
+
+    fprintf(stream, "Usage: axidma_replay <capture path> [-t <DMA tx "
+            "channel>] [-n <buffers>] [-l <loops>] [-f].\n");
+    if (!help) {
+        return;
+    }
+
+    fprintf(stream, "\t<capture path>:\t\tThe path to the capture file to "
+            "replay, as written by axidma_capture.\n");
+    fprintf(stream, "\t-t <DMA tx channel>:\tThe device id of the DMA channel "
+            "to send the packets on. Default is to use the lowest numbered "
+            "channel available.\n");
+    fprintf(stream, "\t-n <buffers>:\t\tThe number of DMA buffers to queue "
+            "packets in. Default is %d.\n", DEFAULT_NUM_BUFS);
+    fprintf(stream, "\t-l <loops>:\t\tThe number of times to replay the "
+            "capture. Default is 1.\n");
+    fprintf(stream, "\t-f:\t\t\tSend the packets as fast as possible, rather "
+            "than with the timing they were captured with.\n");
+    return;
+}
+
+// Parses the command line arguments
+static int parse_args(int argc, char **argv, struct replay *replay,
+        char **path)
+{
+    char option;
+    int int_arg;
+
+    // Set the default values for the arguments
+    replay->channel = -1;
+    replay->num_bufs = DEFAULT_NUM_BUFS;
+    replay->loops = 1;
+    replay->timed = true;
+
+    while ((option = getopt(argc, argv, "t:n:l:fh")) != (char)-1)
+    {
+        switch (option)
+        {
+            // Parse the transmit channel device id
+            case 't':
+                if (parse_int(option, optarg, &int_arg) < 0) {
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                replay->channel = int_arg;
+                break;
+
+            // Parse the number of buffers
+            case 'n':
+                if (parse_int(option, optarg, &int_arg) < 0 || int_arg <= 0) {
+                    fprintf(stderr, "Error: The number of buffers must be "
+                            "positive.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                replay->num_bufs = int_arg;
+                break;
+
+            // Parse the number of times to replay the capture
+            case 'l':
+                if (parse_int(option, optarg, &int_arg) < 0 || int_arg <= 0) {
+                    fprintf(stderr, "Error: The number of loops must be "
+                            "positive.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                replay->loops = int_arg;
+                break;
+
+            case 'f':
+                replay->timed = false;
+                break;
+
+            case 'h':
+                print_usage(true);
+                exit(0);
+
+            default:
+                print_usage(false);
+                return -EINVAL;
+        }
+    }
+
+    // Check that there is exactly the capture path left
+    if (optind != argc-1) {
+        fprintf(stderr, "Error: Expected exactly one capture path.\n");
+        print_usage(false);
+        return -EINVAL;
+    }
+
+    *path = argv[optind];
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Replaying
+ *----------------------------------------------------------------------------*/
+
+// Gets the current time in nanoseconds
+static uint64_t get_time_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// Counts the completed transfer, called from the signal handler
+static void send_done(int channel_id, void *data)
+{
+    struct replay *replay;
+
+    (void)channel_id;
+    replay = data;
+    __atomic_add_fetch(&replay->done, 1, __ATOMIC_RELEASE);
+    return;
+}
+
+/* Waits until fewer than the given number of transfers are queued. The
+ * completion signals interrupt the sleep, so this usually returns as soon as
+ * one completes. */
+static void wait_queued(struct replay *replay, unsigned int queued)
+{
+    struct timespec pause;
+
+    pause.tv_sec = 0;
+    pause.tv_nsec = REPLAY_POLL_NS;
+    while (running && replay->issued -
+           __atomic_load_n(&replay->done, __ATOMIC_ACQUIRE) >= queued)
+    {
+        nanosleep(&pause, NULL);
+    }
+}
+
+// Copies the packet from the capture into the buffer, decompressing it
+static int load_packet(struct replay *replay, uint64_t packet, char *buf)
+{
+    const struct capture_entry *entry;
+
+    entry = &replay->cap.index[packet];
+    if (entry->stored_length == entry->length) {
+        memcpy(buf, capture_packet(&replay->cap, packet), entry->length);
+        return 0;
+    }
+
+#ifdef AXIDMA_LZ4
+    if (LZ4_decompress_safe(capture_packet(&replay->cap, packet), buf,
+            entry->stored_length, entry->length) == (int)entry->length) {
+        return 0;
+    }
+    fprintf(stderr, "Error: Packet %llu of the capture is corrupt.\n",
+            (unsigned long long)packet);
+#else
+    fprintf(stderr, "Error: The capture is compressed, and this build has no "
+            "LZ4 support. Rebuild with AXIDMA_LZ4 defined to replay it.\n");
+#endif
+    return -EINVAL;
+}
+
+/* Waits until the packet's time, as an offset from the start of the replay,
+ * and counts how late it was. The completion signals interrupt the sleep,
+ * so it is resumed until the time has passed. */
+static void wait_until(struct replay *replay, uint64_t target_ns)
+{
+    uint64_t now_ns;
+    struct timespec target;
+
+    target.tv_sec = target_ns / 1000000000;
+    target.tv_nsec = target_ns % 1000000000;
+    while (running && clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target,
+                                      NULL) == EINTR)
+    {
+    }
+
+    now_ns = get_time_ns();
+    if (now_ns > target_ns) {
+        replay->late_total_ns += now_ns - target_ns;
+        if (now_ns - target_ns > replay->late_max_ns) {
+            replay->late_max_ns = now_ns - target_ns;
+        }
+    }
+}
+
+/* Sends every packet of the capture through the channel, the given number of
+ * times. When keeping to the capture's timing, each loop starts where the
+ * last one left off. */
+static int replay_capture(struct replay *replay)
+{
+    int loop, rc;
+    char *buf;
+    uint64_t i, start_ns, first_ns;
+    const struct capture_entry *entry;
+
+    first_ns = replay->cap.index[0].timestamp_ns;
+    for (loop = 0; running && loop < replay->loops; loop++)
+    {
+        start_ns = get_time_ns();
+        for (i = 0; running && i < replay->cap.header->num_packets; i++)
+        {
+            entry = &replay->cap.index[i];
+            wait_queued(replay, replay->num_bufs);
+            buf = replay->bufs[replay->issued % replay->num_bufs];
+            rc = load_packet(replay, i, buf);
+            if (rc < 0) {
+                return rc;
+            }
+
+            if (replay->timed) {
+                wait_until(replay, start_ns + entry->timestamp_ns - first_ns);
+            }
+            if (axidma_oneway_transfer(replay->dev, replay->channel, buf,
+                    entry->length, false) < 0) {
+                fprintf(stderr, "Error: Sending packet %llu failed: %s.\n",
+                        (unsigned long long)i, strerror(errno));
+                return -errno;
+            }
+            replay->issued += 1;
+            replay->packets += 1;
+            replay->bytes += entry->length;
+        }
+    }
+
+    // Let the last packets go out, unless interrupted
+    wait_queued(replay, 1);
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Main
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    int i, rc;
+    char *path;
+    uint64_t start_ns;
+    double elapsed;
+    struct replay replay;
+    const array_t *tx_chans;
+
+    // Parse the input arguments
+    memset(&replay, 0, sizeof(replay));
+    if (parse_args(argc, argv, &replay, &path) < 0) {
+        rc = 1;
+        goto ret;
+    }
+
+    rc = capture_map(path, &replay.cap);
+    if (rc < 0) {
+        fprintf(stderr, "Error: Unable to open the capture '%s': %s.\n", path,
+                rc == -EINVAL ? "Not a valid capture file" : strerror(-rc));
+        rc = 1;
+        goto ret;
+    } else if (replay.cap.header->num_packets == 0) {
+        fprintf(stderr, "Error: The capture holds no packets. It may not "
+                "have been closed.\n");
+        rc = 1;
+        goto unmap_capture;
+    }
+
+    // Initialize the AXI DMA device, and pick the channel
+    replay.dev = axidma_init();
+    if (replay.dev == NULL) {
+        fprintf(stderr, "Error: Failed to initialize the AXI DMA device.\n");
+        rc = 1;
+        goto unmap_capture;
+    }
+    tx_chans = axidma_get_dma_tx(replay.dev);
+    if (tx_chans->len < 1) {
+        fprintf(stderr, "Error: No transmit channels were found.\n");
+        rc = 1;
+        goto destroy_axidma;
+    }
+    if (replay.channel == -1) {
+        replay.channel = tx_chans->data[0];
+    }
+
+    // Allocate buffers big enough for the longest packet
+    replay.buf_size = replay.cap.header->max_length;
+    replay.bufs = calloc(replay.num_bufs, sizeof(*replay.bufs));
+    if (replay.bufs == NULL) {
+        rc = 1;
+        goto destroy_axidma;
+    }
+    for (i = 0; i < replay.num_bufs; i++)
+    {
+        replay.bufs[i] = axidma_malloc(replay.dev, replay.buf_size);
+        if (replay.bufs[i] == NULL) {
+            fprintf(stderr, "Unable to allocate the DMA buffers.\n");
+            rc = 1;
+            goto free_bufs;
+        }
+    }
+
+    printf("AXI DMA Replay Info:\n");
+    printf("\tTransmit Channel: %d\n", replay.channel);
+    printf("\tPackets: %llu\n",
+           (unsigned long long)replay.cap.header->num_packets);
+    printf("\tCompressed: %s\n",
+           replay.cap.header->flags & CAPTURE_FLAG_LZ4 ? "Yes" : "No");
+    printf("\tTiming: %s\n", replay.timed ? "Original" : "As fast as possible");
+    printf("\tLoops: %d\n\n", replay.loops);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGQUIT, signal_handler);
+    axidma_set_callback(replay.dev, replay.channel, send_done, &replay);
+    start_ns = get_time_ns();
+    rc = replay_capture(&replay);
+    elapsed = (get_time_ns() - start_ns) / 1e9;
+    if (replay.issued != __atomic_load_n(&replay.done, __ATOMIC_ACQUIRE)) {
+        axidma_stop_transfer(replay.dev, replay.channel);
+    }
+    axidma_set_callback(replay.dev, replay.channel, NULL, NULL);
+
+    printf("AXI DMA Replay Results:\n");
+    printf("\tPackets Sent: %llu (%.2f MiB)\n",
+           (unsigned long long)replay.packets, BYTE_TO_MIB(replay.bytes));
+    printf("\tRate: %.2f packets/s, %.2f MiB/s\n", replay.packets / elapsed,
+           BYTE_TO_MIB(replay.bytes) / elapsed);
+    if (replay.timed && replay.packets > 0) {
+        printf("\tLateness: %.2f us average, %.2f us max\n",
+               replay.late_total_ns / 1e3 / replay.packets,
+               replay.late_max_ns / 1e3);
+    }
+    rc = (rc < 0) ? 1 : 0;
+
+free_bufs:
+    for (i = 0; i < replay.num_bufs; i++)
+    {
+        if (replay.bufs[i] != NULL) {
+            axidma_free(replay.dev, replay.bufs[i], replay.buf_size);
+        }
+    }
+    free(replay.bufs);
+destroy_axidma:
+    axidma_destroy(replay.dev);
+unmap_capture:
+    capture_unmap(&replay.cap);
+ret:
+    return rc;
+}
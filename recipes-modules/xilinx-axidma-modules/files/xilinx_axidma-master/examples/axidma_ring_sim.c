@@ -0,0 +1,689 @@
+/**
+ * @file axidma_ring_sim.c
+ * @date Monday, October 19, 2026 at 09:40:12 AM EDT
+ *
+ * This program tests the library's userspace rings against a simulated AXI
+ * DMA core, so that they can be checked without the hardware or the driver.
+ * It needs no AXI DMA device.
+ *
+ * The simulation models the registers of a transmit and a receive channel,
+ * and a thread plays the part of their scatter-gather engines. Like the
+ * hardware, each engine starts at its current descriptor when it is run, and
+ * works through the chained descriptors until it has completed the one its
+ * tail register points at. The engines are looped back to each other, so
+ * each packet sent on the transmit ring arrives in the receive ring.
+ *
+ * The test sends packets of varying lengths through the rings, checking that
+ * each one arrives intact, with its length, in order. It then checks that a
+ * full ring refuses another buffer, and that an engine halted on an error is
+ * reported.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include <string.h>             // Memory setting and copying
+#include <getopt.h>             // Option parsing
+#include <errno.h>              // Error codes
+#include <pthread.h>            // The simulated engines' thread
+#include <sched.h>              // Yielding the processor
+
+#include "util.h"               // Miscellaneous utilities
+#include "libaxidma.h"          // Interface to the AXI DMA library
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The default number of buffers in each ring, their size, and packets to send
+#define DEFAULT_NUM_BUFFERS     16
+#define DEFAULT_BUFFER_SIZE     4096
+#define DEFAULT_NUM_PACKETS     10000
+
+// The time to wait for a ring's buffer before failing the test, in ms
+#define RING_TIMEOUT_MS         1000
+
+/* The simulated bus addresses of the transmit and receive rings' memory. The
+ * low word of a descriptor's address must not be zero, which the simulated
+ * engines use for a tail register that they have reached. */
+#define SIM_TX_BASE             0x40000000ULL
+#define SIM_RX_BASE             0x50000000ULL
+
+// The number of packets that the loopback between the engines can hold
+#define SIM_FIFO_DEPTH          4
+
+// The channel registers, as 32-bit word offsets (see Xilinx PG021)
+#define SIM_DMACR               (0x00 / 4)
+#define SIM_DMASR               (0x04 / 4)
+#define SIM_CURDESC             (0x08 / 4)
+#define SIM_CURDESC_MSB         (0x0C / 4)
+#define SIM_TAILDESC            (0x10 / 4)
+#define SIM_TAILDESC_MSB        (0x14 / 4)
+#define SIM_NUM_REGS            (0x30 / 4)
+
+// The register fields that the simulation uses
+#define SIM_DMACR_RS            (1 << 0)
+#define SIM_DMASR_HALTED        (1 << 0)
+#define SIM_DMASR_IDLE          (1 << 1)
+#define SIM_DMASR_SLVERR        (1 << 5)
+#define SIM_DMASR_SGDECERR      (1 << 10)
+#define SIM_DMASR_ERRORS        0x770
+
+// The descriptor fields, as 32-bit word offsets, and their bits
+#define SIM_DESC_NXTDESC        (0x00 / 4)
+#define SIM_DESC_NXTDESC_MSB    (0x04 / 4)
+#define SIM_DESC_BUFFER         (0x08 / 4)
+#define SIM_DESC_BUFFER_MSB     (0x0C / 4)
+#define SIM_DESC_CONTROL        (0x18 / 4)
+#define SIM_DESC_STATUS         (0x1C / 4)
+#define SIM_DESC_SOF            (1 << 27)
+#define SIM_DESC_EOF            (1 << 26)
+#define SIM_DESC_CMPLT          (1U << 31)
+#define SIM_DESC_LENGTH         ((1 << 26) - 1)
+
+// A packet in flight between the simulated engines
+struct sim_packet {
+    size_t length;              // The length of the packet
+    uint8_t *data;              // The packet's data
+};
+
+// A simulated DMA channel, and the memory that its ring lives in
+struct sim_chan {
+    volatile uint32_t regs[SIM_NUM_REGS];   // The channel's registers
+    enum axidma_dir dir;        // The direction of the channel
+    uint8_t *mem;               // The memory holding the ring
+    uint64_t base;              // The bus address of the memory
+    size_t size;                // The size of the memory
+    bool running;               // The engine has been started
+    uint64_t next_desc;         // The next descriptor the engine fetches
+    bool fail_next;             // Halt on an error at the next descriptor
+};
+
+// The simulated AXI DMA core, with its channels looped back
+struct sim_core {
+    struct sim_chan tx;         // The transmit (MM2S) channel
+    struct sim_chan rx;         // The receive (S2MM) channel
+    struct sim_packet fifo[SIM_FIFO_DEPTH];     // The loopback's packets
+    int fifo_head;              // The oldest packet in the loopback
+    int fifo_count;             // The number of packets in the loopback
+    pthread_mutex_t lock;       // Serializes the engines with the test
+    volatile bool stop;         // Stops the engines' thread
+    pthread_t thread;           // The engines' thread
+};
+
+// The parameters of the test
+struct sim_test {
+    int num_buffers;            // The number of buffers in each ring
+    size_t buffer_size;         // The size of each buffer
+    int num_packets;            // The number of packets to send
+};
+
+/*----------------------------------------------------------------------------
+ * Command Line Interface
+ *----------------------------------------------------------------------------*/
+
+// Prints the usage for this program
+static void print_usage(bool help)
+{
+    FILE* stream = (help) ? stdout : stderr;
+
+    fprintf(stream, "Usage: axidma_ring_sim [-n <number of buffers>] "
+            "[-s <buffer size>] [-p <number of packets>].\n");
+    if (!help) {
+        return;
+    }
+
+    fprintf(stream, "\t-n <number of buffers>:\tThe number of buffers in "
+            "each ring. Default is %d.\n", DEFAULT_NUM_BUFFERS);
+    fprintf(stream, "\t-s <buffer size>:\tThe size of each buffer in bytes. "
+            "Packets are up to this long. Default is %d.\n",
+            DEFAULT_BUFFER_SIZE);
+    fprintf(stream, "\t-p <number of packets>:\tThe number of packets to "
+            "send through the rings. Default is %d.\n", DEFAULT_NUM_PACKETS);
+    return;
+}
+
+static int parse_args(int argc, char **argv, struct sim_test *test)
+{
+    char option;
+    int int_arg, rc;
+
+    test->num_buffers = DEFAULT_NUM_BUFFERS;
+    test->buffer_size = DEFAULT_BUFFER_SIZE;
+    test->num_packets = DEFAULT_NUM_PACKETS;
+
+    while ((option = getopt(argc, argv, "n:s:p:h")) != (char)-1)
+    {
+        switch (option)
+        {
+            // Parse the number of buffers in each ring
+            case 'n':
+                rc = parse_int(option, optarg, &int_arg);
+                if (rc < 0 || int_arg < AXIDMA_RING_MIN_DESCRIPTORS ||
+                        int_arg > AXIDMA_RING_MAX_DESCRIPTORS) {
+                    fprintf(stderr, "Error: Number of buffers must be between "
+                            "%d and %d.\n", AXIDMA_RING_MIN_DESCRIPTORS,
+                            AXIDMA_RING_MAX_DESCRIPTORS);
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                test->num_buffers = int_arg;
+                break;
+
+            // Parse the size of each buffer
+            case 's':
+                rc = parse_int(option, optarg, &int_arg);
+                if (rc < 0 || int_arg <= 0) {
+                    fprintf(stderr, "Error: Buffer size must be positive.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                test->buffer_size = int_arg;
+                break;
+
+            // Parse the number of packets to send
+            case 'p':
+                rc = parse_int(option, optarg, &int_arg);
+                if (rc < 0 || int_arg <= 0) {
+                    fprintf(stderr, "Error: Number of packets must be "
+                            "positive.\n");
+                    print_usage(false);
+                    return -EINVAL;
+                }
+                test->num_packets = int_arg;
+                break;
+
+            case 'h':
+                print_usage(true);
+                exit(0);
+
+            default:
+                print_usage(false);
+                return -EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Simulated AXI DMA Core
+ *----------------------------------------------------------------------------*/
+
+// Gets the memory at the bus address, or NULL if it's outside the channel's
+static volatile uint32_t *sim_translate(struct sim_chan *chan, uint64_t addr,
+                                        size_t size)
+{
+    if (addr < chan->base || addr - chan->base + size > chan->size) {
+        return NULL;
+    }
+    return (volatile uint32_t *)(chan->mem + (addr - chan->base));
+}
+
+// Halts the channel's engine with the given error
+static void sim_halt(struct sim_chan *chan, uint32_t error)
+{
+    chan->regs[SIM_DMASR] |= error | SIM_DMASR_HALTED;
+}
+
+/* Moves a packet between the descriptor's buffer and the loopback. Returns
+ * false if the engine has to wait for the loopback. */
+static bool sim_transfer(struct sim_core *core, struct sim_chan *chan,
+                         volatile uint32_t *desc, uint8_t *buffer,
+                         size_t length, uint32_t *status)
+{
+    struct sim_packet *packet;
+
+    if (chan->dir == AXIDMA_WRITE) {
+        if (core->fifo_count == SIM_FIFO_DEPTH) {
+            return false;
+        }
+
+        // A transmitted packet must be framed by its single descriptor
+        if ((desc[SIM_DESC_CONTROL] & (SIM_DESC_SOF | SIM_DESC_EOF)) !=
+                (SIM_DESC_SOF | SIM_DESC_EOF)) {
+            fprintf(stderr, "Error: A transmit descriptor is not framed as "
+                    "a single packet.\n");
+            sim_halt(chan, SIM_DMASR_SLVERR);
+            return false;
+        }
+
+        packet = &core->fifo[(core->fifo_head + core->fifo_count) %
+                             SIM_FIFO_DEPTH];
+        memcpy(packet->data, buffer, length);
+        packet->length = length;
+        core->fifo_count += 1;
+        *status = length;
+        return true;
+    }
+
+    // A receive takes the whole packet, or as much as fits in the buffer
+    if (core->fifo_count == 0) {
+        return false;
+    }
+    packet = &core->fifo[core->fifo_head];
+    if (packet->length < length) {
+        length = packet->length;
+    }
+    memcpy(buffer, packet->data, length);
+    core->fifo_head = (core->fifo_head + 1) % SIM_FIFO_DEPTH;
+    core->fifo_count -= 1;
+    *status = length | SIM_DESC_SOF | SIM_DESC_EOF;
+    return true;
+}
+
+/* Runs the channel's engine for one descriptor, if it has one to do. Returns
+ * true if it completed a descriptor. */
+static bool sim_step(struct sim_core *core, struct sim_chan *chan)
+{
+    uint32_t status;
+    uint64_t tail, buffer_addr;
+    size_t length;
+    volatile uint32_t *desc;
+    uint8_t *buffer;
+
+    // A stopped engine restarts from its current descriptor when it's run
+    if (!(chan->regs[SIM_DMACR] & SIM_DMACR_RS)) {
+        chan->regs[SIM_DMASR] |= SIM_DMASR_HALTED;
+        chan->running = false;
+        return false;
+    } else if (chan->regs[SIM_DMASR] & SIM_DMASR_ERRORS) {
+        return false;
+    } else if (!chan->running) {
+        chan->next_desc = ((uint64_t)chan->regs[SIM_CURDESC_MSB] << 32) |
+                          chan->regs[SIM_CURDESC];
+        chan->running = true;
+        chan->regs[SIM_DMASR] &= ~SIM_DMASR_HALTED;
+    }
+
+    /* The engine is idle once it has completed the tail descriptor. On the
+     * hardware, it's writing the tail register that wakes the engine, even
+     * with the same descriptor as before, so the engine takes the register
+     * back to zero when it reaches the tail, and a write from the ring makes
+     * it nonzero again. */
+    tail = ((uint64_t)chan->regs[SIM_TAILDESC_MSB] << 32) |
+           chan->regs[SIM_TAILDESC];
+    if (chan->regs[SIM_TAILDESC] == 0) {
+        chan->regs[SIM_DMASR] |= SIM_DMASR_IDLE;
+        return false;
+    }
+    chan->regs[SIM_DMASR] &= ~SIM_DMASR_IDLE;
+
+    // Fetch the descriptor, and find its buffer
+    desc = sim_translate(chan, chan->next_desc, AXIDMA_RING_DESC_SIZE);
+    if (desc == NULL || (chan->next_desc % AXIDMA_RING_DESC_SIZE) != 0) {
+        sim_halt(chan, SIM_DMASR_SGDECERR);
+        return false;
+    }
+    __sync_synchronize();
+    length = desc[SIM_DESC_CONTROL] & SIM_DESC_LENGTH;
+    buffer_addr = ((uint64_t)desc[SIM_DESC_BUFFER_MSB] << 32) |
+                  desc[SIM_DESC_BUFFER];
+    buffer = (uint8_t *)sim_translate(chan, buffer_addr, length);
+    if (buffer == NULL || length == 0 || chan->fail_next) {
+        chan->fail_next = false;
+        sim_halt(chan, SIM_DMASR_SLVERR);
+        return false;
+    }
+
+    if (!sim_transfer(core, chan, desc, buffer, length, &status)) {
+        return false;
+    }
+
+    // Write the data before the status, which is what the ring polls
+    __sync_synchronize();
+    desc[SIM_DESC_STATUS] = status | SIM_DESC_CMPLT;
+    if (chan->next_desc == tail) {
+        __sync_bool_compare_and_swap(&chan->regs[SIM_TAILDESC],
+                                     (uint32_t)tail, 0);
+    }
+    chan->next_desc = ((uint64_t)desc[SIM_DESC_NXTDESC_MSB] << 32) |
+                      desc[SIM_DESC_NXTDESC];
+    return true;
+}
+
+// Runs the engines until the simulation is stopped
+static void *sim_thread(void *arg)
+{
+    bool busy;
+    struct sim_core *core;
+
+    core = arg;
+    while (!core->stop)
+    {
+        pthread_mutex_lock(&core->lock);
+        busy = sim_step(core, &core->tx);
+        busy = sim_step(core, &core->rx) || busy;
+        pthread_mutex_unlock(&core->lock);
+
+        if (!busy) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+// Sets up a channel, with memory for a ring of the given dimensions
+static int sim_chan_init(struct sim_chan *chan, enum axidma_dir dir,
+                         uint64_t base, int num_buffers, size_t buffer_size)
+{
+    size_t stride;
+
+    stride = (buffer_size + AXIDMA_RING_DESC_SIZE - 1) &
+             ~(size_t)(AXIDMA_RING_DESC_SIZE - 1);
+    memset(chan, 0, sizeof(*chan));
+    chan->dir = dir;
+    chan->base = base;
+    chan->size = num_buffers * (AXIDMA_RING_DESC_SIZE + stride);
+    if (posix_memalign((void **)&chan->mem, AXIDMA_RING_DESC_SIZE,
+                       chan->size) != 0) {
+        return -ENOMEM;
+    }
+    chan->regs[SIM_DMASR] = SIM_DMASR_HALTED;
+
+    return 0;
+}
+
+static int sim_start(struct sim_core *core, struct sim_test *test)
+{
+    int i, rc;
+
+    memset(core, 0, sizeof(*core));
+    rc = sim_chan_init(&core->tx, AXIDMA_WRITE, SIM_TX_BASE,
+                       test->num_buffers, test->buffer_size);
+    if (rc < 0) {
+        return rc;
+    }
+    rc = sim_chan_init(&core->rx, AXIDMA_READ, SIM_RX_BASE,
+                       test->num_buffers, test->buffer_size);
+    if (rc < 0) {
+        free(core->tx.mem);
+        return rc;
+    }
+    for (i = 0; i < SIM_FIFO_DEPTH; i++)
+    {
+        core->fifo[i].data = malloc(test->buffer_size);
+        assert(core->fifo[i].data != NULL);
+    }
+
+    pthread_mutex_init(&core->lock, NULL);
+    rc = pthread_create(&core->thread, NULL, sim_thread, core);
+    if (rc != 0) {
+        fprintf(stderr, "Unable to start the simulation: %s.\n",
+                strerror(rc));
+        return -rc;
+    }
+
+    return 0;
+}
+
+static void sim_stop(struct sim_core *core)
+{
+    int i;
+
+    core->stop = true;
+    pthread_join(core->thread, NULL);
+    pthread_mutex_destroy(&core->lock);
+    for (i = 0; i < SIM_FIFO_DEPTH; i++)
+    {
+        free(core->fifo[i].data);
+    }
+    free(core->tx.mem);
+    free(core->rx.mem);
+}
+
+/*----------------------------------------------------------------------------
+ * Ring Tests
+ *----------------------------------------------------------------------------*/
+
+// Gets the length of the given packet, which varies over the buffer's size
+static size_t packet_length(struct sim_test *test, int packet)
+{
+    return 1 + ((size_t)packet * 7919) % test->buffer_size;
+}
+
+// Gets the given byte of the given packet
+static uint8_t packet_byte(int packet, size_t offset)
+{
+    return (uint8_t)(packet * 31 + offset);
+}
+
+// Checks that a received buffer holds the given packet
+static int check_packet(struct sim_test *test, axidma_ring_t rx_ring,
+                        struct axidma_ring_completion *done, int packet)
+{
+    size_t i;
+    uint8_t *buffer;
+
+    if (done->error) {
+        fprintf(stderr, "Error: Packet %d was received with an error.\n",
+                packet);
+        return -EIO;
+    } else if (done->length != packet_length(test, packet)) {
+        fprintf(stderr, "Error: Packet %d was received with length %zu, "
+                "expected %zu.\n", packet, done->length,
+                packet_length(test, packet));
+        return -EIO;
+    }
+
+    buffer = axidma_ring_buffer(rx_ring, done->buffer_index);
+    for (i = 0; i < done->length; i++)
+    {
+        if (buffer[i] != packet_byte(packet, i)) {
+            fprintf(stderr, "Error: Packet %d differs at byte %zu.\n", packet,
+                    i);
+            return -EIO;
+        }
+    }
+
+    return 0;
+}
+
+/* Sends the packets through the transmit ring, and checks each one as it
+ * arrives in the receive ring. The receive ring is kept full of buffers. */
+static int test_loopback(struct sim_test *test, axidma_ring_t tx_ring,
+                         axidma_ring_t rx_ring)
+{
+    int rc, i, sent, received, tx_buffer;
+    uint8_t *buffer;
+    size_t length, progress;
+    struct axidma_ring_completion done;
+
+    for (i = 0; i < test->num_buffers; i++)
+    {
+        rc = axidma_ring_post(rx_ring, i, test->buffer_size);
+        if (rc < 0) {
+            fprintf(stderr, "Error: Unable to post receive buffer %d: %s.\n",
+                    i, strerror(-rc));
+            return rc;
+        }
+    }
+
+    // A full ring must refuse another buffer
+    rc = axidma_ring_post(rx_ring, 0, test->buffer_size);
+    if (rc != -ENOSPC) {
+        fprintf(stderr, "Error: Posting to a full ring returned %d, expected "
+                "%d.\n", rc, -ENOSPC);
+        return -EIO;
+    }
+
+    sent = 0;
+    received = 0;
+    tx_buffer = 0;
+    while (received < test->num_packets)
+    {
+        // Take back the transmit buffers that have been sent
+        while (axidma_ring_reap(tx_ring, &done) == 1) {
+            if (done.error) {
+                fprintf(stderr, "Error: A packet was sent with an error.\n");
+                return -EIO;
+            }
+        }
+
+        // Send packets while the transmit ring has room
+        while (sent < test->num_packets &&
+                axidma_ring_pending(tx_ring) < test->num_buffers) {
+            buffer = axidma_ring_buffer(tx_ring, tx_buffer);
+            length = packet_length(test, sent);
+            for (i = 0; i < (int)length; i++)
+            {
+                buffer[i] = packet_byte(sent, i);
+            }
+            rc = axidma_ring_post(tx_ring, tx_buffer, length);
+            if (rc < 0) {
+                fprintf(stderr, "Error: Unable to send packet %d: %s.\n",
+                        sent, strerror(-rc));
+                return rc;
+            }
+            tx_buffer = (tx_buffer + 1) % test->num_buffers;
+            sent += 1;
+        }
+
+        // Wait for the next packet, and check that it's counted in progress
+        rc = axidma_ring_wait(rx_ring, RING_TIMEOUT_MS);
+        if (rc <= 0) {
+            fprintf(stderr, "Error: Timed out waiting for packet %d.\n",
+                    received);
+            return -ETIMEDOUT;
+        }
+        progress = axidma_ring_progress(rx_ring);
+        if (progress < packet_length(test, received)) {
+            fprintf(stderr, "Error: Ring progress is %zu bytes with packet %d "
+                    "of %zu bytes completed.\n", progress, received,
+                    packet_length(test, received));
+            return -EIO;
+        }
+
+        // Check each packet that has arrived, and post its buffer again
+        while (axidma_ring_reap(rx_ring, &done) == 1) {
+            rc = check_packet(test, rx_ring, &done, received);
+            if (rc < 0) {
+                return rc;
+            }
+            received += 1;
+
+            rc = axidma_ring_post(rx_ring, done.buffer_index,
+                                  test->buffer_size);
+            if (rc < 0) {
+                fprintf(stderr, "Error: Unable to post receive buffer %d "
+                        "again: %s.\n", done.buffer_index, strerror(-rc));
+                return rc;
+            }
+        }
+    }
+
+    // Every packet has arrived, so the transmit ring has finished with them
+    while (axidma_ring_reap(tx_ring, &done) == 1) {
+        continue;
+    }
+
+    if (axidma_ring_status(tx_ring) < 0 || axidma_ring_status(rx_ring) < 0) {
+        fprintf(stderr, "Error: An engine halted during the loopback.\n");
+        return -EIO;
+    }
+
+    printf("Loopback: %d packets sent and received intact.\n", received);
+    return 0;
+}
+
+// Checks that an engine halting on an error is reported, and completes nothing
+static int test_error(struct sim_core *core, axidma_ring_t tx_ring)
+{
+    int rc;
+    struct axidma_ring_completion done;
+
+    pthread_mutex_lock(&core->lock);
+    core->tx.fail_next = true;
+    pthread_mutex_unlock(&core->lock);
+
+    rc = axidma_ring_post(tx_ring, 0, 1);
+    if (rc < 0) {
+        fprintf(stderr, "Error: Unable to post the failing buffer: %s.\n",
+                strerror(-rc));
+        return rc;
+    }
+
+    // The buffer never completes, and the ring sees the engine's error
+    rc = axidma_ring_wait(tx_ring, RING_TIMEOUT_MS / 10);
+    if (rc != 0 || axidma_ring_reap(tx_ring, &done) != 0) {
+        fprintf(stderr, "Error: A buffer completed on a failed engine.\n");
+        return -EIO;
+    } else if (axidma_ring_status(tx_ring) != -EIO) {
+        fprintf(stderr, "Error: The engine's error was not reported.\n");
+        return -EIO;
+    }
+
+    printf("Errors: the halted engine was reported.\n");
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Main Function
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    int rc;
+    struct sim_test test;
+    struct sim_core core;
+    axidma_ring_t tx_ring, rx_ring;
+
+    rc = parse_args(argc, argv, &test);
+    if (rc < 0) {
+        return 1;
+    }
+
+    rc = sim_start(&core, &test);
+    if (rc < 0) {
+        fprintf(stderr, "Unable to set up the simulation: %s.\n",
+                strerror(-rc));
+        return 1;
+    }
+
+    // Create the rings over the simulated channels, which starts them
+    tx_ring = axidma_ring_create(core.tx.regs, core.tx.mem, core.tx.base,
+                                 AXIDMA_WRITE, test.num_buffers,
+                                 test.buffer_size);
+    if (tx_ring == NULL) {
+        perror("Unable to create the transmit ring");
+        rc = -errno;
+        goto stop_sim;
+    }
+    rx_ring = axidma_ring_create(core.rx.regs, core.rx.mem, core.rx.base,
+                                 AXIDMA_READ, test.num_buffers,
+                                 test.buffer_size);
+    if (rx_ring == NULL) {
+        perror("Unable to create the receive ring");
+        rc = -errno;
+        goto destroy_tx_ring;
+    }
+
+    rc = test_loopback(&test, tx_ring, rx_ring);
+    if (rc < 0) {
+        goto destroy_rx_ring;
+    }
+    rc = test_error(&core, tx_ring);
+
+destroy_rx_ring:
+    axidma_ring_detach(rx_ring);
+destroy_tx_ring:
+    axidma_ring_detach(tx_ring);
+
+    // Detaching a ring must stop its channel
+    if (core.tx.regs[SIM_DMACR] & SIM_DMACR_RS ||
+            core.rx.regs[SIM_DMACR] & SIM_DMACR_RS) {
+        fprintf(stderr, "Error: Detaching a ring left its channel running.\n");
+        rc = (rc < 0) ? rc : -EIO;
+    }
+stop_sim:
+    sim_stop(&core);
+
+    printf("%s\n", (rc < 0) ? "FAILED" : "PASSED");
+    return (rc < 0) ? 1 : 0;
+}
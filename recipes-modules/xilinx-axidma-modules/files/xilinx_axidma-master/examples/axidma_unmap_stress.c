@@ -0,0 +1,647 @@
+/**
+ * @file axidma_unmap_stress.c
+ * @date Wednesday, October 21, 2026 at 09:14:05 AM EDT
+ *
+ * This program stresses the driver's handling of DMA buffers that are freed
+ * while transfers are being started on them, or are still running on them.
+ * Transfer threads keep starting transfers on a set of DMA buffers, mostly
+ * asynchronous ones that stay queued in the engine, while another thread
+ * keeps unmapping the buffers and mapping new ones in their place, and
+ * stopping the channels now and then.
+ *
+ * A transfer started on a buffer that is being unmapped must either fail
+ * with EFAULT, or keep the buffer's memory until the engine is done with it.
+ * To catch the engine writing into memory that was given back, the unmapping
+ * thread fills freshly mapped canary buffers with a pattern, and checks it
+ * before unmapping them. The canaries are mapped into an address range that
+ * is kept reserved, so that no transfer can be started on one through the
+ * stale address of a buffer. At the end, the channels are stopped, and the
+ * memory that the buffers took out of the CMA area must all come back.
+ *
+ * The transfers are run through the driver directly, rather than through the
+ * library, so that the failures expected along the way aren't reported. Run
+ * it with the receive channel looped back to the transmit channel, so that
+ * the queued receives complete. It is best run on a kernel with KASAN, and
+ * the kernel log checked afterwards.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <fcntl.h>              // Flags for open()
+#include <unistd.h>             // Close() system call
+#include <string.h>             // Memory setting and comparison
+#include <getopt.h>             // Option parsing
+#include <errno.h>              // Error codes
+#include <signal.h>             // Signal handling functions
+#include <time.h>               // Nanosleep() and clocks
+#include <pthread.h>            // Transfer and unmapping threads
+#include <sys/ioctl.h>          // IOCTL system call
+#include <sys/mman.h>           // Mapping the canary buffers
+
+#include "util.h"               // Miscellaneous utilities
+#include "axidma_ioctl.h"       // The driver's IOCTL interface
+#include "libaxidma.h"          // Interface to the AXI DMA library
+
+/*----------------------------------------------------------------------------
+ * Internal Definitions
+ *----------------------------------------------------------------------------*/
+
+// The default size of the buffers, number of them, threads, and run time
+#define DEFAULT_BUFFER_SIZE     (64 * 1024)
+#define DEFAULT_NUM_BUFFERS     8
+#define DEFAULT_NUM_THREADS     4
+#define DEFAULT_DURATION        10
+
+// The number of canary buffers kept mapped at once
+#define NUM_CANARIES            4
+
+// The byte that the canary buffers are filled with
+#define CANARY_PATTERN          0x5a
+
+// How many buffers are replaced between stops of the channels
+#define REMAPS_PER_STOP         64
+
+// How long to wait for the freed buffers to come back, in ms
+#define RECLAIM_TIMEOUT_MS      1000
+
+// The results of the transfers started, by outcome
+enum outcome {
+    OUTCOME_STARTED,            // The transfer was started, or completed
+    OUTCOME_FAULT,              // The buffer was already unmapped
+    OUTCOME_BUSY,               // The channel's queue was full
+    OUTCOME_TIMEOUT,            // A synchronous transfer timed out
+    OUTCOME_ERROR,              // Any other failure, which is unexpected
+    NUM_OUTCOMES,
+};
+
+static const char *const outcome_names[NUM_OUTCOMES] = {
+    "started", "buffer unmapped", "queue full", "timed out", "unexpected",
+};
+
+// The parameters and results of the stress test
+struct stress_test {
+    axidma_dev_t dev;           // The AXI DMA device, for the buffers
+    int fd;                     // The AXI DMA device, for the transfers
+    int tx_channel;             // The channel transmitted on
+    int rx_channel;             // The channel received on
+    size_t size;                // The size of each buffer
+    int num_buffers;            // The number of buffers transferred on
+    int num_threads;            // The number of transfer threads
+    int duration;               // The number of seconds to run for
+
+    void **buffers;             // The buffers, which are replaced as it runs
+    char *canary_area;          // The address range reserved for the canaries
+    size_t canary_size;         // The size of each canary, in whole pages
+    unsigned char *canaries[NUM_CANARIES];  // The canaries mapped, or NULL
+    uint64_t outcomes[NUM_OUTCOMES];    // The count of each outcome
+    uint64_t remaps;            // The number of buffers replaced
+    uint64_t stops;             // The number of times the channels stopped
+    uint64_t corrupted;         // The canaries found overwritten
+    bool failed;                // Set if a buffer couldn't be mapped
+    bool unmapper_started;      // Set once the unmapping thread is started
+};
+
+/* Indicates if the program is still running. Used to communicate between the
+ * signal handlers and the threads. */
+static volatile bool running = true;
+
+static void signal_handler(int signal)
+{
+    switch (signal) {
+        case SIGINT:
+        case SIGTERM:
+        case SIGQUIT:
+            running = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * Command Line Interface
+ *----------------------------------------------------------------------------*/
+
+// Prints the usage for this program
+static void print_usage(bool help)
+{
+    FILE* stream = (help) ? stdout : stderr;
+
+    fprintf(stream, "Usage: axidma_unmap_stress [-t <DMA tx channel>] [-r "
+            "<DMA rx channel>] [-s <buffer size>] [-b <buffers>] [-n "
+            "<threads>] [-D <seconds>]\n");
+    if (!help) {
+        return;
+    }
+
+    fprintf(stream, "\t-t <DMA tx channel>:\tThe device id of the DMA "
+            "channel to transmit on. Defaults to the first one.\n");
+    fprintf(stream, "\t-r <DMA rx channel>:\tThe device id of the DMA "
+            "channel to receive on. Defaults to the first one.\n");
+    fprintf(stream, "\t-s <buffer size>:\tThe size of each buffer in bytes. "
+            "Default is %d.\n", DEFAULT_BUFFER_SIZE);
+    fprintf(stream, "\t-b <buffers>:\t\tThe number of buffers transferred "
+            "on. Default is %d.\n", DEFAULT_NUM_BUFFERS);
+    fprintf(stream, "\t-n <threads>:\t\tThe number of threads starting "
+            "transfers. Default is %d.\n", DEFAULT_NUM_THREADS);
+    fprintf(stream, "\t-D <seconds>:\t\tHow long to run for. Default is "
+            "%d.\n", DEFAULT_DURATION);
+    return;
+}
+
+// Parses a positive integer argument
+static int parse_count(char option, char *arg_str, int *data)
+{
+    if (parse_int(option, arg_str, data) < 0) {
+        return -EINVAL;
+    } else if (*data <= 0) {
+        fprintf(stderr, "Error: The argument to -%c must be positive.\n",
+                option);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+// Parses the command line arguments
+static int parse_args(int argc, char **argv, struct stress_test *test)
+{
+    char option;
+    int int_arg, rc;
+
+    // Set the default values for the arguments
+    test->tx_channel = -1;
+    test->rx_channel = -1;
+    test->size = DEFAULT_BUFFER_SIZE;
+    test->num_buffers = DEFAULT_NUM_BUFFERS;
+    test->num_threads = DEFAULT_NUM_THREADS;
+    test->duration = DEFAULT_DURATION;
+
+    rc = 0;
+    while (rc == 0 && (option = getopt(argc, argv, "t:r:s:b:n:D:h"))
+                != (char)-1)
+    {
+        switch (option)
+        {
+            // Parse the channel device ids
+            case 't':
+                rc = parse_int(option, optarg, &test->tx_channel);
+                break;
+            case 'r':
+                rc = parse_int(option, optarg, &test->rx_channel);
+                break;
+
+            // Parse the buffers and the threads
+            case 's':
+                rc = parse_count(option, optarg, &int_arg);
+                test->size = int_arg;
+                break;
+            case 'b':
+                rc = parse_count(option, optarg, &test->num_buffers);
+                break;
+            case 'n':
+                rc = parse_count(option, optarg, &test->num_threads);
+                break;
+            case 'D':
+                rc = parse_count(option, optarg, &test->duration);
+                break;
+
+            case 'h':
+                print_usage(true);
+                exit(0);
+
+            default:
+                rc = -EINVAL;
+                break;
+        }
+    }
+
+    if (rc < 0) {
+        print_usage(false);
+        return rc;
+    } else if (optind != argc) {
+        fprintf(stderr, "Error: Unexpected argument '%s'.\n", argv[optind]);
+        print_usage(false);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Stress Threads
+ *----------------------------------------------------------------------------*/
+
+// A small random number generator, so that each thread has its own state
+static uint32_t next_random(uint32_t *state)
+{
+    *state = *state * 1103515245 + 12345;
+    return *state >> 16;
+}
+
+/* Starts a transfer on the buffer, straight through the driver, and returns
+ * how it went. Most are asynchronous, and stay queued until they complete or
+ * the channel is stopped. */
+static enum outcome start_transfer(struct stress_test *test, void *buf,
+                                   uint32_t choice)
+{
+    int rc;
+    unsigned long cmd;
+    struct axidma_transaction trans;
+
+    memset(&trans, 0, sizeof(trans));
+    trans.buf = buf;
+    trans.buf_len = test->size;
+    trans.wait = (choice % 8 == 0);
+    if (choice % 2 == 0) {
+        trans.channel_id = test->tx_channel;
+        cmd = AXIDMA_DMA_WRITE;
+    } else {
+        trans.channel_id = test->rx_channel;
+        cmd = AXIDMA_DMA_READ;
+    }
+
+    rc = ioctl(test->fd, cmd, &trans);
+    if (rc == 0) {
+        return OUTCOME_STARTED;
+    }
+
+    switch (errno) {
+        case EFAULT:
+            return OUTCOME_FAULT;
+        case EBUSY:
+            return OUTCOME_BUSY;
+        case ETIME:
+            return OUTCOME_TIMEOUT;
+        default:
+            return OUTCOME_ERROR;
+    }
+}
+
+// Keeps starting transfers on randomly chosen buffers, until the test ends
+static void *transfer_thread(void *arg)
+{
+    int index;
+    void *buf;
+    uint32_t random;
+    enum outcome outcome;
+    struct stress_test *test;
+
+    test = arg;
+    random = (uint32_t)(uintptr_t)pthread_self();
+    while (running)
+    {
+        index = next_random(&random) % test->num_buffers;
+        buf = __atomic_load_n(&test->buffers[index], __ATOMIC_ACQUIRE);
+        outcome = start_transfer(test, buf, next_random(&random));
+        __atomic_fetch_add(&test->outcomes[outcome], 1, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+// Checks that nothing has written into the canary buffer
+static bool canary_intact(struct stress_test *test, unsigned char *canary)
+{
+    size_t i;
+
+    for (i = 0; i < test->canary_size; i++)
+    {
+        if (canary[i] != CANARY_PATTERN) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Maps a new canary into its slot of the reserved range, over the mapping
+ * that keeps it reserved. The new one is likely to take memory that a buffer
+ * just gave back. */
+static int map_canary(struct stress_test *test, int index)
+{
+    void *addr;
+
+    addr = test->canary_area + index * test->canary_size;
+    addr = mmap(addr, test->canary_size, PROT_READ|PROT_WRITE,
+                MAP_SHARED|MAP_FIXED, test->fd, 0);
+    if (addr == MAP_FAILED) {
+        return -errno;
+    }
+
+    test->canaries[index] = addr;
+    memset(test->canaries[index], CANARY_PATTERN, test->canary_size);
+    return 0;
+}
+
+// Checks the canary, then unmaps it, keeping its slot of the range reserved
+static void unmap_canary(struct stress_test *test, int index)
+{
+    if (test->canaries[index] == NULL) {
+        return;
+    }
+
+    if (!canary_intact(test, test->canaries[index])) {
+        test->corrupted += 1;
+    }
+    mmap(test->canaries[index], test->canary_size, PROT_NONE,
+         MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED, -1, 0);
+    test->canaries[index] = NULL;
+}
+
+/* Keeps unmapping the buffers that the transfers are started on, with a new
+ * buffer mapped in each one's place first. Every so often, both channels are
+ * stopped, which gives back the buffers of the transfers that were queued. */
+static void *unmap_thread(void *arg)
+{
+    int index;
+    void *old_buf, *new_buf;
+    uint32_t random;
+    struct stress_test *test;
+
+    test = arg;
+    random = 1;
+    while (running)
+    {
+        new_buf = axidma_malloc(test->dev, test->size);
+        if (new_buf == NULL) {
+            test->failed = true;
+            break;
+        }
+
+        index = next_random(&random) % test->num_buffers;
+        old_buf = __atomic_exchange_n(&test->buffers[index], new_buf,
+                                      __ATOMIC_ACQ_REL);
+        axidma_free(test->dev, old_buf, test->size);
+        test->remaps += 1;
+
+        /* Map a canary into the empty slot, then unmap the oldest one, which
+         * leaves its slot empty for next time */
+        index = test->remaps % NUM_CANARIES;
+        if (map_canary(test, index) < 0) {
+            test->failed = true;
+            break;
+        }
+        unmap_canary(test, (index + 1) % NUM_CANARIES);
+
+        if (test->remaps % REMAPS_PER_STOP == 0) {
+            axidma_stop_transfer(test->dev, test->tx_channel);
+            axidma_stop_transfer(test->dev, test->rx_channel);
+            test->stops += 1;
+        }
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ * Memory Accounting
+ *----------------------------------------------------------------------------*/
+
+// Gets the free memory in the CMA area in kB, or -1 if it isn't reported
+static long cma_free_kb()
+{
+    FILE *meminfo;
+    char line[128];
+    long free_kb;
+
+    meminfo = fopen("/proc/meminfo", "r");
+    if (meminfo == NULL) {
+        return -1;
+    }
+
+    free_kb = -1;
+    while (fgets(line, sizeof(line), meminfo) != NULL)
+    {
+        if (sscanf(line, "CmaFree: %ld kB", &free_kb) == 1) {
+            break;
+        }
+    }
+
+    fclose(meminfo);
+    return free_kb;
+}
+
+/* Waits for the CMA area to get back to the free memory it had before the
+ * test. The buffers held by stopped transfers are freed by the driver in the
+ * background. Other users of the area can move it by a buffer's worth. */
+static bool cma_reclaimed(struct stress_test *test, long start_kb)
+{
+    int waited_ms;
+    long free_kb, slack_kb;
+    struct timespec pause;
+
+    if (start_kb < 0) {
+        return true;
+    }
+
+    slack_kb = test->size / 1024 + 1;
+    pause.tv_sec = 0;
+    pause.tv_nsec = 10 * 1000 * 1000;
+    for (waited_ms = 0; waited_ms < RECLAIM_TIMEOUT_MS; waited_ms += 10)
+    {
+        free_kb = cma_free_kb();
+        if (free_kb + slack_kb >= start_kb) {
+            return true;
+        }
+        nanosleep(&pause, NULL);
+    }
+
+    fprintf(stderr, "Error: %ld kB of CMA memory was not given back.\n",
+            start_kb - free_kb);
+    return false;
+}
+
+/*----------------------------------------------------------------------------
+ * Main Function
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    int rc, i, num_started;
+    long start_kb;
+    pthread_t unmapper, *threads;
+    struct stress_test test;
+    struct axidma_buffer_stats start_stats, end_stats;
+    const array_t *tx_chans, *rx_chans;
+
+    // Parse the input arguments
+    memset(&test, 0, sizeof(test));
+    test.fd = -1;
+    if (parse_args(argc, argv, &test) < 0) {
+        rc = 1;
+        goto ret;
+    }
+
+    // Initialize the AXI DMA device, and pick the channels
+    test.dev = axidma_init();
+    if (test.dev == NULL) {
+        fprintf(stderr, "Error: Failed to initialize the AXI DMA device.\n");
+        rc = 1;
+        goto ret;
+    }
+    tx_chans = axidma_get_dma_tx(test.dev);
+    rx_chans = axidma_get_dma_rx(test.dev);
+    if (tx_chans->len < 1 || rx_chans->len < 1) {
+        fprintf(stderr, "Error: No transmit or receive channels were "
+                "found.\n");
+        rc = 1;
+        goto destroy_axidma;
+    }
+    if (test.tx_channel == -1) {
+        test.tx_channel = tx_chans->data[0];
+    }
+    if (test.rx_channel == -1) {
+        test.rx_channel = rx_chans->data[0];
+    }
+
+    // Open the device again, for the transfers
+    test.fd = open(AXIDMA_DEV_PATH, O_RDWR|O_EXCL);
+    if (test.fd < 0) {
+        perror("Error opening AXI DMA device");
+        rc = 1;
+        goto destroy_axidma;
+    }
+
+    // Note the buffers and free memory to start with, then map the buffers
+    start_kb = cma_free_kb();
+    if (axidma_get_buffer_stats(test.dev, &start_stats) < 0) {
+        rc = 1;
+        goto close_fd;
+    }
+    test.buffers = calloc(test.num_buffers, sizeof(*test.buffers));
+    if (test.buffers == NULL) {
+        rc = 1;
+        goto close_fd;
+    }
+
+    // Reserve the address range for the canaries
+    test.canary_size = (test.size + getpagesize() - 1) /
+                       getpagesize() * getpagesize();
+    test.canary_area = mmap(NULL, NUM_CANARIES * test.canary_size, PROT_NONE,
+                            MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (test.canary_area == MAP_FAILED) {
+        perror("Unable to reserve the canary address range");
+        test.canary_area = NULL;
+        rc = 1;
+        goto free_buffers;
+    }
+    for (i = 0; i < test.num_buffers; i++)
+    {
+        test.buffers[i] = axidma_malloc(test.dev, test.size);
+        if (test.buffers[i] == NULL) {
+            fprintf(stderr, "Unable to allocate the DMA buffers.\n");
+            rc = 1;
+            goto free_buffers;
+        }
+    }
+
+    printf("AXI DMA Unmap Stress Parameters:\n");
+    printf("\tTransmit Channel: %d\n", test.tx_channel);
+    printf("\tReceive Channel: %d\n", test.rx_channel);
+    printf("\tBuffers: %d of %zu bytes\n", test.num_buffers, test.size);
+    printf("\tTransfer Threads: %d\n", test.num_threads);
+    printf("\tDuration: %d s\n\n", test.duration);
+
+    // Start the threads, and let them run
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGQUIT, signal_handler);
+    threads = calloc(test.num_threads, sizeof(*threads));
+    if (threads == NULL) {
+        rc = 1;
+        goto free_buffers;
+    }
+    for (num_started = 0; num_started < test.num_threads; num_started++)
+    {
+        if (pthread_create(&threads[num_started], NULL, transfer_thread,
+                           &test) != 0) {
+            break;
+        }
+    }
+    if (pthread_create(&unmapper, NULL, unmap_thread, &test) == 0) {
+        test.unmapper_started = true;
+    } else {
+        fprintf(stderr, "Error: Unable to start the unmapping thread.\n");
+        test.failed = true;
+        running = false;
+    }
+    for (i = 0; running && i < test.duration; i++)
+    {
+        sleep(1);
+    }
+    running = false;
+    for (i = 0; i < num_started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    if (test.unmapper_started) {
+        pthread_join(unmapper, NULL);
+    }
+    free(threads);
+
+    // Stop what is still queued, and give back all of the buffers
+    axidma_stop_transfer(test.dev, test.tx_channel);
+    axidma_stop_transfer(test.dev, test.rx_channel);
+    for (i = 0; i < NUM_CANARIES; i++)
+    {
+        unmap_canary(&test, i);
+    }
+    for (i = 0; i < test.num_buffers; i++)
+    {
+        axidma_free(test.dev, test.buffers[i], test.size);
+    }
+    free(test.buffers);
+    test.buffers = NULL;
+
+    printf("AXI DMA Unmap Stress Results:\n");
+    printf("\tBuffers Replaced: %llu\n", (unsigned long long)test.remaps);
+    printf("\tChannel Stops: %llu\n", (unsigned long long)test.stops);
+    for (i = 0; i < NUM_OUTCOMES; i++)
+    {
+        printf("\tTransfers %s: %llu\n", outcome_names[i],
+               (unsigned long long)test.outcomes[i]);
+    }
+    printf("\tCanaries Overwritten: %llu\n",
+           (unsigned long long)test.corrupted);
+
+    // Check that the driver kept the memory, and that it gave it all back
+    rc = (test.failed || test.outcomes[OUTCOME_ERROR] > 0) ? 1 : 0;
+    if (test.corrupted > 0) {
+        fprintf(stderr, "Error: A transfer wrote into a buffer that was "
+                "given back.\n");
+        rc = 1;
+    }
+    if (axidma_get_buffer_stats(test.dev, &end_stats) < 0 ||
+            end_stats.num_buffers != start_stats.num_buffers) {
+        fprintf(stderr, "Error: The driver still has buffers that were "
+                "unmapped.\n");
+        rc = 1;
+    }
+    if (!cma_reclaimed(&test, start_kb)) {
+        rc = 1;
+    }
+    printf("\n%s\n", (rc == 0) ? "Passed." : "FAILED.");
+
+free_buffers:
+    if (test.canary_area != NULL) {
+        munmap(test.canary_area, NUM_CANARIES * test.canary_size);
+    }
+    for (i = 0; test.buffers != NULL && i < test.num_buffers; i++)
+    {
+        if (test.buffers[i] != NULL) {
+            axidma_free(test.dev, test.buffers[i], test.size);
+        }
+    }
+    free(test.buffers);
+close_fd:
+    close(test.fd);
+destroy_axidma:
+    axidma_destroy(test.dev);
+ret:
+    return rc;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file capture.c
+ * @date Sunday, October 18, 2026 at 03:06:10 AM EDT
+ *
+ * This file contains the helpers for reading capture files.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include <fcntl.h>              // Flags for open()
+#include <sys/stat.h>           // Fstat() system call
+#include <sys/mman.h>           // Mmap() system call
+#include <unistd.h>             // Close() system call
+#include <string.h>             // Memcmp function
+#include <errno.h>              // Error codes
+
+#include "capture.h"            // Local definitions
+
+/*----------------------------------------------------------------------------
+ * Capture File Reading
+ *----------------------------------------------------------------------------*/
+
+// Checks that the header and the index of a mapped capture file are valid
+static bool capture_valid(const struct capture_file *cap)
+{
+    uint64_t i, index_size;
+    const struct capture_header *header;
+    const struct capture_entry *entry;
+
+    header = cap->header;
+    if (cap->size < CAPTURE_ALIGN ||
+            memcmp(header->magic, CAPTURE_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != CAPTURE_VERSION) {
+        return false;
+    } else if (header->index_offset == 0) {
+        return header->num_packets == 0;
+    }
+
+    index_size = header->num_packets * sizeof(struct capture_entry);
+    if (header->index_offset % CAPTURE_ALIGN != 0 ||
+            header->index_offset > cap->size ||
+            index_size / sizeof(struct capture_entry) != header->num_packets ||
+            index_size > cap->size - header->index_offset) {
+        return false;
+    }
+
+    for (i = 0; i < header->num_packets; i++)
+    {
+        entry = &cap->index[i];
+        if (entry->offset < CAPTURE_ALIGN ||
+                entry->offset > header->index_offset ||
+                entry->stored_length > header->index_offset - entry->offset ||
+                entry->stored_length > entry->length ||
+                entry->length > header->max_length) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int capture_map(const char *path, struct capture_file *cap)
+{
+    int fd, rc;
+    struct stat stat;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -errno;
+    } else if (fstat(fd, &stat) < 0) {
+        rc = -errno;
+        goto close_fd;
+    } else if (stat.st_size < CAPTURE_ALIGN) {
+        rc = -EINVAL;
+        goto close_fd;
+    }
+
+    cap->size = stat.st_size;
+    cap->map = mmap(NULL, cap->size, PROT_READ, MAP_SHARED, fd, 0);
+    if (cap->map == MAP_FAILED) {
+        rc = -errno;
+        goto close_fd;
+    }
+    cap->header = cap->map;
+    cap->index = (const struct capture_entry *)((const char *)cap->map +
+                                                cap->header->index_offset);
+
+    if (!capture_valid(cap)) {
+        munmap(cap->map, cap->size);
+        rc = -EINVAL;
+        goto close_fd;
+    }
+    rc = 0;
+
+close_fd:
+    assert(close(fd) == 0);
+    return rc;
+}
+
+void capture_unmap(struct capture_file *cap)
+{
+    munmap(cap->map, cap->size);
+    return;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file capture.h
+ * @date Sunday, October 18, 2026 at 02:58:44 AM EDT
+ *
+ * This file defines the format of the capture files written by
+ * axidma_capture and read by axidma_replay, and the helpers for mapping one.
+ *
+ * A capture file is laid out in blocks of #CAPTURE_ALIGN bytes, so that it can
+ * be written with O_DIRECT:
+ *
+ *     | header | packet 0 | packet 1 | ... | index |
+ *
+ * Each packet is a received DMA transfer, stored raw or LZ4-compressed and
+ * padded out to a whole block. A packet's length is the bytes that its
+ * transfer actually received, which is less than the transfer's size if the
+ * logic ended the packet early, and is what axidma_replay sends back out. The index holds an entry for each packet, and
+ * is written after the last packet when the capture is closed, after which
+ * the header is rewritten with its offset. A capture that was not closed has
+ * no index, and reads as holding no packets.
+ *
+ * The fields are in the CPU's byte order, and the whole file can be mapped
+ * and read in place.
+ *
+ * @bug No known bugs.
+ **/
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The magic number and version at the start of a capture file
+#define CAPTURE_MAGIC           "AXIDMCAP"
+#define CAPTURE_VERSION         1
+
+// The size of the blocks that the file is laid out in
+#define CAPTURE_ALIGN           4096
+
+// Rounds a size up to a whole number of blocks
+#define CAPTURE_ALIGN_UP(size) \
+    (((size) + CAPTURE_ALIGN - 1) & ~((uint64_t)CAPTURE_ALIGN - 1))
+
+// The packets are LZ4-compressed, where that makes them smaller
+#define CAPTURE_FLAG_LZ4        0x1
+
+// The header in the first block of a capture file
+struct capture_header {
+    char magic[8];              // Set to CAPTURE_MAGIC
+    uint32_t version;           // Set to CAPTURE_VERSION
+    uint32_t flags;             // The CAPTURE_FLAG_* values
+    uint64_t start_ns;          // When the capture started, in the epoch
+    uint64_t num_packets;       // The number of entries in the index
+    uint64_t index_offset;      // The offset of the index, 0 if not closed
+    uint32_t max_length;        // The longest packet, uncompressed
+    uint32_t reserved;          // Unused, set to 0
+};
+
+/* An entry of the index. A packet is compressed if it is stored in fewer
+ * bytes than its length, and stored raw otherwise. */
+struct capture_entry {
+    uint64_t offset;            // The offset of the packet in the file
+    uint64_t timestamp_ns;      // When the packet was received, in the epoch
+    uint32_t length;            // The bytes received for the packet
+    uint32_t stored_length;     // The bytes it is stored in, before padding
+};
+
+// A capture file mapped into memory for reading
+struct capture_file {
+    void *map;                  // The mapping of the whole file
+    size_t size;                // The size of the file
+    const struct capture_header *header;    // The file's header
+    const struct capture_entry *index;      // The file's index
+};
+
+/* Maps a capture file for reading, and checks that its header, index, and
+ * packets are within the file. Returns 0 on success, or a negative errno
+ * value, which is -EINVAL if the file is not a valid capture. */
+int capture_map(const char *path, struct capture_file *cap);
+
+// Unmaps a capture file mapped with capture_map()
+void capture_unmap(struct capture_file *cap);
+
+// Gets the stored bytes of a packet in a mapped capture file
+static inline const void *capture_packet(const struct capture_file *cap,
+        uint64_t packet)
+{
+    return (const char *)cap->map + cap->index[packet].offset;
+}
+
+#endif /* CAPTURE_H_ */
@@ -17,7 +17,10 @@ include library/library.mk
 
 # The list of example programs
 EXAMPLES_DIR = examples
-EXAMPLES_FILES = axidma_benchmark.c axidma_display_image.c axidma_transfer.c
+EXAMPLES_FILES = axidma_benchmark.c axidma_bridge.c axidma_capture.c \
+				 axidma_convert_benchmark.c axidma_display_image.c \
+				 axidma_latency.c axidma_replay.c axidma_ring_sim.c \
+				 axidma_transfer.c axidma_unmap_stress.c
 
 # The variations of specific targets for the example programs
 EXAMPLES_TARGETS = $(EXAMPLES_FILES:%.c=%)
@@ -27,7 +30,7 @@ EXAMPLES_OUTPUT_EXECUTABLES = $(addprefix $(OUTPUT_DIR)/,$(EXAMPLES_TARGETS))
 
 # The local helper function files used across the example programs.
 UTIL_DIR = $(EXAMPLES_DIR)
-UTIL_FILES = util.c
+UTIL_FILES = util.c capture.c
 UTIL = $(addprefix $(UTIL_DIR)/,$(UTIL_FILES))
 
 # The compiler flags used to compile the examples
@@ -36,9 +39,15 @@ EXAMPLES_CFLAGS = $(GLOBAL_CFLAGS)
 # Set the example executables to link against the AXI DMA shared library in
 # the outputs directory
 EXAMPLES_LINKER_FLAGS = -Wl,-rpath,'$$ORIGIN'
-EXAMPLES_LIB_FLAGS = -L $(OUTPUT_DIR) -l $(LIBAXIDMA_NAME) \
+EXAMPLES_LIB_FLAGS = -L $(OUTPUT_DIR) -l $(LIBAXIDMA_NAME) -pthread \
 					 $(EXAMPLES_LINKER_FLAGS)
 
+# If specified, build the capture and replay programs with LZ4 compression
+ifneq ($(origin AXIDMA_LZ4),undefined)
+    EXAMPLES_CFLAGS += -DAXIDMA_LZ4
+    EXAMPLES_LIB_FLAGS += -llz4
+endif
+
 ################################################################################
 # Targets
 ################################################################################
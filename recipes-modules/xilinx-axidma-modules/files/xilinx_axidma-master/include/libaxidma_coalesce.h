@@ -0,0 +1,150 @@
+/**
+ * @file libaxidma_coalesce.h
+ * @date Sunday, October 18, 2026 at 01:14:22 AM EDT
+ *
+ * This file defines the transmit coalescing interface of the AXI DMA library,
+ * which packs many small messages into each DMA transfer, and the helper that
+ * splits a received buffer of them back into messages.
+ *
+ * Each message is framed with its length, as a 32-bit word in the CPU's byte
+ * order, and padded to a whole number of words, so every frame starts on a
+ * word boundary:
+ *
+ *     | length | message ... | padding | length | message ... | ...
+ *
+ * The messages are appended to a DMA buffer, which is sent once it holds the
+ * size threshold, or once its oldest message has waited for the deadline,
+ * whichever comes first. There are two buffers, so messages can be appended
+ * to one while the other is being sent.
+ **/
+
+#ifndef LIBAXIDMA_COALESCE_H_
+#define LIBAXIDMA_COALESCE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libaxidma.h"          // Interface to the AXI DMA library
+
+/**
+ * The size of the length word at the start of each frame.
+ **/
+#define AXIDMA_FRAME_HEADER_SIZE    4
+
+/**
+ * Gets the number of bytes that a message of the given length takes up in a
+ * buffer, with its length and padding.
+ **/
+#define AXIDMA_FRAME_SIZE(len) \
+    (AXIDMA_FRAME_HEADER_SIZE + (((len) + 3) & ~(size_t)3))
+
+/**
+ * Structure holding the counters of a coalescing queue.
+ *
+ * The delay of a message is from when it was queued until the transfer
+ * holding it was started, which is the latency that coalescing adds.
+ **/
+struct axidma_coalesce_stats {
+    uint64_t messages;          ///< The number of messages sent.
+    uint64_t bytes;             ///< The number of bytes sent, with framing.
+    uint64_t transfers;         ///< The number of DMA transfers made.
+    uint64_t size_flushes;      ///< Transfers made for the size threshold.
+    uint64_t deadline_flushes;  ///< Transfers made for the deadline.
+    uint64_t errors;            ///< The number of failed transfers.
+    uint64_t delay_total_ns;    ///< The sum of the messages' delays, in ns.
+    uint64_t delay_max_ns;      ///< The longest delay of a message, in ns.
+};
+
+/**
+ * The struct representing a coalescing queue. This is an opaque type.
+ **/
+struct axidma_coalescer;
+
+/**
+ * Type definition for a coalescing queue.
+ **/
+typedef struct axidma_coalescer* axidma_coalescer_t;
+
+/**
+ * Creates a coalescing queue for the given transmit channel, allocating its
+ * DMA buffers and starting the thread that enforces the deadline.
+ *
+ * This function will abort if the channel is invalid.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA transmit channel to send the messages on.
+ * @param[in] buffer_size The size of each DMA buffer, which is the largest
+ *                        transfer made.
+ * @param[in] threshold The number of bytes, with framing, at which a buffer
+ *                      is sent. This is at most \p buffer_size.
+ * @param[in] deadline_us The longest a message waits before it is sent, in
+ *                        microseconds.
+ * @return A handle to the queue on success, NULL on failure.
+ **/
+axidma_coalescer_t axidma_coalescer_create(axidma_dev_t dev, int channel,
+        size_t buffer_size, size_t threshold, int deadline_us);
+
+/**
+ * Sends the messages still in the queue, then stops its thread and frees it.
+ *
+ * @param[in] coal An #axidma_coalescer_t returned by #axidma_coalescer_create.
+ **/
+void axidma_coalescer_destroy(axidma_coalescer_t coal);
+
+/**
+ * Queues a message to be sent. The message is copied into the DMA buffer, so
+ * it can be reused as soon as this returns.
+ *
+ * If the message does not fit in the buffer, the buffer is sent first. If it
+ * brings the buffer up to the threshold, the buffer is sent before this
+ * returns. Either way, this waits for any transfer in progress to finish.
+ *
+ * This is safe to call from several threads.
+ *
+ * @param[in] coal An #axidma_coalescer_t returned by #axidma_coalescer_create.
+ * @param[in] msg The message to queue.
+ * @param[in] len The number of bytes in the message.
+ * @return 0 upon success, a negative errno value on failure. This is
+ *         -EMSGSIZE if the message, with its framing, is larger than a
+ *         buffer, and -EIO if a transfer it waited for failed.
+ **/
+int axidma_coalescer_send(axidma_coalescer_t coal, const void *msg,
+        size_t len);
+
+/**
+ * Sends the messages in the queue now, without waiting for the threshold or
+ * the deadline.
+ *
+ * @param[in] coal An #axidma_coalescer_t returned by #axidma_coalescer_create.
+ * @return 0 upon success, or -EIO if the transfer failed.
+ **/
+int axidma_coalescer_flush(axidma_coalescer_t coal);
+
+/**
+ * Gets the counters of the queue.
+ *
+ * @param[in] coal An #axidma_coalescer_t returned by #axidma_coalescer_create.
+ * @param[out] stats Filled with the queue's counters.
+ **/
+void axidma_coalescer_get_stats(axidma_coalescer_t coal,
+        struct axidma_coalesce_stats *stats);
+
+/**
+ * Gets the next message from a received buffer of framed messages.
+ *
+ * Start with \p offset at 0, and call this until it returns 0. The message is
+ * returned in place, so it is only valid while the buffer is.
+ *
+ * @param[in] buf The received buffer.
+ * @param[in] len The number of bytes received.
+ * @param[in,out] offset The offset of the next frame, which is advanced past
+ *                       it.
+ * @param[out] msg Set to the start of the message.
+ * @param[out] msg_len Set to the length of the message.
+ * @return 1 if a message was found, 0 if there are no more, or -EBADMSG if a
+ *         frame runs past the end of the buffer.
+ **/
+int axidma_deframe_next(const void *buf, size_t len, size_t *offset,
+        const void **msg, size_t *msg_len);
+
+#endif /* LIBAXIDMA_COALESCE_H_ */
@@ -0,0 +1,132 @@
+/**
+ * @file libaxidma_sched.h
+ * @date Saturday, October 17, 2026 at 11:02:47 PM EDT
+ *
+ * This file defines the job scheduler of the AXI DMA library, which spreads
+ * independent jobs over several identical accelerator instances, each fed by
+ * a transmit channel and drained by a receive channel.
+ *
+ * Each pair of channels has its own queue of jobs, and a thread that runs
+ * them. A job is queued on the pair with the least work, counting the job it
+ * is running. A pair whose queue runs dry steals the newest job queued on the
+ * busiest other pair, so a slow instance does not hold up the jobs behind it.
+ **/
+
+#ifndef LIBAXIDMA_SCHED_H_
+#define LIBAXIDMA_SCHED_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libaxidma.h"          // Interface to the AXI DMA library
+
+struct axidma_job;
+
+/**
+ * Type definition for the function called when a job is done. It is invoked
+ * in the thread of the pair that ran the job.
+ **/
+typedef void (*axidma_job_cb_t)(struct axidma_job *job, void *data);
+
+/**
+ * Structure representing a job, sending an input buffer to an accelerator
+ * and receiving its output back.
+ *
+ * The job belongs to the scheduler from when it is submitted until its
+ * callback is invoked, or until #axidma_sched_drain returns. The callback can
+ * free or resubmit the job, since the scheduler is done with it by then.
+ **/
+struct axidma_job {
+    void *tx_buf;               ///< The DMA buffer holding the input.
+    size_t tx_len;              ///< The number of bytes of input.
+    void *rx_buf;               ///< The DMA buffer to receive the output into.
+    size_t rx_len;              ///< The number of bytes of output.
+    axidma_job_cb_t callback;   ///< Called when the job is done, or NULL.
+    void *data;                 ///< The data to pass to the callback.
+    int status;                 ///< Set to 0, or a negative errno value.
+    int pair;                   ///< Set to the index of the pair it ran on.
+    uint64_t queued_ns;         ///< Set to when it was queued, in ns.
+};
+
+/**
+ * Structure holding the counters of one pair of channels.
+ **/
+struct axidma_sched_stats {
+    uint64_t jobs;              ///< The number of jobs run on the pair.
+    uint64_t stolen;            ///< Jobs it took from another pair's queue.
+    uint64_t busy_ns;           ///< The time spent running jobs, in ns.
+    uint64_t wait_ns;           ///< The sum of its jobs' time queued, in ns.
+    uint64_t max_wait_ns;       ///< The longest time a job was queued, in ns.
+    double utilisation;         ///< The fraction of the time it was busy.
+    int queued;                 ///< The number of jobs queued on it now.
+};
+
+/**
+ * The struct representing a job scheduler. This is an opaque type.
+ **/
+struct axidma_sched;
+
+/**
+ * Type definition for a job scheduler.
+ **/
+typedef struct axidma_sched* axidma_sched_t;
+
+/**
+ * Creates a scheduler for the given pairs of channels, starting a thread to
+ * run the jobs of each pair.
+ *
+ * The channels of pair i are \p tx_channels[i] and \p rx_channels[i]. This
+ * function will abort if any of the channels is invalid.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] tx_channels The DMA channels feeding each instance.
+ * @param[in] rx_channels The DMA channels draining each instance.
+ * @param[in] num_pairs The number of pairs of channels.
+ * @param[in] queue_depth The most jobs that can be queued on each pair.
+ * @return A handle to the scheduler on success, NULL on failure.
+ **/
+axidma_sched_t axidma_sched_create(axidma_dev_t dev, const int *tx_channels,
+        const int *rx_channels, int num_pairs, int queue_depth);
+
+/**
+ * Waits for the jobs that are running to finish, then stops the scheduler's
+ * threads and frees it. Jobs still queued are not run, and their callbacks
+ * are not invoked.
+ *
+ * @param[in] sched An #axidma_sched_t returned by #axidma_sched_create.
+ **/
+void axidma_sched_destroy(axidma_sched_t sched);
+
+/**
+ * Queues a job on the pair of channels with the least work.
+ *
+ * @param[in] sched An #axidma_sched_t returned by #axidma_sched_create.
+ * @param[in] job The job to run. Its buffers must have been allocated by
+ *                #axidma_malloc or registered with #axidma_register_buffer.
+ * @return 0 upon success, or -ENOSPC if every queue is full.
+ **/
+int axidma_sched_submit(axidma_sched_t sched, struct axidma_job *job);
+
+/**
+ * Waits for every job submitted so far to be done.
+ *
+ * @param[in] sched An #axidma_sched_t returned by #axidma_sched_create.
+ * @param[in] timeout The time to wait in milliseconds, or a negative value
+ *                    to wait forever.
+ * @return 0 upon success, or -ETIMEDOUT if jobs were still outstanding when
+ *         the timeout expired.
+ **/
+int axidma_sched_drain(axidma_sched_t sched, int timeout);
+
+/**
+ * Gets the counters of a pair of channels. The utilisation is over the time
+ * since the scheduler was created.
+ *
+ * @param[in] sched An #axidma_sched_t returned by #axidma_sched_create.
+ * @param[in] pair The index of the pair.
+ * @param[out] stats Filled with the pair's counters.
+ **/
+void axidma_sched_get_stats(axidma_sched_t sched, int pair,
+        struct axidma_sched_stats *stats);
+
+#endif /* LIBAXIDMA_SCHED_H_ */
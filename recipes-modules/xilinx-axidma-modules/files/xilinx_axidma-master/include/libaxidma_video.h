@@ -0,0 +1,111 @@
+/**
+ * @file libaxidma_video.h
+ * @date Saturday, October 17, 2026 at 10:12:31 AM EDT
+ *
+ * This file defines the video helper interface of the AXI DMA library, which
+ * converts frames between pixel formats, such as from a camera's format to
+ * the 32-bit pixels used by the display.
+ **/
+
+#ifndef LIBAXIDMA_VIDEO_H_
+#define LIBAXIDMA_VIDEO_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Enumeration for the pixel formats supported by the conversion functions.
+ *
+ * The formats are named from the most significant component to the least
+ * significant one, as for a little-endian integer. So, an XRGB8888 pixel is
+ * stored in memory as the bytes blue, green, red, then the unused byte.
+ **/
+enum axidma_pixel_format {
+    AXIDMA_PIXEL_RGB888,            ///< 24-bit, stored as bytes R, G, B.
+    AXIDMA_PIXEL_XRGB8888,          ///< 32-bit, stored as bytes B, G, R, X.
+    AXIDMA_PIXEL_YUYV,              ///< 4:2:2, stored as bytes Y0, U, Y1, V.
+    AXIDMA_PIXEL_RAW10,             ///< 10-bit, 4 pixels packed in 5 bytes.
+    AXIDMA_PIXEL_RAW16,             ///< 10-bit, in a little-endian 16-bit word.
+};
+
+/**
+ * Structure representing an image, or a window of one, in memory.
+ *
+ * The rows of the image are `stride` bytes apart, so the image can be a
+ * region of a larger frame buffer. A stride of 0 means that the rows are
+ * packed. The RAW10 format packs each group of 4 pixels into 5 bytes, in the
+ * MIPI CSI-2 layout, with the 8 most significant bits of each pixel followed
+ * by a byte holding the 2 least significant bits of all 4. Its width must be
+ * a multiple of 4, and the YUYV format's width must be a multiple of 2.
+ **/
+struct axidma_image {
+    enum axidma_pixel_format format;    ///< The format of the pixels.
+    int width;                      ///< Width of the image in pixels.
+    int height;                     ///< Height of the image in pixels.
+    int stride;                     ///< Bytes between rows, 0 if packed.
+    void *data;                     ///< Address of the first pixel.
+};
+
+/**
+ * Gets the name of the given pixel format, for printing.
+ *
+ * @param[in] format The pixel format.
+ * @return A string constant with the format's name.
+ **/
+const char *axidma_pixel_format_name(enum axidma_pixel_format format);
+
+/**
+ * Gets the number of bytes in a packed row of the given pixel format.
+ *
+ * @param[in] format The pixel format.
+ * @param[in] width The number of pixels in the row.
+ * @return The number of bytes in the row.
+ **/
+size_t axidma_pixel_row_size(enum axidma_pixel_format format, int width);
+
+/**
+ * Indicates if there is a conversion between the two pixel formats.
+ *
+ * The supported conversions are RGB888 to and from XRGB8888, YUYV to either
+ * XRGB8888 or RGB888, and RAW10 to RAW16. YUYV is converted with the BT.601
+ * limited range coefficients.
+ *
+ * @param[in] src_format The pixel format to convert from.
+ * @param[in] dst_format The pixel format to convert to.
+ * @return true if the conversion is supported, false otherwise.
+ **/
+bool axidma_conversion_supported(enum axidma_pixel_format src_format,
+        enum axidma_pixel_format dst_format);
+
+/**
+ * Gets the name of the instruction set that conversions use on this build.
+ *
+ * @return "NEON", "SSSE3", "SSE2" or "scalar". Conversions without a vector
+ *         kernel for the instruction set fall back to scalar code.
+ **/
+const char *axidma_conversion_isa();
+
+/**
+ * Converts an image from one pixel format to another.
+ *
+ * The destination is written in order, one band of rows at a time, with each
+ * band sized to stay in the cache. So, it can be a DMA frame buffer returned
+ * by #axidma_malloc, such as the next buffer of a video transfer, and the
+ * conversion is done in place of a separate copy. The source and destination
+ * must have the same dimensions, and must not overlap.
+ *
+ * The bands can be split across several threads, one per core, for large
+ * frames. The calling thread always takes part in the conversion.
+ *
+ * @param[in] src The image to convert.
+ * @param[in,out] dst The image to write the converted pixels to. Its format,
+ *                    dimensions, stride, and data must be set.
+ * @param[in] num_threads The number of threads to convert with, or 0 or 1 to
+ *                        convert in the calling thread only.
+ * @return 0 upon success, a negative errno value on failure (e.g. if the
+ *         conversion is not supported, or the dimensions are invalid).
+ **/
+int axidma_convert_image(const struct axidma_image *src,
+        struct axidma_image *dst, int num_threads);
+
+#endif /* LIBAXIDMA_VIDEO_H_ */
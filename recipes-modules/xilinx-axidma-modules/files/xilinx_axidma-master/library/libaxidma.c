@@ -23,6 +23,8 @@
 #include <unistd.h>             // Close() system call
 #include <errno.h>              // Error codes
 #include <signal.h>             // Signal handling functions
+#include <stdint.h>             // Fixed-width types for the ring's registers
+#include <time.h>               // Clock for the rings' idle budget
 
 #include "libaxidma.h"          // Local definitions
 #include "axidma_ioctl.h"       // The IOCTL interface to AXI DMA
@@ -52,6 +54,126 @@ struct axidma_dev {
     dma_channel_t *channels;    ///< All of the VDMA/DMA channels in the system
 };
 
+// The registers of an AXI DMA channel, as 32-bit word offsets (see PG021)
+#define RING_DMACR              (0x00 / 4)
+#define RING_DMASR              (0x04 / 4)
+#define RING_CURDESC            (0x08 / 4)
+#define RING_CURDESC_MSB        (0x0C / 4)
+#define RING_TAILDESC           (0x10 / 4)
+#define RING_TAILDESC_MSB       (0x14 / 4)
+
+// The DMACR run/stop bit, and the DMASR error bits
+#define RING_DMACR_RS           (1 << 0)
+#define RING_DMASR_ERRORS       0x770
+
+// The descriptor control and status bits, and the transfer length field
+#define RING_DESC_SOF           (1 << 27)
+#define RING_DESC_EOF           (1 << 26)
+#define RING_DESC_CMPLT         (1U << 31)
+#define RING_DESC_ERRORS        (7 << 28)
+#define RING_DESC_LENGTH        ((1 << 26) - 1)
+
+// An AXI DMA buffer descriptor, as laid out in the ring's memory
+struct ring_desc {
+    uint32_t next_desc;         ///< Bus address of the next descriptor
+    uint32_t next_desc_msb;     ///< Upper 32 bits of the next descriptor
+    uint32_t buffer_addr;       ///< Bus address of the buffer
+    uint32_t buffer_addr_msb;   ///< Upper 32 bits of the buffer address
+    uint32_t reserved[2];
+    uint32_t control;           ///< Transfer length, and packet framing
+    uint32_t status;            ///< Completion, errors, and bytes transferred
+    uint32_t app[5];            ///< User application fields
+    uint32_t padding[3];        ///< Pads the descriptor to 64 bytes
+};
+
+// The structure that represents a scatter-gather ring driven from userspace
+struct axidma_ring {
+    axidma_dev_t dev;           ///< The device the ring is attached through
+    int channel_id;             ///< The channel the ring is attached to
+    enum axidma_dir dir;        ///< Direction of the channel
+    volatile uint32_t *regs;    ///< The channel's registers
+    void *regs_map;             ///< The mapping of the register window
+    size_t regs_size;           ///< The size of the register window mapping
+    volatile struct ring_desc *descs;   ///< The descriptors of the ring
+    uint8_t *buffers;           ///< The buffers of the ring
+    void *mem;                  ///< The mapping of the ring's memory
+    size_t mem_size;            ///< The size of the ring's memory mapping
+    uint64_t dma_addr;          ///< Bus address of the ring's memory
+    int num_descs;              ///< The number of descriptors and buffers
+    size_t buffer_size;         ///< The usable size of each buffer
+    size_t buffer_stride;       ///< Bytes between the buffers
+    int head;                   ///< The oldest posted descriptor
+    int tail;                   ///< The next descriptor to post
+    int num_posted;             ///< The number of descriptors posted
+    int *buffer_indices;        ///< The buffer posted with each descriptor
+    int idle_budget;            ///< Microseconds to poll before sleeping
+};
+
+// The time to wait between polls of a windowed receive's progress
+#define WINDOW_POLL_NS          20000
+
+// A slot of an offload pipeline, holding one block and its result
+struct pipeline_slot {
+    void *tx_buf;               ///< The block sent to the accelerator
+    void *rx_buf;               ///< The result received back from it
+};
+
+/* The structure that represents an offload pipeline. The completion counts
+ * are bumped by the channels' callbacks, in the signal handler, and the other
+ * counts only by the caller. They may wrap, as only their differences are
+ * used. */
+struct axidma_pipeline {
+    axidma_dev_t dev;           ///< The device the channels belong to
+    int tx_channel;             ///< The channel feeding the accelerator
+    int rx_channel;             ///< The channel draining the accelerator
+    int depth;                  ///< The number of slots
+    size_t tx_block_size;       ///< The size of each transmit buffer
+    size_t rx_block_size;       ///< The size of each receive buffer
+    struct pipeline_slot *slots;    ///< The slots of the pipeline
+    int head;                   ///< The slot holding the oldest block
+    int tail;                   ///< The next slot to fill
+    unsigned int submitted;     ///< The number of blocks submitted
+    unsigned int released;      ///< The number of blocks released
+    unsigned int tx_done;       ///< The number of transmits completed
+    unsigned int rx_done;       ///< The number of receives completed
+    uint64_t blocks;            ///< Blocks released, without wrapping
+    uint64_t samples;           ///< Occupancy samples taken
+    uint64_t sending_total;     ///< The sum of the sending samples
+    uint64_t processing_total;  ///< The sum of the processing samples
+};
+
+// The time to wait between checks for a pipeline's oldest block
+#define PIPELINE_POLL_NS        20000
+
+// A channel of a striped stream, and its part of the transfer in progress
+struct stripe_channel {
+    int channel_id;             ///< The DMA channel
+    unsigned int queued;        ///< The chunks queued on the channel
+    unsigned int done;          ///< Chunks completed, bumped by the callback
+    int64_t done_ns;            ///< When the last chunk completed
+    uint64_t bytes;             ///< The bytes queued on the channel
+    struct axidma_stripe_stats stats;   ///< The channel's counters
+};
+
+// The structure that represents a stream striped across several channels
+struct axidma_stripe {
+    axidma_dev_t dev;           ///< The device the channels belong to
+    int width;                  ///< The number of channels
+    size_t chunk_size;          ///< The size of each chunk
+    struct stripe_channel *chans;   ///< The channels of the stream
+    uint8_t *buf;               ///< The buffer being transferred
+    size_t len;                 ///< The length of the transfer
+    size_t num_chunks;          ///< The number of chunks in the transfer
+    size_t next_chunk;          ///< The next chunk to hand to the callback
+    axidma_window_cb_t callback;    ///< The function to hand chunks to
+    void *data;                 ///< The data to pass to the function
+    int64_t start_ns;           ///< When the transfer started
+    struct axidma_stripe_stats stats;   ///< The stream's counters
+};
+
+// The most chunks queued on each channel of a striped stream at once
+#define STRIPE_MAX_QUEUED       8
+
 // The DMA device structure, and a boolean checking if it's already open
 struct axidma_dev axidma_dev = {0};
 
@@ -185,20 +307,36 @@ static int probe_channels(axidma_dev_t dev)
     return rc;
 }
 
+// Finds the DMA channel with the given id
+static dma_channel_t *find_channel(axidma_dev_t dev, int channel_id)
+{
+    int i;
+    dma_channel_t *dma_chan;
+
+    for (i = 0; i < dev->num_channels; i++)
+    {
+        dma_chan = &dev->channels[i];
+        if (dma_chan->channel_id == channel_id) {
+            return dma_chan;
+        }
+    }
+
+    return NULL;
+}
+
 static void axidma_callback(int signal, siginfo_t *siginfo, void *context)
 {
     int channel_id;
     dma_channel_t *chan;
 
-    assert(0 <= siginfo->si_int && siginfo->si_int < axidma_dev.num_channels);
-
     // Silence the compiler
     (void)signal;
     (void)context;
 
     // If the user defined a callback for a given channel, invoke it
     channel_id = siginfo->si_int;
-    chan = &axidma_dev.channels[channel_id];
+    chan = find_channel(&axidma_dev, channel_id);
+    assert(chan != NULL);
     if (chan->callback != NULL) {
         chan->callback(channel_id, chan->user_data);
     }
@@ -234,23 +372,6 @@ static int setup_dma_callback(axidma_dev_t dev)
     return 0;
 }
 
-// Finds the DMA channel with the given id
-static dma_channel_t *find_channel(axidma_dev_t dev, int channel_id)
-{
-    int i;
-    dma_channel_t *dma_chan;
-
-    for (i = 0; i < dev->num_channels; i++)
-    {
-        dma_chan = &dev->channels[i];
-        if (dma_chan->channel_id == channel_id) {
-            return dma_chan;
-        }
-    }
-
-    return NULL;
-}
-
 // Converts the AXI DMA direction to the corresponding ioctl for the transfer
 static unsigned long dir_to_ioctl(enum axidma_dir dir)
 {
@@ -365,6 +486,60 @@ void *axidma_malloc(axidma_dev_t dev, size_t size)
     return addr;
 }
 
+/* Allocates a region of memory from one of the memory region pools. The pool
+ * is selected by the page offset the region is mapped at. */
+void *axidma_malloc_pool(axidma_dev_t dev, size_t size, int pool)
+{
+    void *addr;
+    off_t offset;
+
+    if (pool < 0 || pool >= AXIDMA_MAX_POOLS) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    offset = (off_t)(AXIDMA_POOL_PGOFF + pool) * getpagesize();
+    addr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, dev->fd,
+                offset);
+    if (addr == MAP_FAILED) {
+        return NULL;
+    }
+
+    return addr;
+}
+
+// Looks up the index of a memory region pool by its name
+int axidma_find_pool(axidma_dev_t dev, const char *name)
+{
+    int i, rc;
+    struct axidma_pool_info info;
+
+    for (i = 0; i < AXIDMA_MAX_POOLS; i++)
+    {
+        rc = axidma_get_pool_info(dev, i, &info);
+        if (rc < 0) {
+            break;
+        } else if (strncmp(info.name, name, sizeof(info.name)) == 0) {
+            return i;
+        }
+    }
+
+    return -ENOENT;
+}
+
+// Gets the description and usage of a memory region pool
+int axidma_get_pool_info(axidma_dev_t dev, int pool,
+        struct axidma_pool_info *info)
+{
+    memset(info, 0, sizeof(*info));
+    info->index = pool;
+    if (ioctl(dev->fd, AXIDMA_GET_POOL_INFO, info) < 0) {
+        return -errno;
+    }
+
+    return 0;
+}
+
 /* This frees a region of memory that was allocated with a call to
  * axidma_malloc. The size passed in here must match the one used for that
  * call, or this function will throw an exception. */
@@ -390,7 +565,7 @@ void axidma_set_callback(axidma_dev_t dev, int channel, axidma_cb_t callback,
 
     assert(find_channel(dev, channel) != NULL);
 
-    chan = &dev->channels[channel];
+    chan = find_channel(dev, channel);
     chan->callback = callback;
     chan->user_data = data;
 
@@ -437,10 +612,23 @@ void axidma_unregister_buffer(axidma_dev_t dev, void *user_addr)
     return;
 }
 
-/* This performs a one-way transfer over AXI DMA, the direction being specified
- * by the user. The user determines if this is blocking or not with `wait. */
-int axidma_oneway_transfer(axidma_dev_t dev, int channel, void *buf,
-        size_t len, bool wait)
+// Gets the counts of the buffers the driver is keeping track of
+int axidma_get_buffer_stats(axidma_dev_t dev,
+        struct axidma_buffer_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (ioctl(dev->fd, AXIDMA_GET_BUFFER_STATS, stats) < 0) {
+        perror("Failed to get the driver's buffer stats");
+        return -errno;
+    }
+
+    return 0;
+}
+
+/* Performs a one-way transfer, splitting a receive into segments of the given
+ * size so that its progress can be followed, or not splitting it if 0. */
+static int oneway_transfer(axidma_dev_t dev, int channel, void *buf,
+        size_t len, size_t segment_size, bool wait)
 {
     int rc;
     struct axidma_transaction trans;
@@ -455,6 +643,7 @@ int axidma_oneway_transfer(axidma_dev_t dev, int channel, void *buf,
     trans.channel_id = channel;
     trans.buf = buf;
     trans.buf_len = len;
+    trans.segment_size = segment_size;
     axidma_cmd = dir_to_ioctl(dma_chan->dir);
 
     // Perform the given transfer
@@ -467,6 +656,14 @@ int axidma_oneway_transfer(axidma_dev_t dev, int channel, void *buf,
     return 0;
 }
 
+/* This performs a one-way transfer over AXI DMA, the direction being specified
+ * by the user. The user determines if this is blocking or not with `wait. */
+int axidma_oneway_transfer(axidma_dev_t dev, int channel, void *buf,
+        size_t len, bool wait)
+{
+    return oneway_transfer(dev, channel, buf, len, 0, wait);
+}
+
 /* This performs a two-way transfer over AXI DMA, both sending data out and
  * receiving it back over DMA. The user determines if this call is blocking. */
 int axidma_twoway_transfer(axidma_dev_t dev, int tx_channel, void *tx_buf,
@@ -535,6 +732,9 @@ int axidma_video_transfer(axidma_dev_t dev, int display_channel, size_t width,
     trans.frame.width = width;
     trans.frame.height = height;
     trans.frame.depth = depth;
+    trans.frame.stride = 0;
+    trans.frame.x_offset = 0;
+    trans.frame.y_offset = 0;
     axidma_cmd = (dma_chan->dir == AXIDMA_READ) ? AXIDMA_DMA_VIDEO_READ :
                                                   AXIDMA_DMA_VIDEO_WRITE;
     // Perform the video transfer
@@ -546,6 +746,39 @@ int axidma_video_transfer(axidma_dev_t dev, int display_channel, size_t width,
     return rc;
 }
 
+/* This function performs a video transfer like axidma_video_transfer, except
+ * that the frame can be a window of a larger frame buffer surface. The rows of
+ * the surface are `frame->stride` bytes apart, and the VDMA engine skips over
+ * the bytes outside of the window. */
+int axidma_video_transfer_frame(axidma_dev_t dev, int display_channel,
+        const struct axidma_video_frame *frame, void **frame_buffers,
+        int num_buffers)
+{
+    int rc;
+    unsigned long axidma_cmd;
+    struct axidma_video_transaction trans;
+    dma_channel_t *dma_chan;
+
+    assert(find_channel(dev, display_channel) != NULL);
+    assert(find_channel(dev, display_channel)->type == AXIDMA_VDMA);
+
+    // Setup the argument structure for the IOCTL
+    dma_chan = find_channel(dev, display_channel);
+    trans.channel_id = display_channel;
+    trans.num_frame_buffers = num_buffers;
+    trans.frame_buffers = frame_buffers;
+    memcpy(&trans.frame, frame, sizeof(trans.frame));
+    axidma_cmd = (dma_chan->dir == AXIDMA_READ) ? AXIDMA_DMA_VIDEO_READ :
+                                                  AXIDMA_DMA_VIDEO_WRITE;
+    // Perform the video transfer
+    rc = ioctl(dev->fd, axidma_cmd, &trans);
+    if (rc < 0) {
+        perror("Failed to perform the AXI DMA video transfer");
+    }
+
+    return rc;
+}
+
 /* This function stops all transfers on the given channel with the given
  * direction. This function is required to stop any video transfers, or any
  * non-blocking transfers. */
@@ -570,3 +803,1102 @@ void axidma_stop_transfer(axidma_dev_t dev, int channel)
 
     return;
 }
+
+// Gets the bytes transferred so far by the channel's last transfer
+ssize_t axidma_transfer_progress(axidma_dev_t dev, int channel,
+        bool *complete)
+{
+    struct axidma_progress progress;
+
+    assert(find_channel(dev, channel) != NULL);
+
+    memset(&progress, 0, sizeof(progress));
+    progress.channel_id = channel;
+    if (ioctl(dev->fd, AXIDMA_GET_PROGRESS, &progress) < 0) {
+        perror("Failed to get the progress of the transfer");
+        return -errno;
+    }
+
+    *complete = progress.complete;
+    return progress.transferred;
+}
+
+// Gets the number of transfers completed on the channel so far
+int64_t axidma_transfers_completed(axidma_dev_t dev, int channel)
+{
+    struct axidma_progress progress;
+
+    assert(find_channel(dev, channel) != NULL);
+
+    memset(&progress, 0, sizeof(progress));
+    progress.channel_id = channel;
+    if (ioctl(dev->fd, AXIDMA_GET_PROGRESS, &progress) < 0) {
+        perror("Failed to get the transfers completed on the channel");
+        return -errno;
+    }
+
+    return progress.num_completed;
+}
+
+/* Gets the bytes that the completed transfer received, from the residue that
+ * the driver kept for it, as long as it is one of the last ones it kept. */
+ssize_t axidma_received_length(axidma_dev_t dev, int channel,
+        uint64_t transfer, size_t length)
+{
+    size_t residue;
+    struct axidma_progress progress;
+
+    assert(find_channel(dev, channel) != NULL);
+
+    memset(&progress, 0, sizeof(progress));
+    progress.channel_id = channel;
+    if (ioctl(dev->fd, AXIDMA_GET_PROGRESS, &progress) < 0) {
+        perror("Failed to get the transfers completed on the channel");
+        return -errno;
+    }
+
+    if (transfer >= progress.num_completed) {
+        return -EAGAIN;
+    } else if (progress.num_completed - transfer > AXIDMA_PROGRESS_HISTORY) {
+        return -ENOENT;
+    }
+    residue = progress.residues[transfer % AXIDMA_PROGRESS_HISTORY];
+    return (residue < length) ? length - residue : 0;
+}
+
+/* Starts the receive, then polls its progress, handing each window on once
+ * all of it has landed. The progress is read before the data, so a barrier
+ * keeps the data from being read ahead of it. */
+int axidma_windowed_read(axidma_dev_t dev, int channel, void *buf, size_t len,
+        size_t window_size, axidma_window_cb_t callback, void *data,
+        int timeout)
+{
+    int rc;
+    bool complete;
+    size_t offset, length;
+    ssize_t transferred;
+    struct timespec start, now, pause;
+
+    assert(find_channel(dev, channel) != NULL);
+    assert(find_channel(dev, channel)->dir == AXIDMA_READ);
+    assert(window_size > 0);
+
+    // Split the receive into windows, so the engine reports each one landing
+    rc = oneway_transfer(dev, channel, buf, len, window_size, false);
+    if (rc < 0) {
+        return -errno;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pause.tv_sec = 0;
+    pause.tv_nsec = WINDOW_POLL_NS;
+    offset = 0;
+    complete = false;
+    while (offset < len)
+    {
+        transferred = axidma_transfer_progress(dev, channel, &complete);
+        if (transferred < 0) {
+            return transferred;
+        }
+        __sync_synchronize();
+
+        // A receive that ended early only has windows up to where it ended
+        if (complete && (size_t)transferred < len) {
+            len = transferred;
+        }
+
+        // Hand on the windows that have landed, or all of them once complete
+        while (offset < len &&
+               (complete || offset + window_size <= (size_t)transferred))
+        {
+            length = (len - offset < window_size) ? len - offset : window_size;
+            rc = callback((uint8_t *)buf + offset, offset, length, data);
+            if (rc != 0) {
+                if (!complete) {
+                    axidma_stop_transfer(dev, channel);
+                }
+                return rc;
+            }
+            offset += length;
+        }
+        if (complete) {
+            break;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (timeout >= 0 && (now.tv_sec - start.tv_sec) * 1000 +
+                (now.tv_nsec - start.tv_nsec) / 1000000 >= timeout) {
+            axidma_stop_transfer(dev, channel);
+            return -ETIMEDOUT;
+        }
+        nanosleep(&pause, NULL);
+    }
+
+    return 0;
+}
+
+/* Sets the run-time VDMA parameters (parking, genlock, frame delay, interrupt
+ * coalescing) for the given channel. The driver validates the parameters. */
+int axidma_set_vdma_config(axidma_dev_t dev, int channel,
+        const struct axidma_vdma_config *config)
+{
+    int rc;
+    struct axidma_vdma_config vdma_config;
+
+    assert(find_channel(dev, channel) != NULL);
+    assert(find_channel(dev, channel)->type == AXIDMA_VDMA);
+
+    // Setup the argument structure for the IOCTL
+    memcpy(&vdma_config, config, sizeof(vdma_config));
+    vdma_config.channel_id = channel;
+
+    // Apply the parameters to the channel
+    rc = ioctl(dev->fd, AXIDMA_SET_VDMA_CONFIG, &vdma_config);
+    if (rc < 0) {
+        perror("Failed to set the VDMA channel config");
+    }
+
+    return rc;
+}
+
+// Gets the current run-time VDMA parameters for the given channel
+int axidma_get_vdma_config(axidma_dev_t dev, int channel,
+        struct axidma_vdma_config *config)
+{
+    int rc;
+
+    assert(find_channel(dev, channel) != NULL);
+    assert(find_channel(dev, channel)->type == AXIDMA_VDMA);
+
+    // Query the driver for the channel's parameters
+    config->channel_id = channel;
+    rc = ioctl(dev->fd, AXIDMA_GET_VDMA_CONFIG, config);
+    if (rc < 0) {
+        perror("Failed to get the VDMA channel config");
+    }
+
+    return rc;
+}
+
+/* Takes the next (or the latest) completed frame from the video transfer on
+ * the channel, waiting for up to the timeout for one. Timeouts are expected
+ * while polling, so the error code is returned rather than printed. */
+int axidma_video_get_frame(axidma_dev_t dev, int channel, int timeout,
+        bool latest, struct axidma_frame_event *event)
+{
+    assert(find_channel(dev, channel) != NULL);
+    assert(find_channel(dev, channel)->type == AXIDMA_VDMA);
+
+    // Setup the argument structure for the IOCTL
+    memset(event, 0, sizeof(*event));
+    event->channel_id = channel;
+    event->flags = latest ? AXIDMA_FRAME_LATEST : 0;
+    event->timeout = timeout;
+
+    // Take a frame from the driver, waiting for one if needed
+    if (ioctl(dev->fd, AXIDMA_GET_VIDEO_FRAME, event) < 0) {
+        return -errno;
+    }
+
+    return 0;
+}
+
+/* Gives a frame buffer back to the video transfer on the channel, so that the
+ * VDMA engine can use it again. */
+int axidma_video_put_frame(axidma_dev_t dev, int channel, int buffer_index)
+{
+    int rc;
+    struct axidma_frame_event event;
+
+    assert(find_channel(dev, channel) != NULL);
+    assert(find_channel(dev, channel)->type == AXIDMA_VDMA);
+
+    // Setup the argument structure for the IOCTL
+    memset(&event, 0, sizeof(event));
+    event.channel_id = channel;
+    event.buffer_index = buffer_index;
+
+    // Release the frame buffer back to the driver
+    rc = ioctl(dev->fd, AXIDMA_PUT_VIDEO_FRAME, &event);
+    if (rc < 0) {
+        perror("Failed to put the video frame");
+    }
+
+    return rc;
+}
+
+// Gets the frame statistics for the video transfer on the channel
+int axidma_video_get_stats(axidma_dev_t dev, int channel,
+        struct axidma_video_stats *stats)
+{
+    int rc;
+
+    assert(find_channel(dev, channel) != NULL);
+    assert(find_channel(dev, channel)->type == AXIDMA_VDMA);
+
+    // Query the driver for the transfer's statistics
+    stats->channel_id = channel;
+    rc = ioctl(dev->fd, AXIDMA_GET_VIDEO_STATS, stats);
+    if (rc < 0) {
+        perror("Failed to get the video statistics");
+    }
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------
+ * Userspace Rings
+ *----------------------------------------------------------------------------*/
+
+// Gets the monotonic time in microseconds
+static int64_t ring_time_us()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// Checks if the engine has completed the oldest posted descriptor
+static bool ring_head_done(axidma_ring_t ring)
+{
+    return (ring->descs[ring->head].status & RING_DESC_CMPLT) != 0;
+}
+
+/* Attaches a ring to the DMA channel, mapping the channel's registers and the
+ * ring's memory into the process, and then starting the channel. */
+axidma_ring_t axidma_ring_attach(axidma_dev_t dev, int channel,
+        int num_buffers, size_t buffer_size)
+{
+    long page_size;
+    void *regs, *mem;
+    axidma_ring_t ring;
+    dma_channel_t *dma_chan;
+    struct axidma_ring_info info;
+
+    dma_chan = find_channel(dev, channel);
+    assert(dma_chan != NULL);
+    assert(dma_chan->type == AXIDMA_DMA);
+
+    // Have the driver hand over the channel and allocate the ring
+    memset(&info, 0, sizeof(info));
+    info.channel_id = channel;
+    info.num_descriptors = num_buffers;
+    info.buffer_size = buffer_size;
+    if (ioctl(dev->fd, AXIDMA_ATTACH_RING, &info) < 0) {
+        perror("Failed to attach the ring");
+        return NULL;
+    }
+
+    // Map the channel's registers and the ring's memory
+    page_size = sysconf(_SC_PAGESIZE);
+    regs = mmap(NULL, info.regs_size, PROT_READ|PROT_WRITE, MAP_SHARED,
+                dev->fd, AXIDMA_RING_REGS_PGOFF * page_size);
+    if (regs == MAP_FAILED) {
+        perror("Failed to map the ring's registers");
+        goto detach_ring;
+    }
+    mem = mmap(NULL, info.ring_size, PROT_READ|PROT_WRITE, MAP_SHARED,
+               dev->fd, AXIDMA_RING_MEM_PGOFF * page_size);
+    if (mem == MAP_FAILED) {
+        perror("Failed to map the ring's memory");
+        goto unmap_regs;
+    }
+
+    ring = axidma_ring_create((volatile uint32_t *)((uint8_t *)regs +
+                info.regs_offset), mem, info.ring_dma_addr, dma_chan->dir,
+                num_buffers, buffer_size);
+    if (ring == NULL) {
+        perror("Failed to create the ring");
+        goto unmap_mem;
+    }
+    ring->dev = dev;
+    ring->channel_id = channel;
+    ring->regs_map = regs;
+    ring->regs_size = info.regs_size;
+    ring->mem_size = info.ring_size;
+
+    return ring;
+
+unmap_mem:
+    munmap(mem, info.ring_size);
+unmap_regs:
+    munmap(regs, info.regs_size);
+detach_ring:
+    ioctl(dev->fd, AXIDMA_DETACH_RING, channel);
+    return NULL;
+}
+
+/* Creates a ring over the given registers and memory. The descriptors are
+ * chained into a loop, and the channel is started at the first one. No
+ * descriptors are posted, so the engine stays idle until the tail is set. */
+axidma_ring_t axidma_ring_create(volatile uint32_t *regs, void *mem,
+        uint64_t dma_addr, enum axidma_dir dir, int num_buffers,
+        size_t buffer_size)
+{
+    int i;
+    uint64_t next_addr;
+    axidma_ring_t ring;
+
+    if (num_buffers < AXIDMA_RING_MIN_DESCRIPTORS ||
+        num_buffers > AXIDMA_RING_MAX_DESCRIPTORS ||
+        buffer_size == 0 || buffer_size > RING_DESC_LENGTH) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    ring = calloc(1, sizeof(*ring));
+    if (ring == NULL) {
+        return NULL;
+    }
+    ring->buffer_indices = calloc(num_buffers, sizeof(int));
+    if (ring->buffer_indices == NULL) {
+        free(ring);
+        return NULL;
+    }
+
+    // The buffers follow the descriptors, each aligned like a descriptor
+    ring->channel_id = -1;
+    ring->idle_budget = AXIDMA_RING_DEFAULT_IDLE_BUDGET;
+    ring->dir = dir;
+    ring->regs = regs;
+    ring->mem = mem;
+    ring->dma_addr = dma_addr;
+    ring->num_descs = num_buffers;
+    ring->buffer_size = buffer_size;
+    ring->buffer_stride = (buffer_size + AXIDMA_RING_DESC_SIZE - 1) &
+                          ~(size_t)(AXIDMA_RING_DESC_SIZE - 1);
+    ring->descs = mem;
+    ring->buffers = (uint8_t *)mem + num_buffers * AXIDMA_RING_DESC_SIZE;
+
+    // Chain the descriptors into a loop
+    memset(mem, 0, num_buffers * AXIDMA_RING_DESC_SIZE);
+    for (i = 0; i < num_buffers; i++)
+    {
+        next_addr = dma_addr + ((i + 1) % num_buffers) *
+                    AXIDMA_RING_DESC_SIZE;
+        ring->descs[i].next_desc = (uint32_t)next_addr;
+        ring->descs[i].next_desc_msb = (uint32_t)(next_addr >> 32);
+    }
+
+    // Point the halted channel at the first descriptor, then start it
+    __sync_synchronize();
+    regs[RING_CURDESC_MSB] = (uint32_t)(dma_addr >> 32);
+    regs[RING_CURDESC] = (uint32_t)dma_addr;
+    regs[RING_DMACR] = RING_DMACR_RS;
+
+    return ring;
+}
+
+/* Stops the ring's channel, and gives it back to the driver if the ring was
+ * attached through it. */
+void axidma_ring_detach(axidma_ring_t ring)
+{
+    ring->regs[RING_DMACR] = 0;
+
+    if (ring->dev != NULL) {
+        munmap(ring->mem, ring->mem_size);
+        munmap(ring->regs_map, ring->regs_size);
+        if (ioctl(ring->dev->fd, AXIDMA_DETACH_RING, ring->channel_id) < 0) {
+            perror("Failed to detach the ring");
+        }
+    }
+
+    free(ring->buffer_indices);
+    free(ring);
+    return;
+}
+
+// Gets the address of the buffer in the ring
+void *axidma_ring_buffer(axidma_ring_t ring, int buffer_index)
+{
+    assert(buffer_index >= 0 && buffer_index < ring->num_descs);
+    return ring->buffers + buffer_index * ring->buffer_stride;
+}
+
+// Gets the size of the buffers in the ring
+size_t axidma_ring_buffer_size(axidma_ring_t ring)
+{
+    return ring->buffer_size;
+}
+
+/* Posts the buffer with the next free descriptor, then moves the channel's
+ * tail to it. The descriptor must be in memory before the tail is written,
+ * since that is what makes the engine fetch it. */
+int axidma_ring_post(axidma_ring_t ring, int buffer_index, size_t length)
+{
+    uint64_t buffer_addr, desc_addr;
+    volatile struct ring_desc *desc;
+
+    if (buffer_index < 0 || buffer_index >= ring->num_descs ||
+        length == 0 || length > ring->buffer_size) {
+        return -EINVAL;
+    } else if (ring->num_posted == ring->num_descs) {
+        return -ENOSPC;
+    }
+
+    // Fill in the descriptor, clearing the status left from its last use
+    desc = &ring->descs[ring->tail];
+    buffer_addr = ring->dma_addr + ring->num_descs * AXIDMA_RING_DESC_SIZE +
+                  buffer_index * ring->buffer_stride;
+    desc->buffer_addr = (uint32_t)buffer_addr;
+    desc->buffer_addr_msb = (uint32_t)(buffer_addr >> 32);
+    desc->control = length;
+    if (ring->dir == AXIDMA_WRITE) {
+        desc->control |= RING_DESC_SOF | RING_DESC_EOF;
+    }
+    desc->status = 0;
+    ring->buffer_indices[ring->tail] = buffer_index;
+
+    // Hand the descriptor to the engine
+    desc_addr = ring->dma_addr + ring->tail * AXIDMA_RING_DESC_SIZE;
+    __sync_synchronize();
+    ring->regs[RING_TAILDESC_MSB] = (uint32_t)(desc_addr >> 32);
+    ring->regs[RING_TAILDESC] = (uint32_t)desc_addr;
+
+    ring->tail = (ring->tail + 1) % ring->num_descs;
+    ring->num_posted += 1;
+    return 0;
+}
+
+/* Takes back the oldest posted descriptor, if the engine has marked it as
+ * complete. The buffer is only read after the completion bit is seen. */
+int axidma_ring_reap(axidma_ring_t ring, struct axidma_ring_completion *done)
+{
+    uint32_t status;
+    volatile struct ring_desc *desc;
+
+    if (ring->num_posted == 0) {
+        return 0;
+    }
+
+    desc = &ring->descs[ring->head];
+    status = desc->status;
+    if ((status & RING_DESC_CMPLT) == 0) {
+        return 0;
+    }
+    __sync_synchronize();
+
+    done->buffer_index = ring->buffer_indices[ring->head];
+    done->length = status & RING_DESC_LENGTH;
+    done->error = (status & RING_DESC_ERRORS) != 0;
+    desc->status = 0;
+
+    ring->head = (ring->head + 1) % ring->num_descs;
+    ring->num_posted -= 1;
+    return 1;
+}
+
+// Gets the number of buffers held by the ring's engine
+int axidma_ring_pending(axidma_ring_t ring)
+{
+    return ring->num_posted;
+}
+
+// Checks the channel's status register for an error
+int axidma_ring_status(axidma_ring_t ring)
+{
+    return (ring->regs[RING_DMASR] & RING_DMASR_ERRORS) ? -EIO : 0;
+}
+
+void axidma_ring_set_idle_budget(axidma_ring_t ring, int budget)
+{
+    assert(budget >= 0);
+    ring->idle_budget = budget;
+}
+
+/* Polls the oldest descriptor for the idle budget, then has the driver sleep
+ * on the channel's interrupt until it completes. The interrupt can also be
+ * for an error, or left from an earlier descriptor, so the descriptor is
+ * checked again each time the thread is woken. */
+int axidma_ring_wait(axidma_ring_t ring, int timeout)
+{
+    int64_t start, now, deadline, idle_end;
+    struct axidma_ring_wait wait;
+
+    if (ring->num_posted == 0) {
+        return 0;
+    }
+
+    start = ring_time_us();
+    deadline = (timeout < 0) ? INT64_MAX : start + (int64_t)timeout * 1000;
+    idle_end = start + ring->idle_budget;
+    while (true)
+    {
+        if (ring_head_done(ring)) {
+            __sync_synchronize();
+            return 1;
+        }
+
+        now = ring_time_us();
+        if (now >= deadline) {
+            return 0;
+        } else if (now < idle_end || ring->dev == NULL) {
+            continue;
+        }
+
+        // The ring has been idle for the budget, so sleep on the interrupt
+        memset(&wait, 0, sizeof(wait));
+        wait.channel_id = ring->channel_id;
+        wait.desc_index = ring->head;
+        wait.timeout = (timeout < 0) ? -1 : (deadline - now + 999) / 1000;
+        if (ioctl(ring->dev->fd, AXIDMA_WAIT_RING, &wait) < 0) {
+            if (errno == ETIMEDOUT) {
+                return ring_head_done(ring) ? 1 : 0;
+            } else if (errno == EINTR) {
+                return -EINTR;
+            } else if (errno == EOPNOTSUPP) {
+                idle_end = INT64_MAX;
+                continue;
+            }
+            perror("Failed to wait on the ring's interrupt");
+            return -errno;
+        }
+    }
+}
+
+int axidma_ring_get_stats(axidma_ring_t ring, struct axidma_ring_stats *stats)
+{
+    if (ring->dev == NULL) {
+        return -ENODEV;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->channel_id = ring->channel_id;
+    if (ioctl(ring->dev->fd, AXIDMA_GET_RING_STATS, stats) < 0) {
+        perror("Failed to get the ring's stats");
+        return -errno;
+    }
+
+    return 0;
+}
+
+/* Adds up the lengths of the completed descriptors from the oldest posted one
+ * on, stopping at the first that the engine hasn't finished. */
+size_t axidma_ring_progress(axidma_ring_t ring)
+{
+    int i, desc;
+    size_t bytes;
+    uint32_t status;
+
+    bytes = 0;
+    for (i = 0; i < ring->num_posted; i++)
+    {
+        desc = (ring->head + i) % ring->num_descs;
+        status = ring->descs[desc].status;
+        if ((status & RING_DESC_CMPLT) == 0) {
+            break;
+        }
+        bytes += status & RING_DESC_LENGTH;
+    }
+
+    return bytes;
+}
+
+/*----------------------------------------------------------------------------
+ * Offload Pipelines
+ *----------------------------------------------------------------------------*/
+
+// Counts a completed transmit, called from the signal handler
+static void pipeline_tx_done(int channel_id, void *data)
+{
+    axidma_pipeline_t pipe;
+
+    (void)channel_id;
+    pipe = data;
+    __atomic_add_fetch(&pipe->tx_done, 1, __ATOMIC_RELEASE);
+    return;
+}
+
+// Counts a completed receive, called from the signal handler
+static void pipeline_rx_done(int channel_id, void *data)
+{
+    axidma_pipeline_t pipe;
+
+    (void)channel_id;
+    pipe = data;
+    __atomic_add_fetch(&pipe->rx_done, 1, __ATOMIC_RELEASE);
+    return;
+}
+
+// Frees the buffers of the first num_slots slots, and the pipeline itself
+static void pipeline_free(axidma_pipeline_t pipe, int num_slots)
+{
+    int i;
+
+    for (i = 0; i < num_slots; i++)
+    {
+        axidma_free(pipe->dev, pipe->slots[i].tx_buf, pipe->tx_block_size);
+        axidma_free(pipe->dev, pipe->slots[i].rx_buf, pipe->rx_block_size);
+    }
+    free(pipe->slots);
+    free(pipe);
+    return;
+}
+
+/* Allocates the buffers for each slot, then takes over the channels'
+ * callbacks to count completions. */
+axidma_pipeline_t axidma_pipeline_create(axidma_dev_t dev, int tx_channel,
+        int rx_channel, int depth, size_t tx_block_size, size_t rx_block_size)
+{
+    int i;
+    axidma_pipeline_t pipe;
+    struct pipeline_slot *slot;
+
+    assert(find_channel(dev, tx_channel) != NULL);
+    assert(find_channel(dev, tx_channel)->dir == AXIDMA_WRITE);
+    assert(find_channel(dev, rx_channel) != NULL);
+    assert(find_channel(dev, rx_channel)->dir == AXIDMA_READ);
+
+    if (depth <= 0 || depth > AXIDMA_MAX_QUEUED || tx_block_size == 0 ||
+            rx_block_size == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    pipe = calloc(1, sizeof(*pipe));
+    if (pipe == NULL) {
+        return NULL;
+    }
+    pipe->slots = calloc(depth, sizeof(pipe->slots[0]));
+    if (pipe->slots == NULL) {
+        free(pipe);
+        return NULL;
+    }
+    pipe->dev = dev;
+    pipe->tx_channel = tx_channel;
+    pipe->rx_channel = rx_channel;
+    pipe->depth = depth;
+    pipe->tx_block_size = tx_block_size;
+    pipe->rx_block_size = rx_block_size;
+
+    for (i = 0; i < depth; i++)
+    {
+        slot = &pipe->slots[i];
+        slot->tx_buf = axidma_malloc(dev, tx_block_size);
+        if (slot->tx_buf == NULL) {
+            goto free_slots;
+        }
+        slot->rx_buf = axidma_malloc(dev, rx_block_size);
+        if (slot->rx_buf == NULL) {
+            axidma_free(dev, slot->tx_buf, tx_block_size);
+            goto free_slots;
+        }
+    }
+
+    axidma_set_callback(dev, tx_channel, pipeline_tx_done, pipe);
+    axidma_set_callback(dev, rx_channel, pipeline_rx_done, pipe);
+    return pipe;
+
+free_slots:
+    perror("Failed to allocate the pipeline's buffers");
+    pipeline_free(pipe, i);
+    return NULL;
+}
+
+/* Stops both channels, so that nothing lands in the buffers once they are
+ * freed, then removes the callbacks. */
+void axidma_pipeline_destroy(axidma_pipeline_t pipe)
+{
+    axidma_stop_transfer(pipe->dev, pipe->tx_channel);
+    axidma_stop_transfer(pipe->dev, pipe->rx_channel);
+    axidma_set_callback(pipe->dev, pipe->tx_channel, NULL, NULL);
+    axidma_set_callback(pipe->dev, pipe->rx_channel, NULL, NULL);
+    pipeline_free(pipe, pipe->depth);
+    return;
+}
+
+void *axidma_pipeline_input(axidma_pipeline_t pipe)
+{
+    if (pipe->submitted - pipe->released == (unsigned int)pipe->depth) {
+        return NULL;
+    }
+
+    return pipe->slots[pipe->tail].tx_buf;
+}
+
+/* Queues the block's receive, then its transmit, and samples the occupancy
+ * of the stages with the block in them. */
+int axidma_pipeline_submit(axidma_pipeline_t pipe, size_t tx_len)
+{
+    struct pipeline_slot *slot;
+    struct axidma_pipeline_occupancy occupancy;
+
+    assert(tx_len <= pipe->tx_block_size);
+
+    if (pipe->submitted - pipe->released == (unsigned int)pipe->depth) {
+        return -ENOSPC;
+    }
+
+    slot = &pipe->slots[pipe->tail];
+    if (axidma_oneway_transfer(pipe->dev, pipe->rx_channel, slot->rx_buf,
+            pipe->rx_block_size, false) < 0) {
+        return -errno;
+    }
+    if (axidma_oneway_transfer(pipe->dev, pipe->tx_channel, slot->tx_buf,
+            tx_len, false) < 0) {
+        return -errno;
+    }
+    pipe->tail = (pipe->tail + 1) % pipe->depth;
+    pipe->submitted += 1;
+
+    axidma_pipeline_get_occupancy(pipe, &occupancy);
+    pipe->samples += 1;
+    pipe->sending_total += occupancy.sending;
+    pipe->processing_total += occupancy.processing;
+    return 0;
+}
+
+/* Polls for the oldest block's receive. The completion signal interrupts the
+ * sleep, so the block is usually picked up as soon as it lands. */
+void *axidma_pipeline_output(axidma_pipeline_t pipe, int timeout)
+{
+    struct timespec start, now, pause;
+
+    if (pipe->submitted == pipe->released) {
+        errno = ENODATA;
+        return NULL;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pause.tv_sec = 0;
+    pause.tv_nsec = PIPELINE_POLL_NS;
+    while (__atomic_load_n(&pipe->rx_done, __ATOMIC_ACQUIRE) == pipe->released)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (timeout >= 0 && (now.tv_sec - start.tv_sec) * 1000 +
+                (now.tv_nsec - start.tv_nsec) / 1000000 >= timeout) {
+            errno = ETIMEDOUT;
+            return NULL;
+        }
+        nanosleep(&pause, NULL);
+    }
+
+    return pipe->slots[pipe->head].rx_buf;
+}
+
+void axidma_pipeline_release(axidma_pipeline_t pipe)
+{
+    assert(__atomic_load_n(&pipe->rx_done, __ATOMIC_ACQUIRE) !=
+           pipe->released);
+
+    pipe->head = (pipe->head + 1) % pipe->depth;
+    pipe->released += 1;
+    pipe->blocks += 1;
+    return;
+}
+
+/* Works out the stages from the completion counts. The two channels' signals
+ * can arrive in either order, so a receive may be counted before its
+ * transmit, and the processing stage is kept from going negative. */
+void axidma_pipeline_get_occupancy(axidma_pipeline_t pipe,
+        struct axidma_pipeline_occupancy *occupancy)
+{
+    unsigned int tx_done, rx_done, in_flight;
+
+    tx_done = __atomic_load_n(&pipe->tx_done, __ATOMIC_ACQUIRE);
+    rx_done = __atomic_load_n(&pipe->rx_done, __ATOMIC_ACQUIRE);
+    in_flight = pipe->submitted - pipe->released;
+
+    occupancy->free = pipe->depth - in_flight;
+    occupancy->sending = pipe->submitted - tx_done;
+    occupancy->received = rx_done - pipe->released;
+    occupancy->processing = in_flight - occupancy->sending -
+                            occupancy->received;
+    if (occupancy->processing < 0) {
+        occupancy->processing = 0;
+    }
+    occupancy->blocks = pipe->blocks;
+    if (pipe->samples == 0) {
+        occupancy->avg_sending = 0.0;
+        occupancy->avg_processing = 0.0;
+    } else {
+        occupancy->avg_sending = (double)pipe->sending_total / pipe->samples;
+        occupancy->avg_processing = (double)pipe->processing_total /
+                                    pipe->samples;
+    }
+    return;
+}
+
+/*----------------------------------------------------------------------------
+ * Striped Streams
+ *----------------------------------------------------------------------------*/
+
+// Gets the current time in nanoseconds, this is safe in a signal handler
+static int64_t stripe_time_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// Counts a completed chunk on a channel, called from the signal handler
+static void stripe_chunk_done(int channel_id, void *data)
+{
+    struct stripe_channel *chan;
+
+    (void)channel_id;
+    chan = data;
+    chan->done_ns = stripe_time_ns();
+    __atomic_add_fetch(&chan->done, 1, __ATOMIC_RELEASE);
+    return;
+}
+
+// Sets up the stream for a new transfer of the buffer
+static void stripe_begin(axidma_stripe_t stripe, void *buf, size_t len,
+        axidma_window_cb_t callback, void *data)
+{
+    int i;
+
+    for (i = 0; i < stripe->width; i++)
+    {
+        stripe->chans[i].queued = 0;
+        stripe->chans[i].bytes = 0;
+        __atomic_store_n(&stripe->chans[i].done, 0, __ATOMIC_RELEASE);
+    }
+    stripe->buf = buf;
+    stripe->len = len;
+    stripe->num_chunks = (len + stripe->chunk_size - 1) / stripe->chunk_size;
+    stripe->next_chunk = 0;
+    stripe->callback = callback;
+    stripe->data = data;
+    stripe->start_ns = stripe_time_ns();
+    return;
+}
+
+/* Tops up the chunks queued on each channel, then hands the chunks that have
+ * completed to the callback, in order. Each channel completes its chunks in
+ * the order they were queued, so chunk i is done once its channel has
+ * completed more than i / width of them. */
+static int stripe_step(axidma_stripe_t stripe, bool *done)
+{
+    int i, rc;
+    size_t chunk, offset, length;
+    struct stripe_channel *chan;
+
+    for (i = 0; i < stripe->width; i++)
+    {
+        chan = &stripe->chans[i];
+        while (chan->queued - __atomic_load_n(&chan->done, __ATOMIC_ACQUIRE) <
+               STRIPE_MAX_QUEUED)
+        {
+            chunk = (size_t)chan->queued * stripe->width + i;
+            if (chunk >= stripe->num_chunks) {
+                break;
+            }
+
+            offset = chunk * stripe->chunk_size;
+            length = stripe->len - offset;
+            if (length > stripe->chunk_size) {
+                length = stripe->chunk_size;
+            }
+            if (axidma_oneway_transfer(stripe->dev, chan->channel_id,
+                    stripe->buf + offset, length, false) < 0) {
+                return -errno;
+            }
+            chan->queued += 1;
+            chan->bytes += length;
+        }
+    }
+
+    while (stripe->next_chunk < stripe->num_chunks)
+    {
+        chan = &stripe->chans[stripe->next_chunk % stripe->width];
+        if (__atomic_load_n(&chan->done, __ATOMIC_ACQUIRE) <=
+                stripe->next_chunk / stripe->width) {
+            break;
+        }
+
+        if (stripe->callback != NULL) {
+            offset = stripe->next_chunk * stripe->chunk_size;
+            length = stripe->len - offset;
+            if (length > stripe->chunk_size) {
+                length = stripe->chunk_size;
+            }
+            rc = stripe->callback(stripe->buf + offset, offset, length,
+                                  stripe->data);
+            if (rc != 0) {
+                return rc;
+            }
+        }
+        stripe->next_chunk += 1;
+    }
+
+    *done = stripe->next_chunk == stripe->num_chunks;
+    return 0;
+}
+
+// Adds the finished transfer to the counters of the stream and its channels
+static void stripe_finish(axidma_stripe_t stripe)
+{
+    int i;
+    struct stripe_channel *chan;
+
+    for (i = 0; i < stripe->width; i++)
+    {
+        chan = &stripe->chans[i];
+        if (chan->queued == 0) {
+            continue;
+        }
+        chan->stats.bytes += chan->bytes;
+        chan->stats.time_ns += chan->done_ns - stripe->start_ns;
+    }
+    stripe->stats.bytes += stripe->len;
+    stripe->stats.time_ns += stripe_time_ns() - stripe->start_ns;
+    return;
+}
+
+// Stops the chunks still in flight on the stream's channels
+static void stripe_abort(axidma_stripe_t stripe)
+{
+    int i;
+
+    for (i = 0; i < stripe->width; i++)
+    {
+        axidma_stop_transfer(stripe->dev, stripe->chans[i].channel_id);
+    }
+    return;
+}
+
+/* Steps each of the transfers until all of them are done, sleeping between
+ * steps. The completion signals interrupt the sleep, so the next chunks are
+ * usually queued as soon as a channel frees up. */
+static int stripe_run(axidma_stripe_t *stripes, int num_stripes, int timeout)
+{
+    int i, rc, num_done;
+    bool done;
+    int64_t start_ns;
+    struct timespec pause;
+
+    start_ns = stripe_time_ns();
+    pause.tv_sec = 0;
+    pause.tv_nsec = PIPELINE_POLL_NS;
+    while (true)
+    {
+        num_done = 0;
+        for (i = 0; i < num_stripes; i++)
+        {
+            rc = stripe_step(stripes[i], &done);
+            if (rc != 0) {
+                goto abort;
+            }
+            num_done += done;
+        }
+        if (num_done == num_stripes) {
+            break;
+        }
+
+        if (timeout >= 0 &&
+                stripe_time_ns() - start_ns >= (int64_t)timeout * 1000000) {
+            rc = -ETIMEDOUT;
+            goto abort;
+        }
+        nanosleep(&pause, NULL);
+    }
+
+    for (i = 0; i < num_stripes; i++)
+    {
+        stripe_finish(stripes[i]);
+    }
+    return 0;
+
+abort:
+    for (i = 0; i < num_stripes; i++)
+    {
+        stripe_abort(stripes[i]);
+    }
+    return rc;
+}
+
+// Sets up the stream's channels, and takes over their callbacks
+axidma_stripe_t axidma_stripe_create(axidma_dev_t dev, const int *channels,
+        int width, size_t chunk_size)
+{
+    int i;
+    axidma_stripe_t stripe;
+
+    if (width <= 0 || chunk_size == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    for (i = 0; i < width; i++)
+    {
+        assert(find_channel(dev, channels[i]) != NULL);
+        assert(find_channel(dev, channels[i])->dir ==
+               find_channel(dev, channels[0])->dir);
+    }
+
+    stripe = calloc(1, sizeof(*stripe));
+    if (stripe == NULL) {
+        return NULL;
+    }
+    stripe->chans = calloc(width, sizeof(stripe->chans[0]));
+    if (stripe->chans == NULL) {
+        free(stripe);
+        return NULL;
+    }
+    stripe->dev = dev;
+    stripe->width = width;
+    stripe->chunk_size = chunk_size;
+
+    for (i = 0; i < width; i++)
+    {
+        stripe->chans[i].channel_id = channels[i];
+        axidma_set_callback(dev, channels[i], stripe_chunk_done,
+                            &stripe->chans[i]);
+    }
+
+    return stripe;
+}
+
+void axidma_stripe_destroy(axidma_stripe_t stripe)
+{
+    int i;
+
+    for (i = 0; i < stripe->width; i++)
+    {
+        axidma_set_callback(stripe->dev, stripe->chans[i].channel_id, NULL,
+                            NULL);
+    }
+    free(stripe->chans);
+    free(stripe);
+    return;
+}
+
+int axidma_stripe_transfer(axidma_stripe_t stripe, void *buf, size_t len,
+        axidma_window_cb_t callback, void *data, int timeout)
+{
+    stripe_begin(stripe, buf, len, callback, data);
+    return stripe_run(&stripe, 1, timeout);
+}
+
+// Runs both transfers together, with the receive's chunks queued first
+int axidma_stripe_twoway(axidma_stripe_t tx_stripe, void *tx_buf,
+        size_t tx_len, axidma_stripe_t rx_stripe, void *rx_buf, size_t rx_len,
+        int timeout)
+{
+    axidma_stripe_t stripes[2];
+
+    stripe_begin(rx_stripe, rx_buf, rx_len, NULL, NULL);
+    stripe_begin(tx_stripe, tx_buf, tx_len, NULL, NULL);
+    stripes[0] = rx_stripe;
+    stripes[1] = tx_stripe;
+    return stripe_run(stripes, 2, timeout);
+}
+
+void axidma_stripe_get_stats(axidma_stripe_t stripe,
+        struct axidma_stripe_stats *channel_stats,
+        struct axidma_stripe_stats *total)
+{
+    int i;
+
+    if (channel_stats != NULL) {
+        for (i = 0; i < stripe->width; i++)
+        {
+            channel_stats[i] = stripe->chans[i].stats;
+        }
+    }
+    *total = stripe->stats;
+    return;
+}
@@ -0,0 +1,336 @@
+/**
+ * @file libaxidma_coalesce.c
+ * @date Sunday, October 18, 2026 at 01:40:09 AM EDT
+ *
+ * This file contains the transmit coalescing of the AXI DMA library.
+ *
+ * Messages are appended to the filling buffer under a lock. Sending a buffer
+ * swaps the filling buffer for the other one, then makes a blocking transfer
+ * with the lock dropped, so that appending carries on during the transfer.
+ * Only one buffer is sent at a time, so the buffer swapped in is always empty.
+ * A thread sleeps until the deadline of the oldest message in the filling
+ * buffer, and sends it if the threshold has not done so first.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>             // Memcpy and memset functions
+#include <errno.h>              // Error codes
+#include <time.h>               // Clock for the deadlines
+#include <pthread.h>            // Thread enforcing the deadline
+
+#include "libaxidma_coalesce.h" // Local definitions
+
+/*----------------------------------------------------------------------------
+ * Internal definitions
+ *----------------------------------------------------------------------------*/
+
+// One of the DMA buffers of a coalescing queue, and the messages in it
+struct coalesce_buffer {
+    uint8_t *data;              ///< The DMA buffer
+    size_t len;                 ///< The number of bytes of frames in it
+    uint64_t messages;          ///< The number of messages in it
+    uint64_t first_ns;          ///< When its oldest message was queued
+    uint64_t queued_ns_total;   ///< The sum of when its messages were queued
+};
+
+// The structure that represents a coalescing queue
+struct axidma_coalescer {
+    axidma_dev_t dev;           ///< The device the channel belongs to
+    int channel;                ///< The channel the messages are sent on
+    size_t buffer_size;         ///< The size of each DMA buffer
+    size_t threshold;           ///< The bytes at which a buffer is sent
+    uint64_t deadline_ns;       ///< The longest a message waits to be sent
+    struct coalesce_buffer buffers[2];  ///< The two DMA buffers
+    int fill;                   ///< The buffer being filled
+    bool sending;               ///< The other buffer is being sent
+    bool stopping;              ///< Tells the deadline thread to exit
+    pthread_mutex_t lock;       ///< Guards the buffers and the counters
+    pthread_cond_t work;        ///< Signalled when the deadline changes
+    pthread_cond_t sent;        ///< Signalled when a transfer finishes
+    pthread_t thread;           ///< The thread enforcing the deadline
+    struct axidma_coalesce_stats stats;     ///< The queue's counters
+};
+
+/*----------------------------------------------------------------------------
+ * Private Helper Functions
+ *----------------------------------------------------------------------------*/
+
+// Gets the current time in nanoseconds
+static uint64_t coalesce_time_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* Sends the filling buffer, if it holds any messages, counting the transfer
+ * against the given reason, if any. The delays are counted from when the
+ * transfer starts. Must be called with the lock held, which is dropped while
+ * the transfer is made. */
+static int flush_locked(axidma_coalescer_t coal, uint64_t *reason)
+{
+    int rc;
+    uint64_t start_ns;
+    struct coalesce_buffer *buf;
+
+    while (coal->sending)
+    {
+        pthread_cond_wait(&coal->sent, &coal->lock);
+    }
+    buf = &coal->buffers[coal->fill];
+    if (buf->len == 0) {
+        return 0;
+    }
+
+    coal->fill = 1 - coal->fill;
+    coal->sending = true;
+    start_ns = coalesce_time_ns();
+    coal->stats.messages += buf->messages;
+    coal->stats.bytes += buf->len;
+    coal->stats.transfers += 1;
+    coal->stats.delay_total_ns += buf->messages * start_ns -
+                                  buf->queued_ns_total;
+    if (start_ns - buf->first_ns > coal->stats.delay_max_ns) {
+        coal->stats.delay_max_ns = start_ns - buf->first_ns;
+    }
+    if (reason != NULL) {
+        *reason += 1;
+    }
+
+    pthread_mutex_unlock(&coal->lock);
+    rc = axidma_oneway_transfer(coal->dev, coal->channel, buf->data, buf->len,
+            true);
+    pthread_mutex_lock(&coal->lock);
+
+    buf->len = 0;
+    buf->messages = 0;
+    buf->queued_ns_total = 0;
+    coal->sending = false;
+    pthread_cond_broadcast(&coal->sent);
+    if (rc < 0) {
+        coal->stats.errors += 1;
+        return -EIO;
+    }
+
+    return 0;
+}
+
+// Sends the filling buffer once its oldest message reaches the deadline
+static void *deadline_thread(void *arg)
+{
+    uint64_t deadline_ns;
+    struct timespec deadline;
+    axidma_coalescer_t coal;
+
+    coal = arg;
+    pthread_mutex_lock(&coal->lock);
+    while (!coal->stopping)
+    {
+        if (coal->buffers[coal->fill].len == 0) {
+            pthread_cond_wait(&coal->work, &coal->lock);
+            continue;
+        }
+
+        deadline_ns = coal->buffers[coal->fill].first_ns + coal->deadline_ns;
+        if (coalesce_time_ns() >= deadline_ns) {
+            flush_locked(coal, &coal->stats.deadline_flushes);
+            continue;
+        }
+        deadline.tv_sec = deadline_ns / 1000000000;
+        deadline.tv_nsec = deadline_ns % 1000000000;
+        pthread_cond_timedwait(&coal->work, &coal->lock, &deadline);
+    }
+    pthread_mutex_unlock(&coal->lock);
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ * Public Interface
+ *----------------------------------------------------------------------------*/
+
+/* Allocates both DMA buffers, then starts the deadline thread. The thread
+ * sleeps on the monotonic clock, which the deadlines are measured with. */
+axidma_coalescer_t axidma_coalescer_create(axidma_dev_t dev, int channel,
+        size_t buffer_size, size_t threshold, int deadline_us)
+{
+    int i, rc;
+    axidma_coalescer_t coal;
+    pthread_condattr_t attr;
+
+    if (buffer_size < AXIDMA_FRAME_SIZE(1) || threshold == 0 ||
+            threshold > buffer_size || deadline_us < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    coal = calloc(1, sizeof(*coal));
+    if (coal == NULL) {
+        return NULL;
+    }
+    coal->dev = dev;
+    coal->channel = channel;
+    coal->buffer_size = buffer_size;
+    coal->threshold = threshold;
+    coal->deadline_ns = (uint64_t)deadline_us * 1000;
+    for (i = 0; i < 2; i++)
+    {
+        coal->buffers[i].data = axidma_malloc(dev, buffer_size);
+        if (coal->buffers[i].data == NULL) {
+            goto free_buffers;
+        }
+    }
+
+    pthread_mutex_init(&coal->lock, NULL);
+    pthread_cond_init(&coal->sent, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&coal->work, &attr);
+    pthread_condattr_destroy(&attr);
+    rc = pthread_create(&coal->thread, NULL, deadline_thread, coal);
+    if (rc != 0) {
+        pthread_cond_destroy(&coal->work);
+        pthread_cond_destroy(&coal->sent);
+        pthread_mutex_destroy(&coal->lock);
+        errno = rc;
+        goto free_buffers;
+    }
+
+    return coal;
+
+free_buffers:
+    for (i = 0; i < 2; i++)
+    {
+        if (coal->buffers[i].data != NULL) {
+            axidma_free(dev, coal->buffers[i].data, buffer_size);
+        }
+    }
+    free(coal);
+    return NULL;
+}
+
+void axidma_coalescer_destroy(axidma_coalescer_t coal)
+{
+    int i;
+
+    pthread_mutex_lock(&coal->lock);
+    flush_locked(coal, NULL);
+    coal->stopping = true;
+    pthread_cond_signal(&coal->work);
+    pthread_mutex_unlock(&coal->lock);
+    pthread_join(coal->thread, NULL);
+
+    pthread_cond_destroy(&coal->work);
+    pthread_cond_destroy(&coal->sent);
+    pthread_mutex_destroy(&coal->lock);
+    for (i = 0; i < 2; i++)
+    {
+        axidma_free(coal->dev, coal->buffers[i].data, coal->buffer_size);
+    }
+    free(coal);
+    return;
+}
+
+/* Makes room for the frame, sending the filling buffer as many times as it
+ * takes, since other threads may fill the new one while the lock is dropped.
+ * The first message in a buffer sets its deadline, so the thread is woken. */
+int axidma_coalescer_send(axidma_coalescer_t coal, const void *msg,
+        size_t len)
+{
+    int rc;
+    size_t frame_size;
+    uint64_t now_ns;
+    struct coalesce_buffer *buf;
+
+    frame_size = AXIDMA_FRAME_SIZE(len);
+    if (frame_size > coal->buffer_size) {
+        return -EMSGSIZE;
+    }
+
+    pthread_mutex_lock(&coal->lock);
+    while (coal->buffers[coal->fill].len + frame_size > coal->buffer_size)
+    {
+        rc = flush_locked(coal, &coal->stats.size_flushes);
+        if (rc < 0) {
+            pthread_mutex_unlock(&coal->lock);
+            return rc;
+        }
+    }
+
+    // Frame the message, padding it out to a whole word
+    buf = &coal->buffers[coal->fill];
+    *(uint32_t *)(buf->data + buf->len) = len;
+    memcpy(buf->data + buf->len + AXIDMA_FRAME_HEADER_SIZE, msg, len);
+    memset(buf->data + buf->len + AXIDMA_FRAME_HEADER_SIZE + len, 0,
+           frame_size - AXIDMA_FRAME_HEADER_SIZE - len);
+
+    now_ns = coalesce_time_ns();
+    if (buf->len == 0) {
+        buf->first_ns = now_ns;
+        pthread_cond_signal(&coal->work);
+    }
+    buf->len += frame_size;
+    buf->messages += 1;
+    buf->queued_ns_total += now_ns;
+
+    rc = 0;
+    if (buf->len >= coal->threshold) {
+        rc = flush_locked(coal, &coal->stats.size_flushes);
+    }
+    pthread_mutex_unlock(&coal->lock);
+
+    return rc;
+}
+
+int axidma_coalescer_flush(axidma_coalescer_t coal)
+{
+    int rc;
+
+    pthread_mutex_lock(&coal->lock);
+    rc = flush_locked(coal, NULL);
+    pthread_mutex_unlock(&coal->lock);
+
+    return rc;
+}
+
+void axidma_coalescer_get_stats(axidma_coalescer_t coal,
+        struct axidma_coalesce_stats *stats)
+{
+    pthread_mutex_lock(&coal->lock);
+    *stats = coal->stats;
+    pthread_mutex_unlock(&coal->lock);
+    return;
+}
+
+// Reads the length word of the frame at the offset, and checks it fits
+int axidma_deframe_next(const void *buf, size_t len, size_t *offset,
+        const void **msg, size_t *msg_len)
+{
+    uint32_t length;
+    const uint8_t *frame;
+
+    if (*offset == len) {
+        return 0;
+    } else if (len - *offset < AXIDMA_FRAME_HEADER_SIZE) {
+        return -EBADMSG;
+    }
+
+    frame = (const uint8_t *)buf + *offset;
+    memcpy(&length, frame, sizeof(length));
+    if (length > len - *offset - AXIDMA_FRAME_HEADER_SIZE) {
+        return -EBADMSG;
+    }
+
+    *msg = frame + AXIDMA_FRAME_HEADER_SIZE;
+    *msg_len = length;
+    *offset += AXIDMA_FRAME_SIZE(length);
+    if (*offset > len) {
+        *offset = len;
+    }
+    return 1;
+}
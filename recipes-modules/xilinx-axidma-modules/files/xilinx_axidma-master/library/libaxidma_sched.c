@@ -0,0 +1,345 @@
+/**
+ * @file libaxidma_sched.c
+ * @date Saturday, October 17, 2026 at 11:20:13 PM EDT
+ *
+ * This file contains the job scheduler of the AXI DMA library.
+ *
+ * Each pair of channels has a ring of queued jobs, and a thread that takes
+ * the oldest job from its own ring, or steals the newest one from the longest
+ * ring of another pair, then runs it as a blocking two-way transfer. A job
+ * takes far longer than taking a lock, so one lock guards all of the rings
+ * and counters, which keeps picking the least-loaded pair and stealing
+ * consistent with each other.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>              // Error codes
+#include <time.h>               // Clock for the queue wait times
+#include <pthread.h>            // Threads for each pair of channels
+
+#include "libaxidma_sched.h"    // Local definitions
+
+/*----------------------------------------------------------------------------
+ * Internal definitions
+ *----------------------------------------------------------------------------*/
+
+// A pair of channels, with its queue of jobs and the thread that runs them
+struct sched_pair {
+    int index;                  ///< The index of the pair
+    int tx_channel;             ///< The channel feeding the instance
+    int rx_channel;             ///< The channel draining the instance
+    struct axidma_job **queue;  ///< The ring of queued jobs
+    int head;                   ///< The oldest queued job
+    int num_queued;             ///< The number of queued jobs
+    bool running;               ///< The pair is running a job
+    struct axidma_sched_stats stats;    ///< The counters of the pair
+    pthread_t thread;           ///< The thread running the pair's jobs
+    struct axidma_sched *sched; ///< The scheduler the pair belongs to
+};
+
+// The structure that represents a job scheduler
+struct axidma_sched {
+    axidma_dev_t dev;           ///< The device the channels belong to
+    int num_pairs;              ///< The number of pairs of channels
+    int queue_depth;            ///< The size of each pair's ring
+    struct sched_pair *pairs;   ///< The pairs of channels
+    pthread_mutex_t lock;       ///< Guards the rings and the counters
+    pthread_cond_t work;        ///< Signalled when a job is queued
+    pthread_cond_t done;        ///< Signalled when the last job is done
+    int outstanding;            ///< Jobs submitted that are not done
+    bool stopping;              ///< Tells the pairs' threads to exit
+    uint64_t created_ns;        ///< When the scheduler was created
+};
+
+/*----------------------------------------------------------------------------
+ * Private Helper Functions
+ *----------------------------------------------------------------------------*/
+
+// Gets the current time in nanoseconds
+static uint64_t sched_time_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* Takes the oldest job queued on the pair. If there is none, the newest job
+ * on the longest queue of the other pairs is stolen instead, as it is the one
+ * that would have waited the longest. Must be called with the lock held. */
+static struct axidma_job *take_job(axidma_sched_t sched,
+        struct sched_pair *pair)
+{
+    int i;
+    struct sched_pair *victim;
+    struct axidma_job *job;
+
+    if (pair->num_queued > 0) {
+        job = pair->queue[pair->head];
+        pair->head = (pair->head + 1) % sched->queue_depth;
+        pair->num_queued -= 1;
+        return job;
+    }
+
+    victim = NULL;
+    for (i = 0; i < sched->num_pairs; i++)
+    {
+        if (sched->pairs[i].num_queued > 0 && (victim == NULL ||
+                sched->pairs[i].num_queued > victim->num_queued)) {
+            victim = &sched->pairs[i];
+        }
+    }
+    if (victim == NULL) {
+        return NULL;
+    }
+
+    victim->num_queued -= 1;
+    job = victim->queue[(victim->head + victim->num_queued) %
+                        sched->queue_depth];
+    pair->stats.stolen += 1;
+    return job;
+}
+
+// Runs the jobs of a pair of channels, until the scheduler is destroyed
+static void *pair_thread(void *arg)
+{
+    int rc;
+    uint64_t start_ns, end_ns, wait_ns;
+    struct sched_pair *pair;
+    axidma_sched_t sched;
+    struct axidma_job *job;
+
+    pair = arg;
+    sched = pair->sched;
+    pthread_mutex_lock(&sched->lock);
+    while (!sched->stopping)
+    {
+        job = take_job(sched, pair);
+        if (job == NULL) {
+            pthread_cond_wait(&sched->work, &sched->lock);
+            continue;
+        }
+        pair->running = true;
+        pthread_mutex_unlock(&sched->lock);
+
+        start_ns = sched_time_ns();
+        rc = axidma_twoway_transfer(sched->dev, pair->tx_channel, job->tx_buf,
+                job->tx_len, NULL, pair->rx_channel, job->rx_buf, job->rx_len,
+                NULL, true);
+        end_ns = sched_time_ns();
+        job->status = (rc < 0) ? -errno : 0;
+        job->pair = pair->index;
+
+        // The callback can free the job, so it isn't touched afterwards
+        wait_ns = start_ns - job->queued_ns;
+        if (job->callback != NULL) {
+            job->callback(job, job->data);
+        }
+
+        // Count the job, and wake the drain once the last one is done
+        pthread_mutex_lock(&sched->lock);
+        pair->running = false;
+        pair->stats.jobs += 1;
+        pair->stats.busy_ns += end_ns - start_ns;
+        pair->stats.wait_ns += wait_ns;
+        if (wait_ns > pair->stats.max_wait_ns) {
+            pair->stats.max_wait_ns = wait_ns;
+        }
+        sched->outstanding -= 1;
+        if (sched->outstanding == 0) {
+            pthread_cond_broadcast(&sched->done);
+        }
+    }
+    pthread_mutex_unlock(&sched->lock);
+
+    return NULL;
+}
+
+// Stops the threads of the first num_threads pairs, and frees the scheduler
+static void sched_free(axidma_sched_t sched, int num_threads)
+{
+    int i;
+
+    pthread_mutex_lock(&sched->lock);
+    sched->stopping = true;
+    pthread_cond_broadcast(&sched->work);
+    pthread_mutex_unlock(&sched->lock);
+    for (i = 0; i < num_threads; i++)
+    {
+        pthread_join(sched->pairs[i].thread, NULL);
+    }
+
+    for (i = 0; i < sched->num_pairs; i++)
+    {
+        free(sched->pairs[i].queue);
+    }
+    pthread_cond_destroy(&sched->done);
+    pthread_cond_destroy(&sched->work);
+    pthread_mutex_destroy(&sched->lock);
+    free(sched->pairs);
+    free(sched);
+    return;
+}
+
+/*----------------------------------------------------------------------------
+ * Public Interface
+ *----------------------------------------------------------------------------*/
+
+/* Sets up a ring for each pair, then starts their threads. The drain waits on
+ * the monotonic clock, so it is not thrown off by changes to the time. */
+axidma_sched_t axidma_sched_create(axidma_dev_t dev, const int *tx_channels,
+        const int *rx_channels, int num_pairs, int queue_depth)
+{
+    int i, rc;
+    axidma_sched_t sched;
+    pthread_condattr_t attr;
+    struct sched_pair *pair;
+
+    if (num_pairs <= 0 || queue_depth <= 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    sched = calloc(1, sizeof(*sched));
+    if (sched == NULL) {
+        return NULL;
+    }
+    sched->pairs = calloc(num_pairs, sizeof(sched->pairs[0]));
+    if (sched->pairs == NULL) {
+        free(sched);
+        return NULL;
+    }
+    sched->dev = dev;
+    sched->num_pairs = num_pairs;
+    sched->queue_depth = queue_depth;
+    sched->created_ns = sched_time_ns();
+    pthread_mutex_init(&sched->lock, NULL);
+    pthread_cond_init(&sched->work, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sched->done, &attr);
+    pthread_condattr_destroy(&attr);
+
+    for (i = 0; i < num_pairs; i++)
+    {
+        pair = &sched->pairs[i];
+        pair->index = i;
+        pair->tx_channel = tx_channels[i];
+        pair->rx_channel = rx_channels[i];
+        pair->sched = sched;
+        pair->queue = calloc(queue_depth, sizeof(pair->queue[0]));
+        if (pair->queue == NULL) {
+            sched_free(sched, 0);
+            return NULL;
+        }
+    }
+
+    for (i = 0; i < num_pairs; i++)
+    {
+        rc = pthread_create(&sched->pairs[i].thread, NULL, pair_thread,
+                            &sched->pairs[i]);
+        if (rc != 0) {
+            sched_free(sched, i);
+            errno = rc;
+            return NULL;
+        }
+    }
+
+    return sched;
+}
+
+void axidma_sched_destroy(axidma_sched_t sched)
+{
+    sched_free(sched, sched->num_pairs);
+    return;
+}
+
+/* Queues the job on the pair with the fewest jobs, counting the one it is
+ * running, then wakes all of the threads, since an idle one can steal it. */
+int axidma_sched_submit(axidma_sched_t sched, struct axidma_job *job)
+{
+    int i, load, best_load;
+    struct sched_pair *pair, *best;
+
+    pthread_mutex_lock(&sched->lock);
+    best = NULL;
+    best_load = 0;
+    for (i = 0; i < sched->num_pairs; i++)
+    {
+        pair = &sched->pairs[i];
+        load = pair->num_queued + pair->running;
+        if (pair->num_queued < sched->queue_depth &&
+                (best == NULL || load < best_load)) {
+            best = pair;
+            best_load = load;
+        }
+    }
+    if (best == NULL) {
+        pthread_mutex_unlock(&sched->lock);
+        return -ENOSPC;
+    }
+
+    job->status = 0;
+    job->pair = -1;
+    job->queued_ns = sched_time_ns();
+    best->queue[(best->head + best->num_queued) % sched->queue_depth] = job;
+    best->num_queued += 1;
+    sched->outstanding += 1;
+    pthread_cond_broadcast(&sched->work);
+    pthread_mutex_unlock(&sched->lock);
+
+    return 0;
+}
+
+int axidma_sched_drain(axidma_sched_t sched, int timeout)
+{
+    int rc;
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    if (timeout >= 0) {
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += (timeout % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    rc = 0;
+    pthread_mutex_lock(&sched->lock);
+    while (sched->outstanding > 0 && rc == 0)
+    {
+        if (timeout < 0) {
+            pthread_cond_wait(&sched->done, &sched->lock);
+        } else {
+            rc = pthread_cond_timedwait(&sched->done, &sched->lock,
+                                        &deadline);
+        }
+    }
+    pthread_mutex_unlock(&sched->lock);
+
+    return (rc == 0) ? 0 : -ETIMEDOUT;
+}
+
+void axidma_sched_get_stats(axidma_sched_t sched, int pair,
+        struct axidma_sched_stats *stats)
+{
+    uint64_t elapsed_ns;
+
+    assert(0 <= pair && pair < sched->num_pairs);
+
+    pthread_mutex_lock(&sched->lock);
+    *stats = sched->pairs[pair].stats;
+    stats->queued = sched->pairs[pair].num_queued;
+    pthread_mutex_unlock(&sched->lock);
+
+    elapsed_ns = sched_time_ns() - sched->created_ns;
+    stats->utilisation = (elapsed_ns == 0) ? 0.0 :
+                         (double)stats->busy_ns / elapsed_ns;
+    return;
+}
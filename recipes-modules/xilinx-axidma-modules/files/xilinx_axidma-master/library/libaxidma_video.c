@@ -0,0 +1,698 @@
+/**
+ * @file libaxidma_video.c
+ * @date Saturday, October 17, 2026 at 10:14:02 AM EDT
+ *
+ * This file contains the pixel format conversions of the AXI DMA library.
+ *
+ * Each conversion is a row function, with a vector kernel for the bulk of the
+ * row and scalar code for the pixels left over at the end. The vector kernels
+ * use NEON on the Zynq's ARM cores, and SSE2 or SSSE3 when the library is
+ * built for an x86 host. A frame is converted in bands of rows that fit in the
+ * cache, and the bands are handed out to the converting threads in order.
+ *
+ * @bug No known bugs.
+ **/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>              // Error codes
+#include <pthread.h>            // Threads for splitting up a conversion
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>           // NEON intrinsics
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>          // SSSE3 and SSE2 intrinsics
+#elif defined(__SSE2__)
+#include <emmintrin.h>          // SSE2 intrinsics
+#endif
+
+#include "libaxidma_video.h"    // Local definitions
+
+/*----------------------------------------------------------------------------
+ * Internal definitions
+ *----------------------------------------------------------------------------*/
+
+// The number of bytes read and written for each band of rows in a conversion
+#define AXIDMA_CONVERT_BAND_SIZE    (64 * 1024)
+
+// The BT.601 limited range coefficients for YUV to RGB, with 6 fractional bits
+#define YUV_Y_COEFF                 74
+#define YUV_RV_COEFF                102
+#define YUV_GU_COEFF                25
+#define YUV_GV_COEFF                52
+#define YUV_BU_COEFF                129
+#define YUV_SHIFT                   6
+
+// A function that converts a single row of pixels
+typedef void (*convert_row_t)(const uint8_t *src, uint8_t *dst, int width);
+
+// The state of a conversion, shared by all of the threads doing it
+struct convert_job {
+    convert_row_t convert_row;  ///< The function to convert each row with
+    const uint8_t *src;         ///< The first row of the source image
+    uint8_t *dst;               ///< The first row of the destination image
+    size_t src_stride;          ///< Bytes between rows of the source
+    size_t dst_stride;          ///< Bytes between rows of the destination
+    int width;                  ///< The width of the image in pixels
+    int height;                 ///< The height of the image in pixels
+    int band_rows;              ///< The number of rows in each band
+    int num_bands;              ///< The number of bands in the image
+    int next_band;              ///< The next band to be claimed by a thread
+};
+
+/*----------------------------------------------------------------------------
+ * Scalar Helper Functions
+ *----------------------------------------------------------------------------*/
+
+// Rounds off the fractional bits of a color component, and clamps it to a byte
+static inline uint8_t yuv_clamp(int value)
+{
+    value = (value + (1 << (YUV_SHIFT - 1))) >> YUV_SHIFT;
+    if (value < 0) {
+        return 0;
+    } else if (value > UINT8_MAX) {
+        return UINT8_MAX;
+    }
+    return value;
+}
+
+// Converts a pair of YUYV pixels to RGB, with the components in memory order
+static inline void yuyv_to_rgb_pair(const uint8_t *yuyv, uint8_t rgb[2][3])
+{
+    int i, y, u, v, red, green, blue;
+
+    u = yuyv[1] - 128;
+    v = yuyv[3] - 128;
+    red = YUV_RV_COEFF * v;
+    green = -YUV_GU_COEFF * u - YUV_GV_COEFF * v;
+    blue = YUV_BU_COEFF * u;
+
+    for (i = 0; i < 2; i++)
+    {
+        y = YUV_Y_COEFF * (yuyv[2*i] - 16);
+        rgb[i][0] = yuv_clamp(y + red);
+        rgb[i][1] = yuv_clamp(y + green);
+        rgb[i][2] = yuv_clamp(y + blue);
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * Vector Kernels
+ *----------------------------------------------------------------------------*/
+
+#if defined(__ARM_NEON)
+
+/* Converts 16 YUYV pixels to RGB with NEON. The even and odd pixels share the
+ * chroma samples, so each is converted as its own vector, and then they are
+ * interleaved back together. */
+static inline void yuyv_to_rgb_neon(const uint8_t *src, uint8x16_t *red,
+                                    uint8x16_t *green, uint8x16_t *blue)
+{
+    int i;
+    uint8x8x4_t yuyv;
+    uint8x8x2_t r, g, b;
+    int16x8_t u, v, y, r_diff, g_diff, b_diff;
+
+    yuyv = vld4_u8(src);
+    u = vreinterpretq_s16_u16(vsubl_u8(yuyv.val[1], vdup_n_u8(128)));
+    v = vreinterpretq_s16_u16(vsubl_u8(yuyv.val[3], vdup_n_u8(128)));
+    r_diff = vmulq_n_s16(v, YUV_RV_COEFF);
+    g_diff = vmlaq_n_s16(vmulq_n_s16(u, -YUV_GU_COEFF), v, -YUV_GV_COEFF);
+    b_diff = vmulq_n_s16(u, YUV_BU_COEFF);
+
+    for (i = 0; i < 2; i++)
+    {
+        y = vreinterpretq_s16_u16(vsubl_u8(yuyv.val[2*i], vdup_n_u8(16)));
+        y = vmulq_n_s16(y, YUV_Y_COEFF);
+        r.val[i] = vqrshrun_n_s16(vqaddq_s16(y, r_diff), YUV_SHIFT);
+        g.val[i] = vqrshrun_n_s16(vqaddq_s16(y, g_diff), YUV_SHIFT);
+        b.val[i] = vqrshrun_n_s16(vqaddq_s16(y, b_diff), YUV_SHIFT);
+    }
+
+    r = vzip_u8(r.val[0], r.val[1]);
+    g = vzip_u8(g.val[0], g.val[1]);
+    b = vzip_u8(b.val[0], b.val[1]);
+    *red = vcombine_u8(r.val[0], r.val[1]);
+    *green = vcombine_u8(g.val[0], g.val[1]);
+    *blue = vcombine_u8(b.val[0], b.val[1]);
+}
+
+static int yuyv_to_xrgb8888_kernel(const uint8_t *src, uint8_t *dst,
+                                   int width)
+{
+    int x;
+    uint8x16x4_t xrgb;
+
+    xrgb.val[3] = vdupq_n_u8(UINT8_MAX);
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        yuyv_to_rgb_neon(&src[2*x], &xrgb.val[2], &xrgb.val[1], &xrgb.val[0]);
+        vst4q_u8(&dst[4*x], xrgb);
+    }
+
+    return x;
+}
+
+static int yuyv_to_rgb888_kernel(const uint8_t *src, uint8_t *dst, int width)
+{
+    int x;
+    uint8x16x3_t rgb;
+
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        yuyv_to_rgb_neon(&src[2*x], &rgb.val[0], &rgb.val[1], &rgb.val[2]);
+        vst3q_u8(&dst[3*x], rgb);
+    }
+
+    return x;
+}
+
+static int rgb888_to_xrgb8888_kernel(const uint8_t *src, uint8_t *dst,
+                                     int width)
+{
+    int x;
+    uint8x16x3_t rgb;
+    uint8x16x4_t xrgb;
+
+    xrgb.val[3] = vdupq_n_u8(UINT8_MAX);
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        rgb = vld3q_u8(&src[3*x]);
+        xrgb.val[0] = rgb.val[2];
+        xrgb.val[1] = rgb.val[1];
+        xrgb.val[2] = rgb.val[0];
+        vst4q_u8(&dst[4*x], xrgb);
+    }
+
+    return x;
+}
+
+static int xrgb8888_to_rgb888_kernel(const uint8_t *src, uint8_t *dst,
+                                     int width)
+{
+    int x;
+    uint8x16x3_t rgb;
+    uint8x16x4_t xrgb;
+
+    for (x = 0; x + 16 <= width; x += 16)
+    {
+        xrgb = vld4q_u8(&src[4*x]);
+        rgb.val[0] = xrgb.val[2];
+        rgb.val[1] = xrgb.val[1];
+        rgb.val[2] = xrgb.val[0];
+        vst3q_u8(&dst[3*x], rgb);
+    }
+
+    return x;
+}
+
+/* Unpacks 8 RAW10 pixels at a time. The 16 bytes loaded hold two groups of 4
+ * pixels, and a table lookup gathers each pixel's high bits and the byte with
+ * its low bits. The next group starts within the load, so the last 16 pixels
+ * of the row are left to the scalar code to avoid reading past the row. */
+static int raw10_to_raw16_kernel(const uint8_t *src, uint8_t *dst, int width)
+{
+    int x;
+    uint8x16_t packed;
+    uint8x8x2_t table;
+    uint8x8_t high, low;
+    uint16x8_t pixels;
+    static const uint8_t high_index[8] = {0, 1, 2, 3, 5, 6, 7, 8};
+    static const uint8_t low_index[8] = {4, 4, 4, 4, 9, 9, 9, 9};
+    static const int8_t low_shift[8] = {0, -2, -4, -6, 0, -2, -4, -6};
+
+    for (x = 0; x + 16 < width; x += 8)
+    {
+        packed = vld1q_u8(&src[5*x/4]);
+        table.val[0] = vget_low_u8(packed);
+        table.val[1] = vget_high_u8(packed);
+        high = vtbl2_u8(table, vld1_u8(high_index));
+        low = vtbl2_u8(table, vld1_u8(low_index));
+        low = vand_u8(vshl_u8(low, vld1_s8(low_shift)), vdup_n_u8(0x3));
+        pixels = vorrq_u16(vshll_n_u8(high, 2), vmovl_u8(low));
+        vst1q_u16((uint16_t *)&dst[2*x], pixels);
+    }
+
+    return x;
+}
+
+#elif defined(__SSE2__)
+
+/* Converts 8 YUYV pixels to RGB with SSE2, returning each component as 16-bit
+ * lanes. The chroma samples are duplicated across each pair of pixels, and
+ * the 16-bit arithmetic saturates, so that it matches the scalar code. */
+static inline void yuyv_to_rgb_sse2(const uint8_t *src, __m128i *red,
+                                    __m128i *green, __m128i *blue)
+{
+    __m128i yuyv, y, uv, u, v;
+
+    yuyv = _mm_loadu_si128((const __m128i *)src);
+    y = _mm_and_si128(yuyv, _mm_set1_epi16(0xff));
+    uv = _mm_srli_epi16(yuyv, 8);
+    u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)),
+                            _MM_SHUFFLE(2, 2, 0, 0));
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)),
+                            _MM_SHUFFLE(3, 3, 1, 1));
+    u = _mm_sub_epi16(u, _mm_set1_epi16(128));
+    v = _mm_sub_epi16(v, _mm_set1_epi16(128));
+    y = _mm_mullo_epi16(_mm_sub_epi16(y, _mm_set1_epi16(16)),
+                        _mm_set1_epi16(YUV_Y_COEFF));
+    y = _mm_add_epi16(y, _mm_set1_epi16(1 << (YUV_SHIFT - 1)));
+
+    *red = _mm_adds_epi16(y, _mm_mullo_epi16(v, _mm_set1_epi16(YUV_RV_COEFF)));
+    *green = _mm_subs_epi16(_mm_subs_epi16(y,
+            _mm_mullo_epi16(u, _mm_set1_epi16(YUV_GU_COEFF))),
+            _mm_mullo_epi16(v, _mm_set1_epi16(YUV_GV_COEFF)));
+    *blue = _mm_adds_epi16(y,
+            _mm_mullo_epi16(u, _mm_set1_epi16(YUV_BU_COEFF)));
+    *red = _mm_srai_epi16(*red, YUV_SHIFT);
+    *green = _mm_srai_epi16(*green, YUV_SHIFT);
+    *blue = _mm_srai_epi16(*blue, YUV_SHIFT);
+}
+
+// Converts 8 YUYV pixels to XRGB8888, storing 32 bytes
+static inline void yuyv_to_xrgb8888_sse2(const uint8_t *src, uint8_t *dst)
+{
+    __m128i red, green, blue, bg, ra;
+
+    yuyv_to_rgb_sse2(src, &red, &green, &blue);
+    bg = _mm_unpacklo_epi8(_mm_packus_epi16(blue, blue),
+                           _mm_packus_epi16(green, green));
+    ra = _mm_unpacklo_epi8(_mm_packus_epi16(red, red), _mm_set1_epi8(-1));
+    _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128((__m128i *)&dst[16], _mm_unpackhi_epi16(bg, ra));
+}
+
+static int yuyv_to_xrgb8888_kernel(const uint8_t *src, uint8_t *dst,
+                                   int width)
+{
+    int x;
+
+    for (x = 0; x + 8 <= width; x += 8)
+    {
+        yuyv_to_xrgb8888_sse2(&src[2*x], &dst[4*x]);
+    }
+
+    return x;
+}
+
+// SSE2 has no byte shuffle, so the 32-bit pixels are packed down after
+static int yuyv_to_rgb888_kernel(const uint8_t *src, uint8_t *dst, int width)
+{
+    int x, i;
+    uint8_t xrgb[32];
+
+    for (x = 0; x + 8 <= width; x += 8)
+    {
+        yuyv_to_xrgb8888_sse2(&src[2*x], xrgb);
+        for (i = 0; i < 8; i++)
+        {
+            dst[3*(x+i) + 0] = xrgb[4*i + 2];
+            dst[3*(x+i) + 1] = xrgb[4*i + 1];
+            dst[3*(x+i) + 2] = xrgb[4*i + 0];
+        }
+    }
+
+    return x;
+}
+
+#if defined(__SSSE3__)
+
+/* Converts 4 pixels at a time with a byte shuffle. Each load is 16 bytes, but
+ * only 12 of them are used, so the loop stops early enough to not read past
+ * the end of the row. */
+static int rgb888_to_xrgb8888_kernel(const uint8_t *src, uint8_t *dst,
+                                     int width)
+{
+    int x;
+    __m128i rgb, shuffle, alpha;
+
+    shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1,
+                            11, 10, 9, -1);
+    alpha = _mm_set1_epi32((int)0xff000000);
+    for (x = 0; x + 6 <= width; x += 4)
+    {
+        rgb = _mm_loadu_si128((const __m128i *)&src[3*x]);
+        rgb = _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha);
+        _mm_storeu_si128((__m128i *)&dst[4*x], rgb);
+    }
+
+    return x;
+}
+
+/* Converts 4 pixels at a time with a byte shuffle. Each store is 16 bytes,
+ * with the last 4 being overwritten by the next store, so the loop stops early
+ * enough to not write past the end of the row. */
+static int xrgb8888_to_rgb888_kernel(const uint8_t *src, uint8_t *dst,
+                                     int width)
+{
+    int x;
+    __m128i xrgb, shuffle;
+
+    shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                            -1, -1, -1, -1);
+    for (x = 0; x + 6 <= width; x += 4)
+    {
+        xrgb = _mm_loadu_si128((const __m128i *)&src[4*x]);
+        xrgb = _mm_shuffle_epi8(xrgb, shuffle);
+        _mm_storeu_si128((__m128i *)&dst[3*x], xrgb);
+    }
+
+    return x;
+}
+
+/* Unpacks 8 RAW10 pixels at a time. The high bits of each pixel are shuffled
+ * into its 16-bit lane, and the byte with its low bits is shifted into place
+ * with a multiply. The 16 byte load reaches into the next group, so the last
+ * 16 pixels of the row are left to the scalar code. */
+static int raw10_to_raw16_kernel(const uint8_t *src, uint8_t *dst, int width)
+{
+    int x;
+    __m128i packed, high, low, high_shuffle, low_shuffle, low_shift;
+
+    high_shuffle = _mm_setr_epi8(0, -1, 1, -1, 2, -1, 3, -1,
+                                 5, -1, 6, -1, 7, -1, 8, -1);
+    low_shuffle = _mm_setr_epi8(4, -1, 4, -1, 4, -1, 4, -1,
+                                9, -1, 9, -1, 9, -1, 9, -1);
+    low_shift = _mm_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1);
+    for (x = 0; x + 16 < width; x += 8)
+    {
+        packed = _mm_loadu_si128((const __m128i *)&src[5*x/4]);
+        high = _mm_slli_epi16(_mm_shuffle_epi8(packed, high_shuffle), 2);
+        low = _mm_mullo_epi16(_mm_shuffle_epi8(packed, low_shuffle),
+                              low_shift);
+        low = _mm_and_si128(_mm_srli_epi16(low, 6), _mm_set1_epi16(0x3));
+        _mm_storeu_si128((__m128i *)&dst[2*x], _mm_or_si128(high, low));
+    }
+
+    return x;
+}
+
+#else /* !__SSSE3__ */
+
+static int rgb888_to_xrgb8888_kernel(const uint8_t *src __attribute__((unused)),
+        uint8_t *dst __attribute__((unused)), int width __attribute__((unused)))
+{
+    return 0;
+}
+
+static int xrgb8888_to_rgb888_kernel(const uint8_t *src __attribute__((unused)),
+        uint8_t *dst __attribute__((unused)), int width __attribute__((unused)))
+{
+    return 0;
+}
+
+static int raw10_to_raw16_kernel(const uint8_t *src __attribute__((unused)),
+        uint8_t *dst __attribute__((unused)), int width __attribute__((unused)))
+{
+    return 0;
+}
+
+#endif /* __SSSE3__ */
+
+#else /* !__ARM_NEON && !__SSE2__ */
+
+/* Without a vector instruction set, the kernels convert nothing, and the
+ * scalar code converts the whole row. */
+#define yuyv_to_xrgb8888_kernel(src, dst, width)    0
+#define yuyv_to_rgb888_kernel(src, dst, width)      0
+#define rgb888_to_xrgb8888_kernel(src, dst, width)  0
+#define xrgb8888_to_rgb888_kernel(src, dst, width)  0
+#define raw10_to_raw16_kernel(src, dst, width)      0
+
+#endif /* __ARM_NEON */
+
+/*----------------------------------------------------------------------------
+ * Row Conversion Functions
+ *----------------------------------------------------------------------------*/
+
+static void convert_rgb888_to_xrgb8888(const uint8_t *src, uint8_t *dst,
+                                       int width)
+{
+    int x;
+
+    for (x = rgb888_to_xrgb8888_kernel(src, dst, width); x < width; x++)
+    {
+        dst[4*x + 0] = src[3*x + 2];
+        dst[4*x + 1] = src[3*x + 1];
+        dst[4*x + 2] = src[3*x + 0];
+        dst[4*x + 3] = UINT8_MAX;
+    }
+}
+
+static void convert_xrgb8888_to_rgb888(const uint8_t *src, uint8_t *dst,
+                                       int width)
+{
+    int x;
+
+    for (x = xrgb8888_to_rgb888_kernel(src, dst, width); x < width; x++)
+    {
+        dst[3*x + 0] = src[4*x + 2];
+        dst[3*x + 1] = src[4*x + 1];
+        dst[3*x + 2] = src[4*x + 0];
+    }
+}
+
+static void convert_yuyv_to_xrgb8888(const uint8_t *src, uint8_t *dst,
+                                     int width)
+{
+    int x;
+    uint8_t rgb[2][3];
+
+    for (x = yuyv_to_xrgb8888_kernel(src, dst, width); x < width; x += 2)
+    {
+        yuyv_to_rgb_pair(&src[2*x], rgb);
+        dst[4*x + 0] = rgb[0][2];
+        dst[4*x + 1] = rgb[0][1];
+        dst[4*x + 2] = rgb[0][0];
+        dst[4*x + 3] = UINT8_MAX;
+        dst[4*x + 4] = rgb[1][2];
+        dst[4*x + 5] = rgb[1][1];
+        dst[4*x + 6] = rgb[1][0];
+        dst[4*x + 7] = UINT8_MAX;
+    }
+}
+
+static void convert_yuyv_to_rgb888(const uint8_t *src, uint8_t *dst,
+                                   int width)
+{
+    int x;
+    uint8_t rgb[2][3];
+
+    for (x = yuyv_to_rgb888_kernel(src, dst, width); x < width; x += 2)
+    {
+        yuyv_to_rgb_pair(&src[2*x], rgb);
+        dst[3*x + 0] = rgb[0][0];
+        dst[3*x + 1] = rgb[0][1];
+        dst[3*x + 2] = rgb[0][2];
+        dst[3*x + 3] = rgb[1][0];
+        dst[3*x + 4] = rgb[1][1];
+        dst[3*x + 5] = rgb[1][2];
+    }
+}
+
+static void convert_raw10_to_raw16(const uint8_t *src, uint8_t *dst,
+                                   int width)
+{
+    int x, i;
+    uint16_t pixel;
+    const uint8_t *group;
+
+    for (x = raw10_to_raw16_kernel(src, dst, width); x < width; x += 4)
+    {
+        group = &src[5*x/4];
+        for (i = 0; i < 4; i++)
+        {
+            pixel = (group[i] << 2) | ((group[4] >> (2*i)) & 0x3);
+            dst[2*(x+i) + 0] = pixel & 0xff;
+            dst[2*(x+i) + 1] = pixel >> 8;
+        }
+    }
+}
+
+// Finds the row function for a conversion, or NULL if it's not supported
+static convert_row_t find_conversion(enum axidma_pixel_format src_format,
+                                     enum axidma_pixel_format dst_format)
+{
+    if (src_format == AXIDMA_PIXEL_RGB888 &&
+            dst_format == AXIDMA_PIXEL_XRGB8888) {
+        return convert_rgb888_to_xrgb8888;
+    } else if (src_format == AXIDMA_PIXEL_XRGB8888 &&
+            dst_format == AXIDMA_PIXEL_RGB888) {
+        return convert_xrgb8888_to_rgb888;
+    } else if (src_format == AXIDMA_PIXEL_YUYV &&
+            dst_format == AXIDMA_PIXEL_XRGB8888) {
+        return convert_yuyv_to_xrgb8888;
+    } else if (src_format == AXIDMA_PIXEL_YUYV &&
+            dst_format == AXIDMA_PIXEL_RGB888) {
+        return convert_yuyv_to_rgb888;
+    } else if (src_format == AXIDMA_PIXEL_RAW10 &&
+            dst_format == AXIDMA_PIXEL_RAW16) {
+        return convert_raw10_to_raw16;
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ * Conversion Threads
+ *----------------------------------------------------------------------------*/
+
+/* Converts bands of the image until there are none left. The bands are claimed
+ * in order, so the threads move through the destination together. */
+static void *convert_bands(void *data)
+{
+    int band, row, end_row;
+    struct convert_job *job;
+
+    job = data;
+    while ((band = __sync_fetch_and_add(&job->next_band, 1)) < job->num_bands)
+    {
+        row = band * job->band_rows;
+        end_row = row + job->band_rows;
+        end_row = (end_row < job->height) ? end_row : job->height;
+        for (; row < end_row; row++)
+        {
+            job->convert_row(&job->src[row * job->src_stride],
+                             &job->dst[row * job->dst_stride], job->width);
+        }
+    }
+
+    return NULL;
+}
+
+// Checks that an image's dimensions are valid for its format
+static bool valid_image(const struct axidma_image *image)
+{
+    if (image->data == NULL || image->width <= 0 || image->height <= 0) {
+        return false;
+    } else if (image->format == AXIDMA_PIXEL_YUYV && image->width % 2 != 0) {
+        return false;
+    } else if (image->format == AXIDMA_PIXEL_RAW10 && image->width % 4 != 0) {
+        return false;
+    }
+
+    return image->stride == 0 || (size_t)image->stride >=
+           axidma_pixel_row_size(image->format, image->width);
+}
+
+/*----------------------------------------------------------------------------
+ * Public Interface
+ *----------------------------------------------------------------------------*/
+
+const char *axidma_pixel_format_name(enum axidma_pixel_format format)
+{
+    switch (format)
+    {
+        case AXIDMA_PIXEL_RGB888:
+            return "RGB888";
+        case AXIDMA_PIXEL_XRGB8888:
+            return "XRGB8888";
+        case AXIDMA_PIXEL_YUYV:
+            return "YUYV";
+        case AXIDMA_PIXEL_RAW10:
+            return "RAW10";
+        case AXIDMA_PIXEL_RAW16:
+            return "RAW16";
+    }
+
+    return "unknown";
+}
+
+size_t axidma_pixel_row_size(enum axidma_pixel_format format, int width)
+{
+    switch (format)
+    {
+        case AXIDMA_PIXEL_RGB888:
+            return 3 * (size_t)width;
+        case AXIDMA_PIXEL_XRGB8888:
+            return 4 * (size_t)width;
+        case AXIDMA_PIXEL_YUYV:
+        case AXIDMA_PIXEL_RAW16:
+            return 2 * (size_t)width;
+        case AXIDMA_PIXEL_RAW10:
+            return 5 * (size_t)width / 4;
+    }
+
+    return 0;
+}
+
+bool axidma_conversion_supported(enum axidma_pixel_format src_format,
+                                 enum axidma_pixel_format dst_format)
+{
+    return find_conversion(src_format, dst_format) != NULL;
+}
+
+const char *axidma_conversion_isa()
+{
+#if defined(__ARM_NEON)
+    return "NEON";
+#elif defined(__SSSE3__)
+    return "SSSE3";
+#elif defined(__SSE2__)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+int axidma_convert_image(const struct axidma_image *src,
+                         struct axidma_image *dst, int num_threads)
+{
+    int i, num_started;
+    size_t band_size;
+    pthread_t *threads;
+    struct convert_job job;
+
+    // Check that the conversion is supported, and the images match up
+    job.convert_row = find_conversion(src->format, dst->format);
+    if (job.convert_row == NULL) {
+        return -ENOTSUP;
+    } else if (!valid_image(src) || !valid_image(dst) ||
+            src->width != dst->width || src->height != dst->height) {
+        return -EINVAL;
+    }
+
+    // Split the image up into bands that fit in the cache
+    job.src = src->data;
+    job.dst = dst->data;
+    job.src_stride = (src->stride != 0) ? (size_t)src->stride :
+                     axidma_pixel_row_size(src->format, src->width);
+    job.dst_stride = (dst->stride != 0) ? (size_t)dst->stride :
+                     axidma_pixel_row_size(dst->format, dst->width);
+    job.width = src->width;
+    job.height = src->height;
+    band_size = axidma_pixel_row_size(src->format, src->width) +
+                axidma_pixel_row_size(dst->format, dst->width);
+    job.band_rows = AXIDMA_CONVERT_BAND_SIZE / band_size;
+    job.band_rows = (job.band_rows > 0) ? job.band_rows : 1;
+    job.num_bands = (job.height + job.band_rows - 1) / job.band_rows;
+    job.next_band = 0;
+
+    // Start the helper threads, if there is enough work to go around
+    num_threads = (num_threads < job.num_bands) ? num_threads : job.num_bands;
+    num_started = 0;
+    threads = NULL;
+    if (num_threads > 1) {
+        threads = malloc((num_threads - 1) * sizeof(threads[0]));
+    }
+    for (i = 0; threads != NULL && i < num_threads - 1; i++)
+    {
+        // If a thread can't be started, the others pick up its share
+        if (pthread_create(&threads[i], NULL, convert_bands, &job) != 0) {
+            break;
+        }
+        num_started += 1;
+    }
+
+    // Take part in the conversion, then wait for the helpers to finish
+    convert_bands(&job);
+    for (i = 0; i < num_started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    return 0;
+}
@@ -15,17 +15,19 @@ LIBAXIDMA_MAKEFILE_=included
 ################################################################################
 
 # The flags for compiling the library
-LIBAXIDMA_CFLAGS = $(GLOBAL_CFLAGS) -fPIC -shared \
+LIBAXIDMA_CFLAGS = $(GLOBAL_CFLAGS) -fPIC -shared -pthread \
 				   -Wno-missing-field-initializers
 
 # The files that makeup the AXI DMA library
 LIBAXIDMA_DIR = library
-LIBAXIDMA_FILES = libaxidma.c
+LIBAXIDMA_FILES = libaxidma.c libaxidma_video.c libaxidma_sched.c \
+                  libaxidma_coalesce.c
 LIBAXIDMA = $(addprefix $(LIBAXIDMA_DIR)/,$(LIBAXIDMA_FILES))
 
 # The header files for the AXI DMA library interface
 LIBAXIDMA_INC_DIRS = include
-LIBAXIDMA_INC_FILES = libaxidma.h axidma_ioctl.h
+LIBAXIDMA_INC_FILES = libaxidma.h libaxidma_video.h libaxidma_sched.h \
+                      libaxidma_coalesce.h axidma_ioctl.h
 LIBAXIDMA_INC = $(addprefix $(LIBAXIDMA_INC_DIRS)/,$(LIBAXIDMA_INC_FILES))
 LIBAXIDMA_INC_FLAGS = $(addprefix -I ,$(LIBAXIDMA_INC_DIRS))
 
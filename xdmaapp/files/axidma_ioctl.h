@@ -59,12 +59,226 @@ enum axidma_type {
  * Structure representing all of the data about a video frame.
  *
  * This has all the information needed to properly setup an AXI VDMA
- * transaction, which is simply the video dimensions.
+ * transaction, which is the video dimensions, and the placement of the frame
+ * within its frame buffer.
+ *
+ * The frame buffer is treated as a surface of rows that are `stride` bytes
+ * apart, and the frame is the `width` x `height` window of it whose top-left
+ * pixel is at (`x_offset`, `y_offset`). This allows for cropped, padded, or
+ * tiled transfers to be done by the VDMA engine. A stride of 0 means that the
+ * rows are tightly packed (i.e. `width` * `depth` bytes apart), so a zeroed
+ * stride and offsets describe a frame that fills its whole buffer.
  **/
 struct axidma_video_frame {
     int height;                     ///< Height of the image in terms of pixels.
     int width;                      ///< Width of the image in terms of pixels.
     int depth;                      ///< Depth of the image in terms of pixels.
+    int stride;                     ///< Bytes between rows, 0 if packed.
+    int x_offset;                   ///< Pixel column of the frame's left edge.
+    int y_offset;                   ///< Pixel row of the frame's top edge.
+};
+
+/**
+ * Structure representing the run-time parameters of an AXI VDMA channel.
+ *
+ * These map onto the fields of the VDMA control register (see Xilinx PG020).
+ * The parameters are kept per-channel by the driver, and are applied to the
+ * channel immediately, and again whenever a new video transfer is started on
+ * it. The defaults are a free-running channel that interrupts once per frame.
+ *
+ * A video transfer always runs its channel parked, on the frame buffer that it
+ * is working on, so the park settings only apply to single frame transfers.
+ * For the same reason, a video transfer can't be started with genlock.
+ **/
+struct axidma_vdma_config {
+    int channel_id;                 ///< The id of the VDMA channel.
+    bool gen_lock;                  ///< Synchronize to a VDMA via genlock.
+    int genlock_master;             ///< Genlock master to follow (0-15).
+    int frame_delay;                ///< Frames behind genlock master (0-15).
+    bool park;                      ///< Park on a single frame buffer.
+    int park_frame;                 ///< Frame buffer to park on (0-31).
+    bool frame_count_irq;           ///< Enable the frame count interrupt.
+    int coalesce;                   ///< Frames per interrupt (1-255).
+    int delay;                      ///< Delay timer interrupt, 0 disables it.
+    int fsync_source;               ///< FrameSyncSrcSelect field value (0-2).
+};
+
+// The maximum number of frame buffers that a video transfer can use
+#define AXIDMA_MAX_FRAME_BUFFERS        32
+
+// Flag for taking the newest completed frame, discarding any older ones
+#define AXIDMA_FRAME_LATEST             (1 << 0)
+
+/**
+ * Structure representing a completed frame of a video transfer.
+ *
+ * This is used both to take a completed frame from a running video transfer,
+ * and to give it back to the driver once the user is done with it. While the
+ * user holds a frame buffer, the VDMA engine skips over it, so its contents
+ * stay intact. The sequence number counts frames completed since the transfer
+ * started, so gaps in it show frames that were dropped.
+ **/
+struct axidma_frame_event {
+    int channel_id;                 ///< The id of the VDMA channel.
+    int flags;                      ///< Flags for taking a frame (see above).
+    int timeout;                    ///< Time to wait in ms, <0 waits forever.
+    int buffer_index;               ///< Index of the frame buffer.
+    unsigned int sequence;          ///< Sequence number of the frame.
+    unsigned long long timestamp;   ///< Completion time (ns, monotonic).
+};
+
+/**
+ * Structure representing the statistics for a video transfer.
+ *
+ * A frame is dropped when a receive channel overwrites it before the user
+ * takes it, or when it is skipped over by taking the latest frame. The engine
+ * is starved when no frame buffer is free for it to use. A receive channel
+ * then waits for the user to give one back, and a transmit channel repeats its
+ * last frame.
+ **/
+struct axidma_video_stats {
+    int channel_id;                 ///< The id of the VDMA channel.
+    bool active;                    ///< The video transfer is running.
+    unsigned int sequence;          ///< Sequence number of the last frame.
+    int frames_ready;               ///< Completed frames not yet taken.
+    int frames_held;                ///< Frame buffers held by the user.
+    unsigned long long frames_completed;    ///< Frames completed by VDMA.
+    unsigned long long frames_dropped;      ///< Frames lost before being read.
+    unsigned long long frames_starved;      ///< Times no buffer was free.
+};
+
+// The size and alignment of each buffer descriptor in a userspace ring
+#define AXIDMA_RING_DESC_SIZE           64
+
+// The limits on the number of buffer descriptors in a userspace ring
+#define AXIDMA_RING_MIN_DESCRIPTORS     2
+#define AXIDMA_RING_MAX_DESCRIPTORS     4096
+
+// The mmap page offsets of the channel's registers and the ring's memory
+#define AXIDMA_RING_REGS_PGOFF          1
+#define AXIDMA_RING_MEM_PGOFF           2
+
+// The limits on the memory region pools, and the names they are looked up by
+#define AXIDMA_MAX_POOLS                8
+#define AXIDMA_POOL_NAME_LEN            32
+
+/* The mmap page offset of the first memory region pool. A buffer is allocated
+ * from pool i by mapping it at AXIDMA_POOL_PGOFF + i pages into the device. */
+#define AXIDMA_POOL_PGOFF               16
+
+/**
+ * Structure representing a scatter-gather ring handed to userspace.
+ *
+ * While attached, the DMA channel is taken away from the kernel's DMA engine,
+ * and the process drives it directly, by writing buffer descriptors into the
+ * ring and polling them for completion. The ring's memory is coherent, and
+ * holds the descriptors, followed by the buffers. Descriptor i is at offset
+ * i * AXIDMA_RING_DESC_SIZE, and buffer i is at offset num_descriptors *
+ * AXIDMA_RING_DESC_SIZE + i * buffer_stride.
+ *
+ * The registers are mapped at AXIDMA_RING_REGS_PGOFF pages into the device,
+ * and the ring's memory at AXIDMA_RING_MEM_PGOFF pages. The register window
+ * is the first page of the DMA core's, which holds both of its channels, so
+ * the attached channel's registers are `regs_offset` bytes into it. Since the
+ * core can only be reset as a whole, the ring takes both of its channels, and
+ * can only be attached while the other channel is idle.
+ **/
+struct axidma_ring_info {
+    int channel_id;                 ///< The id of the DMA channel.
+    int num_descriptors;            ///< Number of descriptors and buffers.
+    size_t buffer_size;             ///< The size of each buffer in bytes.
+    size_t buffer_stride;           ///< Bytes between buffers in the ring.
+    size_t ring_size;               ///< The size of the ring's memory.
+    size_t regs_size;               ///< The size of the register window.
+    int regs_offset;                ///< The channel's offset in the window.
+    unsigned long long ring_dma_addr;   ///< Bus address of the ring's memory.
+};
+
+/**
+ * Structure representing a wait for a userspace ring's engine to complete a
+ * descriptor.
+ **/
+struct axidma_ring_wait {
+    int channel_id;                 ///< The id of the DMA channel.
+    int desc_index;                 ///< The descriptor to wait for.
+    int timeout;                    ///< Milliseconds to wait, or -1 for ever.
+};
+
+/**
+ * Structure holding the counters of a userspace ring's completion modes.
+ *
+ * A ring is polled by its process while there is traffic, and switches to
+ * waiting on the channel's interrupt once it has been idle for a while. It
+ * goes back to polling as soon as the interrupt wakes it.
+ **/
+struct axidma_ring_stats {
+    int channel_id;                 ///< The id of the DMA channel.
+    int irq_mode;                   ///< The ring is waiting on the interrupt.
+    unsigned long long irq_switches;    ///< Switches to the interrupt.
+    unsigned long long poll_switches;   ///< Switches back to polling.
+    unsigned long long interrupts;  ///< Waits ended by the interrupt.
+    unsigned long long poll_time_ns;    ///< Time spent polling.
+    unsigned long long irq_time_ns;     ///< Time spent waiting on interrupts.
+};
+
+// The number of completed transactions that each channel keeps the residue of
+#define AXIDMA_PROGRESS_HISTORY         64
+
+/* The most transactions that can be queued on a channel at once. Any more are
+ * refused with EBUSY until some of them complete. */
+#define AXIDMA_MAX_QUEUED               64
+
+/**
+ * Structure representing the progress of the last transaction on a DMA
+ * channel.
+ *
+ * The progress comes from the residue that the DMA engine reports, which is
+ * updated as each of the transaction's segments completes. A receive is one
+ * segment unless its transaction asks for a segment size, which lets its data
+ * be consumed while the rest of it is still arriving.
+ **/
+struct axidma_progress {
+    int channel_id;                 ///< The id of the DMA channel.
+    int complete;                   ///< The transaction has completed.
+    size_t length;                  ///< The length of the transaction.
+    size_t transferred;             ///< The bytes transferred so far.
+    unsigned long long num_completed;   ///< Transactions completed so far.
+    size_t residues[AXIDMA_PROGRESS_HISTORY];   ///< Bytes left unfilled by
+                                    ///< completed transaction n, at n modulo
+                                    ///< #AXIDMA_PROGRESS_HISTORY.
+};
+
+/**
+ * Structure holding the counts of the DMA buffers that the driver is keeping
+ * track of, across all processes.
+ *
+ * These are for watching for leaks over a long run. A count that only ever
+ * grows while the same buffers are allocated and freed points to buffers that
+ * are never given back.
+ **/
+struct axidma_buffer_stats {
+    int num_buffers;                ///< Buffers allocated with mmap().
+    int num_external;               ///< Buffers registered from other drivers.
+    unsigned long long buffer_bytes;    ///< Bytes in the allocated buffers.
+    unsigned long long external_bytes;  ///< Bytes in the registered buffers.
+};
+
+/**
+ * Structure describing one of the memory region pools that buffers can be
+ * allocated from.
+ *
+ * The pools come from the device tree's `memory-region` phandles, and are
+ * named by `memory-region-names`. Each is a separate bank of memory, such as
+ * DDR attached to the programmable logic, or the on-chip memory, so buffers
+ * in it don't contend with the processor for the main DDR.
+ **/
+struct axidma_pool_info {
+    int index;                      ///< The index of the pool.
+    char name[AXIDMA_POOL_NAME_LEN];    ///< The name of the pool.
+    unsigned long long size;        ///< The size of the pool's region.
+    int num_buffers;                ///< Buffers allocated from the pool.
+    unsigned long long used_bytes;  ///< Bytes in the allocated buffers.
+    unsigned long long failures;    ///< Allocations the pool couldn't fit.
 };
 
 // TODO: Channel really should not be here
@@ -99,6 +313,7 @@ struct axidma_transaction {
     int channel_id;                 // The id of the DMA channel to use
     void *buf;                      // The buffer used for the transaction
     size_t buf_len;                 // The length of the buffer
+    size_t segment_size;            // Receive segments to follow, 0 for one
 
     // Kept as a union for extend ability.
     union {
@@ -133,7 +348,7 @@ struct axidma_video_transaction {
 #define AXIDMA_IOCTL_MAGIC              'W'
 
 // The number of IOCTL's implemented, used for verification
-#define AXIDMA_NUM_IOCTLS               10
+#define AXIDMA_NUM_IOCTLS               23
 
 /**
  * Returns the number of available DMA channels in the system.
@@ -241,6 +456,11 @@ struct axidma_video_transaction {
  *  - channel_id - The id for the channel you want receive data over.
  *  - buf - The address of the buffer you want to receive the data in.
  *  - buf_len - The number of bytes to receive.
+ *  - segment_size - 0 to receive into one descriptor, which ends at the end
+ *    of a packet. Otherwise, the buffer is split into descriptors of at least
+ *    this size, so that the progress of the receive can be followed. Each of
+ *    them ends at the end of a packet, so this is only for streams that
+ *    aren't split into packets. It is ignored for VDMA channels.
  **/
 #define AXIDMA_DMA_READ                 _IOR(AXIDMA_IOCTL_MAGIC, 4, \
                                              struct axidma_transaction)
@@ -300,13 +520,18 @@ struct axidma_video_transaction {
  * the first buffer. This is used for frame-buffer based cameras.
  *
  * All of the frame buffers must be within an address range that was allocated
- * by a call to mmap with the AXI DMA device. Also, each buffer must
- * be able to hold a frame of (width * height * depth) bytes. The input array of
- * buffers must be a memory location that holds `num_frame_buffers` addresses.
+ * by a call to mmap with the AXI DMA device. Also, each buffer must be able to
+ * hold the frame's surface, which is (width * height * depth) bytes for packed
+ * frames, or reaches to the last pixel of the frame's window otherwise. The
+ * input array of buffers must be a memory location that holds
+ * `num_frame_buffers` addresses.
  *
  * This call is always non-blocking as the VDMA engine will run forever. In
  * order to end the transaction, you must make a call to the stop dma channel
- * ioctl.
+ * ioctl. Only one video transfer can run on a channel at a time. The frames
+ * are transferred one buffer at a time, so that each completed frame can be
+ * taken with the get video frame ioctl, and the registered signal, if any, is
+ * sent as each frame completes.
  *
  * Inputs:
  *  - channel_id - The id for the channel you want to send data over.
@@ -315,6 +540,9 @@ struct axidma_video_transaction {
  *  - width - The width of the frame (image) in pixels.
  *  - height - The height of the frame in lines.
  *  - depth - The size of each pixel in the frame in bytes.
+ *  - stride - The number of bytes between rows, or 0 for packed rows.
+ *  - x_offset - The column in the frame buffer of the frame's first pixel.
+ *  - y_offset - The row in the frame buffer of the frame's first pixel.
  **/
 #define AXIDMA_DMA_VIDEO_READ           _IOR(AXIDMA_IOCTL_MAGIC, 7, \
                                              struct axidma_video_transaction)
@@ -328,13 +556,18 @@ struct axidma_video_transaction {
  * This is used for frame-buffer based graphics.
  *
  * All of the frame buffers must be within an address range that was allocated
- * by a call to mmap with the AXI DMA device. Also, each buffer must
- * be able to hold a frame of (width * height * depth) bytes. The input array of
- * buffers must be a memory location that holds `num_frame_buffers` addresses.
+ * by a call to mmap with the AXI DMA device. Also, each buffer must be able to
+ * hold the frame's surface, which is (width * height * depth) bytes for packed
+ * frames, or reaches to the last pixel of the frame's window otherwise. The
+ * input array of buffers must be a memory location that holds
+ * `num_frame_buffers` addresses.
  *
  * This call is always non-blocking as the VDMA engine will run forever. In
  * order to end the transaction, you must make a call to the stop dma channel
- * ioctl.
+ * ioctl. Only one video transfer can run on a channel at a time. The frames
+ * are transferred one buffer at a time, so that each completed frame can be
+ * taken with the get video frame ioctl, and the registered signal, if any, is
+ * sent as each frame completes.
  *
  * Inputs:
  *  - channel_id - The id for the channel you want to send data over.
@@ -343,6 +576,9 @@ struct axidma_video_transaction {
  *  - width - The width of the frame (image) in pixels.
  *  - height - The height of the frame in lines.
  *  - depth - The size of each pixel in the frame in bytes.
+ *  - stride - The number of bytes between rows, or 0 for packed rows.
+ *  - x_offset - The column in the frame buffer of the frame's first pixel.
+ *  - y_offset - The row in the frame buffer of the frame's first pixel.
  **/
 #define AXIDMA_DMA_VIDEO_WRITE          _IOR(AXIDMA_IOCTL_MAGIC, 8, \
                                              struct axidma_video_transaction)
@@ -377,4 +613,236 @@ struct axidma_video_transaction {
  **/
 #define AXIDMA_UNREGISTER_BUFFER        _IO(AXIDMA_IOCTL_MAGIC, 10)
 
+/**
+ * Sets the run-time parameters for the given VDMA channel.
+ *
+ * This configures parking, genlock synchronization, frame delay, and the
+ * frame count interrupt coalescing for a VDMA channel. The parameters are
+ * validated, stored with the channel, and applied right away. They are also
+ * re-applied every time a video or VDMA transfer is started on the channel.
+ *
+ * A parked channel will repeatedly transfer `park_frame`, which must be less
+ * than the number of frame buffers used by the transfer. The park and genlock
+ * settings only apply to single frame transfers. A video transfer always
+ * parks its channel on the frame buffer it is working on, and is rejected if
+ * the channel is configured for genlock.
+ *
+ * Inputs:
+ *  - channel_id - The id of the VDMA channel to configure.
+ *  - gen_lock - Enables genlock synchronization with another VDMA.
+ *  - genlock_master - The genlock master the channel follows (0-15).
+ *  - frame_delay - The number of frames to trail the genlock master (0-15).
+ *  - park - Indicates that the channel should park on a single frame.
+ *  - park_frame - The frame buffer to park on, when parking (0-31).
+ *  - frame_count_irq - Enables the frame count interrupt.
+ *  - coalesce - The number of frames per interrupt (1-255).
+ *  - delay - The delay timer interrupt value, or 0 to disable it (0-255).
+ *  - fsync_source - The frame sync source, as in PG020's FrameSyncSrcSelect
+ *                   field (0-2).
+ **/
+#define AXIDMA_SET_VDMA_CONFIG          _IOR(AXIDMA_IOCTL_MAGIC, 11, \
+                                             struct axidma_vdma_config)
+
+/**
+ * Gets the current run-time parameters for the given VDMA channel.
+ *
+ * Inputs:
+ *  - channel_id - The id of the VDMA channel to query.
+ *
+ * Outputs:
+ *  - The remaining fields of the structure, as described for
+ *    AXIDMA_SET_VDMA_CONFIG.
+ **/
+#define AXIDMA_GET_VDMA_CONFIG          _IOWR(AXIDMA_IOCTL_MAGIC, 12, \
+                                              struct axidma_vdma_config)
+
+/**
+ * Takes a completed frame from the video transfer on the given VDMA channel.
+ *
+ * The frame buffer is held by the user until it is given back with the put
+ * video frame ioctl, and the VDMA engine will not touch it in the meantime.
+ * By default, frames are taken in the order they completed. With the
+ * AXIDMA_FRAME_LATEST flag, the newest frame is taken instead, and any older
+ * completed frames are dropped, which bounds the age of the frame. For
+ * transmit channels, the frame buffer is one that the engine has finished
+ * sending (or has never used), ready to be filled with the next frame. Frames
+ * given back on a transmit channel are sent in the order they were given back.
+ *
+ * If no frame has completed, the call waits for up to `timeout` milliseconds,
+ * failing with ETIMEDOUT, or forever if it is negative. A timeout of 0 fails
+ * with EAGAIN right away. If no video transfer is running, the call fails with
+ * ENODATA.
+ *
+ * Inputs:
+ *  - channel_id - The id of the VDMA channel.
+ *  - flags - Either 0, or AXIDMA_FRAME_LATEST.
+ *  - timeout - The time to wait for a frame in milliseconds.
+ *
+ * Outputs:
+ *  - buffer_index - The index of the frame buffer, in the order that the frame
+ *                   buffers were given to the video transfer.
+ *  - sequence - The sequence number of the frame, starting from 1.
+ *  - timestamp - The time the frame completed, from CLOCK_MONOTONIC, in ns.
+ **/
+#define AXIDMA_GET_VIDEO_FRAME          _IOWR(AXIDMA_IOCTL_MAGIC, 13, \
+                                              struct axidma_frame_event)
+
+/**
+ * Gives a frame buffer taken with the get video frame ioctl back to the
+ * video transfer on the given VDMA channel.
+ *
+ * Inputs:
+ *  - channel_id - The id of the VDMA channel.
+ *  - buffer_index - The index of the frame buffer being released.
+ **/
+#define AXIDMA_PUT_VIDEO_FRAME          _IOR(AXIDMA_IOCTL_MAGIC, 14, \
+                                             struct axidma_frame_event)
+
+/**
+ * Gets the statistics for the video transfer on the given VDMA channel.
+ *
+ * The counters are reset each time a video transfer is started.
+ *
+ * Inputs:
+ *  - channel_id - The id of the VDMA channel to query.
+ *
+ * Outputs:
+ *  - The remaining fields of the structure, as described above.
+ **/
+#define AXIDMA_GET_VIDEO_STATS          _IOWR(AXIDMA_IOCTL_MAGIC, 15, \
+                                              struct axidma_video_stats)
+
+/**
+ * Attaches a scatter-gather ring to the given DMA channel, handing the channel
+ * over to the calling process.
+ *
+ * The channel is halted and taken from the kernel's DMA engine, and the ring's
+ * memory is allocated. The process then maps the registers and the ring, and
+ * drives the channel itself, with no system calls or interrupts. Only one
+ * ring can be attached at a time, and only by one process. The channel must
+ * be an AXI DMA channel built with the scatter-gather engine. Its interrupts
+ * are left disabled, so the process polls it, except while it waits with
+ * AXIDMA_WAIT_RING. Transfers on the channel through the other ioctls fail
+ * with EBUSY until the ring is detached.
+ *
+ * Inputs:
+ *  - channel_id - The id of the DMA channel to attach the ring to.
+ *  - num_descriptors - The number of descriptors and buffers in the ring,
+ *                      between AXIDMA_RING_MIN_DESCRIPTORS and
+ *                      AXIDMA_RING_MAX_DESCRIPTORS.
+ *  - buffer_size - The size of each buffer, which must fit in the length
+ *                  width that the DMA core was built with.
+ *
+ * Outputs:
+ *  - The remaining fields of the structure, as described above.
+ **/
+#define AXIDMA_ATTACH_RING              _IOWR(AXIDMA_IOCTL_MAGIC, 16, \
+                                              struct axidma_ring_info)
+
+/**
+ * Detaches the ring from the given DMA channel, giving the channel back to
+ * the kernel's DMA engine.
+ *
+ * The registers and the ring's memory must be unmapped first, otherwise this
+ * fails with EBUSY. If the process exits with the ring attached, it is
+ * detached automatically.
+ *
+ * Inputs:
+ *  - channel_id - The id of the DMA channel the ring is attached to.
+ **/
+#define AXIDMA_DETACH_RING              _IO(AXIDMA_IOCTL_MAGIC, 17)
+
+/**
+ * Waits for the engine of the ring on the given DMA channel to complete a
+ * descriptor, sleeping on the channel's interrupt.
+ *
+ * The channel's interrupts are enabled only for the duration of the wait, and
+ * are disabled again as soon as one arrives, so the process can go back to
+ * polling the ring. If the descriptor is already complete when its interrupt
+ * is enabled, this returns at once. This fails with ETIMEDOUT if the timeout
+ * expires first, and with EOPNOTSUPP if the channel has no interrupt.
+ *
+ * Inputs:
+ *  - channel_id - The id of the DMA channel the ring is attached to.
+ *  - desc_index - The index of the descriptor to wait for.
+ *  - timeout - The time to wait in milliseconds, or a negative value to wait
+ *              until the descriptor completes.
+ **/
+#define AXIDMA_WAIT_RING                _IOR(AXIDMA_IOCTL_MAGIC, 18, \
+                                             struct axidma_ring_wait)
+
+/**
+ * Gets the counters of the completion modes of the ring on the given DMA
+ * channel. The time in the current mode is included in its total.
+ *
+ * Inputs:
+ *  - channel_id - The id of the DMA channel the ring is attached to.
+ *
+ * Outputs:
+ *  - The remaining fields of the structure, as described above.
+ **/
+#define AXIDMA_GET_RING_STATS           _IOWR(AXIDMA_IOCTL_MAGIC, 19, \
+                                              struct axidma_ring_stats)
+
+/**
+ * Gets the progress of the last transaction started on the given DMA channel.
+ *
+ * This is for following a non-blocking transaction, so that the data at the
+ * start of a large receive can be used before the rest of it arrives. The
+ * bytes transferred never count data that has not landed in memory, but they
+ * can lag behind it by up to a segment, and a receive that isn't segmented
+ * counts nothing until it completes. If the channel's DMA engine can't report
+ * a residue, nothing is counted until the transaction completes. Once it has
+ * completed, a receive counts the bytes actually received, which is less than
+ * its length if the packet ended early. An engine that doesn't pass the
+ * residue to the completion counts the full length. This fails with EIO if
+ * the transaction failed.
+ *
+ * Inputs:
+ *  - channel_id - The id of the DMA channel to query.
+ *
+ * The residues of the channel's last #AXIDMA_PROGRESS_HISTORY completed
+ * transactions are also given, so that a process with several receives queued
+ * can find how much each of them received, from its length less its residue.
+ * The transactions are counted from when the driver was loaded, in the order
+ * they complete, which is the order they were queued in. A transaction that
+ * is stopped is never counted.
+ *
+ * Outputs:
+ *  - complete - Set if the transaction has completed, or if there is none.
+ *  - length - The length of the transaction in bytes, or 0 if there is none.
+ *  - transferred - The bytes transferred so far.
+ *  - num_completed - The number of transactions completed on the channel.
+ *  - residues - The residue of the completed transaction n, for the last
+ *    #AXIDMA_PROGRESS_HISTORY of them, at n % #AXIDMA_PROGRESS_HISTORY.
+ **/
+#define AXIDMA_GET_PROGRESS             _IOWR(AXIDMA_IOCTL_MAGIC, 20, \
+                                              struct axidma_progress)
+
+/**
+ * Gets the counts of the DMA buffers allocated through the driver, and of the
+ * external buffers registered with it.
+ *
+ * Outputs:
+ *  - num_buffers - The number of buffers allocated with mmap().
+ *  - num_external - The number of external buffers registered.
+ *  - buffer_bytes - The total size of the allocated buffers.
+ *  - external_bytes - The total size of the registered buffers.
+ **/
+#define AXIDMA_GET_BUFFER_STATS         _IOW(AXIDMA_IOCTL_MAGIC, 21, \
+                                             struct axidma_buffer_stats)
+
+/**
+ * Gets the description and usage of one of the memory region pools. The pools
+ * are numbered from 0, and this fails with ENOENT past the last one.
+ *
+ * Inputs:
+ *  - index - The index of the pool.
+ *
+ * Outputs:
+ *  - The remaining fields of the structure, as described above.
+ **/
+#define AXIDMA_GET_POOL_INFO            _IOWR(AXIDMA_IOCTL_MAGIC, 22, \
+                                              struct axidma_pool_info)
+
 #endif /* AXIDMA_IOCTL_H_ */
@@ -11,6 +11,10 @@
 #ifndef LIBAXIDMA_H_
 #define LIBAXIDMA_H_
 
+#include <stdbool.h>
+#include <stdint.h>         // Fixed-width types for the ring's registers
+#include <sys/types.h>      // Signed size type for transfer progress
+
 #include "axidma_ioctl.h"   // Video frame structure
 
 /**
@@ -48,6 +52,103 @@ typedef struct array {
  **/
 typedef void (*axidma_cb_t)(int channel_id, void *data);
 
+/**
+ * Type definition for a function that processes a window of a receive.
+ *
+ * The function is invoked by #axidma_windowed_read with each window of the
+ * buffer, in order, as soon as the window's data has landed. The window is
+ * passed as its address, its offset into the buffer, and its length, which is
+ * only shorter than the window size for the last window. Returning a nonzero
+ * value stops the receive. #axidma_stripe_transfer invokes it the same way
+ * with each chunk of a striped transfer.
+ **/
+typedef int (*axidma_window_cb_t)(void *window, size_t offset, size_t length,
+                                  void *data);
+
+/**
+ * The struct representing a scatter-gather ring driven from userspace.
+ *
+ * This is an opaque type to the end user, so it can only be used as a pointer
+ * or handle.
+ **/
+struct axidma_ring;
+
+/**
+ * Type definition for a userspace scatter-gather ring.
+ **/
+typedef struct axidma_ring* axidma_ring_t;
+
+/**
+ * Structure representing a buffer that the ring's engine has finished with.
+ **/
+struct axidma_ring_completion {
+    int buffer_index;       ///< The index of the buffer in the ring.
+    size_t length;          ///< The number of bytes transferred.
+    bool error;             ///< The engine reported an error for the buffer.
+};
+
+/**
+ * The default time that #axidma_ring_wait polls a ring for, before it waits
+ * on the channel's interrupt, in microseconds.
+ **/
+#define AXIDMA_RING_DEFAULT_IDLE_BUDGET     200
+
+/**
+ * The struct representing a full-duplex offload pipeline.
+ *
+ * This is an opaque type to the end user, so it can only be used as a pointer
+ * or handle.
+ **/
+struct axidma_pipeline;
+
+/**
+ * Type definition for a full-duplex offload pipeline.
+ **/
+typedef struct axidma_pipeline* axidma_pipeline_t;
+
+/**
+ * Structure holding the occupancy of each stage of a pipeline.
+ *
+ * A block is being sent until its transmit completes, and is being processed
+ * from then until its receive completes. The averages are sampled each time
+ * a block is submitted.
+ **/
+struct axidma_pipeline_occupancy {
+    int free;               ///< Slots free to be filled with a block.
+    int sending;            ///< Blocks whose transmit has not completed.
+    int processing;         ///< Blocks sent, but not yet received back.
+    int received;           ///< Blocks received, but not yet released.
+    uint64_t blocks;        ///< The number of blocks released so far.
+    double avg_sending;     ///< The average number of blocks being sent.
+    double avg_processing;  ///< The average number of blocks being processed.
+};
+
+/**
+ * The struct representing a stream striped across several DMA channels.
+ *
+ * This is an opaque type to the end user, so it can only be used as a pointer
+ * or handle.
+ **/
+struct axidma_stripe;
+
+/**
+ * Type definition for a striped stream.
+ **/
+typedef struct axidma_stripe* axidma_stripe_t;
+
+/**
+ * Structure holding the throughput counters of a striped stream, or of one of
+ * its channels.
+ *
+ * The time of a channel is counted from the start of each transfer until the
+ * channel's last chunk completes, and the time of the stream until the whole
+ * transfer completes, so the throughput is the bytes over the time.
+ **/
+struct axidma_stripe_stats {
+    uint64_t bytes;         ///< The number of bytes transferred.
+    uint64_t time_ns;       ///< The time spent transferring them, in ns.
+};
+
 /**
  * Initializes an AXI DMA device, returning a handle to the device.
  *
@@ -125,7 +226,50 @@ const array_t *axidma_get_vdma_rx(axidma_dev_t dev);
 void *axidma_malloc(axidma_dev_t dev, size_t size);
 
 /**
- * Frees a DMA buffer previously allocated by #axidma_malloc.
+ * Allocates a DMA buffer of \p size bytes from one of the memory region pools.
+ *
+ * This is the same as #axidma_malloc, except that the buffer comes from the
+ * memory region that the pool is backed by, such as DDR attached to the
+ * programmable logic, or the on-chip memory. The pools are described by the
+ * device tree's `memory-region` phandles.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] size The size of the buffer in bytes.
+ * @param[in] pool The index of the pool, as returned by #axidma_find_pool.
+ * @return The address of buffer on success, NULL on failure.
+ **/
+void *axidma_malloc_pool(axidma_dev_t dev, size_t size, int pool);
+
+/**
+ * Finds the memory region pool with the given name.
+ *
+ * The names come from the device tree's `memory-region-names`, or are the
+ * names of the memory regions' nodes if there aren't any.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] name The name of the pool.
+ * @return The index of the pool on success, -ENOENT if there is no such pool.
+ **/
+int axidma_find_pool(axidma_dev_t dev, const char *name);
+
+/**
+ * Gets the description of a memory region pool, and how much of it is used.
+ *
+ * The usage covers the buffers allocated from the pool by all processes,
+ * along with the allocations that it couldn't fit.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] pool The index of the pool.
+ * @param[out] info The description and usage of the pool.
+ * @return 0 on success, -ENOENT if there is no such pool, or another negative
+ *         errno value on failure.
+ **/
+int axidma_get_pool_info(axidma_dev_t dev, int pool,
+        struct axidma_pool_info *info);
+
+/**
+ * Frees a DMA buffer previously allocated by #axidma_malloc or
+ * #axidma_malloc_pool.
  *
  * This function will abort if \p addr is not an address previously returned by
  * #axidma_malloc, or if \p size does not match the value used when the buffer
@@ -172,6 +316,20 @@ int axidma_register_buffer(axidma_dev_t dev, int dmabuf_fd, void *user_addr,
  **/
 void axidma_unregister_buffer(axidma_dev_t dev, void *user_addr);
 
+/**
+ * Gets the counts of the DMA buffers that the driver is keeping track of.
+ *
+ * The counts cover the buffers allocated with #axidma_malloc and registered
+ * with #axidma_register_buffer by all processes, so they can be sampled over
+ * a long run to look for buffers that are never given back.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[out] stats The counts of the buffers.
+ * @return 0 on success, a negative errno value on failure.
+ **/
+int axidma_get_buffer_stats(axidma_dev_t dev,
+        struct axidma_buffer_stats *stats);
+
 /**
  * Registers a user callback function to be invoked upon completion of an
  * asynchronous transfer for the specified DMA channel.
@@ -277,6 +435,36 @@ int axidma_twoway_transfer(axidma_dev_t dev, int tx_channel, void *tx_buf,
 int axidma_video_transfer(axidma_dev_t dev, int display_channel, size_t width,
         size_t height, size_t depth, void **frame_buffers, int num_buffers);
 
+/**
+ * Starts a video DMA (VDMA) loop/continuous transfer of a window of the given
+ * frame buffers.
+ *
+ * This behaves like #axidma_video_transfer, except that the frame is
+ * described by \p frame, which may place it anywhere within a larger frame
+ * buffer surface. The rows of the surface are \p frame->stride bytes apart,
+ * and the frame's top-left pixel is at (\p frame->x_offset,
+ * \p frame->y_offset). This allows for cropping a region out of a larger
+ * frame buffer, or writing into a padded or aligned surface, without copying
+ * on the processor. A stride of 0 indicates that the rows are packed.
+ *
+ * The VDMA engine may have alignment requirements for the stride and the
+ * start of each row, depending on how it was configured in the hardware.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] display_channel DMA channel the video transfer will take place
+ *                            on. This must be a VDMA channel.
+ * @param[in] frame The dimensions of the frame, and its window within each of
+ *                  the frame buffers.
+ * @param[in] frame_buffers A list of frame buffer addresses. Each must hold
+ *                          the frame surface up to the frame's last pixel.
+ * @param[in] num_buffers The number of buffers in \p frame_buffers. This must
+ *                        match the length of the list.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_video_transfer_frame(axidma_dev_t dev, int display_channel,
+        const struct axidma_video_frame *frame, void **frame_buffers,
+        int num_buffers);
+
 /**
  * Stops the DMA transfer on specified DMA channel.
  *
@@ -290,4 +478,566 @@ int axidma_video_transfer(axidma_dev_t dev, int display_channel, size_t width,
  **/
 void axidma_stop_transfer(axidma_dev_t dev, int channel);
 
+/**
+ * Gets the progress of the last transfer started on the specified DMA
+ * channel.
+ *
+ * This is for following a non-blocking transfer. The bytes transferred are
+ * counted as the DMA engine finishes each segment of the transfer, so the
+ * count lags behind the data, but never runs ahead of it. A transfer started
+ * by #axidma_oneway_transfer is a single segment, so nothing is counted until
+ * it completes. Once a receive has completed, the count is the bytes actually
+ * received, which is less than its length if the packet ended early.
+ *
+ * This function will abort if the channel is invalid.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel to get the progress of.
+ * @param[out] complete Set to true if the transfer has completed.
+ * @return The number of bytes transferred so far upon success, a negative
+ *         errno value on failure. This is -EIO if the transfer failed.
+ **/
+ssize_t axidma_transfer_progress(axidma_dev_t dev, int channel,
+        bool *complete);
+
+/**
+ * Gets the number of transfers completed on the specified DMA channel so far.
+ *
+ * Along with #axidma_received_length, this finds how many bytes each of
+ * several receives queued on a channel got. The count read before the first
+ * of them is queued is the number of the first one, and the rest are
+ * numbered on from it, in the order they were queued. A transfer that is
+ * stopped is never counted, so the numbering only holds while none are.
+ *
+ * This function will abort if the channel is invalid.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel to count the transfers of.
+ * @return The number of transfers completed upon success, a negative errno
+ *         value on failure.
+ **/
+int64_t axidma_transfers_completed(axidma_dev_t dev, int channel);
+
+/**
+ * Gets the number of bytes that a completed transfer on the specified DMA
+ * channel received.
+ *
+ * A receive ends early at the end of a packet, so it can get less than the
+ * length it was queued with. The driver keeps what is needed for the last
+ * #AXIDMA_PROGRESS_HISTORY transfers completed on each channel. If its DMA
+ * engine doesn't report a residue, the full length is given.
+ *
+ * This function will abort if the channel is invalid.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel that the transfer was on.
+ * @param[in] transfer The number of the transfer, counted as described for
+ *                     #axidma_transfers_completed.
+ * @param[in] length The length that the transfer was queued with.
+ * @return The number of bytes received upon success, a negative errno value
+ *         on failure. This is -EAGAIN if the transfer has not completed, and
+ *         -ENOENT if it completed too long ago for the driver to have kept it.
+ **/
+ssize_t axidma_received_length(axidma_dev_t dev, int channel,
+        uint64_t transfer, size_t length);
+
+/**
+ * Receives into a buffer on the specified DMA channel, processing it in
+ * windows while the rest of it is still arriving.
+ *
+ * The receive is started as a non-blocking transfer, split into a segment for
+ * each window, and its progress is polled. Each time a whole window has
+ * landed, \p callback is invoked with it, so that processing the start of a
+ * large receive overlaps with receiving its tail. The last window is handed
+ * on once the receive completes. If the callback returns nonzero, or the
+ * timeout expires, the receive is stopped.
+ *
+ * Each segment ends at the end of a packet, so this is only for streams that
+ * aren't split into packets, or whose packets fill the buffer. A packet that
+ * ends early leaves the rest of its segment unfilled, and the next packet
+ * goes into the next segment.
+ *
+ * The addresses \p buf and \p buf+\p len must be within a buffer that was
+ * previously allocated by #axidma_malloc or registered with
+ * #axidma_register_buffer. This function will abort if the channel is invalid.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA receive channel to use.
+ * @param[in] buf Address of the DMA buffer to receive into.
+ * @param[in] len Number of bytes to receive.
+ * @param[in] window_size The size of the windows to process, in bytes.
+ * @param[in] callback The function to process each window with.
+ * @param[in] data Generic user data that is passed to the callback function.
+ * @param[in] timeout The time to wait for the receive in milliseconds, or a
+ *                    negative value to wait forever.
+ * @return 0 upon success, the callback's value if it stopped the receive,
+ *         or a negative errno value on failure. This is -ETIMEDOUT if the
+ *         receive did not complete in time.
+ **/
+int axidma_windowed_read(axidma_dev_t dev, int channel, void *buf, size_t len,
+        size_t window_size, axidma_window_cb_t callback, void *data,
+        int timeout);
+
+/**
+ * Sets the run-time parameters of the specified VDMA channel.
+ *
+ * This controls parking, genlock synchronization, frame delay and interrupt
+ * coalescing for the channel. The parameters take effect immediately, and are
+ * kept by the driver for all later transfers on the channel. The channel id
+ * field of \p config is ignored, \p channel is used instead.
+ *
+ * The park and genlock settings only apply to single frame transfers. A video
+ * transfer always parks the channel on the frame it is working on, so
+ * #axidma_video_transfer fails on a channel that is configured for genlock.
+ *
+ * This function will abort if the channel is invalid or is not a VDMA channel.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel VDMA channel to configure.
+ * @param[in] config The VDMA parameters for the channel.
+ * @return 0 upon success, a negative number on failure (e.g. if any of the
+ *         parameters are out of range).
+ **/
+int axidma_set_vdma_config(axidma_dev_t dev, int channel,
+        const struct axidma_vdma_config *config);
+
+/**
+ * Gets the current run-time parameters of the specified VDMA channel.
+ *
+ * This function will abort if the channel is invalid or is not a VDMA channel.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel VDMA channel to query.
+ * @param[out] config Filled with the channel's VDMA parameters.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_get_vdma_config(axidma_dev_t dev, int channel,
+        struct axidma_vdma_config *config);
+
+/**
+ * Takes the next completed frame from a running video transfer.
+ *
+ * The frame buffer at \p event->buffer_index is held by the caller, and the
+ * VDMA engine will not touch it, until it is given back with
+ * #axidma_video_put_frame. Each frame is stamped with a sequence number, so
+ * gaps in it show dropped frames, and the time it completed in nanoseconds
+ * from CLOCK_MONOTONIC.
+ *
+ * By default, frames are taken in the order they completed. If \p latest is
+ * set, the newest completed frame is taken instead, and older ones are
+ * dropped, which gives the lowest latency.
+ *
+ * This function will abort if the channel is invalid or is not a VDMA channel.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel VDMA channel the video transfer is running on.
+ * @param[in] timeout The time to wait for a frame in milliseconds. A negative
+ *                    value waits forever, and 0 does not wait at all.
+ * @param[in] latest Indicates that the newest frame should be taken.
+ * @param[out] event Filled with the frame buffer index, sequence number, and
+ *                   timestamp of the frame.
+ * @return 0 upon success, or a negative errno value on failure. This is
+ *         -ETIMEDOUT if the timeout expired, -EAGAIN if \p timeout was 0 and
+ *         no frame was ready, and -ENODATA if no video transfer is running.
+ **/
+int axidma_video_get_frame(axidma_dev_t dev, int channel, int timeout,
+        bool latest, struct axidma_frame_event *event);
+
+/**
+ * Gives a frame buffer taken with #axidma_video_get_frame back to the running
+ * video transfer, so that the VDMA engine can use it again.
+ *
+ * This function will abort if the channel is invalid or is not a VDMA channel.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel VDMA channel the video transfer is running on.
+ * @param[in] buffer_index The index of the frame buffer to give back.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_video_put_frame(axidma_dev_t dev, int channel, int buffer_index);
+
+/**
+ * Gets the frame statistics for the video transfer on the specified channel.
+ *
+ * This function will abort if the channel is invalid or is not a VDMA channel.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel VDMA channel to query.
+ * @param[out] stats Filled with the counts of completed, dropped, and starved
+ *                   frames for the transfer.
+ * @return 0 upon success, a negative number on failure.
+ **/
+int axidma_video_get_stats(axidma_dev_t dev, int channel,
+        struct axidma_video_stats *stats);
+
+/**
+ * Attaches a scatter-gather ring to the specified DMA channel, so that the
+ * channel is driven from userspace by polling.
+ *
+ * The channel is taken from the kernel's DMA engine, and the ring's buffers
+ * are allocated by the driver. Buffers are then posted to the engine with
+ * #axidma_ring_post, and taken back with #axidma_ring_reap, neither of which
+ * makes a system call or waits for an interrupt. This is only available for
+ * channels of an AXI DMA core built with scatter-gather. The ring takes the
+ * whole core, so this fails with EBUSY while the core's other channel is in
+ * use, and neither channel can be used for regular transfers until the ring
+ * is detached.
+ *
+ * A ring must only be used from one thread at a time.
+ *
+ * This function will abort if the channel is invalid or is not a DMA channel.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channel DMA channel to attach the ring to.
+ * @param[in] num_buffers The number of buffers, and descriptors, in the ring.
+ * @param[in] buffer_size The size of each buffer in bytes.
+ * @return A handle to the ring on success, NULL on failure.
+ **/
+axidma_ring_t axidma_ring_attach(axidma_dev_t dev, int channel,
+        int num_buffers, size_t buffer_size);
+
+/**
+ * Creates a scatter-gather ring over registers and memory supplied by the
+ * caller, rather than the driver.
+ *
+ * This is what #axidma_ring_attach uses once the channel is mapped, and it
+ * lets the ring be driven against a model of the AXI DMA registers and
+ * descriptors, for testing without the hardware. The memory must hold the
+ * descriptors followed by the buffers, in the layout described for
+ * #axidma_ring_info, with each buffer's size rounded up to
+ * AXIDMA_RING_DESC_SIZE. The channel is started by the call.
+ *
+ * @param[in] regs The channel's registers (i.e. its DMACR register).
+ * @param[in] mem The ring's memory, aligned to AXIDMA_RING_DESC_SIZE.
+ * @param[in] dma_addr The bus address of the ring's memory.
+ * @param[in] dir The direction of the channel.
+ * @param[in] num_buffers The number of buffers, and descriptors, in the ring.
+ * @param[in] buffer_size The size of each buffer in bytes.
+ * @return A handle to the ring on success, NULL on failure.
+ **/
+axidma_ring_t axidma_ring_create(volatile uint32_t *regs, void *mem,
+        uint64_t dma_addr, enum axidma_dir dir, int num_buffers,
+        size_t buffer_size);
+
+/**
+ * Stops the ring's channel and frees the ring.
+ *
+ * If the ring was attached with #axidma_ring_attach, it is unmapped and the
+ * channel is given back to the kernel's DMA engine. Any buffers still posted
+ * are abandoned.
+ *
+ * @param[in] ring An #axidma_ring_t returned by #axidma_ring_attach or
+ *                 #axidma_ring_create.
+ **/
+void axidma_ring_detach(axidma_ring_t ring);
+
+/**
+ * Gets the address of the specified buffer in the ring.
+ *
+ * @param[in] ring An #axidma_ring_t returned by #axidma_ring_attach.
+ * @param[in] buffer_index The index of the buffer.
+ * @return The address of the buffer, which is #axidma_ring_buffer_size bytes.
+ **/
+void *axidma_ring_buffer(axidma_ring_t ring, int buffer_index);
+
+/**
+ * Gets the size of each buffer in the ring, in bytes.
+ *
+ * @param[in] ring An #axidma_ring_t returned by #axidma_ring_attach.
+ * @return The size of the ring's buffers.
+ **/
+size_t axidma_ring_buffer_size(axidma_ring_t ring);
+
+/**
+ * Posts a buffer to the ring's engine.
+ *
+ * For a transmit channel, the first \p length bytes of the buffer are sent as
+ * one packet. For a receive channel, the engine fills up to \p length bytes
+ * of the buffer with the next packet. Buffers complete in the order they were
+ * posted.
+ *
+ * @param[in] ring An #axidma_ring_t returned by #axidma_ring_attach.
+ * @param[in] buffer_index The index of the buffer to post.
+ * @param[in] length The number of bytes to send or receive.
+ * @return 0 upon success, or a negative errno value on failure. This is
+ *         -ENOSPC if every descriptor in the ring is already posted.
+ **/
+int axidma_ring_post(axidma_ring_t ring, int buffer_index, size_t length);
+
+/**
+ * Takes the oldest posted buffer back from the ring's engine, if the engine
+ * has finished with it.
+ *
+ * This only reads the descriptor from memory, so it is cheap to call in a
+ * busy loop.
+ *
+ * @param[in] ring An #axidma_ring_t returned by #axidma_ring_attach.
+ * @param[out] done Filled with the buffer's index, the number of bytes
+ *                  transferred, and if the engine reported an error.
+ * @return 1 if a buffer was taken back, 0 if none has completed yet.
+ **/
+int axidma_ring_reap(axidma_ring_t ring, struct axidma_ring_completion *done);
+
+/**
+ * Gets the number of buffers posted to the ring's engine, and not yet reaped.
+ *
+ * @param[in] ring An #axidma_ring_t returned by #axidma_ring_attach.
+ * @return The number of buffers held by the engine.
+ **/
+int axidma_ring_pending(axidma_ring_t ring);
+
+/**
+ * Checks if the ring's engine has stopped on an error.
+ *
+ * When the engine hits an error, it halts, and no more buffers complete. The
+ * ring then has to be detached and attached again.
+ *
+ * @param[in] ring An #axidma_ring_t returned by #axidma_ring_attach.
+ * @return 0 if the engine is running, -EIO if it has halted on an error.
+ **/
+int axidma_ring_status(axidma_ring_t ring);
+
+/**
+ * Sets how long #axidma_ring_wait polls the ring for before it waits on the
+ * channel's interrupt.
+ *
+ * A longer budget keeps the ring polled through short gaps in the traffic, at
+ * the cost of the CPU spent polling when the traffic stops. A budget of 0
+ * waits on the interrupt as soon as the oldest buffer is found incomplete.
+ *
+ * @param[in] ring An #axidma_ring_t returned by #axidma_ring_attach.
+ * @param[in] budget The time to poll for, in microseconds. This is
+ *                   #AXIDMA_RING_DEFAULT_IDLE_BUDGET by default.
+ **/
+void axidma_ring_set_idle_budget(axidma_ring_t ring, int budget);
+
+/**
+ * Waits for the oldest posted buffer in the ring to complete, so that it can
+ * be taken back with #axidma_ring_reap.
+ *
+ * The ring is polled while buffers keep completing, which has the lowest
+ * latency. Once it has been polled for the idle budget with nothing
+ * completing, the thread sleeps on the channel's interrupt instead, which
+ * frees the CPU, and polling starts again when the interrupt arrives. Rings
+ * made with #axidma_ring_create, and channels without an interrupt, are only
+ * ever polled.
+ *
+ * @param[in] ring An #axidma_ring_t returned by #axidma_ring_attach.
+ * @param[in] timeout The time to wait in milliseconds. A negative value waits
+ *                    forever, and 0 does not wait at all.
+ * @return 1 if the oldest buffer has completed, 0 if it did not before the
+ *         timeout or if no buffers are posted, or a negative errno value on
+ *         failure. This is -EINTR if the wait was interrupted by a signal.
+ **/
+int axidma_ring_wait(axidma_ring_t ring, int timeout);
+
+/**
+ * Gets the counters of how the ring's completions were waited for: the
+ * number of switches between polling and waiting on the interrupt, and the
+ * time spent in each.
+ *
+ * @param[in] ring An #axidma_ring_t returned by #axidma_ring_attach.
+ * @param[out] stats Filled with the ring's counters.
+ * @return 0 upon success, a negative errno value on failure. This is -ENODEV
+ *         for rings made with #axidma_ring_create.
+ **/
+int axidma_ring_get_stats(axidma_ring_t ring, struct axidma_ring_stats *stats);
+
+/**
+ * Gets the number of bytes that have landed in the ring's posted buffers, and
+ * are ready to be reaped.
+ *
+ * The engine writes the length of each completed buffer into its descriptor,
+ * in the ring's shared memory, so this makes no system call. When a packet
+ * spans several buffers, this is how much of it has arrived so far.
+ *
+ * @param[in] ring An #axidma_ring_t returned by #axidma_ring_attach.
+ * @return The bytes in the completed buffers that have not been reaped.
+ **/
+size_t axidma_ring_progress(axidma_ring_t ring);
+
+/**
+ * Creates a pipeline that keeps several blocks in flight through an
+ * accelerator, fed by a transmit channel and drained by a receive channel.
+ *
+ * The pipeline has \p depth slots, each with a transmit and a receive buffer
+ * allocated with #axidma_malloc. While one block is being received, the next
+ * can be processed by the accelerator, and the one after that sent to it, so
+ * both channels stay busy. The accelerator must produce exactly one receive
+ * for each block sent to it, so that blocks come back in the order they were
+ * submitted.
+ *
+ * The pipeline counts completions with the callbacks of both channels, so it
+ * replaces any callback registered with #axidma_set_callback for them, until
+ * it is destroyed. This function will abort if either channel is invalid.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] tx_channel DMA channel that sends blocks to the accelerator.
+ * @param[in] rx_channel DMA channel that receives the results.
+ * @param[in] depth The number of blocks that can be in the pipeline at once,
+ *                  at most #AXIDMA_MAX_QUEUED.
+ * @param[in] tx_block_size The size of each transmit buffer, in bytes.
+ * @param[in] rx_block_size The size of each receive buffer, in bytes. This is
+ *                          the length of each receive.
+ * @return A handle to the pipeline on success, NULL on failure. errno is
+ *         EINVAL if \p depth is more than the driver can queue on a channel.
+ **/
+axidma_pipeline_t axidma_pipeline_create(axidma_dev_t dev, int tx_channel,
+        int rx_channel, int depth, size_t tx_block_size, size_t rx_block_size);
+
+/**
+ * Stops the pipeline's transfers that are still in flight, frees its buffers,
+ * and removes its callbacks from the channels.
+ *
+ * @param[in] pipe An #axidma_pipeline_t returned by #axidma_pipeline_create.
+ **/
+void axidma_pipeline_destroy(axidma_pipeline_t pipe);
+
+/**
+ * Gets the transmit buffer of the next free slot, to fill with a block.
+ *
+ * @param[in] pipe An #axidma_pipeline_t returned by #axidma_pipeline_create.
+ * @return The slot's transmit buffer, or NULL if every slot is in use.
+ **/
+void *axidma_pipeline_input(axidma_pipeline_t pipe);
+
+/**
+ * Submits the block in the buffer returned by #axidma_pipeline_input.
+ *
+ * The receive for the block is queued before its transmit, so the channel is
+ * ready for the result by the time the accelerator produces it. Neither
+ * transfer is waited for.
+ *
+ * @param[in] pipe An #axidma_pipeline_t returned by #axidma_pipeline_create.
+ * @param[in] tx_len The number of bytes in the block.
+ * @return 0 upon success, a negative errno value on failure. This is -ENOSPC
+ *         if every slot is in use. If the transmit fails after its receive was
+ *         queued, the pipeline should be destroyed.
+ **/
+int axidma_pipeline_submit(axidma_pipeline_t pipe, size_t tx_len);
+
+/**
+ * Waits for the oldest block in the pipeline to be received back.
+ *
+ * The block stays in its slot until it is released with
+ * #axidma_pipeline_release, so the result can be used in place.
+ *
+ * @param[in] pipe An #axidma_pipeline_t returned by #axidma_pipeline_create.
+ * @param[in] timeout The time to wait in milliseconds. A negative value waits
+ *                    forever, and 0 does not wait at all.
+ * @return The receive buffer holding the result, or NULL with errno set to
+ *         ETIMEDOUT if it did not arrive in time, or to ENODATA if no blocks
+ *         are in the pipeline.
+ **/
+void *axidma_pipeline_output(axidma_pipeline_t pipe, int timeout);
+
+/**
+ * Releases the oldest block, returned by #axidma_pipeline_output, freeing its
+ * slot for another block.
+ *
+ * @param[in] pipe An #axidma_pipeline_t returned by #axidma_pipeline_create.
+ **/
+void axidma_pipeline_release(axidma_pipeline_t pipe);
+
+/**
+ * Gets the number of blocks in each stage of the pipeline.
+ *
+ * @param[in] pipe An #axidma_pipeline_t returned by #axidma_pipeline_create.
+ * @param[out] occupancy Filled with the occupancy of each stage.
+ **/
+void axidma_pipeline_get_occupancy(axidma_pipeline_t pipe,
+        struct axidma_pipeline_occupancy *occupancy);
+
+/**
+ * Creates a stream that is striped across several DMA channels, so that its
+ * throughput is not limited by a single DMA core.
+ *
+ * Each transfer on the stream is split into chunks, which are handed out to
+ * the channels in turn: chunk i goes over channel i modulo the width. The
+ * channels must all have the same direction, and for a receive, the fabric
+ * must deal the chunks out to them in the same order.
+ *
+ * The stream counts completions with the callbacks of its channels, so it
+ * replaces any callback registered with #axidma_set_callback for them, until
+ * it is destroyed. This function will abort if any channel is invalid.
+ *
+ * @param[in] dev An #axidma_dev_t returned by #axidma_init.
+ * @param[in] channels The DMA channels to stripe the stream across.
+ * @param[in] width The number of channels.
+ * @param[in] chunk_size The size of each chunk, in bytes.
+ * @return A handle to the stream on success, NULL on failure.
+ **/
+axidma_stripe_t axidma_stripe_create(axidma_dev_t dev, const int *channels,
+        int width, size_t chunk_size);
+
+/**
+ * Removes the stream's callbacks from its channels, and frees it.
+ *
+ * @param[in] stripe An #axidma_stripe_t returned by #axidma_stripe_create.
+ **/
+void axidma_stripe_destroy(axidma_stripe_t stripe);
+
+/**
+ * Transfers a buffer over the striped stream, with its chunks in flight on
+ * all of the channels at once.
+ *
+ * If \p callback is not NULL, it is invoked with each chunk, in order, once
+ * the chunk and all of the chunks before it have been transferred. For a
+ * receive, this hands the stream on reassembled while the rest of the buffer
+ * is still arriving. A continuous stream is transferred by calling this for
+ * each buffer of it.
+ *
+ * The addresses \p buf and \p buf+\p len must be within a buffer that was
+ * previously allocated by #axidma_malloc or registered with
+ * #axidma_register_buffer.
+ *
+ * @param[in] stripe An #axidma_stripe_t returned by #axidma_stripe_create.
+ * @param[in] buf Address of the DMA buffer to transfer.
+ * @param[in] len Number of bytes to transfer.
+ * @param[in] callback The function to hand each chunk to, or NULL.
+ * @param[in] data Generic user data that is passed to the callback function.
+ * @param[in] timeout The time to wait for the transfer in milliseconds, or a
+ *                    negative value to wait forever.
+ * @return 0 upon success, the callback's value if it stopped the transfer,
+ *         or a negative errno value on failure. This is -ETIMEDOUT if the
+ *         transfer did not complete in time.
+ **/
+int axidma_stripe_transfer(axidma_stripe_t stripe, void *buf, size_t len,
+        axidma_window_cb_t callback, void *data, int timeout);
+
+/**
+ * Sends a buffer over one striped stream while receiving into another buffer
+ * over a second stream, both striped across their channels at once.
+ *
+ * The receive chunks are queued before the transmit chunks, so the channels
+ * are ready for the data by the time it comes back.
+ *
+ * @param[in] tx_stripe The #axidma_stripe_t to send over.
+ * @param[in] tx_buf Address of the DMA buffer to send.
+ * @param[in] tx_len Number of bytes to send.
+ * @param[in] rx_stripe The #axidma_stripe_t to receive over.
+ * @param[in] rx_buf Address of the DMA buffer to receive into.
+ * @param[in] rx_len Number of bytes to receive.
+ * @param[in] timeout The time to wait for both transfers in milliseconds, or
+ *                    a negative value to wait forever.
+ * @return 0 upon success, a negative errno value on failure. This is
+ *         -ETIMEDOUT if the transfers did not complete in time.
+ **/
+int axidma_stripe_twoway(axidma_stripe_t tx_stripe, void *tx_buf,
+        size_t tx_len, axidma_stripe_t rx_stripe, void *rx_buf, size_t rx_len,
+        int timeout);
+
+/**
+ * Gets the throughput counters of the striped stream, and of each of its
+ * channels.
+ *
+ * @param[in] stripe An #axidma_stripe_t returned by #axidma_stripe_create.
+ * @param[out] channel_stats An array with an entry for each channel, filled
+ *                           in the order the channels were given, or NULL.
+ * @param[out] total Filled with the counters of the whole stream.
+ **/
+void axidma_stripe_get_stats(axidma_stripe_t stripe,
+        struct axidma_stripe_stats *channel_stats,
+        struct axidma_stripe_stats *total);
+
 #endif /* LIBAXIDMA_H_ */